@@ -0,0 +1,397 @@
+/** @file Benchmarks.cpp
+ * @brief Benchmarks of reading steps and colouring/rendering the grid, on synthetic output written before the run.
+ *
+ * Every result is printed as one JSON object per line (JSON Lines), so runs before and after a change
+ * can be compared by scripts. Example:
+ *      QtVtkViewerBenchmarks --rows=4096 --columns=4096 --nodesX=4 --nodesY=4 --steps=20 --output=results.jsonl */
+
+#include <algorithm> // std::ranges::minmax
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric> // std::accumulate, std::iota
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QCoreApplication>
+#include <argparse/argparse.hpp>
+#include <vtkActor.h>
+#include <vtkSmartPointer.h>
+
+#include "SyntheticOutput.h"
+#include "examples/custom_model_plugin/CustomCell.h"
+#include "utilities/AllocationCounter.h"
+#include "utilities/Matrix2D.h"
+#include "utilities/ModelReader.hpp"
+#include "utilities/OutputContainer.h"
+#include "utilities/StageProfiler.h"
+#include "visualiser/CellColors.h"
+#include "visualiser/OffscreenScene.h"
+#include "visualiser/SettingParameter.h"
+#include "visualiser/StepFrame.h"
+#include "visualiser/Visualizer.hpp"
+
+
+namespace
+{
+using BenchmarkCell = CustomCell;
+
+/// @brief Options of the whole run
+struct BenchmarkOptions
+{
+    SyntheticOutputOptions output;
+    unsigned repetitions = 5;
+    std::filesystem::path workDirectory;
+    bool skipRender = false;
+    bool keepData = false;
+    int imageSize = 1024; ///< Width and height of offscreen frames
+};
+
+/// @brief Writes results as JSON Lines
+class BenchmarkReport
+{
+public:
+    BenchmarkReport(std::ostream& output, const BenchmarkOptions& options)
+        : output{ output }
+        , options{ options }
+    {
+    }
+
+    /** @brief Runs body the given number of times and writes one line with statistics of the durations.
+     *  @param items Items processed by one run (e.g. cells), reported as throughput
+     *  @param beforeEach Called before every run, not measured (e.g. to drop caches of the previous run) */
+    void measure(const std::string& benchmark,
+                 const std::string& mode,
+                 std::uint64_t items,
+                 const std::function<void()>& body,
+                 const std::function<void()>& beforeEach = {})
+    {
+        std::vector<double> milliseconds;
+        for (unsigned repetition = 0; repetition < options.repetitions; ++repetition)
+        {
+            if (beforeEach)
+                beforeEach();
+
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        const auto [minimum, maximum] = std::ranges::minmax(milliseconds);
+        const double mean = std::accumulate(milliseconds.begin(), milliseconds.end(), 0.0) / static_cast<double>(milliseconds.size());
+        output << std::format(R"({{"benchmark":"{}","mode":"{}","rows":{},"columns":{},"nodes":{},"steps":{},"repetitions":{},)"
+                              R"("mean_ms":{:.4f},"min_ms":{:.4f},"max_ms":{:.4f},"items":{},"items_per_second":{:.1f}}})",
+                              benchmark,
+                              mode,
+                              options.output.rows,
+                              options.output.columns,
+                              options.output.nodesX * options.output.nodesY,
+                              options.output.steps,
+                              milliseconds.size(),
+                              mean,
+                              minimum,
+                              maximum,
+                              items,
+                              mean > 0 ? static_cast<double>(items) * 1000.0 / mean : 0.0)
+               << std::endl;
+    }
+
+    /// @brief Writes one line with a counted quantity (e.g. heap allocations per step) instead of durations
+    void count(const std::string& benchmark, const std::string& mode, const std::string& counter, double value)
+    {
+        output << std::format(R"({{"benchmark":"{}","mode":"{}","rows":{},"columns":{},"nodes":{},"steps":{},"{}":{:.2f}}})",
+                              benchmark,
+                              mode,
+                              options.output.rows,
+                              options.output.columns,
+                              options.output.nodesX * options.output.nodesY,
+                              options.output.steps,
+                              counter,
+                              value)
+               << std::endl;
+    }
+
+private:
+    std::ostream& output;
+    const BenchmarkOptions& options;
+};
+
+/// @brief Settings of the stage as readSettingParameterFromConfigFile() would have them for the synthetic output
+SettingParameter settingsFor(const SyntheticOutputOptions& output, const std::string& outputFileName, const std::string& readMode)
+{
+    SettingParameter sp{};
+    sp.numberOfColumnX = output.columns;
+    sp.numberOfRowsY = output.rows;
+    sp.nsteps = static_cast<int>(output.steps);
+    sp.nNodeX = output.nodesX;
+    sp.nNodeY = output.nodesY;
+    sp.numberOfLines = static_cast<int>(2 * (output.nodesX * output.nodesY) + output.nodesX + output.nodesY);
+    sp.outputFileName = outputFileName;
+    sp.readMode = readMode;
+    return sp;
+}
+
+void removeIndexCaches(const SyntheticOutputOptions& output, const std::string& outputFileName)
+{
+    for (NodeIndex node = 0; node < output.nodesX * output.nodesY; ++node)
+    {
+        std::error_code error;
+        std::filesystem::remove(NodeStepOffsets::cacheFileName(ReaderHelpers::giveMeFileNameIndex(outputFileName, node)), error);
+    }
+}
+
+/// @brief Index loading (text parsing and binary sidecar) and reading of all steps in the given mode
+void benchmarkReading(BenchmarkReport& report, const BenchmarkOptions& options, const std::string& outputFileName, const std::string& readMode)
+{
+    const auto& output = options.output;
+    auto sp = settingsFor(output, outputFileName, readMode);
+    ModelReader<BenchmarkCell> reader;
+
+    if ("container" != readMode)
+    {
+        report.measure("readStepsOffsetsForAllNodesFromFiles", readMode + "_index", output.nodesX * output.nodesY, [&]
+        {
+            reader.readStepsOffsetsForAllNodesFromFiles(sp.nNodeX, sp.nNodeY, sp.outputFileName, sp.readMode);
+        },
+        [&]
+        {
+            removeIndexCaches(output, outputFileName);
+        });
+    }
+    report.measure("readStepsOffsetsForAllNodesFromFiles", readMode + "_cached", output.nodesX * output.nodesY, [&]
+    {
+        reader.readStepsOffsetsForAllNodesFromFiles(sp.nNodeX, sp.nNodeY, sp.outputFileName, sp.readMode);
+    });
+
+    Matrix2D<BenchmarkCell> cells;
+    cells.resize(output.rows, output.columns);
+    std::vector<Line> lines(sp.numberOfLines);
+    const auto cellsOfAllSteps = static_cast<std::uint64_t>(output.rows) * output.columns * output.steps;
+    report.measure("readStageStateFromFilesForStep", readMode, cellsOfAllSteps, [&]
+    {
+        for (StepIndex step = 0; step < output.steps; ++step)
+        {
+            sp.step = step;
+            reader.readStageStateFromFilesForStep(cells, &sp, lines.data());
+        }
+    });
+
+    // steady state: buffers were grown by the runs above, so reading a step should not allocate at all
+    if (output.steps > 1)
+    {
+        auto& profiler = StageProfiler::instance();
+        profiler.setEnabled(true);
+        std::uint64_t callingThreadAllocations = 0;
+        std::uint64_t nodeAllocations = 0;
+        for (StepIndex step = 1; step < output.steps; ++step)
+        {
+            sp.step = step;
+            const auto allocationsBefore = AllocationCounter::threadAllocations();
+            reader.readStageStateFromFilesForStep(cells, &sp, lines.data());
+            callingThreadAllocations += AllocationCounter::threadAllocations() - allocationsBefore;
+
+            profiler.finishFrame();
+            for (const auto& total : profiler.lastFrame().stages)
+            {
+                if (std::string_view(total.stage) == ProfiledStage::ReadNode)
+                    nodeAllocations += total.allocations;
+            }
+        }
+        profiler.setEnabled(false);
+
+        const auto steps = static_cast<double>(output.steps - 1);
+        report.count("readStageStateFromFilesForStep_allocations", readMode + "_calling_thread", "allocations_per_step", static_cast<double>(callingThreadAllocations) / steps);
+        report.count("readStageStateFromFilesForStep_allocations", readMode + "_nodes", "allocations_per_step", static_cast<double>(nodeAllocations) / steps);
+    }
+
+    // a window of 3x3 cells in the middle of the grid over all steps, as probed with a double-click
+    // (the first run finds the rows of text files, the following ones seek to them)
+    std::vector<StepIndex> allSteps(output.steps);
+    std::iota(allSteps.begin(), allSteps.end(), StepIndex{ 0 });
+    const CellRegion probedWindow{ .firstRow = output.rows / 2 - 1, .firstColumn = output.columns / 2 - 1, .rows = 3, .columns = 3 };
+    report.measure("readCellsOfSteps", readMode, 9 * allSteps.size(), [&]
+    {
+        reader.readCellsOfSteps(sp, probedWindow, allSteps);
+    });
+}
+
+/// @brief Colouring of the cells (Visualizer::buidColor() through refreshWindowsVTK()) and showing precomputed colours
+void benchmarkColors(BenchmarkReport& report, const BenchmarkOptions& options, const std::string& outputFileName)
+{
+    const auto& output = options.output;
+    auto sp = settingsFor(output, outputFileName, "text");
+    ModelReader<BenchmarkCell> reader;
+    reader.readStepsOffsetsForAllNodesFromFiles(sp.nNodeX, sp.nNodeY, sp.outputFileName, sp.readMode);
+
+    Matrix2D<BenchmarkCell> cells;
+    cells.resize(output.rows, output.columns);
+    std::vector<Line> lines(sp.numberOfLines);
+    reader.readStageStateFromFilesForStep(cells, &sp, lines.data());
+
+    const auto cellsCount = static_cast<std::uint64_t>(output.rows) * output.columns;
+    Visualizer visualizer;
+    auto gridActor = vtkSmartPointer<vtkActor>::New();
+    report.measure("Visualizer::refreshWindowsVTK", "cells", cellsCount, [&]
+    {
+        visualizer.refreshWindowsVTK(cells, output.rows, output.columns, gridActor);
+    });
+
+    auto colors = std::make_shared<std::vector<unsigned char>>(cellsCount * 3);
+    report.measure("writeCellColors", "cells", cellsCount, [&]
+    {
+        writeCellColors(cells, output.rows, output.columns, colors->data());
+    });
+
+    // two buffers shown alternately, as decoded steps are: otherwise the unchanged buffer is not uploaded again
+    std::shared_ptr<const std::vector<unsigned char>> shownColors[2] = { colors, std::make_shared<std::vector<unsigned char>>(*colors) };
+    std::size_t shown = 0;
+    report.measure("Visualizer::refreshWindowsVTK", "shared_colors", cellsCount, [&]
+    {
+        visualizer.refreshWindowsVTK(shownColors[shown++ % 2], output.rows, output.columns, gridActor);
+    });
+}
+
+/// @brief Rendering of frames into an offscreen window and capturing them (what headless rendering and video export do)
+void benchmarkOffscreenRender(BenchmarkReport& report, const BenchmarkOptions& options, const std::string& outputFileName)
+{
+    const auto& output = options.output;
+    auto sp = settingsFor(output, outputFileName, "text");
+    ModelReader<BenchmarkCell> reader;
+    reader.readStepsOffsetsForAllNodesFromFiles(sp.nNodeX, sp.nNodeY, sp.outputFileName, sp.readMode);
+
+    Matrix2D<BenchmarkCell> cells;
+    cells.resize(output.rows, output.columns);
+    StepFrame frames[2];
+    for (StepIndex step = 0; step < 2; ++step)
+    {
+        auto& frame = frames[step];
+        frame.step = sp.step = std::min<StepIndex>(step, output.steps - 1);
+        frame.rows = output.rows;
+        frame.columns = output.columns;
+        frame.lines.resize(sp.numberOfLines);
+        reader.readStageStateFromFilesForStep(cells, &sp, frame.lines.data());
+
+        auto colors = std::make_shared<std::vector<unsigned char>>(static_cast<std::size_t>(output.rows) * output.columns * 3);
+        writeCellColors(cells, output.rows, output.columns, colors->data());
+        frame.colors = std::move(colors);
+    }
+
+    OffscreenScene scene(options.imageSize, options.imageSize);
+    scene.render(frames[0]); // creates the OpenGL context and the scene
+    std::size_t rendered = 0;
+    report.measure("OffscreenScene::render", std::format("{}x{}", options.imageSize, options.imageSize), 1, [&]
+    {
+        scene.render(frames[++rendered % 2]);
+    });
+}
+
+bool parseOptions(int argc, char* argv[], BenchmarkOptions& options, std::string& outputPath)
+{
+    argparse::ArgumentParser program("QtVtkViewerBenchmarks");
+    program.add_description("Benchmarks of reading and rendering steps, on synthetic output generated in the work directory");
+    program.add_argument("--rows").help("Rows of the grid").default_value(options.output.rows).scan<'i', int>();
+    program.add_argument("--columns").help("Columns of the grid").default_value(options.output.columns).scan<'i', int>();
+    program.add_argument("--nodesX").help("Nodes along the X axis").default_value(static_cast<int>(options.output.nodesX)).scan<'i', int>();
+    program.add_argument("--nodesY").help("Nodes along the Y axis").default_value(static_cast<int>(options.output.nodesY)).scan<'i', int>();
+    program.add_argument("--steps").help("Steps of the synthetic output").default_value(static_cast<int>(options.output.steps)).scan<'i', int>();
+    program.add_argument("--repetitions").help("Measured runs of every benchmark").default_value(static_cast<int>(options.repetitions)).scan<'i', int>();
+    program.add_argument("--imageSize").help("Width and height of offscreen frames").default_value(options.imageSize).scan<'i', int>();
+    program.add_argument("--workDirectory").help("Directory for the synthetic output").default_value((std::filesystem::temp_directory_path() / "QtVtkViewerBenchmarks").string());
+    program.add_argument("--output").help("File for results (JSON Lines), standard output by default");
+    program.add_argument("--skipRender").help("Skip the offscreen rendering benchmark (e.g. no OpenGL available)").flag();
+    program.add_argument("--keepData").help("Keep the synthetic output after the run").flag();
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << err.what() << std::endl << program << std::endl;
+        return false;
+    }
+
+    options.output.rows = program.get<int>("--rows");
+    options.output.columns = program.get<int>("--columns");
+    options.output.nodesX = static_cast<NodeIndex>(std::max(1, program.get<int>("--nodesX")));
+    options.output.nodesY = static_cast<NodeIndex>(std::max(1, program.get<int>("--nodesY")));
+    options.output.steps = static_cast<StepIndex>(std::max(1, program.get<int>("--steps")));
+    options.repetitions = static_cast<unsigned>(std::max(1, program.get<int>("--repetitions")));
+    options.imageSize = std::max(16, program.get<int>("--imageSize"));
+    options.workDirectory = program.get<std::string>("--workDirectory");
+    options.skipRender = program.is_used("--skipRender");
+    options.keepData = program.is_used("--keepData");
+    if (auto path = program.present<std::string>("--output"))
+        outputPath = *path;
+    return true;
+}
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv); // colour settings of the offscreen scene
+    QCoreApplication::setApplicationName("Visualiser");
+
+    BenchmarkOptions options;
+    std::string outputPath;
+    if (! parseOptions(argc, argv, options, outputPath))
+        return 1;
+
+    std::ofstream outputFile;
+    if (! outputPath.empty())
+    {
+        outputFile.open(outputPath, std::ios::trunc);
+        if (! outputFile)
+        {
+            std::cerr << "Error: can't write results to '" << outputPath << "'" << std::endl;
+            return 1;
+        }
+    }
+    BenchmarkReport report(outputPath.empty() ? std::cout : outputFile, options);
+
+    try
+    {
+        std::filesystem::create_directories(options.workDirectory / "text");
+        std::filesystem::create_directories(options.workDirectory / "binary");
+        const auto textOutput = (options.workDirectory / "text" / "synthetic").string();
+        const auto binaryOutput = (options.workDirectory / "binary" / "synthetic").string();
+
+        auto output = options.output;
+        output.outputFileName = textOutput;
+        std::cerr << std::format("Writing {}x{} cells in {}x{} nodes, {} steps to '{}'", output.columns, output.rows, output.nodesX, output.nodesY, output.steps, options.workDirectory.string())
+                  << std::endl;
+        writeSyntheticTextOutput(output);
+        output.outputFileName = binaryOutput;
+        writeSyntheticBinaryOutput<BenchmarkCell>(output);
+
+        const auto compression = isContainerCompressionAvailable(ContainerCompression::Lz4) ? ContainerCompression::Lz4 : ContainerCompression::None;
+        OutputContainer::pack(textOutput, output.nodesX * output.nodesY, OutputContainer::fileName(textOutput), compression);
+
+        benchmarkReading(report, options, textOutput, "text");
+        benchmarkReading(report, options, binaryOutput, "binary");
+        benchmarkReading(report, options, textOutput, "container");
+        benchmarkColors(report, options, textOutput);
+        if (! options.skipRender)
+            benchmarkOffscreenRender(report, options, textOutput);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (! options.keepData)
+    {
+        std::error_code error;
+        std::filesystem::remove_all(options.workDirectory / "text", error);
+        std::filesystem::remove_all(options.workDirectory / "binary", error);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/** @file SyntheticOutput.cpp
+ * @brief Implementation of the generator of synthetic simulation output. */
+
+#include "SyntheticOutput.h"
+
+#include <charconv> // std::to_chars
+
+
+std::vector<ColumnAndRow> syntheticNodeSizes(const SyntheticOutputOptions& options)
+{
+    if (options.nodesX == 0 || options.nodesY == 0 || options.columns < static_cast<int>(options.nodesX) || options.rows < static_cast<int>(options.nodesY))
+        throw std::invalid_argument(std::format("Grid {}x{} can't be split into {}x{} nodes", options.columns, options.rows, options.nodesX, options.nodesY));
+
+    const int nodeColumns = options.columns / static_cast<int>(options.nodesX);
+    const int nodeRows = options.rows / static_cast<int>(options.nodesY);
+
+    std::vector<ColumnAndRow> sizes;
+    sizes.reserve(options.nodesX * options.nodesY);
+    for (NodeIndex nodeRow = 0; nodeRow < options.nodesY; ++nodeRow)
+    {
+        for (NodeIndex nodeColumn = 0; nodeColumn < options.nodesX; ++nodeColumn)
+        {
+            const bool lastColumn = (nodeColumn + 1 == options.nodesX);
+            const bool lastRow = (nodeRow + 1 == options.nodesY);
+            sizes.push_back(ColumnAndRow::xy(lastColumn ? options.columns - nodeColumns * static_cast<int>(nodeColumn) : nodeColumns,
+                                             lastRow ? options.rows - nodeRows * static_cast<int>(nodeRow) : nodeRows));
+        }
+    }
+    return sizes;
+}
+
+std::uint64_t writeSyntheticTextOutput(const SyntheticOutputOptions& options)
+{
+    const auto sizes = syntheticNodeSizes(options);
+    std::uint64_t dataBytes = 0;
+    std::string line;
+    for (NodeIndex node = 0; node < sizes.size(); ++node)
+    {
+        const auto& size = sizes[node];
+        const auto offset = ReaderHelpers::calculateXYOffsetForNode(node, options.nodesX, options.nodesY, sizes);
+
+        const auto dataFileName = ReaderHelpers::giveMeFileName(options.outputFileName, node);
+        const auto indexFileName = ReaderHelpers::giveMeFileNameIndex(options.outputFileName, node);
+        std::ofstream data(dataFileName, std::ios::binary | std::ios::trunc);
+        std::ofstream index(indexFileName, std::ios::trunc);
+        if (! data || ! index)
+            throw std::runtime_error(std::format("Can't write synthetic output '{}'", dataFileName));
+
+        std::uint64_t position = 0;
+        for (StepIndex step = 0; step < options.steps; ++step)
+        {
+            index << step << ' ' << position << '\n';
+
+            line = std::format("{}-{}\n", size.column, size.row);
+            data.write(line.data(), static_cast<std::streamsize>(line.size()));
+            position += line.size();
+
+            for (int row = 0; row < size.row; ++row)
+            {
+                line.clear();
+                for (int column = 0; column < size.column; ++column)
+                {
+                    char token[16];
+                    const auto [end, error] = std::to_chars(token, token + sizeof(token), syntheticCellValue(offset.y() + row, offset.x() + column, step));
+                    line.append(token, end);
+                    line.push_back(' ');
+                }
+                line.back() = '\n';
+                data.write(line.data(), static_cast<std::streamsize>(line.size()));
+                position += line.size();
+            }
+        }
+        if (! data.flush() || ! index.flush())
+            throw std::runtime_error(std::format("Can't write synthetic output '{}'", dataFileName));
+        dataBytes += position;
+    }
+    return dataBytes;
+}
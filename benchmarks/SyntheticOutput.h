@@ -0,0 +1,90 @@
+/** @file SyntheticOutput.h
+ * @brief Declaration of the generator of synthetic simulation output (node data and index files) for benchmarks. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utilities/ModelReader.hpp" // ReaderHelpers
+#include "utilities/types.h"
+
+/// @brief Shape of the generated output
+struct SyntheticOutputOptions
+{
+    int rows = 1024;        ///< Rows of the whole grid
+    int columns = 1024;     ///< Columns of the whole grid
+    NodeIndex nodesX = 2;   ///< Nodes along the X axis (number_node_x)
+    NodeIndex nodesY = 2;   ///< Nodes along the Y axis (number_node_y)
+    StepIndex steps = 10;   ///< Steps written for every node
+    std::string outputFileName; ///< Basename of the files (output_file_name with its directory)
+};
+
+/// @brief Sizes of all nodes: the grid split evenly, the last node in a row (column) takes the remainder
+std::vector<ColumnAndRow> syntheticNodeSizes(const SyntheticOutputOptions& options);
+
+/// @brief Value of the cell (row and column in the whole grid) at the step, 0-255 so every colour of a ramp is used
+inline int syntheticCellValue(int row, int column, StepIndex step)
+{
+    return static_cast<int>((static_cast<unsigned>(row) * 7u + static_cast<unsigned>(column) * 13u + step * 5u) % 256u);
+}
+
+/** @brief Writes text output: `<output>N.txt` with a "columns-rows" header line and a line of values per row for every step,
+ *  and `<output>N_index.txt` with "<step> <position>" lines (the legacy format, so sizes are read from the headers).
+ *  @return Number of bytes of the data files
+ *  @throws std::runtime_error If a file cannot be written */
+std::uint64_t writeSyntheticTextOutput(const SyntheticOutputOptions& options);
+
+/** @brief Writes binary output: `<output>N.bin` with raw bytes of cells (row by row) for every step,
+ *  and `<output>N_index.txt` with "<step> <position> (columns-rows)" lines (sizes are required in binary mode).
+ *
+ * The cells are constructed from syntheticCellValue() and written as their object representation,
+ * which is what ModelReader copies back (the reading process has to use the same Cell type and build).
+ * @return Number of bytes of the data files
+ * @throws std::runtime_error If a file cannot be written */
+template<class Cell>
+std::uint64_t writeSyntheticBinaryOutput(const SyntheticOutputOptions& options)
+{
+    const auto sizes = syntheticNodeSizes(options);
+    std::uint64_t dataBytes = 0;
+    std::vector<char> rowBytes;
+    for (NodeIndex node = 0; node < sizes.size(); ++node)
+    {
+        const auto& size = sizes[node];
+        const auto offset = ReaderHelpers::calculateXYOffsetForNode(node, options.nodesX, options.nodesY, sizes);
+
+        const auto dataFileName = ReaderHelpers::giveMeFileName(options.outputFileName, node, /*isBinary=*/true);
+        const auto indexFileName = ReaderHelpers::giveMeFileNameIndex(options.outputFileName, node);
+        std::ofstream data(dataFileName, std::ios::binary | std::ios::trunc);
+        std::ofstream index(indexFileName, std::ios::trunc);
+        if (! data || ! index)
+            throw std::runtime_error(std::format("Can't write synthetic output '{}'", dataFileName));
+
+        rowBytes.resize(static_cast<std::size_t>(size.column) * sizeof(Cell));
+        std::uint64_t position = 0;
+        for (StepIndex step = 0; step < options.steps; ++step)
+        {
+            index << std::format("{} {} ({}-{})\n", step, position, size.column, size.row);
+            for (int row = 0; row < size.row; ++row)
+            {
+                for (int column = 0; column < size.column; ++column)
+                {
+                    const Cell cell(syntheticCellValue(offset.y() + row, offset.x() + column, step));
+                    std::memcpy(rowBytes.data() + static_cast<std::size_t>(column) * sizeof(Cell), static_cast<const void*>(&cell), sizeof(Cell));
+                }
+                data.write(rowBytes.data(), static_cast<std::streamsize>(rowBytes.size()));
+                position += rowBytes.size();
+            }
+        }
+        if (! data.flush() || ! index.flush())
+            throw std::runtime_error(std::format("Can't write synthetic output '{}'", dataFileName));
+        dataBytes += position;
+    }
+    return dataBytes;
+}
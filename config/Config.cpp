@@ -114,7 +114,17 @@ void Config::setUpConfigCategories()
         {
             {"substates", "h", ConfigParameter::string_par},
             {"mode", "text", ConfigParameter::string_par},
-            {"reduction", "sum,min,max", ConfigParameter::string_par}
+            {"remote_agent", "", ConfigParameter::string_par},
+            {"reduction", "sum,min,max", ConfigParameter::string_par},
+            {"prefetch_steps", "4", ConfigParameter::int_par},
+            {"step_cache_memory_mb", "1024", ConfigParameter::int_par},
+            {"compressed_step_cache_memory_mb", "0", ConfigParameter::int_par},
+            {"max_open_files", "256", ConfigParameter::int_par},
+            {"lod_reduction", "average", ConfigParameter::string_par},
+            {"substate_storage", "cells", ConfigParameter::string_par},
+            {"color_substate", "", ConfigParameter::string_par},
+            {"height_substate", "", ConfigParameter::string_par},
+            {"height_scale", "1", ConfigParameter::double_par}
         }
     });
 }
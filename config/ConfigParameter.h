@@ -99,6 +99,15 @@ inline int ConfigParameter::getValue() const
     throw std::runtime_error("Type does not match!");
 }
 
+template<>
+inline double ConfigParameter::getValue() const
+{
+    if (double_par == type)
+        return std::stod(defaultValue);
+
+    throw std::runtime_error("Type does not match!");
+}
+
 template<>
 inline std::string ConfigParameter::getValue() const
 {
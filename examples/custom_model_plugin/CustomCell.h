@@ -1,11 +1,13 @@
 #pragma once
 
-#include <algorithm> // std::max, std::min
+#include <algorithm> // std::find, std::max, std::min
 #include <charconv>  // std::from_chars
 #include <cstring>
 #include <format>
 #include <limits>
+#include <span>
 #include <stdexcept> // std::invalid_argument
+#include <string_view>
 
 #include "OOpenCAL/base/Cell.h"
 
@@ -20,6 +22,39 @@ class CustomCell : public Cell
 {
     int value;
 
+    /// Colour gradient shared by outputValue() and outputColorRow()
+    static Color colorForValue(int value)
+    {
+        // Normalize value to 0-1 range (assuming 0-255 input)
+        double normalized = value / 255.0;
+        normalized = std::max(0.0, std::min(1.0, normalized));
+
+        if (normalized < 0.25)
+        {
+            // Blue -> Cyan
+            double t = normalized * 4.0;
+            return Color(0, static_cast<int>(255 * t), 255);
+        }
+        else if (normalized < 0.5)
+        {
+            // Cyan -> Green
+            double t = (normalized - 0.25) * 4.0;
+            return Color(0, 255, static_cast<int>(255 * (1 - t)));
+        }
+        else if (normalized < 0.75)
+        {
+            // Green -> Yellow
+            double t = (normalized - 0.5) * 4.0;
+            return Color(static_cast<int>(255 * t), 255, 0);
+        }
+        else
+        {
+            // Yellow -> Red
+            double t = (normalized - 0.75) * 4.0;
+            return Color(255, static_cast<int>(255 * (1 - t)), 0);
+        }
+    }
+
 public:
     OPENCALF CustomCell()
         : value(0)
@@ -72,48 +107,90 @@ public:
         }
     }
 
+    /** Parse the token given as string_view (optional hook detected by the viewer).
+     * Used instead of composeElement(char*) by the text reader: the token does not need to be null-terminated. */
+    void composeElement(std::string_view token)
+    {
+        int result = 0;
+        const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), result);
+        if (token.empty() || ec == std::errc::invalid_argument)
+        {
+            this->value = 0;
+            throw std::invalid_argument("Provided not number '" + std::string(token) + "'");
+        }
+        else if (ec == std::errc::result_out_of_range)
+        {
+            this->value = 0;
+            throw std::invalid_argument(std::format("Provided number '{}' is out of int range [{}, {}]",
+                                                    token,
+                                                    std::numeric_limits<int>::min(),
+                                                    std::numeric_limits<int>::max()));
+        }
+        this->value = result;
+    }
+
+    /** Parse a whole row of the node's output at once (optional hook detected by the viewer, see CellRowDecoding.h).
+     * Used instead of composeElement() for every token: one tight loop without virtual calls. */
+    static void composeRow(std::string_view line, std::span<CustomCell> cells)
+    {
+        const char* position = line.data();
+        const char* const end = line.data() + line.size();
+        for (CustomCell& cell : cells)
+        {
+            while (position < end && ' ' == *position)
+                ++position;
+            if (position >= end)
+                break; // fewer tokens than cells
+
+            int result = 0;
+            const auto [next, ec] = std::from_chars(position, end, result);
+            if (ec == std::errc::invalid_argument)
+            {
+                throw std::invalid_argument("Provided not number '" + std::string(position, std::find(position, end, ' ')) + "'");
+            }
+            else if (ec == std::errc::result_out_of_range)
+            {
+                throw std::invalid_argument(std::format("Provided number '{}' is out of int range [{}, {}]",
+                                                        std::string_view(position, std::find(position, end, ' ')),
+                                                        std::numeric_limits<int>::min(),
+                                                        std::numeric_limits<int>::max()));
+            }
+            cell.value = result;
+            position = next;
+        }
+    }
+
     /// Convert cell state to string representation
     std::string stringEncoding(const char*) const override
     {
         return std::to_string(value);
     }
 
+    /** Value of the substate as a number (optional hook detected by the viewer).
+     * Used by reductions (sum, min, max, ...) instead of parsing stringEncoding(). */
+    double substateValue(const char*) const
+    {
+        return value;
+    }
+
     /** Determine the output color based on the cell value
      * Blue (0) -> Cyan -> Green -> Yellow -> Red (255) */
     Color outputValue(const char* /*str*/) const override
     {
-        Color outputColor{ 128, 128, 128 };
-
-        // Normalize value to 0-1 range (assuming 0-255 input)
-        double normalized = value / 255.0;
-        normalized = std::max(0.0, std::min(1.0, normalized));
+        return colorForValue(value);
+    }
 
-        if (normalized < 0.25)
-        {
-            // Blue -> Cyan
-            double t = normalized * 4.0;
-            outputColor = Color(0, static_cast<int>(255 * t), 255);
-        }
-        else if (normalized < 0.5)
-        {
-            // Cyan -> Green
-            double t = (normalized - 0.25) * 4.0;
-            outputColor = Color(0, 255, static_cast<int>(255 * (1 - t)));
-        }
-        else if (normalized < 0.75)
-        {
-            // Green -> Yellow
-            double t = (normalized - 0.5) * 4.0;
-            outputColor = Color(static_cast<int>(255 * t), 255, 0);
-        }
-        else
+    /** Colour a whole row of cells at once (optional hook detected by the viewer).
+     * Writes 3 bytes (R, G, B) per cell; it contains no virtual calls, so the loop can be vectorised. */
+    static void outputColorRow(std::span<const CustomCell> cells, unsigned char* rgb)
+    {
+        for (const CustomCell& cell : cells)
         {
-            // Yellow -> Red
-            double t = (normalized - 0.75) * 4.0;
-            outputColor = Color(255, static_cast<int>(255 * (1 - t)), 0);
+            const Color color = colorForValue(cell.value);
+            *rgb++ = static_cast<unsigned char>(color.getRed());
+            *rgb++ = static_cast<unsigned char>(color.getGreen());
+            *rgb++ = static_cast<unsigned char>(color.getBlue());
         }
-
-        return outputColor;
     }
 
     /// Called at the start of each simulation step
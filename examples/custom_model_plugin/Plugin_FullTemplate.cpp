@@ -40,6 +40,7 @@
 #include <iostream>
 #include <memory> // std::unique_ptr
 #include EXPAND_AND_STRINGIFY(PLUGIN_CELL_CLASS.h)
+#include "utilities/CellRowDecoding.h"
 #include "visualiserProxy/SceneWidgetVisualizerAdapter.h"
 #include "visualiserProxy/SceneWidgetVisualizerFactory.h"
 
@@ -93,4 +94,11 @@ const char* getModelName()
 {
     return PLUGIN_MODEL_NAME;
 }
+
+/// Optional: version of the row decoding hook composeRow() of the cell class, 0 when it decodes cell by cell (see CellRowDecoding.h)
+__attribute__((visibility("default")))
+int getRowDecodingVersion()
+{
+    return cellRowDecodingVersion<PLUGIN_CELL_CLASS>();
+}
 } // extern "C"
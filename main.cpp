@@ -17,15 +17,24 @@
  * - Support for multiple model types (runtime switchable)
  * - Plugin system for custom models (no recompilation needed)
  * - Video export functionality
+ * - Headless batch rendering of images and videos (--headless, no display needed)
  *
  * @include README.md */
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QFile>
 #include <QFileInfo>
 #include <QStyleFactory>
 #include <QSurfaceFormat>
+#include <QTimer>
 #include <filesystem>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility> // std::in_place, std::move
+#include <vector>
 
 #include <QVTKOpenGLNativeWidget.h>
 #include <vtkGenericOpenGLRenderWindow.h>
@@ -33,30 +42,52 @@
 #include "mainwindow.h"
 #include "utilities/CommandLineParser.h"
 #include "utilities/PluginLoader.h"
+#include "utilities/StageProfiler.h"
+#include "utilities/StartupTimeline.h"
+#include "visualiser/HeadlessRenderer.h"
 
 
+namespace
+{
+const std::vector<std::string> PLUGIN_DIRECTORIES = {
+    "./plugins",      // Current directory
+    "../plugins",     // Parent directory
+    "./build/plugins" // Build directory
+};
+} // namespace
+
 void applyStyleSheet(MainWindow& mainWindow);
+std::future<PluginLoader::PluginDiscovery> discoverPluginsInBackground();
+void loadPlugins(const CommandLineParser& cmdParser, PluginLoader::PluginDiscovery discovery);
+std::optional<std::string> existingConfigFile(const CommandLineParser& cmdParser);
+void finishStartup(MainWindow& mainWindow, CommandLineParser& cmdParser, std::future<PluginLoader::PluginDiscovery>& pluginDiscovery);
+void startRecordingTrace(const CommandLineParser& cmdParser);
+void saveRecordedTrace(const CommandLineParser& cmdParser);
+int runHeadless(int argc, char* argv[]);
 
 
 int main(int argc, char* argv[])
 {
+    StartupTimeline::instance(); // phases of the startup are measured from here
+
     // vtkObject::GlobalWarningDisplayOff();
 
+    // Headless mode must not create QApplication, which needs a display
+    if (CommandLineParser::isHeadlessRequested(argc, argv))
+    {
+        return runHeadless(argc, argv);
+    }
+
+    // Plugin directories and the manifest are read while the window is created
+    auto pluginDiscovery = discoverPluginsInBackground();
+
+    std::optional<ScopedStartupPhase> windowPhase(std::in_place, StartupPhase::Window);
     QSurfaceFormat::setDefaultFormat(QVTKOpenGLNativeWidget::defaultFormat());
 
     QApplication a(argc, argv);
     QApplication::setStyle(QStyleFactory::create("Fusion"));
     QApplication::setApplicationName("Visualiser");
 
-    // Load plugins from standard locations
-    // This happens before MainWindow creation so models are available immediately
-    PluginLoader& pluginLoader = PluginLoader::instance();
-    pluginLoader.loadFromStandardDirectories({
-        "./plugins",      // Current directory
-        "../plugins",     // Parent directory
-        "./build/plugins" // Build directory
-    });
-
     // Parse command-line arguments
     CommandLineParser cmdParser;
     if (! cmdParser.parse(argc, argv))
@@ -64,43 +95,69 @@ int main(int argc, char* argv[])
         return 1; // Parsing failed
     }
 
-    // Load custom model plugins if specified
-    for (const auto& modelPath : cmdParser.getLoadModelPaths())
-    {
-        if (! pluginLoader.loadPlugin(modelPath))
-        {
-            std::cerr << "Warning: Failed to load plugin: " << modelPath << std::endl;
-        }
-    }
+    startRecordingTrace(cmdParser);
+    StartupTimeline::instance().setPrintedOnFinish(cmdParser.shouldProfile());
 
     MainWindow mainWindow;
     mainWindow.setSilentMode(cmdParser.isSilentMode());
+    applyStyleSheet(mainWindow);
 
-    // Load configuration file if provided
-    if (cmdParser.getConfigFile())
+    if (const auto configFile = existingConfigFile(cmdParser))
     {
-        const auto& configFile = cmdParser.getConfigFile().value();
-        if (std::filesystem::exists(configFile))
-        {
-            mainWindow.loadInitialConfiguration(QString::fromStdString(configFile));
-        }
-        else
-        {
-            std::cerr << "Configuration file not found: '" << configFile << "'" << std::endl;
-        }
+        mainWindow.showConfigurationBeingLoaded(QString::fromStdString(*configFile));
     }
 
-    applyStyleSheet(mainWindow);
-
-    mainWindow.applyCommandLineOptions(cmdParser);
-
     // Show window (unless in headless mode)
     if (! cmdParser.getGenerateMoviePath() && ! cmdParser.getGenerateImagePath())
     {
         mainWindow.show();
     }
+    windowPhase.reset();
+
+    // Plugins, the configuration and its first step are loaded once the event loop runs, so the window is painted first
+    QTimer::singleShot(0,
+                       &mainWindow,
+                       [&]
+                       {
+                           finishStartup(mainWindow, cmdParser, pluginDiscovery);
+                       });
+
+    const int exitCode = a.exec();
+    saveRecordedTrace(cmdParser);
+    return exitCode;
+}
 
-    return a.exec();
+void finishStartup(MainWindow& mainWindow, CommandLineParser& cmdParser, std::future<PluginLoader::PluginDiscovery>& pluginDiscovery)
+{
+    {
+        ScopedStartupPhase phase(StartupPhase::PluginRegistration);
+        loadPlugins(cmdParser, pluginDiscovery.get());
+        mainWindow.recreateModelMenuActions(); // models of the plugins
+    }
+    mainWindow.applyStartingModel(cmdParser); // before the configuration, so its data is read only once
+
+    // Load configuration file if provided
+    if (const auto configFile = existingConfigFile(cmdParser))
+    {
+        mainWindow.loadInitialConfiguration(QString::fromStdString(*configFile));
+    }
+    StartupTimeline::instance().finish(); // no-op when the first frame was shown, otherwise there is none to wait for
+
+    mainWindow.applyCommandLineOptions(cmdParser);
+}
+
+std::optional<std::string> existingConfigFile(const CommandLineParser& cmdParser)
+{
+    if (! cmdParser.getConfigFile())
+        return std::nullopt;
+
+    const auto& configFile = cmdParser.getConfigFile().value();
+    if (! std::filesystem::exists(configFile))
+    {
+        std::cerr << "Configuration file not found: '" << configFile << "'" << std::endl;
+        return std::nullopt;
+    }
+    return configFile;
 }
 
 void applyStyleSheet(MainWindow& mainWindow)
@@ -114,3 +171,76 @@ void applyStyleSheet(MainWindow& mainWindow)
         }
     }
 }
+
+std::future<PluginLoader::PluginDiscovery> discoverPluginsInBackground()
+{
+    return std::async(std::launch::async,
+                      [manifestPath = PluginLoader::instance().getManifestPath()]
+                      {
+                          ScopedStartupPhase phase(StartupPhase::PluginDiscovery);
+                          return PluginLoader::discoverPlugins(PLUGIN_DIRECTORIES, manifestPath);
+                      });
+}
+
+void loadPlugins(const CommandLineParser& cmdParser, PluginLoader::PluginDiscovery discovery)
+{
+    // Load plugins found in standard locations
+    PluginLoader& pluginLoader = PluginLoader::instance();
+    pluginLoader.loadDiscoveredPlugins(std::move(discovery));
+
+    // Load custom model plugins if specified
+    for (const auto& modelPath : cmdParser.getLoadModelPaths())
+    {
+        if (! pluginLoader.loadPlugin(modelPath))
+        {
+            std::cerr << "Warning: Failed to load plugin: " << modelPath << std::endl;
+        }
+    }
+}
+
+void startRecordingTrace(const CommandLineParser& cmdParser)
+{
+    if (cmdParser.getProfileTracePath())
+    {
+        auto& profiler = StageProfiler::instance();
+        profiler.setTraceRecording(true);
+        profiler.setEnabled(true);
+    }
+}
+
+void saveRecordedTrace(const CommandLineParser& cmdParser)
+{
+    if (const auto& tracePath = cmdParser.getProfileTracePath())
+    {
+        try
+        {
+            StageProfiler::instance().writeChromeTrace(*tracePath);
+            std::cout << "Trace saved to: " << *tracePath << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+}
+
+int runHeadless(int argc, char* argv[])
+{
+    HeadlessRenderer::preferDisplaylessRenderWindow();
+
+    QCoreApplication a(argc, argv); // settings (colours) and application name, but no connection to a display
+    QCoreApplication::setApplicationName("Visualiser");
+
+    CommandLineParser cmdParser;
+    if (! cmdParser.parse(argc, argv))
+    {
+        return 1; // Parsing failed
+    }
+
+    loadPlugins(cmdParser, PluginLoader::discoverPlugins(PLUGIN_DIRECTORIES, PluginLoader::instance().getManifestPath()));
+    startRecordingTrace(cmdParser);
+
+    const int exitCode = HeadlessRenderer(cmdParser).run();
+    saveRecordedTrace(cmdParser);
+    return exitCode;
+}
@@ -1,3 +1,4 @@
+#include <algorithm> // std::max
 #include <utility> // std::to_underlying, which requires C++23
 #include <QCommonStyle>
 #include <QSettings>
@@ -9,11 +10,21 @@
 #include <QStandardPaths>
 #include <QFileDialog>
 #include <QActionGroup>
+#include <QDockWidget>
+#include <QInputDialog>
 #include <QProgressDialog>
+#include <QScopeGuard>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QDir>
 #include <QTimer>
+#include <QEvent>
+#include <QImage>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QStyleOptionSlider>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
@@ -22,6 +33,9 @@
 #include "widgets/ConfigDetailsDialog.h"
 #include "widgets/ColorSettingsDialog.h"
 #include "widgets/AboutDialog.h"
+#include "widgets/CellProbePanel.h"
+#include "widgets/ReductionsPanel.h"
+#include "widgets/TemporalAggregationDialog.h"
 #include "visualiser/VideoExporter.h"
 #include "visualiserProxy/SceneWidgetVisualizerFactory.h"
 #include "config/Config.h"
@@ -30,6 +44,9 @@
 namespace
 {
 constexpr StepIndex FIRST_STEP_NUMBER = 0;
+
+/// Thumbnails of steps are shown enlarged above the slider (without smoothing, so cells stay sharp)
+constexpr int STEP_THUMBNAIL_PREVIEW_SCALE = 2;
 }
 
 
@@ -38,6 +55,10 @@ MainWindow::MainWindow(QWidget* parent)
     , ui(new Ui::MainWindow)
     , modelActionGroup(nullptr)
     , playbackTimer(new QTimer(this))
+    , reductionsDock(nullptr)
+    , reductionsPanel(nullptr)
+    , cellProbeDock(nullptr)
+    , cellProbePanel(nullptr)
     , currentStep{ FIRST_STEP_NUMBER }
 {
     ui->setupUi(this);
@@ -48,6 +69,8 @@ MainWindow::MainWindow(QWidget* parent)
     loadStrings();
     recreateModelMenuActions();
     createViewModeActionGroup();
+    createReductionsDock();
+    createCellProbeDock();
     updateRecentFilesMenu();
 
     enterNoConfigurationFileMode();
@@ -57,11 +80,27 @@ void MainWindow::loadInitialConfiguration(const QString& configFileName)
 {
     if (! configFileName.isEmpty())
     {
-        configureUIElements(configFileName);
-        addToRecentFiles(configFileName);
+        try
+        {
+            configureUIElements(configFileName);
+            addToRecentFiles(configFileName);
+        }
+        catch (const std::exception& e) // the window is already shown: it stays usable without a configuration
+        {
+            std::cerr << "Failed to load configuration: " << e.what() << std::endl;
+            enterNoConfigurationFileMode();
+            ui->openConfigurationFileLabel->show();
+        }
     }
 }
 
+void MainWindow::showConfigurationBeingLoaded(const QString& configFileName)
+{
+    ui->openConfigurationFileLabel->hide();
+    ui->sceneWidget->setHidden(false); // empty until the first step is drawn
+    ui->inputFilePathLabel->setText(tr("Loading %1...").arg(configFileName));
+}
+
 void MainWindow::configureUIElements(const QString& configFileName)
 {
     initializeSceneWidget(configFileName);
@@ -83,6 +122,14 @@ void MainWindow::setupConnections()
     connect(ui->sceneWidget, &SceneWidget::changedStepNumberWithKeyboardKeys, ui->updatePositionSlider, &QSlider::setValue);
     connect(ui->sceneWidget, &SceneWidget::totalNumberOfStepsReadFromConfigFile, this, &MainWindow::totalStepsNumberChanged);
     connect(ui->sceneWidget, &SceneWidget::availableStepsReadFromConfigFile, this, &MainWindow::availableStepsLoadedFromConfigFile);
+    connect(ui->sceneWidget, &SceneWidget::newStepsAvailable, this, &MainWindow::onNewStepsAvailable);
+    connect(ui->sceneWidget, &SceneWidget::stepLoadFailed, this, &MainWindow::onStepLoadFailed);
+    connect(ui->sceneWidget, &SceneWidget::displayedStepChanged, this, &MainWindow::refreshReductionsPanel);
+    connect(ui->sceneWidget, &SceneWidget::stepAggregationProgress, this, &MainWindow::onStepAggregationProgress);
+    connect(ui->sceneWidget, &SceneWidget::stepAggregationFinished, this, &MainWindow::onStepAggregationFinished);
+    connect(ui->sceneWidget, &SceneWidget::stepAggregationFailed, this, &MainWindow::onStepAggregationFailed);
+    connect(ui->sceneWidget, &SceneWidget::stepThumbnailsChanged, this, &MainWindow::onStepThumbnailsChanged);
+    connect(ui->sceneWidget, &SceneWidget::cellProbeRequested, this, &MainWindow::onCellProbeRequested);
 
     connect(playbackTimer, &QTimer::timeout, this, &MainWindow::onPlaybackTimerTick);
 }
@@ -95,12 +142,18 @@ void MainWindow::connectMenuActions()
     connect(ui->actionExport_Video, &QAction::triggered, this, &MainWindow::exportVideoDialog);
     connect(ui->actionOpenConfiguration, &QAction::triggered, this, &MainWindow::onOpenConfigurationRequested);
     connect(ui->actionReloadData, &QAction::triggered, this, &MainWindow::onReloadDataRequested);
+    connect(ui->actionFollowLiveOutput, &QAction::toggled, ui->sceneWidget, &SceneWidget::setLiveFollowEnabled);
     connect(ui->actionLoadPlugin, &QAction::triggered, this, &MainWindow::onLoadPluginRequested);
     connect(ui->actionColor_settings, &QAction::triggered, this, &MainWindow::onColorSettingsRequested);
 
     // View mode actions
     connect(ui->action2DMode, &QAction::triggered, this, &MainWindow::on2DModeRequested);
     connect(ui->action3DMode, &QAction::triggered, this, &MainWindow::on3DModeRequested);
+    connect(ui->actionShowTimingOverlay, &QAction::toggled, ui->sceneWidget, &SceneWidget::setTimingOverlayVisible);
+    connect(ui->actionStepThumbnails, &QAction::toggled, ui->sceneWidget, &SceneWidget::setStepThumbnailsEnabled);
+    connect(ui->actionAddLinkedView, &QAction::triggered, this, &MainWindow::onAddLinkedViewRequested);
+    connect(ui->actionCloseLinkedViews, &QAction::triggered, this, &MainWindow::closeLinkedViews);
+    connect(ui->actionAggregateSteps, &QAction::triggered, this, &MainWindow::onAggregateStepsRequested);
 
     /// Model selection actions are connected dynamically in createModelMenuActions()
 }
@@ -150,6 +203,19 @@ void MainWindow::availableStepsLoadedFromConfigFile(std::vector<StepIndex> avail
     }
 }
 
+void MainWindow::onNewStepsAvailable(std::vector<StepIndex> availableSteps)
+{
+    if (availableSteps.empty() || ! ui->actionJumpToNewestStep->isChecked() || playbackTimer->isActive())
+        return;
+
+    const auto newestStep = availableSteps.back();
+    if (newestStep > currentStep)
+    {
+        currentStep = newestStep;
+        setPositionOnWidgets(currentStep);
+    }
+}
+
 void MainWindow::totalStepsNumberChanged(StepIndex totalStepsValue)
 {
     ui->totalStep->setText(QString("/") + QString::number(totalStepsValue));
@@ -176,6 +242,8 @@ void MainWindow::connectButtons()
 void MainWindow::connectSliders()
 {
     connect(ui->updatePositionSlider, &QSlider::valueChanged, this, &MainWindow::onUpdateStepPositionOnSlider);
+    ui->updatePositionSlider->setMouseTracking(true); // thumbnails of steps follow the mouse, see eventFilter()
+    ui->updatePositionSlider->installEventFilter(this);
 
     // Camera control sliders
     connect(ui->azimuthSlider, &QSlider::valueChanged, this, &MainWindow::onAzimuthChanged);
@@ -227,20 +295,59 @@ void MainWindow::showConfigDetailsDialog()
 
 void MainWindow::exportVideoDialog()
 {
+    // Every available codec has its filter, the chosen filter selects the codec
+    QStringList filters;
+    QString selectedFilter;
+    const auto codecs = availableVideoCodecs();
+    for (const auto& codec : codecs)
+    {
+        const auto filter = "theora" == codec ? tr("OGG Theora Video (*.ogv)")
+                                              : tr("%1 Video (*.mp4 *.mkv)").arg("h264" == codec ? "H.264" : "H.265");
+        filters << filter;
+        if (codec == videoEncoding.codec)
+            selectedFilter = filter;
+    }
+
     QString outputFilePath = QFileDialog::getSaveFileName(this,
                                                           tr("Export Video"),
                                                           /*dir=*/QString(),
-                                                          tr("OGG Video Files (*.ogv);;All Files (*)"));
+                                                          filters.join(";;"),
+                                                          &selectedFilter);
 
     if (outputFilePath.isEmpty())
     {
         return; // User cancelled
     }
 
-    // Ensure .ogv extension
-    if (! outputFilePath.endsWith(".ogv", Qt::CaseInsensitive))
+    if (const auto index = filters.indexOf(selectedFilter); index >= 0)
+    {
+        videoEncoding.codec = codecs[static_cast<std::size_t>(index)];
+    }
+
+    // Ensure extension of the container of the codec
+    const auto suffix = QFileInfo(outputFilePath).suffix().toLower();
+    const bool hasContainerSuffix = "theora" == videoEncoding.codec ? "ogv" == suffix : ("mp4" == suffix || "mkv" == suffix);
+    if (! hasContainerSuffix)
     {
-        outputFilePath += ".ogv";
+        outputFilePath += QString::fromStdString(videoFileExtension(videoEncoding.codec));
+    }
+
+    if ("theora" != videoEncoding.codec)
+    {
+        bool accepted = false;
+        const int bitrate = QInputDialog::getInt(this,
+                                                 tr("Export Video"),
+                                                 tr("Bitrate [kbit/s] (0: default of the encoder):"),
+                                                 static_cast<int>(videoEncoding.bitrateKbps),
+                                                 /*min=*/0,
+                                                 /*max=*/1'000'000,
+                                                 /*step=*/1000,
+                                                 &accepted);
+        if (! accepted)
+        {
+            return;
+        }
+        videoEncoding.bitrateKbps = static_cast<unsigned>(bitrate);
     }
 
     const int fps = ui->speedSpinBox->value();
@@ -263,8 +370,7 @@ void MainWindow::exportVideoDialog()
 
 void MainWindow::recordVideoToFile(const QString& outputFilePath, int fps)
 {
-    // Save current state
-    const auto originalStep = currentStep;
+    // Playback would compete with the export for reading steps
     const bool wasPlaying = playbackTimer->isActive();
     playbackTimer->stop();
 
@@ -276,15 +382,7 @@ void MainWindow::recordVideoToFile(const QString& outputFilePath, int fps)
 
     // Create video exporter
     VideoExporter exporter;
-
-    // Define callback to update visualization for each step
-    auto updateStepCallback = [this](StepIndex step)
-    {
-        currentStep = step;
-        QSignalBlocker blockSlider(ui->updatePositionSlider);
-        setPositionOnWidgets(currentStep);
-        QApplication::processEvents();
-    };
+    exporter.setEncoding(videoEncoding);
 
     // Define callback to report progress
     auto progressCallback = [&progress](StepIndex step, StepIndex total)
@@ -299,25 +397,27 @@ void MainWindow::recordVideoToFile(const QString& outputFilePath, int fps)
         return progress.wasCanceled();
     };
 
-    // Export video using VideoExporter
+    // Export video using VideoExporter: steps are decoded and frames encoded in background,
+    // frames are rendered offscreen, so the displayed step stays as it is
+    const auto restorePlayback = qScopeGuard(
+        [this, wasPlaying]
+        {
+            if (wasPlaying)
+            {
+                startPlayback();
+            }
+        });
     exporter.exportVideo(ui->sceneWidget->renderWindow(),
                          outputFilePath,
                          fps,
                          totalSteps(),
-                         updateStepCallback,
+                         ui->sceneWidget->stepFrameDecoder(),
                          progressCallback,
                          cancelledCallback);
 
-    // Restore original state
-    currentStep = originalStep;
-    setPositionOnWidgets(currentStep);
-    if (wasPlaying)
-    {
-        playbackTimer->start(ui->sleepSpinBox->value());
-    }
-
     progress.setValue(static_cast<int>(totalSteps()));
 }
+
 void MainWindow::playingRequested(PlayingDirection direction)
 {
     if (playbackTimer->isActive() && playbackDirection == direction)
@@ -329,36 +429,94 @@ void MainWindow::playingRequested(PlayingDirection direction)
 
     // Start playback in the specified direction
     playbackDirection = direction;
+    startPlayback();
+}
+
+void MainWindow::startPlayback()
+{
+    const auto now = PlaybackScheduler::Clock::now();
+    const auto endStep = playbackDirection == PlayingDirection::Forward ? totalSteps() : FIRST_STEP_NUMBER;
+    playbackScheduler.start(currentStep, playbackStride(), endStep, std::chrono::milliseconds(ui->sleepSpinBox->value()), now);
 
-    // Start timer with interval from sleepSpinBox
-    playbackTimer->start(ui->sleepSpinBox->value());
+    // Ticks come more often than the frames (sleepSpinBox is the target frame interval), so a decoded step is shown on time
+    playbackTimer->setTimerType(Qt::PreciseTimer);
+    playbackTimer->start(std::min(ui->sleepSpinBox->value(), PLAYBACK_TICK_MS));
+
+    // Decode the first frames while waiting for the first tick
+    ui->sceneWidget->prefetchPlaybackSteps(
+        playbackScheduler.stepsToDecode(now, ui->sceneWidget->averageStepDecodeTime(), ui->sceneWidget->getSettingParameter()->prefetchSteps));
 }
 
-void MainWindow::onPlaybackTimerTick()
+int MainWindow::playbackStride() const
+{
+    return std::to_underlying(playbackDirection) * ui->speedSpinBox->value();
+}
+
+void MainWindow::printStepCacheStatistics() const
 {
-    // Update current step
-    currentStep += static_cast<StepIndex>(std::to_underlying(playbackDirection) * ui->speedSpinBox->value());
-    currentStep = std::clamp<StepIndex>(currentStep, FIRST_STEP_NUMBER, totalSteps());
+    const auto statistics = ui->sceneWidget->stepCacheStatistics();
+    std::cout << "Step cache: " << statistics.hits << " hits, " << statistics.misses << " misses, "
+              << statistics.cachedSteps << " steps cached in full, " << statistics.compressedSteps << " delta-compressed ("
+              << statistics.memoryUsage / (1024 * 1024) << " of "
+              << statistics.memoryBudget / (1024 * 1024) << " MiB)" << std::endl;
+}
 
-    // Update UI
+void MainWindow::onPlaybackTimerTick()
+{
+    // Update pace in case sleepSpinBox or speedSpinBox changed
+    const auto now = PlaybackScheduler::Clock::now();
+    playbackScheduler.setPace(playbackStride(), std::chrono::milliseconds(ui->sleepSpinBox->value()), now);
+    playbackTimer->setInterval(std::min(ui->sleepSpinBox->value(), PLAYBACK_TICK_MS));
+
+    const auto decodeTime = ui->sceneWidget->averageStepDecodeTime();
+    const auto frame = playbackScheduler.nextFrame(now,
+                                                   decodeTime,
+                                                   [this](StepIndex step)
+                                                   {
+                                                       return ui->sceneWidget->isStepDecoded(step);
+                                                   });
+    if (frame.step)
     {
-        QSignalBlocker blockSlider(ui->updatePositionSlider);
-        if (bool changingPositionSuccess = setPositionOnWidgets(currentStep); ! changingPositionSuccess)
+        currentStep = *frame.step;
+        if (frame.decoded)
         {
-            playbackTimer->stop();
-            return;
+            QSignalBlocker blockSlider(ui->updatePositionSlider);
+            if (bool changingPositionSuccess = setPositionOnWidgets(currentStep); ! changingPositionSuccess)
+            {
+                playbackTimer->stop();
+                return;
+            }
         }
+        else
+        {
+            // nothing was decoded in time: the step is read in background, the tick does not wait for it
+            {
+                QSignalBlocker blockSlider(ui->updatePositionSlider);
+                QSignalBlocker blockSpinBox(ui->positionSpinBox);
+                ui->updatePositionSlider->setValue(static_cast<int>(currentStep));
+                ui->positionSpinBox->setValue(static_cast<int>(currentStep));
+            }
+            ui->sceneWidget->requestStepAsync(currentStep);
+            changeWhichButtonsAreEnabled();
+        }
+        playbackScheduler.frameShown(currentStep, now);
+
+        const auto statistics = playbackScheduler.statistics(now);
+        ui->statusbar->showMessage(tr("Playback: %1 fps, %2 steps dropped").arg(statistics.framesPerSecond, 0, 'f', 1).arg(statistics.droppedSteps));
     }
 
     // Check if we reached the end
-    if ((playbackDirection == PlayingDirection::Forward && currentStep >= totalSteps())
-        || (playbackDirection == PlayingDirection::Backward && currentStep <= FIRST_STEP_NUMBER))
+    if (playbackScheduler.finished())
     {
         playbackTimer->stop();
+        const auto statistics = playbackScheduler.statistics(now);
+        std::cout << "Playback: " << statistics.shownFrames << " frames shown, " << statistics.droppedSteps << " steps dropped" << std::endl;
+        printStepCacheStatistics();
+        return;
     }
 
-    // Update timer interval in case sleepSpinBox changed
-    playbackTimer->setInterval(ui->sleepSpinBox->value());
+    // Next frames are decoded in background while this one is displayed, steps the playback moved past are dropped
+    ui->sceneWidget->prefetchPlaybackSteps(playbackScheduler.stepsToDecode(now, decodeTime, ui->sceneWidget->getSettingParameter()->prefetchSteps));
 }
 
 
@@ -473,7 +631,117 @@ void MainWindow::onUpdateStepPositionOnSlider(StepIndex value)
 
     currentStep = value;
 
-    setPositionOnWidgets(value, /*updateSlider=*/false);
+    // dragging the slider requests many steps, they are read in background and only the last one is shown
+    ui->sceneWidget->requestStepAsync(value);
+    changeWhichButtonsAreEnabled();
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == ui->updatePositionSlider)
+    {
+        switch (event->type())
+        {
+        case QEvent::MouseMove:
+            showStepThumbnail(static_cast<QMouseEvent*>(event)->position().toPoint());
+            break;
+        case QEvent::Leave:
+        case QEvent::Hide:
+            if (stepThumbnailPreview)
+                stepThumbnailPreview->hide();
+            break;
+        case QEvent::ToolTip: // the thumbnail replaces the tool tip of the slider
+            if (! ui->sceneWidget->stepThumbnails().empty())
+                return true;
+            break;
+        default:
+            break;
+        }
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::showStepThumbnail(const QPoint& sliderPosition)
+{
+    const auto& thumbnails = ui->sceneWidget->stepThumbnails();
+    auto* slider = ui->updatePositionSlider;
+    if (thumbnails.empty() || ! slider->isEnabled())
+    {
+        if (stepThumbnailPreview)
+            stepThumbnailPreview->hide();
+        return;
+    }
+
+    // the step under the mouse, mapped the way the style maps the handle of the slider
+    QStyleOptionSlider option;
+    option.initFrom(slider);
+    option.orientation = slider->orientation();
+    option.minimum = slider->minimum();
+    option.maximum = slider->maximum();
+    option.sliderPosition = slider->sliderPosition();
+    option.sliderValue = slider->value();
+    option.upsideDown = slider->invertedAppearance();
+    const QRect groove = slider->style()->subControlRect(QStyle::CC_Slider, &option, QStyle::SC_SliderGroove, slider);
+    const QRect handle = slider->style()->subControlRect(QStyle::CC_Slider, &option, QStyle::SC_SliderHandle, slider);
+    const int step = QStyle::sliderValueFromPosition(slider->minimum(),
+                                                     slider->maximum(),
+                                                     sliderPosition.x() - groove.x() - handle.width() / 2,
+                                                     groove.width() - handle.width(),
+                                                     option.upsideDown);
+
+    const auto* entry = thumbnails.nearest(static_cast<StepIndex>(step));
+    const auto& thumbnail = entry->thumbnail;
+    const QImage image(thumbnail.rgb.data(), thumbnail.width, thumbnail.height, 3 * thumbnail.width, QImage::Format_RGB888);
+    const QPixmap picture = QPixmap::fromImage(image).scaled(STEP_THUMBNAIL_PREVIEW_SCALE * thumbnail.width,
+                                                             STEP_THUMBNAIL_PREVIEW_SCALE * thumbnail.height,
+                                                             Qt::IgnoreAspectRatio,
+                                                             Qt::FastTransformation);
+
+    if (! stepThumbnailPreview)
+    {
+        stepThumbnailPreview = new QLabel(this, Qt::ToolTip);
+        stepThumbnailPreview->setMargin(2);
+    }
+
+    // the step of the thumbnail is written below it (it is the nearest sampled step, not always the one under the mouse)
+    const int textHeight = stepThumbnailPreview->fontMetrics().height();
+    QPixmap preview(std::max(picture.width(), stepThumbnailPreview->fontMetrics().horizontalAdvance(tr("Step %1").arg(entry->step))),
+                    picture.height() + textHeight);
+    preview.fill(stepThumbnailPreview->palette().color(QPalette::ToolTipBase));
+    {
+        QPainter painter(&preview);
+        painter.drawPixmap((preview.width() - picture.width()) / 2, 0, picture);
+        painter.setPen(stepThumbnailPreview->palette().color(QPalette::ToolTipText));
+        painter.drawText(QRect(0, picture.height(), preview.width(), textHeight), Qt::AlignCenter, tr("Step %1").arg(entry->step));
+    }
+    stepThumbnailPreview->setPixmap(preview);
+    stepThumbnailPreview->adjustSize();
+
+    stepThumbnailPreview->move(slider->mapToGlobal(QPoint(sliderPosition.x() - stepThumbnailPreview->width() / 2, -stepThumbnailPreview->height())));
+    stepThumbnailPreview->show();
+}
+
+void MainWindow::onStepThumbnailsChanged(int builtThumbnails, int totalThumbnails)
+{
+    if (0 == builtThumbnails)
+    {
+        if (stepThumbnailPreview)
+            stepThumbnailPreview->hide();
+        return;
+    }
+    if (builtThumbnails == totalThumbnails)
+        ui->statusbar->showMessage(tr("Thumbnails of %1 steps are ready").arg(totalThumbnails), 3000);
+}
+
+void MainWindow::onStepLoadFailed(StepIndex step, const QString& message)
+{
+    playbackTimer->stop(); // the playback would keep requesting steps which cannot be read
+    if (! silentMode)
+    {
+        QMessageBox::warning(this,
+                             "Changing position error",
+                             tr("It was impossible to change position to %1, because:\n").arg(step) + message);
+    }
 }
 
 void MainWindow::onModelSelected()
@@ -496,6 +764,9 @@ void MainWindow::switchToModel(const QString& modelName)
             throw std::invalid_argument("Model not registered: " + modelName.toStdString());
         }
 
+        closeLinkedViews();
+        cancelStepAggregation();
+        cancelCellProbe();
         ui->sceneWidget->switchModel(modelName.toStdString());
 
         if (! silentMode)
@@ -526,6 +797,9 @@ void MainWindow::onReloadDataRequested()
 {
     try
     {
+        closeLinkedViews();
+        cancelStepAggregation();
+        cancelCellProbe();
         ui->sceneWidget->reloadData();
 
         if (! silentMode)
@@ -566,6 +840,9 @@ void MainWindow::openConfigurationFile(const QString& configFileName)
     {
         // Stop any ongoing playback
         playbackTimer->stop();
+        closeLinkedViews();
+        cancelStepAggregation();
+        cancelCellProbe();
 
         if (bool isFirstConfiguration [[maybe_unused]] = ui->inputFilePathLabel->getFileName().isEmpty())
         {
@@ -650,8 +927,8 @@ void MainWindow::recreateModelMenuActions()
         QAction* action = new QAction(QString::fromStdString(modelName), this);
         action->setCheckable(true);
 
-        // First model is checked by default
-        if (modelName == availableModels[0])
+        // The model of the scene is checked (the first model when the menu is created with the window)
+        if (modelName == ui->sceneWidget->getCurrentModelName())
         {
             action->setChecked(true);
         }
@@ -667,6 +944,9 @@ void MainWindow::recreateModelMenuActions()
     ui->menuModel->addSeparator();
     ui->menuModel->addAction(ui->actionLoadPlugin);
     ui->menuModel->addAction(ui->actionReloadData);
+    ui->menuModel->addSeparator();
+    ui->menuModel->addAction(ui->actionFollowLiveOutput);
+    ui->menuModel->addAction(ui->actionJumpToNewestStep);
 
     std::cout << "Created " << availableModels.size() << " model menu actions" << std::endl;
 }
@@ -718,9 +998,213 @@ void MainWindow::createViewModeActionGroup()
     ui->action2DMode->setChecked(true);
 }
 
+void MainWindow::createReductionsDock()
+{
+    reductionsPanel = new ReductionsPanel(this);
+
+    reductionsDock = new QDockWidget(tr("Reductions"), this);
+    reductionsDock->setObjectName("reductionsDock");
+    reductionsDock->setWidget(reductionsPanel);
+    addDockWidget(Qt::RightDockWidgetArea, reductionsDock);
+    reductionsDock->hide();
+
+    ui->menuView->addSeparator();
+    ui->menuView->addAction(reductionsDock->toggleViewAction());
+
+    connect(reductionsDock, &QDockWidget::visibilityChanged, this, &MainWindow::refreshReductionsPanel);
+}
+
+void MainWindow::createCellProbeDock()
+{
+    cellProbePanel = new CellProbePanel(this);
+
+    cellProbeDock = new QDockWidget(tr("Cell Probe"), this);
+    cellProbeDock->setObjectName("cellProbeDock");
+    cellProbeDock->setWidget(cellProbePanel);
+    addDockWidget(Qt::BottomDockWidgetArea, cellProbeDock);
+    cellProbeDock->hide();
+
+    ui->menuView->addAction(cellProbeDock->toggleViewAction());
+
+    connect(cellProbePanel, &CellProbePanel::probeRequested, this, &MainWindow::onProbeRequestedByPanel);
+    connect(cellProbePanel, &CellProbePanel::stepSelected, ui->updatePositionSlider, &QSlider::setValue);
+    connect(ui->sceneWidget, &SceneWidget::cellProbeFinished, cellProbePanel, &CellProbePanel::showSeries);
+    connect(ui->sceneWidget, &SceneWidget::cellProbeFailed, cellProbePanel, &CellProbePanel::showError);
+    connect(ui->sceneWidget, &SceneWidget::displayedStepChanged, cellProbePanel, &CellProbePanel::setCurrentStep);
+}
+
+QStringList MainWindow::configuredSubstates() const
+{
+    QStringList substates;
+    for (const auto& substate : QString::fromStdString(ui->sceneWidget->getSettingParameter()->substates).split(',', Qt::SkipEmptyParts))
+        substates << substate.trimmed();
+    return substates;
+}
+
+void MainWindow::refreshReductionsPanel()
+{
+    if (! reductionsDock || ! reductionsDock->isVisible())
+        return;
+
+    const auto* settingParameter = ui->sceneWidget->getSettingParameter();
+    reductionsPanel->showReductions(settingParameter->step, ui->sceneWidget->displayedStepReductions(), settingParameter->reduction);
+}
+
+void MainWindow::onAddLinkedViewRequested()
+{
+    const QString modelColors = tr("(colours of the model)");
+    QStringList colorings{ modelColors };
+    for (const auto& substate : QString::fromStdString(ui->sceneWidget->getSettingParameter()->substates).split(',', Qt::SkipEmptyParts))
+        colorings << substate.trimmed();
+
+    bool accepted = false;
+    const QString coloring = QInputDialog::getItem(this,
+                                                   tr("Add Linked View"),
+                                                   tr("Colour the cells of the new view by:"),
+                                                   colorings,
+                                                   /*current=*/0,
+                                                   /*editable=*/false,
+                                                   &accepted);
+    if (! accepted)
+        return;
+
+    auto* dock = new QDockWidget(tr("Linked View: %1").arg(coloring), this);
+    dock->setAttribute(Qt::WA_DeleteOnClose);
+    auto* linkedView = new SceneWidget(dock);
+    dock->setWidget(linkedView);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+
+    try
+    {
+        linkedView->showLinkedView(*ui->sceneWidget, coloring == modelColors ? std::string{} : coloring.toStdString());
+    }
+    catch (const std::exception& e)
+    {
+        delete dock;
+        QMessageBox::critical(this, tr("Linked View Failed"), tr("Failed to open the linked view:\n%1").arg(e.what()));
+        return;
+    }
+
+    // the main view decides the shown step, the linked view only follows it
+    connect(ui->sceneWidget, &SceneWidget::displayedStepChanged, linkedView, &SceneWidget::requestStepAsync);
+    connect(ui->sceneWidget, &SceneWidget::stepIndexAppended, linkedView, &SceneWidget::onStepIndexOfOwnerAppended);
+    connect(linkedView, &SceneWidget::changedStepNumberWithKeyboardKeys, ui->updatePositionSlider, &QSlider::setValue);
+    linkedViewDocks.append(dock);
+}
+
+void MainWindow::closeLinkedViews()
+{
+    // deleted right now: background reads of the views have to end before the stage changes
+    for (const auto& dock : std::exchange(linkedViewDocks, {}))
+        delete dock.data();
+}
+
+void MainWindow::onAggregateStepsRequested()
+{
+    QStringList substates;
+    for (const auto& substate : QString::fromStdString(ui->sceneWidget->getSettingParameter()->substates).split(',', Qt::SkipEmptyParts))
+        substates << substate.trimmed();
+
+    TemporalAggregationDialog dialog(substates, totalSteps(), this);
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+    const auto request = dialog.request();
+
+    try
+    {
+        ui->sceneWidget->requestStepAggregation(request);
+    }
+    catch (const std::exception& e)
+    {
+        QMessageBox::critical(this, tr("Aggregation Failed"), tr("Failed to aggregate steps:\n%1").arg(e.what()));
+        return;
+    }
+
+    if (! aggregationProgressDialog)
+    {
+        // non-modal: the steps can be browsed while aggregating
+        aggregationProgressDialog = new QProgressDialog(this);
+        aggregationProgressDialog->setWindowTitle(tr("Aggregate Steps"));
+        aggregationProgressDialog->setWindowModality(Qt::NonModal);
+        aggregationProgressDialog->setAutoClose(false);
+        aggregationProgressDialog->setAutoReset(false);
+        connect(aggregationProgressDialog, &QProgressDialog::canceled, ui->sceneWidget, &SceneWidget::cancelStepAggregation);
+    }
+    aggregationProgressDialog->setLabelText(tr("Computing %1...").arg(QString::fromStdString(request.description())));
+    aggregationProgressDialog->setRange(0, 0); // busy until the number of steps is known
+    aggregationProgressDialog->setValue(0);
+    aggregationProgressDialog->show();
+}
+
+void MainWindow::onStepAggregationProgress(int aggregatedSteps, int totalSteps)
+{
+    if (! aggregationProgressDialog)
+        return;
+    aggregationProgressDialog->setMaximum(totalSteps);
+    aggregationProgressDialog->setValue(std::max(aggregationProgressDialog->value(), aggregatedSteps));
+}
+
+void MainWindow::onStepAggregationFinished()
+{
+    if (aggregationProgressDialog)
+        aggregationProgressDialog->hide();
+}
+
+void MainWindow::onStepAggregationFailed(const QString& message)
+{
+    onStepAggregationFinished();
+    if (! silentMode)
+        QMessageBox::warning(this, tr("Aggregation Failed"), tr("Failed to aggregate steps:\n%1").arg(message));
+}
+
+void MainWindow::cancelStepAggregation()
+{
+    ui->sceneWidget->cancelStepAggregation();
+    onStepAggregationFinished();
+}
+
+void MainWindow::onCellProbeRequested(int row, int column)
+{
+    cellProbePanel->setSubstates(configuredSubstates());
+    cellProbePanel->setCurrentStep(currentStep);
+    cellProbeDock->show();
+    cellProbePanel->probeCell(row, column, totalSteps());
+}
+
+void MainWindow::onProbeRequestedByPanel(const CellProbeRequest& request)
+{
+    try
+    {
+        ui->sceneWidget->requestCellProbe(request);
+    }
+    catch (const std::exception& e)
+    {
+        cellProbePanel->showError(QString::fromUtf8(e.what()));
+    }
+}
+
+void MainWindow::cancelCellProbe()
+{
+    ui->sceneWidget->cancelCellProbe();
+    cellProbePanel->clear();
+}
+
+QList<SceneWidget*> MainWindow::linkedViews() const
+{
+    QList<SceneWidget*> views;
+    for (const auto& dock : linkedViewDocks)
+    {
+        if (dock)
+            views << static_cast<SceneWidget*>(dock->widget());
+    }
+    return views;
+}
+
 void MainWindow::on2DModeRequested()
 {
     ui->sceneWidget->setViewMode2D();
+    for (auto* linkedView : linkedViews())
+        linkedView->setViewMode2D();
     updateCameraControlsVisibility();
 
     QMessageBox::information(this,
@@ -731,6 +1215,8 @@ void MainWindow::on2DModeRequested()
 void MainWindow::on3DModeRequested()
 {
     ui->sceneWidget->setViewMode3D();
+    for (auto* linkedView : linkedViews())
+        linkedView->setViewMode3D();
 
     // Reset sliders to default position (0, 0) when entering 3D mode
     QSignalBlocker azimuthBlocker(ui->azimuthSlider);
@@ -1069,6 +1555,11 @@ void MainWindow::setWidgetsEnabledState(bool enabled)
     ui->actionShow_config_details->setEnabled(enabled);
     ui->actionExport_Video->setEnabled(enabled);
     ui->actionReloadData->setEnabled(enabled);
+    ui->actionAddLinkedView->setEnabled(enabled);
+    ui->actionCloseLinkedViews->setEnabled(enabled);
+    ui->actionAggregateSteps->setEnabled(enabled);
+    ui->actionFollowLiveOutput->setEnabled(enabled);
+    ui->actionJumpToNewestStep->setEnabled(enabled);
 
     // View mode actions should always be enabled
     ui->action2DMode->setEnabled(true);
@@ -1076,48 +1567,53 @@ void MainWindow::setWidgetsEnabledState(bool enabled)
 }
 
 
-void MainWindow::applyCommandLineOptions(CommandLineParser& cmdParser)
+void MainWindow::applyStartingModel(const CommandLineParser& cmdParser)
 {
-    // Store silent mode flag
-    silentMode = cmdParser.isSilentMode();
+    if (! cmdParser.getStartingModel())
+        return;
+
+    const auto& modelName = cmdParser.getStartingModel().value();
+    const QString modelQStr = QString::fromStdString(modelName);
 
-    // Set starting model if specified
-    if (cmdParser.getStartingModel())
+    // Check if model is registered
+    if (! SceneWidgetVisualizerFactory::isModelRegistered(modelName))
     {
-        const auto& modelName = cmdParser.getStartingModel().value();
-        const QString modelQStr = QString::fromStdString(modelName);
+        std::cerr << "Warning: Starting model not found: " << modelName << std::endl;
+        return;
+    }
 
-        // Check if model is registered
-        if (SceneWidgetVisualizerFactory::isModelRegistered(modelName))
+    // Find and check the corresponding action in the menu
+    for (QAction* action : modelActionGroup->actions())
+    {
+        if (action->text() == modelQStr)
         {
-            // Find and check the corresponding action in the menu
-            for (QAction* action : modelActionGroup->actions())
+            try
             {
-                if (action->text() == modelQStr)
-                {
-                    action->setChecked(true);
-                    switchToModel(modelQStr);
-
-                    // Reload data with the new model only if configuration was loaded
-                    if (cmdParser.getConfigFile())
-                    {
-                        try
-                        {
-                            ui->sceneWidget->reloadData();
-                        }
-                        catch (const std::exception& e)
-                        {
-                            std::cerr << "Error reloading data with new model: " << e.what() << std::endl;
-                        }
-                    }
-                    break;
-                }
+                // no configuration is loaded yet, so there is no data to reload (nor a message about it)
+                ui->sceneWidget->switchModel(modelName);
+                action->setChecked(true);
             }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Error switching to the starting model: " << e.what() << std::endl;
+            }
+            break;
         }
-        else
-        {
-            std::cerr << "Warning: Starting model not found: " << modelName << std::endl;
-        }
+    }
+}
+
+void MainWindow::applyCommandLineOptions(CommandLineParser& cmdParser)
+{
+    // Store silent mode flag
+    silentMode = cmdParser.isSilentMode();
+
+    if (cmdParser.getVideoCodec())
+        videoEncoding.codec = *cmdParser.getVideoCodec();
+    videoEncoding.bitrateKbps = cmdParser.getVideoBitrate().value_or(0);
+
+    if (cmdParser.shouldProfile())
+    {
+        ui->actionShowTimingOverlay->setChecked(true);
     }
 
     // Set step if specified
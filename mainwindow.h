@@ -3,19 +3,30 @@
 
 #pragma once
 
+#include <QList>
 #include <QMainWindow>
+#include <QPointer>
 #include <QStyle>
 
+#include "utilities/PlaybackScheduler.h"
 #include "utilities/types.h"
+#include "visualiser/VideoEncoder.h" // VideoEncoding
 
 namespace Ui
 {
 class MainWindow;
 }
 
+class QDockWidget;
+class QLabel;
 class QPushButton;
 class QActionGroup;
+class QProgressDialog;
 class QTimer;
+class ReductionsPanel;
+class CellProbePanel;
+class SceneWidget;
+struct CellProbeRequest;
 
 /** @class MainWindow
  * @brief The main application window class that manages the user interface.
@@ -33,11 +44,24 @@ public:
     void loadInitialConfiguration(const QString &configFileName);
     void applyCommandLineOptions(class CommandLineParser &cmdParser);
 
+    /// @brief Shows the empty scene and the name of the configuration, before it is loaded in the first pass of the event loop
+    void showConfigurationBeingLoaded(const QString &configFileName);
+
+    /// @brief Selects the model given by `--startingModel`, before the configuration is loaded (so its data is read only once)
+    void applyStartingModel(const class CommandLineParser &cmdParser);
+
+    /// @brief Recreates the Model menu from models registered in the factory (e.g. after plugins were loaded)
+    void recreateModelMenuActions();
+
     void setSilentMode(bool newSilentMode)
     {
         silentMode = newSilentMode;
     }
 
+protected:
+    /// @brief Shows thumbnails of steps while the mouse moves over the step slider (see showStepThumbnail())
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void showAboutThisApplicationDialog();
     void showConfigDetailsDialog();
@@ -69,10 +93,42 @@ private slots:
 
     void totalStepsNumberChanged(StepIndex totalStepsValue);
     void availableStepsLoadedFromConfigFile(std::vector<StepIndex> availableSteps);
+    void onNewStepsAvailable(std::vector<StepIndex> availableSteps);
+    void onStepLoadFailed(StepIndex step, const QString& message);
 
     void onRecentFileTriggered();
     void onPlaybackTimerTick();
 
+    /// @brief Shows reductions of the displayed step in the reductions panel (only when the panel is visible)
+    void refreshReductionsPanel();
+
+    /// @brief Asks for the coloured substate and opens a linked view (dock) showing the same steps as the main view
+    void onAddLinkedViewRequested();
+
+    /// @brief Destroys all linked views, it has to be done before the stage of the main view changes
+    void closeLinkedViews();
+
+    /// @brief Asks for a temporal aggregation and starts it in background, its progress is shown by a non-modal dialog
+    void onAggregateStepsRequested();
+
+    void onStepAggregationProgress(int aggregatedSteps, int totalSteps);
+    void onStepAggregationFinished();
+    void onStepAggregationFailed(const QString& message);
+
+    /// @brief Stops the running aggregation of the main view and hides its progress
+    void cancelStepAggregation();
+
+    /// @brief Shows the cell probe panel and probes the double-clicked cell over all steps
+    void onCellProbeRequested(int row, int column);
+
+    /// @brief Starts the probe asked for by the cell probe panel in background
+    void onProbeRequestedByPanel(const CellProbeRequest& request);
+
+    /// @brief Stops the running probe of the main view and drops the probed cell
+    void cancelCellProbe();
+
+    void onStepThumbnailsChanged(int builtThumbnails, int totalThumbnails);
+
 private:
     enum class PlayingDirection
     {
@@ -82,6 +138,18 @@ private:
 
     void playingRequested(PlayingDirection direction);
 
+    /// @brief Starts the playback timer and the timeline of the playback from the current step
+    void startPlayback();
+
+    /// @brief Steps between consecutive frames of the playback (negative when playing backward)
+    int playbackStride() const;
+
+    void printStepCacheStatistics() const;
+
+    /** @brief Shows the thumbnail of the step under the mouse above the step slider, hides it when there are no thumbnails
+     *  @param sliderPosition Position of the mouse in coordinates of the slider */
+    void showStepThumbnail(const QPoint &sliderPosition);
+
     void configureUIElements(const QString &configFileName);
     void setupConnections();
     void configureButtons();
@@ -106,10 +174,21 @@ private:
     void enterNoConfigurationFileMode();
 
     void switchToModel(const QString &modelName);
-    void recreateModelMenuActions();
     void createViewModeActionGroup();
+
+    /// @brief Creates the dockable panel with reductions of substates (hidden by default, toggled from the View menu)
+    void createReductionsDock();
+
+    /// @brief Creates the dockable panel plotting probed cells over time (hidden until a cell is double-clicked)
+    void createCellProbeDock();
+
+    /// @brief Names of substates of the `substates` setting of the loaded configuration
+    QStringList configuredSubstates() const;
     void updateCameraControlsVisibility();
 
+    /// @brief Returns the linked views which are still open
+    QList<SceneWidget*> linkedViews() const;
+
     // Recent files management
     void updateRecentFilesMenu();
     void addToRecentFiles(const QString &filePath);
@@ -121,15 +200,37 @@ private:
 
     static constexpr int MAX_RECENT_FILES = 10;
 
+    /// Longest period of the playback timer: the ticks only check whether a decoded step is due, so they can be frequent
+    static constexpr int PLAYBACK_TICK_MS = 10;
+
     Ui::MainWindow *ui;
 
     QActionGroup *modelActionGroup;
     QTimer *playbackTimer;
 
+    QDockWidget *reductionsDock;
+    ReductionsPanel *reductionsPanel;
+
+    QDockWidget *cellProbeDock;
+    CellProbePanel *cellProbePanel;
+
+    /// Docks of linked views (see SceneWidget::showLinkedView()), nullptr when closed by the user
+    QList<QPointer<QDockWidget>> linkedViewDocks;
+
+    /// Progress of the running aggregation of steps (created on the first one), Cancel stops the aggregation
+    QProgressDialog *aggregationProgressDialog = nullptr;
+
+    /// Thumbnail of the step under the mouse shown above the step slider (a tool tip window, created when first shown)
+    QLabel *stepThumbnailPreview = nullptr;
+
     StepIndex currentStep;
 
     // Playback state for timer-based playback
     PlayingDirection playbackDirection = PlayingDirection::Forward;
+    PlaybackScheduler playbackScheduler;
+
+    /// Codec and bitrate of exported videos (from the command line, changed by the export dialog)
+    VideoEncoding videoEncoding;
 
     QString noSelectionMessage;
     QString directorySelectionMessage;
@@ -0,0 +1,199 @@
+/** @file AllocationCounter.cpp
+ * @brief Implementation of the AllocationCounter functions and the counting replacement of the global operator new. */
+
+#include "AllocationCounter.h"
+
+#include <algorithm> // std::max
+#include <cstddef>
+#include <cstdlib> // std::malloc, std::aligned_alloc, std::free
+#include <new>
+
+
+namespace
+{
+/// Constant-initialised, so the counters are usable by allocations during the start and the end of any thread
+thread_local std::uint64_t allocations = 0;
+thread_local std::uint64_t excludedAllocations = 0;
+
+void* allocate(std::size_t size)
+{
+    ++allocations;
+    if (0 == size)
+        size = 1; // every call has to return a distinct pointer
+    while (true)
+    {
+        if (void* memory = std::malloc(size))
+            return memory;
+
+        const auto handler = std::get_new_handler();
+        if (! handler)
+            throw std::bad_alloc();
+        handler(); // frees some memory or throws
+    }
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    ++allocations;
+    const auto alignmentBytes = static_cast<std::size_t>(alignment);
+    const auto alignedSize = (std::max<std::size_t>(size, 1) + alignmentBytes - 1) / alignmentBytes * alignmentBytes; // required by aligned_alloc
+    while (true)
+    {
+        if (void* memory = std::aligned_alloc(alignmentBytes, alignedSize))
+            return memory;
+
+        const auto handler = std::get_new_handler();
+        if (! handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+} // namespace
+
+
+std::uint64_t AllocationCounter::threadAllocations()
+{
+    return allocations - excludedAllocations;
+}
+
+AllocationCounter::ExcludedScope::ExcludedScope()
+    : allocationsAtStart{ threadAllocations() }
+{
+}
+
+AllocationCounter::ExcludedScope::~ExcludedScope()
+{
+    excludedAllocations += threadAllocations() - allocationsAtStart;
+}
+
+
+/////////////////////////////
+// Replacements of the global allocation functions (all of them, so every new is counted and freed by the matching delete)
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocateAligned(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocateAligned(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
@@ -0,0 +1,32 @@
+/** @file AllocationCounter.h
+ * @brief Declaration of the AllocationCounter functions - heap allocations made by the calling thread.
+ *
+ * The global operator new is replaced (see AllocationCounter.cpp): every allocation increments a counter
+ * of the allocating thread. Nothing is shared between threads, so counting does not add contention
+ * to the allocator it measures. ScopedStageTimer reports the allocations of every profiled stage. */
+
+#pragma once
+
+#include <cstdint>
+
+namespace AllocationCounter
+{
+/// @brief Heap allocations (calls of operator new) made by the calling thread so far, without ones inside ExcludedScope
+std::uint64_t threadAllocations();
+
+/** @class ExcludedScope
+ * @brief Allocations of the calling thread made during the lifetime of the object are not counted,
+ *        e.g. bookkeeping of the profiler, which would be attributed to the stage being measured. */
+class ExcludedScope
+{
+public:
+    ExcludedScope();
+    ~ExcludedScope();
+
+    ExcludedScope(const ExcludedScope&) = delete;
+    ExcludedScope& operator=(const ExcludedScope&) = delete;
+
+private:
+    const std::uint64_t allocationsAtStart;
+};
+} // namespace AllocationCounter
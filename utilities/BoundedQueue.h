@@ -0,0 +1,109 @@
+/** @file BoundedQueue.h
+ * @brief Declaration of the BoundedQueue class template - blocking FIFO queue with limited capacity between pipeline stages. */
+
+#pragma once
+
+#include <algorithm> // std::max
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility> // std::move
+
+/** @class BoundedQueue
+ * @brief Thread-safe FIFO queue connecting a producing and a consuming thread.
+ *
+ * The producer waits when the queue is full, so a fast stage (e.g. decoding steps) runs at most
+ * capacity items ahead of a slow one (e.g. encoding video) and memory stays limited.
+ * Closing the queue wakes both sides: push() then refuses new items, pop() returns the remaining
+ * items and then an empty optional. It is used to stop the pipeline on errors and on cancellation.
+ *
+ * @tparam T Type of queued items, has to be movable */
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : capacity{ std::max<std::size_t>(capacity, 1) }
+    {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /** @brief Appends the item, waits while the queue is full.
+     *  @return false if the queue was closed (the item is dropped) */
+    bool push(T item)
+    {
+        {
+            std::unique_lock lock(mutex);
+            notFull.wait(lock,
+                         [this]
+                         {
+                             return closed || items.size() < capacity;
+                         });
+            if (closed)
+                return false;
+
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /** @brief Removes the oldest item, waits while the queue is empty.
+     *  @return Empty optional when the queue is closed and all items were taken */
+    std::optional<T> pop()
+    {
+        std::optional<T> item;
+        {
+            std::unique_lock lock(mutex);
+            notEmpty.wait(lock,
+                          [this]
+                          {
+                              return closed || ! items.empty();
+                          });
+            if (items.empty())
+                return std::nullopt;
+
+            item = std::move(items.front());
+            items.pop_front();
+        }
+        notFull.notify_one();
+        return item;
+    }
+
+    /// @brief Refuses further items and wakes all waiting threads (items already queued can still be popped)
+    void close()
+    {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    /// @brief Closes the queue and drops the queued items (used when the consumer stops early)
+    void cancel()
+    {
+        std::deque<T> dropped;
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+            dropped.swap(items);
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    const std::size_t capacity;
+
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    bool closed = false;
+};
@@ -0,0 +1,42 @@
+/** @file CellRowDecoding.h
+ * @brief Optional hook of a model decoding a whole row of a node's text output in one call, and its version. */
+
+#pragma once
+
+#include <span>
+#include <string_view>
+
+/** @brief Version of the row decoding hook (CellWithRowDecoding), exported by plugins as getRowDecodingVersion().
+ *
+ * It is increased whenever the signature or the contract of the hook changes, so the viewer can recognise
+ * plugins built for another version. 0 means that the plugin's model decodes cell by cell (composeElement()). */
+inline constexpr int CELL_ROW_DECODING_VERSION = 1;
+
+/** @concept CellWithRowDecoding
+ * @brief Cell type which decodes a whole row of a node at once (optional hook of a model, version 1).
+ *
+ * Such a type provides a static function:
+ * @code
+ * static void composeRow(std::string_view line, std::span<MyCell> cells);
+ * @endcode
+ * - line is one row of the node's text output: tokens separated by spaces, not null-terminated and not to be modified,
+ * - cells are the cells of the row inside the grid, one per token from the start of the line
+ *   (the row can be clipped, then the remaining tokens are ignored; cells without a token are left unchanged),
+ * - invalid tokens are reported by throwing std::invalid_argument, as composeElement() does.
+ *
+ * ModelReader calls it instead of composeElement() for every token, so the model controls the whole loop
+ * without a virtual call per cell. */
+template<class Cell>
+concept CellWithRowDecoding = requires(std::string_view line, std::span<Cell> cells) {
+    Cell::composeRow(line, cells);
+};
+
+/// @brief Version of the row decoding used for the cell type: CELL_ROW_DECODING_VERSION, or 0 when it decodes cell by cell
+template<class Cell>
+constexpr int cellRowDecodingVersion()
+{
+    if constexpr (CellWithRowDecoding<Cell>)
+        return CELL_ROW_DECODING_VERSION;
+    else
+        return 0;
+}
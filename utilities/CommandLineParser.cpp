@@ -1,9 +1,64 @@
+#include <charconv> // std::from_chars
+#include <cstring>  // std::strcmp
+#include <iterator> // std::size
+#include <format>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
 #include <argparse/argparse.hpp>
 #include <QApplication>
 #include "CommandLineParser.h"
 
 
+namespace
+{
+/// @brief Parses "first:last[:stride]"
+CommandLineParser::StepRange parseStepRange(const std::string& text)
+{
+    CommandLineParser::StepRange range{};
+    int* const fields[] = { &range.first, &range.last, &range.stride };
+
+    std::size_t fieldsCount = 0;
+    const char* position = text.data();
+    const char* const end = text.data() + text.size();
+    while (fieldsCount < std::size(fields))
+    {
+        const auto [next, error] = std::from_chars(position, end, *fields[fieldsCount]);
+        if (error != std::errc{})
+            break;
+        ++fieldsCount;
+        position = next;
+        if (position == end || *position != ':')
+            break;
+        ++position;
+    }
+
+    if (fieldsCount < 2 || position != end)
+    {
+        throw std::invalid_argument(std::format("Invalid step range '{}', expected FIRST:LAST or FIRST:LAST:STRIDE", text));
+    }
+    if (2 == fieldsCount)
+    {
+        range.stride = 1;
+    }
+    if (range.first < 0 || range.first > range.last || range.stride < 1)
+    {
+        throw std::invalid_argument(std::format("Invalid step range '{}', steps must be 0 <= FIRST <= LAST and STRIDE >= 1", text));
+    }
+    return range;
+}
+} // namespace
+
+bool CommandLineParser::isHeadlessRequested(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == std::strcmp(argv[i], ARG_HEADLESS))
+            return true;
+    }
+    return false;
+}
+
 bool CommandLineParser::parse(int argc, char* argv[])
 {
     const auto appName = QApplication::applicationName().toStdString();
@@ -14,7 +69,8 @@ bool CommandLineParser::parse(int argc, char* argv[])
         program.add_epilog("Examples:\n" +
                            std::format("  {} config.txt\n", appName) +
                            std::format("  {} config.txt {}=MyModel\n", appName, ARG_STARTING_MODEL) +
-                           std::format("  {} {}=/tmp/movie {}", appName, ARG_GENERATE_MOVIE, ARG_EXIT_AFTER_LAST));
+                           std::format("  {} {}=/tmp/movie {}\n", appName, ARG_GENERATE_MOVIE, ARG_EXIT_AFTER_LAST) +
+                           std::format("  {} config.txt {} {}=0:100:10 {}=/tmp/step.png", appName, ARG_HEADLESS, ARG_STEP_RANGE, ARG_GENERATE_IMAGE));
 
         // Positional argument: configuration file
         program.add_argument(ARG_CONFIG)
@@ -35,6 +91,15 @@ bool CommandLineParser::parse(int argc, char* argv[])
         program.add_argument(ARG_GENERATE_IMAGE)
             .help("Generate image for current step and save to file");
 
+        program.add_argument(ARG_VIDEO_CODEC)
+            .help(std::format("Codec of the movie of {}: 'theora' (default), 'h264' or 'h265' (fastest available: NVENC, VAAPI, software), "
+                              "or a name of an FFmpeg encoder; FFmpeg codecs require FFmpeg in the build",
+                              ARG_GENERATE_MOVIE));
+
+        program.add_argument(ARG_VIDEO_BITRATE)
+            .help(std::format("Target bitrate of the movie of {} in kbit/s (default of the encoder when not given)", ARG_GENERATE_MOVIE))
+            .scan<'i', int>();
+
         program.add_argument(ARG_STEP)
             .help("Go to specific step directly")
             .scan<'i', int>();
@@ -47,6 +112,38 @@ bool CommandLineParser::parse(int argc, char* argv[])
             .help("Silent mode: Skip displaying information dialogs (usefull when we use commandline arguments)")
             .flag();
 
+        program.add_argument(ARG_HEADLESS)
+            .help(std::format("Render {} or {} offscreen without any window and exit (no X server needed)", ARG_GENERATE_IMAGE, ARG_GENERATE_MOVIE))
+            .flag();
+
+        program.add_argument(ARG_STEP_RANGE)
+            .help("Steps rendered in headless mode: FIRST:LAST or FIRST:LAST:STRIDE");
+
+        program.add_argument(ARG_RAW_GRID_IMAGES)
+            .help(std::format("Images of {} in headless mode are the colours of the grid (one pixel per cell), made without rendering", ARG_GENERATE_IMAGE))
+            .flag();
+
+        program.add_argument(ARG_REDUCTIONS_PATH)
+            .help("Save reductions of substates (the 'reduction' and 'substates' settings) of the steps to a CSV file in headless mode");
+
+        program.add_argument(ARG_PACK_OUTPUT)
+            .help("Pack all node files of the output into one container file (read with 'mode = container') in headless mode")
+            .flag();
+
+        program.add_argument(ARG_PACK_COMPRESSION)
+            .help("Compression of the packed container (and of the served output): 'lz4' (default when available) or 'none'");
+
+        program.add_argument(ARG_SERVE_OUTPUT)
+            .help("Serve the node files to viewers reading them with 'mode = remote' on the TCP port in headless mode (until interrupted)")
+            .scan<'i', int>();
+
+        program.add_argument(ARG_PROFILE)
+            .help("Show times of reading, colouring and rendering of every frame and the frame rate in an overlay")
+            .flag();
+
+        program.add_argument(ARG_PROFILE_TRACE)
+            .help("Record times of all stages and save them at exit as Chrome trace (open in chrome://tracing or ui.perfetto.dev)");
+
         try
         {
             program.parse_args(argc, argv);
@@ -79,11 +176,64 @@ bool CommandLineParser::parse(int argc, char* argv[])
         if (auto path = program.present<std::string>(ARG_GENERATE_IMAGE))
             generateImagePath = *path;
 
+        if (auto codec = program.present<std::string>(ARG_VIDEO_CODEC))
+            videoCodec = *codec;
+
+        if (auto bitrate = program.present<int>(ARG_VIDEO_BITRATE))
+        {
+            if (*bitrate <= 0)
+                throw std::invalid_argument(std::format("{} requires a positive bitrate in kbit/s, got {}", ARG_VIDEO_BITRATE, *bitrate));
+            videoBitrate = static_cast<unsigned>(*bitrate);
+        }
+
         if (auto st = program.present<int>(ARG_STEP))
             step = *st;
 
+        if (auto range = program.present<std::string>(ARG_STEP_RANGE))
+            stepRange = parseStepRange(*range);
+
+        if (auto path = program.present<std::string>(ARG_REDUCTIONS_PATH))
+            reductionsPath = *path;
+
+        if (auto compression = program.present<std::string>(ARG_PACK_COMPRESSION))
+            packCompression = *compression;
+
+        if (auto port = program.present<int>(ARG_SERVE_OUTPUT))
+            serveOutputPort = *port;
+
+        if (auto path = program.present<std::string>(ARG_PROFILE_TRACE))
+            profileTracePath = *path;
+
         exitAfterLastStep = program.is_used(ARG_EXIT_AFTER_LAST);
         silentMode        = program.is_used(ARG_SILENT);
+        headless          = program.is_used(ARG_HEADLESS);
+        packOutput        = program.is_used(ARG_PACK_OUTPUT);
+        rawGridImages     = program.is_used(ARG_RAW_GRID_IMAGES);
+        profile           = program.is_used(ARG_PROFILE);
+
+        if (headless && (! configFile || (! generateImagePath && ! generateMoviePath && ! reductionsPath && ! packOutput && ! serveOutputPort)))
+        {
+            throw std::invalid_argument(std::format("{} requires a configuration file and {}, {}, {}, {} or {}",
+                                                    ARG_HEADLESS, ARG_GENERATE_IMAGE, ARG_GENERATE_MOVIE, ARG_REDUCTIONS_PATH, ARG_PACK_OUTPUT, ARG_SERVE_OUTPUT));
+        }
+        if (rawGridImages && (! headless || ! generateImagePath))
+        {
+            throw std::invalid_argument(std::format("{} is available only with {} and {}", ARG_RAW_GRID_IMAGES, ARG_HEADLESS, ARG_GENERATE_IMAGE));
+        }
+        if (packOutput && ! headless)
+        {
+            throw std::invalid_argument(std::format("{} is available only with {}", ARG_PACK_OUTPUT, ARG_HEADLESS));
+        }
+        if (serveOutputPort)
+        {
+            if (! headless)
+                throw std::invalid_argument(std::format("{} is available only with {}", ARG_SERVE_OUTPUT, ARG_HEADLESS));
+            if (*serveOutputPort < 0 || *serveOutputPort > 65535)
+                throw std::invalid_argument(std::format("{} requires a TCP port (0-65535), got {}", ARG_SERVE_OUTPUT, *serveOutputPort));
+            if (generateImagePath || generateMoviePath || reductionsPath)
+                throw std::invalid_argument(std::format("{} runs until interrupted, it can not be combined with {}, {} or {}",
+                                                        ARG_SERVE_OUTPUT, ARG_GENERATE_IMAGE, ARG_GENERATE_MOVIE, ARG_REDUCTIONS_PATH));
+        }
 
         return true;
     }
@@ -107,12 +257,24 @@ void CommandLineParser::printHelp() const
               << std::format("  {: <{}} Start with specific model\n", ARG_STARTING_MODEL, WIDTH)
               << std::format("  {: <{}} Generate movie by running all steps\n", ARG_GENERATE_MOVIE, WIDTH)
               << std::format("  {: <{}} Generate image for current step\n", ARG_GENERATE_IMAGE, WIDTH)
+              << std::format("  {: <{}} Codec of the movie (theora, h264, h265 or FFmpeg encoder)\n", ARG_VIDEO_CODEC, WIDTH)
+              << std::format("  {: <{}} Target bitrate of the movie in kbit/s\n", ARG_VIDEO_BITRATE, WIDTH)
               << std::format("  {: <{}} Go to specific step directly\n", ARG_STEP, WIDTH)
               << std::format("  {: <{}} Exit after last step\n", ARG_EXIT_AFTER_LAST, WIDTH)
               << std::format("  {: <{}} Suppress error dialogs and messages\n", ARG_SILENT, WIDTH)
+              << std::format("  {: <{}} Render image or movie offscreen without window and exit\n", ARG_HEADLESS, WIDTH)
+              << std::format("  {: <{}} Steps rendered in headless mode (FIRST:LAST[:STRIDE])\n", ARG_STEP_RANGE, WIDTH)
+              << std::format("  {: <{}} Headless images of the grid only, without rendering\n", ARG_RAW_GRID_IMAGES, WIDTH)
+              << std::format("  {: <{}} Save reductions of substates to CSV in headless mode\n", ARG_REDUCTIONS_PATH, WIDTH)
+              << std::format("  {: <{}} Pack node files into one output container in headless mode\n", ARG_PACK_OUTPUT, WIDTH)
+              << std::format("  {: <{}} Compression of the packed container (lz4 or none)\n", ARG_PACK_COMPRESSION, WIDTH)
+              << std::format("  {: <{}} Serve output to viewers in remote mode on the port (headless)\n", ARG_SERVE_OUTPUT, WIDTH)
+              << std::format("  {: <{}} Show times of stages of every frame in an overlay\n", ARG_PROFILE, WIDTH)
+              << std::format("  {: <{}} Save times of all stages as Chrome trace at exit\n", ARG_PROFILE_TRACE, WIDTH)
               << std::format("  {: <{}} Show this help message\n\n", "-h, --help", WIDTH)
               << "Examples:\n"
               << std::format("  {} config.txt\n", appName)
               << std::format("  {} config.txt {}=MyModel\n", appName, ARG_STARTING_MODEL)
-              << std::format("  {} {}=/tmp/movie {}\n", appName, ARG_GENERATE_MOVIE, ARG_EXIT_AFTER_LAST);
+              << std::format("  {} {}=/tmp/movie {}\n", appName, ARG_GENERATE_MOVIE, ARG_EXIT_AFTER_LAST)
+              << std::format("  {} config.txt {} {}=0:100:10 {}=/tmp/step.png\n", appName, ARG_HEADLESS, ARG_STEP_RANGE, ARG_GENERATE_IMAGE);
 }
@@ -19,9 +19,20 @@
  * - startingModel=<name>: Start with specific model
  * - generateMoviePath=<path>: Generate movie by running all steps (testing)
  * - exitAfterLastStep: Exit after last step (useful with generateMoviePath)
+ * - videoCodec=<theora|h264|h265|encoder>: Codec of generated movies (see createVideoEncoder())
+ * - videoBitrate=<kbit/s>: Target bitrate of generated movies
  * - step=<number>: Go to specific step directly
  * - generateImagePath=<path>: Generate image for current step and save to file
  * - silent: Suppress error dialogs
+ * - headless: Render images or movie without any window (no X server needed), then exit
+ * - stepRange=<first>:<last>[:<stride>]: Steps rendered in headless mode
+ * - rawGridImages: Headless images are the colours of the grid, one pixel per cell, made without rendering
+ * - reductionsPath=<path>: Save reductions of substates of the steps to a CSV file in headless mode
+ * - packOutput: Pack the node files into one output container in headless mode (see OutputContainer)
+ * - packCompression=<none|lz4>: Compression of chunks of the packed container (and of the served output)
+ * - serveOutput=<port>: Serve the output to viewers with `mode = remote` in headless mode (see RemoteOutputAgent)
+ * - profile: Show times of stages of every frame in an overlay (see StageProfiler)
+ * - profileTrace=<path>: Record times of all stages and save them as Chrome trace (JSON) at exit
  * - configFile: Path to configuration file (positional argument) */
 class CommandLineParser
 {
@@ -32,9 +43,33 @@ public:
     static constexpr const char ARG_STARTING_MODEL[] = "--startingModel";
     static constexpr const char ARG_GENERATE_MOVIE[] = "--generateMoviePath";
     static constexpr const char ARG_GENERATE_IMAGE[] = "--generateImagePath";
+    static constexpr const char ARG_VIDEO_CODEC[] = "--videoCodec";
+    static constexpr const char ARG_VIDEO_BITRATE[] = "--videoBitrate";
     static constexpr const char ARG_STEP[] = "--step";
     static constexpr const char ARG_EXIT_AFTER_LAST[] = "--exitAfterLastStep";
     static constexpr const char ARG_SILENT[] = "--silent";
+    static constexpr const char ARG_HEADLESS[] = "--headless";
+    static constexpr const char ARG_STEP_RANGE[] = "--stepRange";
+    static constexpr const char ARG_RAW_GRID_IMAGES[] = "--rawGridImages";
+    static constexpr const char ARG_REDUCTIONS_PATH[] = "--reductionsPath";
+    static constexpr const char ARG_PACK_OUTPUT[] = "--packOutput";
+    static constexpr const char ARG_PACK_COMPRESSION[] = "--packCompression";
+    static constexpr const char ARG_SERVE_OUTPUT[] = "--serveOutput";
+    static constexpr const char ARG_PROFILE[] = "--profile";
+    static constexpr const char ARG_PROFILE_TRACE[] = "--profileTrace";
+
+    /// @brief Steps first, first + stride, ... up to last (inclusive)
+    struct StepRange
+    {
+        int first;
+        int last;
+        int stride = 1;
+    };
+
+    /** @brief Whether headless mode is requested, usable before the Qt application is created.
+     *
+     * Headless mode must not create QApplication (it needs a display), so the mode is known before parse(). */
+    static bool isHeadlessRequested(int argc, char* argv[]);
 
     /** @brief Parse command-line arguments.
      * @param argc Number of arguments
@@ -59,6 +94,14 @@ public:
     {
         return generateImagePath;
     }
+    const std::optional<std::string>& getVideoCodec() const
+    {
+        return videoCodec;
+    }
+    const std::optional<unsigned>& getVideoBitrate() const
+    {
+        return videoBitrate;
+    }
     const std::optional<int>& getStep() const
     {
         return step;
@@ -75,6 +118,42 @@ public:
     {
         return silentMode;
     }
+    bool isHeadless() const
+    {
+        return headless;
+    }
+    const std::optional<StepRange>& getStepRange() const
+    {
+        return stepRange;
+    }
+    bool shouldWriteRawGridImages() const
+    {
+        return rawGridImages;
+    }
+    const std::optional<std::string>& getReductionsPath() const
+    {
+        return reductionsPath;
+    }
+    bool shouldPackOutput() const
+    {
+        return packOutput;
+    }
+    const std::optional<std::string>& getPackCompression() const
+    {
+        return packCompression;
+    }
+    const std::optional<int>& getServeOutputPort() const
+    {
+        return serveOutputPort;
+    }
+    bool shouldProfile() const
+    {
+        return profile;
+    }
+    const std::optional<std::string>& getProfileTracePath() const
+    {
+        return profileTracePath;
+    }
 
     /// @brief Print help message with available arguments.
     void printHelp() const;
@@ -84,8 +163,19 @@ private:
     std::optional<std::string> startingModel;
     std::optional<std::string> generateMoviePath;
     std::optional<std::string> generateImagePath;
+    std::optional<std::string> videoCodec;
+    std::optional<unsigned> videoBitrate; ///< kbit/s
     std::optional<int> step;
     std::optional<std::string> configFile;
     bool exitAfterLastStep = false;
     bool silentMode = false;
+    bool headless = false;
+    std::optional<StepRange> stepRange;
+    bool rawGridImages = false;
+    std::optional<std::string> reductionsPath;
+    bool packOutput = false;
+    std::optional<std::string> packCompression;
+    std::optional<int> serveOutputPort;
+    bool profile = false;
+    std::optional<std::string> profileTracePath;
 };
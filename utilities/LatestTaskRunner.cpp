@@ -0,0 +1,116 @@
+/** @file LatestTaskRunner.cpp
+ * @brief Implementation of the LatestTaskRunner class. */
+
+#include "LatestTaskRunner.h"
+
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <exception>
+#include <iostream>
+#include <utility> // std::move
+#include <sys/resource.h> // setpriority
+#include <unistd.h>       // gettid
+
+
+namespace
+{
+/// Nice value of Priority::Background threads (on Linux it is set per thread)
+constexpr int BACKGROUND_NICE_VALUE = 19;
+} // namespace
+
+
+LatestTaskRunner::LatestTaskRunner(Priority priority)
+    : worker{ [this, priority](std::stop_token stopToken)
+              {
+                  workerLoop(stopToken, priority);
+              } }
+{
+}
+
+LatestTaskRunner::~LatestTaskRunner()
+{
+    cancel();
+    worker.request_stop(); // wakes the worker waiting in wakeCondition
+}
+
+void LatestTaskRunner::submit(Task task)
+{
+    {
+        std::lock_guard lock(mutex);
+        runningTaskStopSource.request_stop();
+        waitingTask = std::move(task);
+    }
+    wakeCondition.notify_one();
+}
+
+void LatestTaskRunner::cancel()
+{
+    std::lock_guard lock(mutex);
+    runningTaskStopSource.request_stop();
+    waitingTask.reset();
+}
+
+void LatestTaskRunner::cancelAndWait()
+{
+    std::unique_lock lock(mutex);
+    runningTaskStopSource.request_stop();
+    waitingTask.reset();
+    idleCondition.wait(lock,
+                       [this]
+                       {
+                           return ! taskRunning;
+                       });
+}
+
+bool LatestTaskRunner::isBusy() const
+{
+    std::lock_guard lock(mutex);
+    return taskRunning || waitingTask.has_value();
+}
+
+void LatestTaskRunner::workerLoop(std::stop_token workerStopToken, Priority priority)
+{
+    if (Priority::Background == priority && 0 != setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), BACKGROUND_NICE_VALUE))
+    {
+        std::cerr << "Warning: can't lower priority of a background thread: " << std::strerror(errno) << std::endl;
+    }
+
+    while (true)
+    {
+        Task task;
+        std::stop_token taskStopToken;
+        {
+            std::unique_lock lock(mutex);
+            if (! wakeCondition.wait(lock,
+                                     workerStopToken,
+                                     [this]
+                                     {
+                                         return waitingTask.has_value();
+                                     }))
+            {
+                return; // the runner is being destroyed
+            }
+
+            task = std::move(*waitingTask);
+            waitingTask.reset();
+            runningTaskStopSource = std::stop_source{};
+            taskStopToken = runningTaskStopSource.get_token();
+            taskRunning = true;
+        }
+
+        try
+        {
+            task(taskStopToken);
+        }
+        catch (const std::exception& e) // tasks report their errors themselves, this only keeps the thread alive
+        {
+            std::cerr << "Warning: background task failed: " << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            taskRunning = false;
+        }
+        idleCondition.notify_all();
+    }
+}
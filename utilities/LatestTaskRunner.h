@@ -0,0 +1,64 @@
+/** @file LatestTaskRunner.h
+ * @brief Declaration of the LatestTaskRunner class - background thread running only the newest of requested tasks. */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+/** @class LatestTaskRunner
+ * @brief Runs tasks on one background thread, where every new task supersedes the older ones.
+ *
+ * Submitting a task requests stop of the running task (through its std::stop_token)
+ * and replaces the task waiting for start, so when requests come faster than they can be
+ * processed (e.g. dragging the step slider), only the newest one is finished.
+ * Tasks are expected to check the token regularly and to return early when stop is requested. */
+class LatestTaskRunner
+{
+public:
+    using Task = std::function<void(std::stop_token)>;
+
+    /// @brief Scheduling priority of the background thread
+    enum class Priority
+    {
+        Normal,
+        Background ///< the lowest one (nice value 19 on Linux), for passes nobody waits for, e.g. thumbnails of steps
+    };
+
+    explicit LatestTaskRunner(Priority priority = Priority::Normal);
+
+    /// @brief Stops the running task and joins the thread (the waiting task is dropped)
+    ~LatestTaskRunner();
+
+    LatestTaskRunner(const LatestTaskRunner&) = delete;
+    LatestTaskRunner& operator=(const LatestTaskRunner&) = delete;
+
+    /// @brief Schedules the task, requests stop of the running one and drops the not started one
+    void submit(Task task);
+
+    /// @brief Requests stop of the running task and drops the not started one, does not wait
+    void cancel();
+
+    /// @brief Like cancel(), but also waits until the running task returns
+    void cancelAndWait();
+
+    /// @brief Whether a task is running or waiting for start
+    bool isBusy() const;
+
+private:
+    void workerLoop(std::stop_token workerStopToken, Priority priority);
+
+    mutable std::mutex mutex;
+    std::condition_variable_any wakeCondition;
+    std::condition_variable_any idleCondition;
+    std::optional<Task> waitingTask;
+    std::stop_source runningTaskStopSource;
+    bool taskRunning = false;
+
+    /// Declared last, so the thread is stopped and joined before other members are destroyed
+    std::jthread worker;
+};
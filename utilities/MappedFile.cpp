@@ -0,0 +1,105 @@
+/** @file MappedFile.cpp
+ * @brief Implementation of the MappedFile class. */
+
+#include "MappedFile.h"
+
+#include <algorithm> // std::min
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <format>
+#include <stdexcept>
+#include <utility> // std::exchange
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile(const std::string& filePath)
+    : filePath{ filePath }
+{
+    const int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::format("Can't open '{}' for mapping: {}", filePath, std::strerror(errno)));
+    }
+
+    struct stat fileStat{};
+    if (::fstat(fd, &fileStat) != 0)
+    {
+        const auto error = errno;
+        ::close(fd);
+        throw std::runtime_error(std::format("Can't read size of '{}': {}", filePath, std::strerror(error)));
+    }
+
+    mappedSize = static_cast<std::size_t>(fileStat.st_size);
+    if (mappedSize > 0) // mapping of empty file is not allowed
+    {
+        void* address = ::mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == address)
+        {
+            const auto error = errno;
+            ::close(fd);
+            throw std::runtime_error(std::format("Can't map '{}' into memory: {}", filePath, std::strerror(error)));
+        }
+        mappedData = static_cast<const char*>(address);
+    }
+
+    ::close(fd); // the mapping stays valid after closing descriptor
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : filePath{ std::move(other.filePath) }
+    , mappedData{ std::exchange(other.mappedData, nullptr) }
+    , mappedSize{ std::exchange(other.mappedSize, 0) }
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        filePath = std::move(other.filePath);
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+    }
+    return *this;
+}
+
+std::string_view MappedFile::view(std::size_t offset, std::size_t length) const
+{
+    if (offset > mappedSize || length > mappedSize - offset)
+    {
+        throw std::out_of_range(std::format("Range [{}, {}) exceeds size {} of mapped file '{}'", offset, offset + length, mappedSize, filePath));
+    }
+    return { mappedData + offset, length };
+}
+
+void MappedFile::prefetch(std::size_t offset, std::size_t length) const
+{
+    if (! mappedData || offset >= mappedSize)
+        return;
+
+    // madvise needs an address aligned to a page
+    const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto alignedOffset = offset / pageSize * pageSize;
+    const auto end = std::min(mappedSize, offset + std::min(length, mappedSize - offset));
+    ::madvise(const_cast<char*>(mappedData) + alignedOffset, end - alignedOffset, MADV_WILLNEED); // failure does not matter
+}
+
+void MappedFile::unmap()
+{
+    if (mappedData)
+    {
+        ::munmap(const_cast<char*>(mappedData), mappedSize);
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+}
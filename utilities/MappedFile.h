@@ -0,0 +1,64 @@
+/** @file MappedFile.h
+ * @brief Declaration of the MappedFile class - read-only memory mapping of a whole file. */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/** @class MappedFile
+ * @brief RAII wrapper of a read-only, shared memory mapping of a file (POSIX mmap).
+ *
+ * The file descriptor is closed just after mapping, only the mapping is kept. Data is paged in
+ * by the kernel on access, so reading from the mapping is limited by the page-cache bandwidth.
+ *
+ * @note The mapping covers the file size the file had when it was mapped.
+ *       If the file grows, a new MappedFile has to be created to see appended bytes. */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    /** @brief Maps the whole file into memory.
+     *  @param filePath Path of the file to map
+     *  @throws std::runtime_error If the file cannot be opened or mapped */
+    explicit MappedFile(const std::string& filePath);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return mappedData;
+    }
+
+    std::size_t size() const
+    {
+        return mappedSize;
+    }
+
+    const std::string& path() const
+    {
+        return filePath;
+    }
+
+    /** @brief Returns view of the bytes [offset, offset + length) of the file.
+     *  @throws std::out_of_range If the requested range exceeds mapped file size */
+    std::string_view view(std::size_t offset, std::size_t length) const;
+
+    /// @brief Asks the kernel to page in bytes [offset, offset + length) in background (only a hint, clamped to the mapping)
+    void prefetch(std::size_t offset, std::size_t length) const;
+
+private:
+    void unmap();
+
+    std::string filePath;
+    const char* mappedData = nullptr;
+    std::size_t mappedSize = 0;
+};
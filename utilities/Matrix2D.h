@@ -0,0 +1,113 @@
+/** @file Matrix2D.h
+ * @brief Declaration of the Matrix2D class template - contiguous, row-major 2D grid. */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/** @class Matrix2D
+ * @brief Two dimensional grid stored in a single contiguous, row-major buffer.
+ *
+ * Rows are accessed through views (std::span) placed every columns() elements in the buffer,
+ * so `m[row][column]` keeps working like for a vector of vectors, but the whole grid is one
+ * allocation and consecutive rows lie next to each other in memory.
+ * This allows to fill a row of a node with a single copy and to stream through all cells linearly.
+ *
+ * @tparam T Type of a single element (cell) */
+template<typename T>
+class Matrix2D
+{
+public:
+    using value_type = T;
+    using RowView = std::span<T>;
+    using ConstRowView = std::span<const T>;
+
+    Matrix2D() = default;
+
+    Matrix2D(std::size_t rows, std::size_t columns)
+    {
+        resize(rows, columns);
+    }
+
+    /** @brief Changes dimensions of the grid.
+     *
+     * When the dimensions are different than the current ones, all elements are replaced
+     * with default-constructed ones. Otherwise the grid is left untouched (no reallocation).
+     * @param rows Number of rows (Y dimension)
+     * @param columns Number of columns (X dimension) */
+    void resize(std::size_t rows, std::size_t columns)
+    {
+        if (rows == rowsCount && columns == columnsCount)
+            return;
+
+        cells.clear();
+        cells.resize(rows * columns);
+        rowsCount = rows;
+        columnsCount = columns;
+    }
+
+    std::size_t rows() const
+    {
+        return rowsCount;
+    }
+
+    std::size_t columns() const
+    {
+        return columnsCount;
+    }
+
+    /// @brief Distance (in elements) between beginnings of consecutive rows
+    std::size_t stride() const
+    {
+        return columnsCount;
+    }
+
+    /// @brief Total number of elements (rows * columns)
+    std::size_t size() const
+    {
+        return cells.size();
+    }
+
+    bool empty() const
+    {
+        return cells.empty();
+    }
+
+    RowView operator[](std::size_t row)
+    {
+        return RowView{ cells.data() + row * stride(), columnsCount };
+    }
+
+    ConstRowView operator[](std::size_t row) const
+    {
+        return ConstRowView{ cells.data() + row * stride(), columnsCount };
+    }
+
+    T* data()
+    {
+        return cells.data();
+    }
+
+    const T* data() const
+    {
+        return cells.data();
+    }
+
+    /// @brief All elements in row-major order
+    std::span<T> flat()
+    {
+        return cells;
+    }
+
+    std::span<const T> flat() const
+    {
+        return cells;
+    }
+
+private:
+    std::vector<T> cells;
+    std::size_t rowsCount = 0;
+    std::size_t columnsCount = 0;
+};
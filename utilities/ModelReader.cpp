@@ -1,7 +1,30 @@
 #include "ModelReader.hpp"
 
+#include <charconv> // std::from_chars
 
-ColumnAndRow ReaderHelpers::getColumnAndRowFromLine(const std::string& line)
+
+namespace
+{
+/// @brief Number at the beginning of the text (after spaces) like std::stoi, but without a copy of the text
+int parseHeaderNumber(std::string_view text, std::string_view line)
+{
+    while (! text.empty() && ' ' == text.front())
+        text.remove_prefix(1);
+    if (text.starts_with('+'))
+        text.remove_prefix(1);
+
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (std::errc::result_out_of_range == error)
+        throw std::out_of_range(std::format("Number out of range in the line: >{}<", line));
+    if (std::errc{} != error)
+        throw std::invalid_argument(std::format("Invalid number of columns or rows in the line: >{}<", line));
+    return value;
+}
+} // namespace
+
+
+ColumnAndRow ReaderHelpers::getColumnAndRowFromLine(std::string_view line)
 {
     /// input format: "C-R" where C and R are numbers
     if (line.empty())
@@ -10,13 +33,13 @@ ColumnAndRow ReaderHelpers::getColumnAndRowFromLine(const std::string& line)
     }
 
     const auto delimiterPos = line.find('-');
-    if (delimiterPos == std::string::npos)
+    if (delimiterPos == std::string_view::npos)
     {
-        throw std::runtime_error("No delimiter '-' found in the line: >" + line + "<");
+        throw std::runtime_error(std::format("No delimiter '-' found in the line: >{}<", line));
     }
 
-    const auto x = std::stoi(line.substr(0, delimiterPos));
-    const auto y = std::stoi(line.substr(delimiterPos + 1));
+    const auto x = parseHeaderNumber(line.substr(0, delimiterPos), line);
+    const auto y = parseHeaderNumber(line.substr(delimiterPos + 1), line);
     return ColumnAndRow::xy(x, y);
 }
 
@@ -43,3 +66,29 @@ ColumnAndRow ReaderHelpers::calculateXYOffsetForNode(NodeIndex node,
     }
     return ColumnAndRow::xy(offsetX, offsetY);
 }
+
+std::uint64_t ReaderHelpers::hashBytes(std::string_view bytes, std::uint64_t seed)
+{
+    /// multiply-xorshift rounds over 8-byte words (constants of the 64-bit MurmurHash finalizer)
+    constexpr std::uint64_t multiplier = 0xff51afd7ed558ccdULL;
+    const auto mix = [](std::uint64_t hash, std::uint64_t word)
+    {
+        hash ^= word;
+        hash *= multiplier;
+        return hash ^ (hash >> 33);
+    };
+
+    std::uint64_t hash = mix(seed, bytes.size());
+    std::size_t position = 0;
+    for (; position + sizeof(std::uint64_t) <= bytes.size(); position += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes.data() + position, sizeof(word));
+        hash = mix(hash, word);
+    }
+
+    std::uint64_t lastWord = 0;
+    if (position < bytes.size())
+        std::memcpy(&lastWord, bytes.data() + position, bytes.size() - position);
+    return mix(hash, lastWord);
+}
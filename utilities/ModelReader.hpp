@@ -7,24 +7,64 @@
 
 #pragma once
 
-#include <algorithm> // std::ranges::sort
-#include <climits>   // INT_MAX
-#include <cmath>     // log10
+#include <algorithm> // std::ranges::all_of, std::ranges::upper_bound, std::min, std::clamp
+#include <atomic>
+#include <cstdint>
 #include <cstring>   // std::memcpy
 #include <filesystem>
 #include <format>
-#include <fstream>
-#include <future>
+#include <functional>
 #include <iostream>
-#include <ranges>
-#include <regex>
+#include <iterator> // std::back_inserter
+#include <memory> // std::shared_ptr
+#include <mutex>
+#include <optional>
+#include <ranges> // std::views::drop
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <type_traits> // std::is_trivially_copyable_v
 #include <unordered_map>
 #include <vector>
 
+#include "CellRowDecoding.h"
+#include "MappedFile.h"
+#include "Matrix2D.h"
+#include "NodeFilePool.h"
+#include "NodeStepOffsets.h"
+#include "OutputContainer.h"
+#include "RemoteOutput.h"
+#include "StageProfiler.h"
+#include "StepLayout.h"
+#include "TextBlockReader.h"
+#include "TextRowIndex.h"
+#include "ThreadPool.h"
+#include "WorkerArenas.h"
 #include "types.h"
 #include "visualiser/Line.h"
 #include "visualiser/SettingParameter.h"
 
+/** @concept CellWithStringViewParsing
+ * @brief Cell type which can parse its text token given as std::string_view (optional hook of a model).
+ *
+ * Such a type provides `void composeElement(std::string_view token)`, e.g. implemented with std::from_chars.
+ * The token is not null-terminated and is not modified, so the reader does not need to touch the line.
+ * Cells without it get the null-terminated token through the legacy composeElement(char*). */
+template<class Cell>
+concept CellWithStringViewParsing = requires(Cell& cell, std::string_view token) {
+    cell.composeElement(token);
+};
+
+/** @brief Called by ModelReader::readStageStateFromFilesForStep() after cells of a node were read into the matrix.
+ *
+ * It runs on the worker thread which read the node, right after parsing (while the cells are still in the CPU cache),
+ * so work derived from the cells (e.g. reductions) needs no separate pass over the grid.
+ * Called concurrently for different nodes, not called for nodes which were skipped or whose reading was stopped.
+ * @param node Index of the node
+ * @param cells Cells of the node in the matrix (clipped to the grid) */
+using NodeReadCallback = std::function<void(NodeIndex node, const CellRegion& cells)>;
+
 /** @class ModelReader
  * @brief Template class for reading and processing model data from files.
  * 
@@ -38,14 +78,52 @@ template<class Cell>
 class ModelReader
 {
 public:
-    struct StepOffsetInfo
+    using StepOffsetInfo = ::StepOffsetInfo;
+
+    using StepLayout = ::StepLayout;
+
+private:
+    std::vector<NodeStepOffsets> nodeStepOffsets; ///< Sorted file positions of steps, for every node
+
+    /** Binary node files, mapped on first use and kept for the whole stage.
+     *  Readers hold their own reference, so remapping a grown file does not invalidate them. */
+    std::vector<std::shared_ptr<const MappedFile>> mappedBinaryNodeFiles;
+    std::mutex mappedBinaryNodeFilesMutex;
+
+    /// Text node files, opened once for the stage and read with positional reads (shared by all reading threads)
+    NodeFilePool textNodeFiles;
+
+    /// Positions of rows of text node files found by cell probes (see readCellsOfSteps())
+    TextRowIndex textRowIndex;
+
+    /// Container with text of all nodes (`mode = container`), nullptr when the node files are read
+    std::shared_ptr<const OutputContainer> outputContainer;
+
+    /// Agent sending the nodes of steps (`mode = remote`), nullptr when the output is read locally
+    std::shared_ptr<RemoteOutputClient> remoteOutput;
+    std::string remoteAgentAddress; ///< "host:port" of the agent, used by the next load of the index in the remote mode
+
+    /** Layouts of steps already read. In text mode the sizes come from the header lines of the data files,
+     *  so they are read only on the first visit of the step (unless the index provides them). */
+    std::unordered_map<StepIndex, std::shared_ptr<const StepLayout>> stepLayouts;
+    /// The last built layout, shared by following steps with the same sizes in the index (no layout is built for them)
+    std::shared_ptr<const StepLayout> lastStepLayout;
+    std::mutex stepLayoutsMutex;
+
+    /// Long-lived workers reading node files, so step changes do not create a thread per node
+    mutable ThreadPool threadPool; // mutable: also used by const validation of the stage
+
+    /// Scratch memory of reading one node, grown by the first steps of the stage and reused by all following ones
+    struct NodeReadBuffers
     {
-        FilePosition position;
-        std::optional<ColumnAndRow> sceneSize;
+        std::vector<char> textBlocks;       ///< blocks of the TextBlockReader
+        std::vector<char> decompressedText; ///< the node's chunk of the container or its text received from the agent
+        std::string fileName;               ///< name of the node's data file
+        std::vector<Cell> rowCells;         ///< a row decoded from its beginning by a cell probe (models decoding whole rows)
     };
 
-private:
-    std::vector<std::unordered_map<StepIndex, StepOffsetInfo>> nodeStepOffsets; ///< Maps node indices to their file positions for each step
+    /// Buffers of the workers of threadPool (and of the threads reading with them), released by clearStage()
+    WorkerArenas<NodeReadBuffers> readBuffers{ threadPool };
 
 public:
     /** @brief Prepares the reader for a new stage of data processing.
@@ -58,12 +136,29 @@ public:
     void prepareStage(NodeIndex nNodeX, NodeIndex nNodeY)
     {
         nodeStepOffsets.resize(nNodeX * nNodeY);
+        clearStepLayouts();
+        textNodeFiles.reset(nNodeX * nNodeY);
+        textRowIndex.clear();
+        outputContainer.reset();
+        remoteOutput.reset();
+
+        std::lock_guard lock(mappedBinaryNodeFilesMutex);
+        mappedBinaryNodeFiles.resize(nNodeX * nNodeY);
     }
 
     /// @brief Clears the current stage and releases associated resources.
     void clearStage()
     {
         nodeStepOffsets.clear();
+        clearStepLayouts();
+        textNodeFiles.clear();
+        textRowIndex.clear();
+        outputContainer.reset();
+        remoteOutput.reset();
+        readBuffers.clear();
+
+        std::lock_guard lock(mappedBinaryNodeFilesMutex);
+        mappedBinaryNodeFiles.clear();
     }
 
     /** @brief Reads the stage state from files for a specific step.
@@ -71,16 +166,49 @@ public:
      * This method reads the model state for a specific simulation step and updates
      * the provided matrix and settings accordingly.
      * 
-     * @tparam Matrix The matrix type used to store the model state
+     * @tparam Matrix The matrix type used to store the model state (Matrix2D<Cell>: rows(), columns() and contiguous row views)
      * @param m Reference to the matrix that will store the model state
      * @param sp Pointer to the setting parameters
-     * @param lines Pointer to the line data structure */
+     * @param lines Pointer to the line data structure
+     * @param stopToken When stop is requested, reading ends early (checked before every row), the matrix is left partially filled
+     * @param contents If given, receives the layout of the step, hashes of raw data of the nodes and which nodes were read.
+     *                 Nodes marked as read in contents of the same layout are skipped (the matrix already has them).
+     * @param onNodeRead If given, called for every node read now (see NodeReadCallback)
+     * @note Only nodes intersecting sp->regionOfInterest are read, when it is set
+     * @return false if reading was stopped before all nodes were read */
     template<class Matrix>
-    void readStageStateFromFilesForStep(Matrix& m, SettingParameter* sp, Line* lines);
-
-    /** @brief Loads step offset data from text files into an internal hash map.
+    bool readStageStateFromFilesForStep(Matrix& m,
+                                        SettingParameter* sp,
+                                        Line* lines,
+                                        std::stop_token stopToken = {},
+                                        StepContents* contents = nullptr,
+                                        const NodeReadCallback& onNodeRead = {});
+
+    /** @brief Reads the cells of a small window of the grid in many steps (e.g. a cell probed over time), without reading whole steps.
+     *
+     * Only the nodes owning cells of the window are read, and only their rows inside it: in the binary mode the cells are
+     * copied straight from their offsets in the mapped file, in the text mode the rows are read with one positional read each
+     * through TextRowIndex (the first probe of a node's step scans its line ends up to the row, following probes seek to it).
+     * In the container mode the node's chunk is decompressed and the rows before the window are skipped.
+     * Steps are read in parallel by the reader's pool.
+     * @param sp Parameters of the stage, the step and the region of interest inside are ignored
+     * @param window Cells to read, clipped to the grid
+     * @param steps Steps to read, they have to be in the index of the nodes owning the window
+     * @param stopToken When stop is requested, reading ends early and std::nullopt is returned
+     * @return Cells of the clipped window in every step (in the order of steps), cells of nodes without the step in the layout are default
+     * @throws std::runtime_error If a step cannot be read, or in the remote mode (the agent sends whole nodes) */
+    std::optional<std::vector<Matrix2D<Cell>>> readCellsOfSteps(const SettingParameter& sp,
+                                                                const CellRegion& window,
+                                                                std::span<const StepIndex> steps,
+                                                                std::stop_token stopToken = {});
+
+    /** @brief Loads step offset data of all nodes into dense sorted arrays.
      *
-     * Supports two file formats:
+     * Every node's index is taken from its binary sidecar `<output>N_index.cache` when it is up to date
+     * (same size and modification time of the text index), otherwise the text index is parsed
+     * and the sidecar is written for the next time (see NodeStepOffsets).
+     *
+     * Supports two text file formats:
      * 1) Legacy format:
      *      <stepNumber:int> <positionInFile:long>
      * 2) Extended format:
@@ -90,12 +218,39 @@ public:
      *      0 0 (250-500)
      *      1 2000000 (250-500)
      *
+     * Nodes are loaded in parallel by the reader's thread pool.
+     *
+     * In the container mode the index of all nodes is taken from the header of the container `<filename>.oocpack`
+     * (see OutputContainer) and the steps are read from its chunks instead of the node files.
+     * In the remote mode the index and the steps are received from the agent set by setRemoteAgent() (see RemoteOutputClient).
+     *
      * @param nNodeX Number of nodes along the X axis
      * @param nNodeY Number of nodes along the Y axis
      * @param filename Name of the file containing the step offsets
+     * @param readMode The `mode` setting: "text", "binary", "container" or "remote"
+     * @param progress Optional callback called after every loaded node (from worker threads, so it has to be thread-safe)
+     * @param firstStep Step to be shown first: as soon as a node's index is loaded, its data file is opened and the kernel
+     *                  starts reading the step into the page cache, so the first step is read while other indices are loaded
+     *                  (text and binary modes)
      *
      * @throws std::runtime_error If the file cannot be opened or has an invalid format */
-    void readStepsOffsetsForAllNodesFromFiles(NodeIndex nNodeX, NodeIndex nNodeY, const std::string& filename);
+    void readStepsOffsetsForAllNodesFromFiles(NodeIndex nNodeX,
+                                              NodeIndex nNodeY,
+                                              const std::string& filename,
+                                              const std::string& readMode,
+                                              const IndexLoadingProgressCallback& progress = {},
+                                              std::optional<StepIndex> firstStep = std::nullopt);
+
+    /** @brief Reads only lines appended to the nodes' text index files since they were loaded.
+     *
+     * Used to follow a simulation which is still writing its output: known steps stay untouched,
+     * so cached step layouts and open files are kept. Nodes are processed in parallel.
+     * An output container does not grow, so nothing is appended in the container mode (nor in the remote mode,
+     * where the agent sends the index read when the stage is loaded).
+     * @param filename Name of the file containing the step offsets (the same as in readStepsOffsetsForAllNodesFromFiles())
+     * @return Number of appended lines in all nodes, and whether any index had to be parsed again from the start
+     * @throws std::runtime_error If an index file cannot be read or has an invalid format */
+    IndexAppendResult appendStepsOffsetsForAllNodesFromFiles(const std::string& filename);
 
     /** @brief Returns a sorted list of all available simulation steps.
      *
@@ -121,45 +276,133 @@ public:
      *         - the step sets differ between nodes. */
     std::vector<StepIndex> availableSteps(bool throwOnMismatch = false) const;
 
+    /// @brief Checks if every node of the stage has the step in its index (no file is touched)
+    bool hasStep(StepIndex step) const;
+
+    /** @brief Returns sorted steps which are in the index of every node (without warnings about differences).
+     *  While a simulation is still running, nodes which are ahead have more steps than the others. */
+    std::vector<StepIndex> stepsInAllNodes() const;
+
+    /// @brief Sets how many text node files are kept open between steps (the least recently used are closed above it)
+    void setMaxOpenFiles(std::size_t maxOpenFiles)
+    {
+        textNodeFiles.setMaxOpenFiles(maxOpenFiles);
+    }
+
+    /// @brief Sets the address ("host:port") of the agent from which the next stage is read in the remote mode
+    void setRemoteAgent(const std::string& address)
+    {
+        remoteAgentAddress = address;
+    }
+
+    /** @brief In the remote mode asks the agent for the steps ahead, so they are on the way when they are read
+     *  (see RemoteOutputClient::fetchAhead()). Does nothing in other modes.
+     *  @param sp Parameters of the stage, only nodes intersecting sp.regionOfInterest are requested (the step inside is ignored) */
+    void fetchStepsAhead(const SettingParameter& sp, std::span<const StepIndex> steps);
+
 private:
     FilePosition getStepStartingPositionInFile(StepIndex step, NodeIndex node) const;
 
-    /** @brief Opens the data file for a given simulation step and node.
+    /// @brief Returns node dimensions stored in the index file (required in binary mode)
+    ColumnAndRow getSceneSizeFromStepOffsets(StepIndex step, NodeIndex node) const;
+
+    /** @brief Returns mapping of the node's binary file containing at least requiredSize bytes.
+     *
+     * The file is mapped on the first use in the stage and the mapping is reused for all steps.
+     * It is mapped again only when it is too short (e.g. the simulation appended more steps).
+     * @throws std::runtime_error If the file cannot be mapped */
+    std::shared_ptr<const MappedFile> mappedBinaryNodeFile(const std::string& fileName, NodeIndex node, std::size_t requiredSize);
+
+    /** @brief Opens the node's data file and asks the kernel to read the step's bytes in background (up to the next step in the file).
+     *  Failures are ignored: the step is read (and errors are reported) when it is shown. */
+    void prefetchStepOfNode(const std::string& fileName, NodeIndex node, StepIndex step, bool isBinary);
+
+    /** @brief Returns reader of the text data of a given simulation step and node.
      *
-     * The function locates the correct file for the specified node (e.g. "ball3.txt", where 3 is node number),
-     * seeks to the byte position corresponding to the given simulation step in file,
-     * reads the first header line containing local grid dimensions (columns and rows),
-     * and returns an input file stream positioned right after that header.
+     * The function takes the node's file (e.g. "ball3.txt", where 3 is node number) from the pool of open files,
+     * reads (with positional reads, from the byte position of the step) the first header line containing
+     * local grid dimensions (columns and rows), and returns the reader positioned right after that header.
+     * In the container mode the text is the node's chunk of the container, decompressed by the calling thread.
      *
      * @param step         Simulation step number.
      * @param fileName     Base file name (without node index or extension).
      * @param node         Node index for which data should be opened.
+     * @param buffers      Storage for blocks of the reader, for the decompressed chunk and the file name.
+     *                     It has to be kept as long as the reader.
      * @param columnAndRow Output: number of local columns and rows read from header line.
+     * @param blockSize    Size of blocks read at once (small when only the header is needed).
      *
-     * @return std::ifstream Stream ready for reading cell data of this node at given step.
-     * @throws std::runtime_error If the file cannot be opened, seek fails, or header is invalid. */
-    [[nodiscard]] std::ifstream readColumnAndRowForStepFromFileReturningStream(StepIndex step,
-                                                                               const std::string& fileName,
-                                                                               NodeIndex node,
-                                                                               ColumnAndRow& columnAndRow,
-                                                                               bool isBinary = false);
+     * @return TextBlockReader Reader of the rows of cell data of this node at given step.
+     * @throws std::runtime_error If the file cannot be opened or read, or header is invalid. */
+    [[nodiscard]] TextBlockReader openTextNodeDataForStep(StepIndex step,
+                                                          const std::string& fileName,
+                                                          NodeIndex node,
+                                                          NodeReadBuffers& buffers,
+                                                          ColumnAndRow& columnAndRow,
+                                                          std::size_t blockSize = TextBlockReader::DEFAULT_BLOCK_SIZE);
 
     [[nodiscard]] ColumnAndRow readColumnAndRowForStepFromFile(StepIndex step, const std::string& fileName, NodeIndex node, bool isBinary = false);
 
-    std::vector<ColumnAndRow> giveMeLocalColsAndRowsForAllSteps(StepIndex step,
-                                                                NodeIndex nNodeX,
-                                                                NodeIndex nNodeY,
-                                                                const std::string& fileName,
-                                                                bool isBinary = false);
+    /** @brief Reads the cells of the window owned by the node in the step into the cells of the window (see readCellsOfSteps())
+     *  @param window Clipped to the grid, it intersects the node */
+    void readWindowOfNode(const SettingParameter& sp, const StepLayout& layout, NodeIndex node, const CellRegion& window, Matrix2D<Cell>& cells);
+
+    /** @brief Parses the cells of columns [firstColumn, firstColumn + destination.size()) of a node's text row.
+     *  @param line Text of the row, with a writable byte after it (tokens may be terminated in place)
+     *  @param rowCells Storage of the cells before the columns, for models decoding whole rows (CellWithRowDecoding) */
+    static void decodeTextRowPart(std::span<char> line, int firstColumn, std::span<Cell> destination, std::vector<Cell>& rowCells);
+
+    /** @brief Layout of a probed step (see readCellsOfSteps()), new layouts are not added to the known ones.
+     *
+     * The known layout of the step is used, or the reference one when the sizes in the index are equal to it. In text mode
+     * without sizes in the index, only the headers of the deciding nodes are read: when they have the sizes of the reference,
+     * the window's cells are at the same places (the layout may differ only in other nodes). Otherwise the whole layout is built.
+     * @param decidingNodes Nodes owning the window in the reference layout, and the nodes before them in their row and column of nodes */
+    std::shared_ptr<const StepLayout> probedStepLayout(const SettingParameter& sp,
+                                                       bool isBinary,
+                                                       const std::shared_ptr<const StepLayout>& reference,
+                                                       std::span<const NodeIndex> decidingNodes);
+
+    /// @brief Builds the layout of the step, from the sizes in the index or from the header lines of the nodes read in parallel
+    std::shared_ptr<StepLayout> buildStepLayout(const SettingParameter& sp, bool isBinary);
+
+    /// @brief Size of the node in the step, from the index or from the header line of its data file
+    ColumnAndRow nodeSizeInStep(StepIndex step, const std::string& fileName, NodeIndex node, bool isBinary);
+
+    /** @brief Returns sizes and offsets of all nodes for the step, from the cache or built in parallel.
+     *
+     * Sizes are taken from the index when it contains them (always in binary mode), otherwise
+     * headers of the text data files are read (through the pool of open files, so reading
+     * the cells afterwards does not open the files again). */
+    std::shared_ptr<const StepLayout> giveMeStepLayout(const SettingParameter& sp, bool isBinary);
+
+    void clearStepLayouts()
+    {
+        std::lock_guard lock(stepLayoutsMutex);
+        stepLayouts.clear();
+        lastStepLayout.reset();
+    }
+
+    /// @brief Whether sizes of all nodes in the step are in the index and equal to the ones of the layout
+    bool hasSceneSizesInIndex(StepIndex step, const StepLayout& layout) const;
 };
 
 /////////////////////////////
 namespace ReaderHelpers /// functions which are not templates
 {
-[[nodiscard]] inline std::string giveMeFileName(const std::string& fileName, NodeIndex node, bool isBinary = false)
+/// @brief Writes the name of giveMeFileName() into the string, which keeps its capacity (no allocation when it is big enough)
+inline void assignFileName(std::string& destination, const std::string& fileName, NodeIndex node, bool isBinary = false)
 {
     const auto extention = isBinary ? "bin" : "txt";
-    return std::format("{}{}.{}", fileName, node, extention);
+    destination.clear();
+    std::format_to(std::back_inserter(destination), "{}{}.{}", fileName, node, extention);
+}
+
+[[nodiscard]] inline std::string giveMeFileName(const std::string& fileName, NodeIndex node, bool isBinary = false)
+{
+    std::string name;
+    assignFileName(name, fileName, node, isBinary);
+    return name;
 }
 
 [[nodiscard]] inline std::string giveMeFileNameIndex(const std::string& fileName, NodeIndex node)
@@ -167,90 +410,176 @@ namespace ReaderHelpers /// functions which are not templates
     return std::format("{}{}_index.txt", fileName, node);
 }
 
-ColumnAndRow getColumnAndRowFromLine(const std::string& line);
+/** @brief Parses the header line "C-R" of a node's step (columns and rows).
+ *  @throws std::invalid_argument If the line is empty or a number is invalid
+ *  @throws std::runtime_error If there is no delimiter
+ *  @throws std::out_of_range If a number does not fit into int */
+ColumnAndRow getColumnAndRowFromLine(std::string_view line);
+
+/** @brief Returns reader of the text of a node's step held in memory, positioned after the header line.
+ *  @param owner Keeps the storage of the text alive while the reader exists
+ *  @param columnAndRow Output: number of local columns and rows read from header line
+ *  @param describe Returns what the text is, called only for the error message
+ *  @throws std::runtime_error If the text is empty or the header is invalid */
+template<class Describe>
+[[nodiscard]] TextBlockReader openTextInMemory(std::string_view text,
+                                               std::shared_ptr<const void> owner,
+                                               std::vector<char>& buffer,
+                                               ColumnAndRow& columnAndRow,
+                                               std::size_t blockSize,
+                                               const Describe& describe)
+{
+    TextBlockReader reader(
+        [text](char* destination, std::size_t maxBytes) mutable
+        {
+            const auto bytesRead = std::min(maxBytes, text.size());
+            std::memcpy(destination, text.data(), bytesRead);
+            text.remove_prefix(bytesRead);
+            return bytesRead;
+        },
+        buffer,
+        blockSize,
+        std::move(owner));
+
+    std::span<char> headerLine;
+    if (! reader.readLine(headerLine))
+        throw std::runtime_error(std::format("Empty text of {}", describe()));
+
+    columnAndRow = getColumnAndRowFromLine(std::string_view(headerLine.data(), headerLine.size()));
+    return reader;
+}
 
 ColumnAndRow calculateXYOffsetForNode(NodeIndex node, NodeIndex nNodeX, NodeIndex nNodeY, const std::vector<ColumnAndRow>& columnsAndRows);
+
+/** @brief Fast non-cryptographic 64-bit hash of the bytes (8 bytes per round), used to find unchanged node data.
+ *  @param seed Hash of the preceding bytes, so data read in parts (e.g. lines) can be hashed incrementally */
+[[nodiscard]] std::uint64_t hashBytes(std::string_view bytes, std::uint64_t seed = 0);
 } // namespace ReaderHelpers
 /////////////////////////////
 
 template<class Cell>
 ColumnAndRow ModelReader<Cell>::readColumnAndRowForStepFromFile(StepIndex step, const std::string& fileName, NodeIndex node, bool isBinary)
 {
+    if (isBinary) // dimensions are in the index, no need to touch the data file
+        return getSceneSizeFromStepOffsets(step, node);
+
+    constexpr std::size_t headerBlockSize = 256; // only the header line is needed
+    const auto buffers = readBuffers.acquire();
     ColumnAndRow columnAndRow;
-    std::ifstream file [[maybe_unused]] = readColumnAndRowForStepFromFileReturningStream(step, fileName, node, columnAndRow, isBinary);
+    [[maybe_unused]] auto reader = openTextNodeDataForStep(step, fileName, node, *buffers, columnAndRow, headerBlockSize);
     return columnAndRow;
 }
 
 template<class Cell>
-std::ifstream ModelReader<Cell>::readColumnAndRowForStepFromFileReturningStream(StepIndex step,
-                                                                                const std::string& fileName,
-                                                                                NodeIndex node,
-                                                                                ColumnAndRow& columnAndRow,
-                                                                                bool isBinary)
+TextBlockReader ModelReader<Cell>::openTextNodeDataForStep(StepIndex step,
+                                                           const std::string& fileName,
+                                                           NodeIndex node,
+                                                           NodeReadBuffers& buffers,
+                                                           ColumnAndRow& columnAndRow,
+                                                           std::size_t blockSize)
 {
-    const auto fileNameTmp = ReaderHelpers::giveMeFileName(fileName, node, isBinary);
-
-    std::ifstream file(fileNameTmp, isBinary ? std::ios::binary : std::ios::in);
-    if (! file.is_open())
+    if (outputContainer)
     {
-        throw std::runtime_error(std::format("Can't read '{}' in {} function", fileNameTmp, __func__));
+        const auto* chunk = outputContainer->findChunk(node, step);
+        if (! chunk)
+            throw std::out_of_range(std::format("Step {} not found in node {} of '{}'", step, node, outputContainer->path()));
+
+        return ReaderHelpers::openTextInMemory(outputContainer->chunkData(*chunk, buffers.decompressedText),
+                                               outputContainer,
+                                               buffers.textBlocks,
+                                               columnAndRow,
+                                               blockSize,
+                                               [&]
+                                               {
+                                                   return std::format("chunk of step {} of node {} in '{}'", step, node, outputContainer->path());
+                                               });
     }
 
+    ReaderHelpers::assignFileName(buffers.fileName, fileName, node);
     const auto fPos = getStepStartingPositionInFile(step, node);
-    file.seekg(fPos);
-    if (! file)
-    {
-        throw std::runtime_error(std::format("Seek failed in '{}' at position {}", fileNameTmp, fPos));
-    }
-
-    if (isBinary)
-    {
-        // For binary mode, read dimensions from sceneSize in StepOffsetInfo
-        if (node >= nodeStepOffsets.size())
-            throw std::runtime_error(std::format("Invalid node index {} in binary mode", node));
+    auto file = textNodeFiles.file(node, buffers.fileName);
+    const NodeFile* openFile = file.get(); // the reader keeps the file open
 
-        const auto& stepMap = nodeStepOffsets[node];
-        if (auto it = stepMap.find(step); it != stepMap.end() && it->second.sceneSize.has_value())
+    TextBlockReader reader(
+        [file = openFile, readPosition = fPos](char* destination, std::size_t maxBytes) mutable
         {
-            columnAndRow = it->second.sceneSize.value();
-        }
-        else
-        {
-            throw std::runtime_error(std::format("Binary mode requires sceneSize in step offset info for step {} node {}", step, node));
-        }
-    }
-    else
+            const auto bytesRead = file->readAt(readPosition, destination, maxBytes);
+            readPosition += static_cast<FilePosition>(bytesRead);
+            return bytesRead;
+        },
+        buffers.textBlocks,
+        blockSize,
+        std::move(file));
+
+    // Header line with dimensions
+    std::span<char> headerLine;
+    if (! reader.readLine(headerLine))
     {
-        // For text mode, read header line with dimensions
-        std::string line;
-        if (! std::getline(file, line))
-        {
-            throw std::runtime_error(std::format("Failed to read line from '{}' at position {}", fileNameTmp, fPos));
-        }
-
-        columnAndRow = ReaderHelpers::getColumnAndRowFromLine(line);
+        throw std::runtime_error(std::format("Failed to read line from '{}' at position {}", buffers.fileName, fPos));
     }
 
-    return file;
+    columnAndRow = ReaderHelpers::getColumnAndRowFromLine(std::string_view(headerLine.data(), headerLine.size()));
+    return reader;
 }
 
 template<class Cell>
 template<class Matrix>
-void ModelReader<Cell>::readStageStateFromFilesForStep(Matrix& m, SettingParameter* sp, Line* lines)
+bool ModelReader<Cell>::readStageStateFromFilesForStep(Matrix& m,
+                                                       SettingParameter* sp,
+                                                       Line* lines,
+                                                       std::stop_token stopToken,
+                                                       StepContents* contents,
+                                                       const NodeReadCallback& onNodeRead)
 {
     const auto totalNodes = sp->nNodeX * sp->nNodeY;
     const bool isBinary = (sp->readMode == "binary");
-    const auto columnsAndRows = giveMeLocalColsAndRowsForAllSteps(sp->step, sp->nNodeX, sp->nNodeY, sp->outputFileName, isBinary);
+    if (sp->readMode == "container" && ! outputContainer)
+        throw std::runtime_error("Container mode requires the index read from the output container first");
+    if (sp->readMode == "remote" && ! remoteOutput)
+        throw std::runtime_error("Remote mode requires the index received from the agent first");
+
+    const auto layout = giveMeStepLayout(*sp, isBinary);
+    if (contents)
+    {
+        const bool continuesPreviousRead = contents->layout && *contents->layout == *layout && contents->nodesRead.size() == totalNodes;
+        if (! continuesPreviousRead)
+        {
+            contents->nodeHashes.assign(totalNodes, 0);
+            contents->nodesRead.assign(totalNodes, 0);
+        }
+        contents->layout = layout;
+    }
+
+    // in the remote mode all nodes which will be read come in one reply of the agent (maybe requested ahead)
+    std::shared_ptr<const RemoteStepData> remoteStep;
+    if (remoteOutput)
+    {
+        std::vector<NodeIndex> neededNodes;
+        for (NodeIndex node = 0; node < totalNodes; ++node)
+        {
+            if (contents && contents->nodesRead[node])
+                continue;
+            if (sp->regionOfInterest && ! sp->regionOfInterest->intersects(layout->offsetsXY[node], layout->sceneSizes[node]))
+                continue;
+            neededNodes.push_back(node);
+        }
+        if (! neededNodes.empty())
+        {
+            ScopedStageTimer receiveTimer(ProfiledStage::OpenNode);
+            remoteStep = remoteOutput->takeStep(sp->step, neededNodes, stopToken);
+            if (! remoteStep)
+                return false;
+        }
+    }
 
     /// Lambda responsible for reading and processing a single node's file
     auto processNode = [&, this](NodeIndex node)
     {
-        const auto offsetXY = ReaderHelpers::calculateXYOffsetForNode(node, sp->nNodeX, sp->nNodeY, columnsAndRows);
+        if (stopToken.stop_requested())
+            return;
 
-        ColumnAndRow columnAndRow;
-        std::ifstream fp = readColumnAndRowForStepFromFileReturningStream(sp->step, sp->outputFileName, node, columnAndRow, isBinary);
-        if (! fp)
-            throw std::runtime_error("Cannot open file for node " + std::to_string(node));
+        const auto& offsetXY = layout->offsetsXY[node];
+        const auto& columnAndRow = layout->sceneSizes[node];
 
         // Define boundary lines for the node (bottom and left edges)
         lines[node * 2] = Line(offsetXY.x(), offsetXY.y(), offsetXY.x() + columnAndRow.column, offsetXY.y());
@@ -278,87 +607,147 @@ void ModelReader<Cell>::readStageStateFromFilesForStep(Matrix& m, SettingParamet
                                          offsetXY.y() + columnAndRow.row);
         }
 
+        // nodes outside of the region of interest are not read, nor ones already read into the matrix
+        if (contents && contents->nodesRead[node])
+            return;
+        if (sp->regionOfInterest && ! sp->regionOfInterest->intersects(offsetXY, columnAndRow))
+            return;
+        if (contents)
+            contents->nodesRead[node] = 1; // every node has its own element, so no synchronisation is needed
+
+        ScopedStageTimer nodeTimer(ProfiledStage::ReadNode);
         bool localStartStepDone = false;
 
         if (isBinary)
         {
-            // Binary mode: read raw cell data
-            const size_t cellCount = columnAndRow.column * columnAndRow.row;
+            // Binary mode: copy raw cell data straight from the mapped file
             const size_t cellSize = sizeof(Cell);
-            const size_t totalBytes = cellCount * cellSize;
-
-            std::vector<char> buffer(totalBytes);
-            fp.read(buffer.data(), totalBytes);
+            const size_t rowBytes = columnAndRow.column * cellSize;
+            const size_t totalBytes = rowBytes * columnAndRow.row;
+            const auto slabBegin = static_cast<size_t>(getStepStartingPositionInFile(sp->step, node));
 
-            if (fp.gcount() != static_cast<std::streamsize>(totalBytes))
+            const auto mappedFile = [&]
+            {
+                ScopedStageTimer openTimer(ProfiledStage::OpenNode);
+                return mappedBinaryNodeFile(sp->outputFileName, node, slabBegin + totalBytes);
+            }();
+            if (mappedFile->size() < slabBegin + totalBytes)
             {
                 throw std::runtime_error(std::format("Failed to read {} bytes from binary file for node {}", totalBytes, node));
             }
+            const char* slab = mappedFile->data() + slabBegin;
+            if (contents)
+                contents->nodeHashes[node] = ReaderHelpers::hashBytes(std::string_view(slab, totalBytes));
 
-            // Parse binary data and fill matrix
+            Cell tempCell; // only for cell types which can not be copied as bytes directly into the matrix
             for (int row = 0; row < columnAndRow.row; ++row)
             {
+                if (stopToken.stop_requested())
+                    return;
+
                 const int matrixRow = row + offsetXY.y();
-                if (matrixRow >= static_cast<int>(m.size())) // TODO: GB: to fix?
+                if (matrixRow >= static_cast<int>(m.rows())) // TODO: GB: to fix?
                     break; // Skip rows that are out of bounds
-                    
-                for (int col = 0; col < columnAndRow.column; ++col)
+
+                // Skip columns that are out of bounds
+                const int columnsToCopy = std::min(columnAndRow.column, static_cast<int>(m.columns()) - offsetXY.x());
+                if (columnsToCopy <= 0)
+                    continue;
+
+                if (! localStartStepDone) [[unlikely]]
                 {
-                    const int matrixCol = col + offsetXY.x();
-                    if (matrixCol >= static_cast<int>(m[matrixRow].size())) // TODO: GB: to fix?
-                        break; // Skip columns that are out of bounds
+                    m[matrixRow][offsetXY.x()].Cell::startStep(sp->step);
+                    localStartStepDone = true;
+                }
 
-                    if (! localStartStepDone) [[unlikely]]
+                const char* rowData = slab + row * rowBytes;
+                if constexpr (std::is_trivially_copyable_v<Cell>)
+                {
+                    // whole row of the node in one copy
+                    std::memcpy(m[matrixRow].data() + offsetXY.x(), rowData, columnsToCopy * cellSize);
+                }
+                else
+                {
+                    // Cell with virtual methods: copy bytes into temporary cell, then assign (keeps the destination's vtable)
+                    for (int col = 0; col < columnsToCopy; ++col)
                     {
-                        m[matrixRow][matrixCol].Cell::startStep(sp->step);
-                        localStartStepDone = true;
+                        std::memcpy(&tempCell, rowData + col * cellSize, cellSize);
+                        m[matrixRow][offsetXY.x() + col] = tempCell;
                     }
-
-                    const size_t cellIndex = row * columnAndRow.column + col;
-                    const char* cellData = buffer.data() + (cellIndex * cellSize);
-
-                    // Create a temporary cell from binary data and copy to matrix
-                    Cell tempCell;
-                    std::memcpy(&tempCell, cellData, cellSize);
-                    m[matrixRow][matrixCol] = tempCell;
                 }
             }
         }
         else
         {
-            // Text mode: read and parse text data (original behavior)
-            // Use a thread-local buffer for faster reading
-            static thread_local char fileBuffer[1 << 16];
-            fp.rdbuf()->pubsetbuf(fileBuffer, sizeof(fileBuffer));
-
-            // Reserve a large line buffer to minimize reallocations
-            constexpr std::size_t numbersPerLine = 10'000;
-            const std::size_t lineBufferSize = (std::log10(UINT_MAX) + 2) * numbersPerLine;
-            std::string line;
-            line.reserve(lineBufferSize);
+            // Text mode: lines are taken straight from big blocks read from the file (kept open between steps)
+            // or decompressed from the node's chunk of the output container (or from the text received from the agent)
+            const auto buffers = readBuffers.acquire(); // kept until the node is read, the reader uses its memory
+            ColumnAndRow headerColumnAndRow [[maybe_unused]]; // same as in the layout
+            auto textReader = [&]
+            {
+                ScopedStageTimer openTimer(ProfiledStage::OpenNode);
+                if (remoteStep)
+                {
+                    return ReaderHelpers::openTextInMemory(remoteStep->nodeText(node, buffers->decompressedText),
+                                                           remoteStep,
+                                                           buffers->textBlocks,
+                                                           headerColumnAndRow,
+                                                           TextBlockReader::DEFAULT_BLOCK_SIZE,
+                                                           [&]
+                                                           {
+                                                               return std::format("step {} of node {} from '{}'", sp->step, node, remoteOutput->address());
+                                                           });
+                }
+                return openTextNodeDataForStep(sp->step, sp->outputFileName, node, *buffers, headerColumnAndRow);
+            }();
 
             // Process each line (row) from the node's file
+            std::span<char> line;
             for (int row = 0; row < columnAndRow.row; ++row)
             {
+                if (stopToken.stop_requested())
+                    return;
+
                 const int matrixRow = row + offsetXY.y();
-                if (matrixRow >= static_cast<int>(m.size())) // TODO: GB: to fix?
+                if (matrixRow >= static_cast<int>(m.rows())) // TODO: GB: to fix?
                     break; // Skip rows that are out of bounds
-                    
-                if (! std::getline(fp, line))
+
+                if (! textReader.readLine(line))
                 {
                     const auto fileNameTmp = ReaderHelpers::giveMeFileName(sp->outputFileName, node, isBinary);
                     throw std::runtime_error("Error reading entire line from " + fileNameTmp);
                 }
+                if (contents) // before tokenizing, which may write into the line
+                    contents->nodeHashes[node] = ReaderHelpers::hashBytes(std::string_view(line.data(), line.size()), contents->nodeHashes[node]);
 
-                // Replace spaces with '\0' to tokenize more efficiently
-                std::replace(line.begin(), line.end(), ' ', '\0');
+                if constexpr (CellWithRowDecoding<Cell>)
+                {
+                    // the model decodes the part of the row inside the grid in one call
+                    const int columnsInGrid = std::min(columnAndRow.column, static_cast<int>(m.columns()) - offsetXY.x());
+                    if (columnsInGrid <= 0)
+                        continue;
+
+                    if (! localStartStepDone) [[unlikely]]
+                    {
+                        m[matrixRow][offsetXY.x()].Cell::startStep(sp->step);
+                        localStartStepDone = true;
+                    }
+                    Cell::composeRow(std::string_view(line.data(), line.size()), std::span<Cell>(m[matrixRow].data() + offsetXY.x(), columnsInGrid));
+                    continue;
+                }
 
                 // Tokenize and fill the corresponding part of the matrix
                 char* currentTokenPtr = line.data();
-                for (int col = 0; col < columnAndRow.column && *currentTokenPtr; ++col)
+                char* const lineEnd = line.data() + line.size();
+                for (int col = 0; col < columnAndRow.column; ++col)
                 {
+                    while (currentTokenPtr < lineEnd && ' ' == *currentTokenPtr)
+                        ++currentTokenPtr;
+                    if (currentTokenPtr >= lineEnd)
+                        break; // fewer tokens than columns
+
                     const int matrixCol = col + offsetXY.x();
-                    if (matrixCol >= static_cast<int>(m[matrixRow].size())) // TODO: GB: to fix?
+                    if (matrixCol >= static_cast<int>(m.columns())) // TODO: GB: to fix?
                         break; // Skip columns that are out of bounds
 
                     if (! localStartStepDone) [[unlikely]]
@@ -367,113 +756,452 @@ void ModelReader<Cell>::readStageStateFromFilesForStep(Matrix& m, SettingParamet
                         localStartStepDone = true;
                     }
 
-                    /// composeElement() may add extra '\0', so we need extra variable to jump to next position
-                    char* nextTokenPtr = std::find(currentTokenPtr, line.data() + line.size(), '\0');
-                    ++nextTokenPtr; // skip '\0'
+                    auto* tokenEnd = static_cast<char*>(std::memchr(currentTokenPtr, ' ', lineEnd - currentTokenPtr));
+                    if (! tokenEnd)
+                        tokenEnd = lineEnd;
 
-                    m[matrixRow][matrixCol].Cell::composeElement(currentTokenPtr);
+                    if constexpr (CellWithStringViewParsing<Cell>)
+                    {
+                        m[matrixRow][matrixCol].Cell::composeElement(std::string_view(currentTokenPtr, tokenEnd));
+                    }
+                    else
+                    {
+                        // compatibility path: null-terminated token, composeElement() may add extra '\0' inside it
+                        *tokenEnd = '\0'; // the reader guarantees a writable byte after the line
+                        m[matrixRow][matrixCol].Cell::composeElement(currentTokenPtr);
+                    }
 
-                    currentTokenPtr = nextTokenPtr;
+                    currentTokenPtr = tokenEnd + 1;
                 }
             }
         }
+
+        if (onNodeRead)
+            onNodeRead(node, CellRegion::ofNode(offsetXY, columnAndRow, static_cast<int>(m.rows()), static_cast<int>(m.columns())));
     };
 
-    /// Launch async tasks — one per node
-    std::vector<std::future<void>> futures;
-    futures.reserve(totalNodes);
+    /// Nodes are handed out to the pool workers one by one, so big nodes do not leave cores idle
+    threadPool.parallelFor(totalNodes,
+                           [&](std::size_t node)
+                           {
+                               processNode(static_cast<NodeIndex>(node));
+                           });
+    return ! stopToken.stop_requested();
+}
 
-    for (NodeIndex node = 0; node < totalNodes; ++node)
+template<class Cell>
+auto ModelReader<Cell>::readCellsOfSteps(const SettingParameter& sp, const CellRegion& window, std::span<const StepIndex> steps, std::stop_token stopToken)
+    -> std::optional<std::vector<Matrix2D<Cell>>>
+{
+    if (remoteOutput)
+        throw std::runtime_error("Cells cannot be probed in the remote mode");
+    if (sp.readMode == "container" && ! outputContainer)
+        throw std::runtime_error("Container mode requires the index read from the output container first");
+
+    const int firstRow = std::clamp(window.firstRow, 0, sp.numberOfRowsY);
+    const int firstColumn = std::clamp(window.firstColumn, 0, sp.numberOfColumnX);
+    const CellRegion clippedWindow{ .firstRow = firstRow,
+                                    .firstColumn = firstColumn,
+                                    .rows = std::clamp(window.firstRow + window.rows, 0, sp.numberOfRowsY) - firstRow,
+                                    .columns = std::clamp(window.firstColumn + window.columns, 0, sp.numberOfColumnX) - firstColumn };
+    const bool isBinary = (sp.readMode == "binary");
+    if (steps.empty())
+        return std::vector<Matrix2D<Cell>>{};
+
+    // layouts of the probed steps are not kept: most steps share the layout of the first one
+    SettingParameter referenceParameters = sp;
+    referenceParameters.step = steps.front();
+    const auto referenceLayout = giveMeStepLayout(referenceParameters, isBinary);
+    std::vector<NodeIndex> decidingNodes; // their sizes decide where the window is: nodes owning it, and all before them in their row and column of nodes
+    for (NodeIndex node = 0; node < referenceLayout->sceneSizes.size(); ++node)
     {
-        futures.push_back(std::async(std::launch::async,
-                                     [&, node]()
-                                     {
-                                         processNode(node);
-                                     }));
+        for (NodeIndex owner = 0; owner < referenceLayout->sceneSizes.size(); ++owner)
+        {
+            if (! clippedWindow.intersects(referenceLayout->offsetsXY[owner], referenceLayout->sceneSizes[owner]))
+                continue;
+            const bool sameNodeRow = node / sp.nNodeX == owner / sp.nNodeX && node % sp.nNodeX <= owner % sp.nNodeX;
+            const bool sameNodeColumn = node % sp.nNodeX == owner % sp.nNodeX && node / sp.nNodeX <= owner / sp.nNodeX;
+            if (sameNodeRow || sameNodeColumn)
+            {
+                decidingNodes.push_back(node);
+                break;
+            }
+        }
     }
 
-    // Wait for all async tasks to complete
-    std::ranges::for_each(futures,
-                          [](std::future<void>& f)
-                          {
-                              f.get();
-                          });
+    std::vector<Matrix2D<Cell>> cellsOfSteps(steps.size());
+    threadPool.parallelFor(steps.size(),
+                           [&](std::size_t index)
+                           {
+                               if (stopToken.stop_requested())
+                                   return;
+
+                               SettingParameter stepParameters = sp;
+                               stepParameters.step = steps[index];
+                               stepParameters.regionOfInterest.reset();
+                               const auto layout = probedStepLayout(stepParameters, isBinary, referenceLayout, decidingNodes);
+
+                               auto& cells = cellsOfSteps[index];
+                               cells.resize(clippedWindow.rows, clippedWindow.columns);
+                               for (NodeIndex node = 0; node < layout->sceneSizes.size(); ++node)
+                               {
+                                   if (clippedWindow.intersects(layout->offsetsXY[node], layout->sceneSizes[node]))
+                                       readWindowOfNode(stepParameters, *layout, node, clippedWindow, cells);
+                               }
+                           });
+
+    if (stopToken.stop_requested())
+        return std::nullopt;
+    return cellsOfSteps;
 }
 
 template<class Cell>
-std::vector<ColumnAndRow> ModelReader<Cell>::giveMeLocalColsAndRowsForAllSteps(StepIndex step,
-                                                                               NodeIndex nNodeX,
-                                                                               NodeIndex nNodeY,
-                                                                               const std::string& fileName,
-                                                                               bool isBinary)
+void ModelReader<Cell>::readWindowOfNode(const SettingParameter& sp, const StepLayout& layout, NodeIndex node, const CellRegion& window, Matrix2D<Cell>& cells)
 {
-    const auto nodesCount = nNodeX * nNodeY;
-    std::vector<ColumnAndRow> allColumnsAndRows(nodesCount);
-    allColumnsAndRows.resize(nodesCount);
+    ScopedStageTimer nodeTimer(ProfiledStage::ProbeNode);
+    const auto& offsetXY = layout.offsetsXY[node];
+    const auto& columnAndRow = layout.sceneSizes[node];
+
+    // part of the window inside the node
+    const int firstRow = std::max(window.firstRow, offsetXY.y());
+    const int endRow = std::min(window.firstRow + window.rows, offsetXY.y() + columnAndRow.row);
+    const int firstColumn = std::max(window.firstColumn, offsetXY.x());
+    const int columnsToRead = std::min(window.firstColumn + window.columns, offsetXY.x() + columnAndRow.column) - firstColumn;
+    const auto destinationOfRow = [&](int row)
+    {
+        return cells[row - window.firstRow].subspan(firstColumn - window.firstColumn, columnsToRead);
+    };
+    cells[firstRow - window.firstRow][firstColumn - window.firstColumn].Cell::startStep(sp.step);
 
-    for (NodeIndex node = 0; node < nodesCount; node++)
+    if (sp.readMode == "binary")
     {
-        allColumnsAndRows[node] = readColumnAndRowForStepFromFile(step, fileName, node, isBinary);
+        const size_t cellSize = sizeof(Cell);
+        const size_t rowBytes = columnAndRow.column * cellSize;
+        const size_t totalBytes = rowBytes * columnAndRow.row;
+        const auto slabBegin = static_cast<size_t>(getStepStartingPositionInFile(sp.step, node));
+        const auto mappedFile = mappedBinaryNodeFile(sp.outputFileName, node, slabBegin + totalBytes);
+        if (mappedFile->size() < slabBegin + totalBytes)
+            throw std::runtime_error(std::format("Failed to read {} bytes from binary file for node {}", totalBytes, node));
+
+        Cell tempCell;
+        for (int row = firstRow; row < endRow; ++row)
+        {
+            const char* rowData = mappedFile->data() + slabBegin + (row - offsetXY.y()) * rowBytes + (firstColumn - offsetXY.x()) * cellSize;
+            const auto destination = destinationOfRow(row);
+            if constexpr (std::is_trivially_copyable_v<Cell>)
+            {
+                std::memcpy(destination.data(), rowData, columnsToRead * cellSize);
+            }
+            else
+            {
+                for (int col = 0; col < columnsToRead; ++col)
+                {
+                    std::memcpy(&tempCell, rowData + col * cellSize, cellSize);
+                    destination[col] = tempCell;
+                }
+            }
+        }
+        return;
+    }
+
+    const auto buffers = readBuffers.acquire();
+    if (outputContainer) // the chunk is compressed as a whole: its rows before the window are skipped
+    {
+        ColumnAndRow headerColumnAndRow [[maybe_unused]];
+        auto textReader = openTextNodeDataForStep(sp.step, sp.outputFileName, node, *buffers, headerColumnAndRow);
+        std::span<char> line;
+        for (int row = offsetXY.y(); row < endRow; ++row)
+        {
+            if (! textReader.readLine(line))
+                throw std::runtime_error(std::format("Row {} of step {} of node {} not found in '{}'", row - offsetXY.y(), sp.step, node, outputContainer->path()));
+            if (row >= firstRow)
+                decodeTextRowPart(line, firstColumn - offsetXY.x(), destinationOfRow(row), buffers->rowCells);
+        }
+        return;
+    }
+
+    ReaderHelpers::assignFileName(buffers->fileName, sp.outputFileName, node);
+    const auto stepPosition = getStepStartingPositionInFile(sp.step, node);
+    const auto file = textNodeFiles.file(node, buffers->fileName);
+    for (int row = firstRow; row < endRow; ++row)
+    {
+        const auto line = textRowIndex.readRow(*file, node, sp.step, stepPosition, row - offsetXY.y(), columnAndRow.row, buffers->textBlocks);
+        if (! line)
+            throw std::runtime_error(std::format("Row {} of step {} not found in '{}'", row - offsetXY.y(), sp.step, buffers->fileName));
+        decodeTextRowPart(*line, firstColumn - offsetXY.x(), destinationOfRow(row), buffers->rowCells);
     }
-    return allColumnsAndRows;
 }
 
 template<class Cell>
-void ModelReader<Cell>::readStepsOffsetsForAllNodesFromFiles(NodeIndex nNodeX, NodeIndex nNodeY, const std::string& filename)
+void ModelReader<Cell>::decodeTextRowPart(std::span<char> line, int firstColumn, std::span<Cell> destination, std::vector<Cell>& rowCells)
 {
-    const auto totalNodes = nNodeX * nNodeY;
-    prepareStage(nNodeX, nNodeY);
-
-    for (NodeIndex node = 0; node < totalNodes; ++node)
+    if constexpr (CellWithRowDecoding<Cell>)
     {
-        const auto fileNameIndex = ReaderHelpers::giveMeFileNameIndex(filename, node);
-        if (! std::filesystem::exists(fileNameIndex))
-            throw std::runtime_error("File not found: " + fileNameIndex);
-
-        std::ifstream file(fileNameIndex);
-        if (! file)
-            throw std::runtime_error("Cannot open file: " + fileNameIndex);
-
-        std::string line;
-        while (std::getline(file, line))
+        rowCells.assign(firstColumn + destination.size(), Cell{}); // the model decodes rows from their beginning (keeps the capacity)
+        Cell::composeRow(std::string_view(line.data(), line.size()), std::span<Cell>(rowCells));
+        std::copy(rowCells.begin() + firstColumn, rowCells.end(), destination.begin());
+    }
+    else
+    {
+        char* currentTokenPtr = line.data();
+        char* const lineEnd = line.data() + line.size();
+        for (int col = 0; col < firstColumn + static_cast<int>(destination.size()); ++col)
         {
-            if (line.empty()) continue;
-
-            std::istringstream iss(line);
-            StepIndex stepNumber{};
-            FilePosition position{};
-            if (! (iss >> stepNumber >> position))
-                throw std::runtime_error("Invalid line format in file: " + fileNameIndex);
+            while (currentTokenPtr < lineEnd && ' ' == *currentTokenPtr)
+                ++currentTokenPtr;
+            if (currentTokenPtr >= lineEnd)
+                break; // fewer tokens than columns
 
-            StepOffsetInfo info{position, std::nullopt};
+            auto* tokenEnd = static_cast<char*>(std::memchr(currentTokenPtr, ' ', lineEnd - currentTokenPtr));
+            if (! tokenEnd)
+                tokenEnd = lineEnd;
 
-            // Check if we have the optional "(columns-rows)" part
-            std::string rangePart;
-            if (iss >> rangePart)
+            if (col >= firstColumn)
             {
-                std::regex rangeRegex(R"(\((\d+)-(\d+)\))");
-                std::smatch match;
-                if (std::regex_match(rangePart, match, rangeRegex))
+                if constexpr (CellWithStringViewParsing<Cell>)
                 {
-                    const int columnCount = std::stoi(match[1].str());
-                    const int rowsCount = std::stoi(match[2].str());
-                    info.sceneSize = ColumnAndRow{.column = columnCount, .row = rowsCount};
+                    destination[col - firstColumn].Cell::composeElement(std::string_view(currentTokenPtr, tokenEnd));
                 }
                 else
                 {
-                    throw std::runtime_error("Invalid range format in file: " + fileNameIndex + " line: " + line);
+                    *tokenEnd = '\0'; // a writable byte after the line
+                    destination[col - firstColumn].Cell::composeElement(currentTokenPtr);
                 }
             }
+            currentTokenPtr = tokenEnd + 1;
+        }
+    }
+}
 
-            const auto [it, inserted] = nodeStepOffsets[node].emplace(stepNumber, info);
-            if (! inserted)
-            {
-                std::cerr << std::format("Duplicate stepNumber {} in file '{}' (node {})", stepNumber, fileNameIndex, node) << std::endl;
-            }
+template<class Cell>
+auto ModelReader<Cell>::giveMeStepLayout(const SettingParameter& sp, bool isBinary)
+    -> std::shared_ptr<const StepLayout>
+{
+    std::shared_ptr<const StepLayout> previousLayout;
+    {
+        std::lock_guard lock(stepLayoutsMutex);
+        if (auto it = stepLayouts.find(sp.step); it != stepLayouts.end())
+            return it->second;
+        previousLayout = lastStepLayout;
+    }
+
+    // playing steps of unchanged sizes allocates nothing: they share the previous layout and are not added to the cache
+    const auto nodesCount = sp.nNodeX * sp.nNodeY;
+    if (previousLayout && previousLayout->sceneSizes.size() == nodesCount && hasSceneSizesInIndex(sp.step, *previousLayout))
+        return previousLayout;
+
+    auto layout = buildStepLayout(sp, isBinary);
+    std::lock_guard lock(stepLayoutsMutex);
+    lastStepLayout = stepLayouts.try_emplace(sp.step, std::move(layout)).first->second;
+    return lastStepLayout;
+}
+
+template<class Cell>
+auto ModelReader<Cell>::probedStepLayout(const SettingParameter& sp,
+                                         bool isBinary,
+                                         const std::shared_ptr<const StepLayout>& reference,
+                                         std::span<const NodeIndex> decidingNodes) -> std::shared_ptr<const StepLayout>
+{
+    {
+        std::lock_guard lock(stepLayoutsMutex);
+        if (auto it = stepLayouts.find(sp.step); it != stepLayouts.end())
+            return it->second;
+    }
+    if (hasSceneSizesInIndex(sp.step, *reference))
+        return reference;
+
+    const bool sameDecidingSizes = ! isBinary
+                                && std::ranges::all_of(decidingNodes,
+                                                       [&](NodeIndex node)
+                                                       {
+                                                           return nodeSizeInStep(sp.step, sp.outputFileName, node, isBinary) == reference->sceneSizes[node];
+                                                       });
+    if (sameDecidingSizes)
+        return reference;
+    return buildStepLayout(sp, isBinary);
+}
+
+template<class Cell>
+auto ModelReader<Cell>::buildStepLayout(const SettingParameter& sp, bool isBinary) -> std::shared_ptr<StepLayout>
+{
+    const auto nodesCount = sp.nNodeX * sp.nNodeY;
+    auto layout = std::make_shared<StepLayout>();
+    layout->sceneSizes.resize(nodesCount);
+
+    threadPool.parallelFor(nodesCount,
+                           [&](std::size_t node)
+                           {
+                               layout->sceneSizes[node] = nodeSizeInStep(sp.step, sp.outputFileName, static_cast<NodeIndex>(node), isBinary);
+                           });
+
+    layout->offsetsXY.resize(nodesCount);
+    for (NodeIndex node = 0; node < nodesCount; ++node)
+    {
+        layout->offsetsXY[node] = ReaderHelpers::calculateXYOffsetForNode(node, sp.nNodeX, sp.nNodeY, layout->sceneSizes);
+    }
+    return layout;
+}
+
+template<class Cell>
+ColumnAndRow ModelReader<Cell>::nodeSizeInStep(StepIndex step, const std::string& fileName, NodeIndex node, bool isBinary)
+{
+    const auto* info = nodeStepOffsets.at(node).find(step);
+    if (isBinary || (info && info->sceneSize)) // dimensions are in the index
+        return getSceneSizeFromStepOffsets(step, node);
+    return readColumnAndRowForStepFromFile(step, fileName, node);
+}
+
+template<class Cell>
+bool ModelReader<Cell>::hasSceneSizesInIndex(StepIndex step, const StepLayout& layout) const
+{
+    for (std::size_t node = 0; node < layout.sceneSizes.size(); ++node)
+    {
+        const auto* info = nodeStepOffsets.at(node).find(step);
+        if (! info || info->sceneSize != layout.sceneSizes[node])
+            return false;
+    }
+    return true;
+}
+
+template<class Cell>
+void ModelReader<Cell>::readStepsOffsetsForAllNodesFromFiles(NodeIndex nNodeX,
+                                                             NodeIndex nNodeY,
+                                                             const std::string& filename,
+                                                             const std::string& readMode,
+                                                             const IndexLoadingProgressCallback& progress,
+                                                             std::optional<StepIndex> firstStep)
+{
+    const auto totalNodes = nNodeX * nNodeY;
+    prepareStage(nNodeX, nNodeY);
+
+    if (readMode == "container")
+    {
+        auto container = std::make_shared<const OutputContainer>(OutputContainer::fileName(filename));
+        if (container->nodesCount() != totalNodes)
+        {
+            throw std::runtime_error(
+                std::format("Output container '{}' has {} nodes, but the configuration expects {}", container->path(), container->nodesCount(), totalNodes));
+        }
+
+        for (NodeIndex node = 0; node < totalNodes; ++node)
+        {
+            nodeStepOffsets[node] = container->nodeStepOffsets(node);
+            if (progress)
+                progress(node + 1, totalNodes);
+        }
+        outputContainer = std::move(container);
+        return;
+    }
+
+    if (readMode == "remote")
+    {
+        if (remoteAgentAddress.empty())
+            throw std::runtime_error("Remote mode requires the address of the agent (remote_agent = host:port in the VISUALIZATION section)");
+
+        auto client = std::make_shared<RemoteOutputClient>(remoteAgentAddress);
+        auto indices = client->readIndex(totalNodes);
+        for (NodeIndex node = 0; node < totalNodes; ++node)
+        {
+            nodeStepOffsets[node] = std::move(indices[node]);
+            if (progress)
+                progress(node + 1, totalNodes);
+        }
+        remoteOutput = std::move(client);
+        return;
+    }
+
+    // every node writes only its own element, so the nodes (mostly waiting for I/O) are loaded concurrently
+    std::atomic<std::size_t> loadedNodes{};
+    threadPool.parallelFor(totalNodes,
+                           [&](std::size_t node)
+                           {
+                               nodeStepOffsets[node] = NodeStepOffsets::loadFromIndexFile(
+                                   ReaderHelpers::giveMeFileNameIndex(filename, static_cast<NodeIndex>(node)));
+                               if (firstStep)
+                                   prefetchStepOfNode(filename, static_cast<NodeIndex>(node), *firstStep, readMode == "binary");
+
+                               const auto loaded = loadedNodes.fetch_add(1, std::memory_order_relaxed) + 1;
+                               if (progress)
+                                   progress(loaded, totalNodes);
+                           });
+}
+
+template<class Cell>
+IndexAppendResult ModelReader<Cell>::appendStepsOffsetsForAllNodesFromFiles(const std::string& filename)
+{
+    if (outputContainer || remoteOutput)
+        return {};
+
+    std::vector<IndexAppendResult> nodeResults(nodeStepOffsets.size());
+    threadPool.parallelFor(nodeStepOffsets.size(),
+                           [&](std::size_t node)
+                           {
+                               nodeResults[node] = nodeStepOffsets[node].appendFromTextIndexFile(
+                                   ReaderHelpers::giveMeFileNameIndex(filename, static_cast<NodeIndex>(node)));
+                           });
+
+    IndexAppendResult result;
+    for (const auto& nodeResult : nodeResults)
+        result += nodeResult;
+
+    if (result.reloaded) // positions of known steps may have changed
+        clearStepLayouts();
+    return result;
+}
+
+template<class Cell>
+void ModelReader<Cell>::fetchStepsAhead(const SettingParameter& sp, std::span<const StepIndex> steps)
+{
+    if (! remoteOutput)
+        return;
+
+    SettingParameter stepParameters = sp;
+    for (const auto step : steps)
+    {
+        if (! hasStep(step))
+            continue;
+        stepParameters.step = step;
+        const auto layout = giveMeStepLayout(stepParameters, false); // sizes are in the index received from the agent
+
+        std::vector<NodeIndex> nodes;
+        for (NodeIndex node = 0; node < layout->sceneSizes.size(); ++node)
+        {
+            if (! sp.regionOfInterest || sp.regionOfInterest->intersects(layout->offsetsXY[node], layout->sceneSizes[node]))
+                nodes.push_back(node);
         }
+        remoteOutput->fetchAhead(step, std::move(nodes));
     }
 }
 
+template<class Cell>
+bool ModelReader<Cell>::hasStep(StepIndex step) const
+{
+    return ! nodeStepOffsets.empty()
+           && std::ranges::all_of(nodeStepOffsets,
+                                  [step](const NodeStepOffsets& stepOffsets)
+                                  {
+                                      return stepOffsets.contains(step);
+                                  });
+}
+
+template<class Cell>
+std::vector<StepIndex> ModelReader<Cell>::stepsInAllNodes() const
+{
+    if (nodeStepOffsets.empty())
+        return {};
+
+    auto steps = nodeStepOffsets.front().steps();
+    for (const auto& stepOffsets : nodeStepOffsets | std::views::drop(1))
+    {
+        std::erase_if(steps,
+                      [&stepOffsets](StepIndex step)
+                      {
+                          return ! stepOffsets.contains(step);
+                      });
+    }
+    return steps;
+}
+
 template<class Cell>
 std::vector<StepIndex> ModelReader<Cell>::availableSteps(bool throwOnMismatch) const
 {
@@ -491,53 +1219,110 @@ std::vector<StepIndex> ModelReader<Cell>::availableSteps(bool throwOnMismatch) c
         return {};
     }
 
-    // Helper lambda: extracts all step indices (keys) from a map and returns them sorted.
-    auto extractAndSortStepIndices = [](const auto& map) -> std::vector<StepIndex>
-    {
-        auto steps = std::views::keys(map);
-        std::vector<StepIndex> steps2Return(steps.begin(), steps.end());
-        std::ranges::sort(steps2Return);
-        return steps2Return;
-    };
-
     // Use the first node as the reference
     const auto& fistNodeData = nodeStepOffsets.front();
 
-    // Collect and sort all step indices from the first node
-    auto firstNodeSteps = extractAndSortStepIndices(fistNodeData);
+    // Steps are already kept sorted, so they are only copied out
+    auto firstNodeSteps = fistNodeData.steps();
+
+    // Nodes are compared against the reference in parallel, problems are reported afterwards in node order
+    std::vector<std::string> nodeProblems(nodeStepOffsets.size());
+    threadPool.parallelFor(nodeStepOffsets.size() - 1,
+                           [&](std::size_t i)
+                           {
+                               const auto node = i + 1;
+                               const auto& nodeMap = nodeStepOffsets[node];
+                               if (nodeMap.size() != fistNodeData.size())
+                               {
+                                   nodeProblems[node] = std::format("Step count mismatch for node {} (expected {}, found {})",
+                                                                    node,
+                                                                    fistNodeData.size(),
+                                                                    nodeMap.size());
+                               }
+                               // Compare with reference set (both sorted)
+                               else if (! std::ranges::equal(firstNodeSteps, nodeMap.entries(), {}, {}, &NodeStepOffsets::Entry::step))
+                               {
+                                   nodeProblems[node] = std::format("Inconsistent step indices detected in node {}.", node);
+                               }
+                           });
+
+    for (const auto& msg : nodeProblems)
+    {
+        if (msg.empty())
+            continue;
+
+        if (throwOnMismatch)
+            throw std::runtime_error(msg);
+        else
+            std::cerr << "Warning: " << msg << '\n';
+    }
 
-    // Compare each node's step list against the reference
-    for (NodeIndex node = 1; node < nodeStepOffsets.size(); ++node)
+    // Return the sorted list of unique steps
+    return firstNodeSteps;
+}
+
+template<class Cell>
+ColumnAndRow ModelReader<Cell>::getSceneSizeFromStepOffsets(StepIndex step, NodeIndex node) const
+{
+    if (node >= nodeStepOffsets.size())
+        throw std::runtime_error(std::format("Invalid node index {} in binary mode", node));
+
+    if (const auto* info = nodeStepOffsets[node].find(step); info && info->sceneSize.has_value())
     {
-        const auto& nodeMap = nodeStepOffsets[node];
-        if (nodeMap.size() != fistNodeData.size())
-        {
-            const std::string msg = std::format("Step count mismatch for node {} (expected {}, found {})",
-                                                node,
-                                                fistNodeData.size(),
-                                                nodeMap.size());
-            if (throwOnMismatch)
-                throw std::runtime_error(msg);
-            else
-                std::cerr << "Warning: " << msg << '\n';
-        }
+        return info->sceneSize.value();
+    }
+
+    throw std::runtime_error(std::format("Binary mode requires sceneSize in step offset info for step {} node {}", step, node));
+}
+
+template<class Cell>
+std::shared_ptr<const MappedFile> ModelReader<Cell>::mappedBinaryNodeFile(const std::string& fileName, NodeIndex node, std::size_t requiredSize)
+{
+    std::lock_guard lock(mappedBinaryNodeFilesMutex);
+    if (node >= mappedBinaryNodeFiles.size())
+    {
+        throw std::out_of_range(std::format("Invalid node index {} (available nodes: {})", node, mappedBinaryNodeFiles.size()));
+    }
 
-        // Extract steps for comparison
-        auto nodeSteps = extractAndSortStepIndices(nodeMap);
+    auto& mappedFile = mappedBinaryNodeFiles[node];
+    if (! mappedFile || mappedFile->size() < requiredSize)
+    {
+        mappedFile = std::make_shared<const MappedFile>(ReaderHelpers::giveMeFileName(fileName, node, /*isBinary=*/true));
+    }
+    return mappedFile;
+}
 
-        // Compare with reference set
-        if (! std::ranges::equal(firstNodeSteps, nodeSteps))
+template<class Cell>
+void ModelReader<Cell>::prefetchStepOfNode(const std::string& fileName, NodeIndex node, StepIndex step, bool isBinary)
+{
+    const auto& stepOffsets = nodeStepOffsets[node];
+    const auto* info = stepOffsets.find(step);
+    if (! info)
+        return;
+
+    // steps are usually written in order, so the step ends where the next one starts (the last one at the end of the file)
+    const auto& entries = stepOffsets.entries();
+    const auto next = std::ranges::upper_bound(entries, step, {}, &NodeStepOffsets::Entry::step);
+    if (next != entries.end() && next->info.position <= info->position)
+        return; // unknown end: the step is not worth guessing
+    const std::size_t length = (next != entries.end()) ? static_cast<std::size_t>(next->info.position - info->position) : 0;
+
+    try
+    {
+        if (isBinary)
         {
-            const std::string msg = std::format("Inconsistent step indices detected in node {}.", node);
-            if (throwOnMismatch)
-                throw std::runtime_error(msg);
-            else
-                std::cerr << "[Warning] " << msg << '\n';
+            const auto mappedFile = mappedBinaryNodeFile(fileName, node, 0);
+            mappedFile->prefetch(info->position, length ? length : mappedFile->size());
+        }
+        else
+        {
+            textNodeFiles.file(node, ReaderHelpers::giveMeFileName(fileName, node))->prefetch(info->position, length);
         }
     }
-
-    // Return the sorted list of unique steps
-    return firstNodeSteps;
+    catch (const std::exception&)
+    {
+        // only a hint: the step is read (and the error reported) when it is shown
+    }
 }
 
 template<class Cell>
@@ -548,11 +1333,11 @@ FilePosition ModelReader<Cell>::getStepStartingPositionInFile(StepIndex step, No
         throw std::out_of_range(std::format("Invalid node index {} (available nodes: {})", node, nodeStepOffsets.size()));
     }
 
-    const auto& stepMap = nodeStepOffsets[node];
-    if (auto it = stepMap.find(step); it != stepMap.end())
+    const auto& stepOffsets = nodeStepOffsets[node];
+    if (const auto* info = stepOffsets.find(step))
     {
-        return it->second.position;
+        return info->position;
     }
 
-    throw std::out_of_range(std::format("Step {} not found in node {} (available step indices: {})", step, node, stepMap.size() - 1));
+    throw std::out_of_range(std::format("Step {} not found in node {} (available step indices: {})", step, node, stepOffsets.size() - 1));
 }
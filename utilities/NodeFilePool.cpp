@@ -0,0 +1,145 @@
+/** @file NodeFilePool.cpp
+ * @brief Implementation of the NodeFile and NodeFilePool classes. */
+
+#include "NodeFilePool.h"
+
+#include <algorithm> // std::max
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <format>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+NodeFile::NodeFile(const std::string& filePath)
+    : filePath{ filePath }
+{
+    fileDescriptor = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor < 0)
+    {
+        throw std::runtime_error(std::format("Can't open '{}': {}", filePath, std::strerror(errno)));
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL); // only a hint, failure does not matter
+#endif
+}
+
+NodeFile::~NodeFile()
+{
+    if (fileDescriptor >= 0)
+        ::close(fileDescriptor);
+}
+
+std::size_t NodeFile::readAt(FilePosition offset, char* destination, std::size_t length) const
+{
+    std::size_t bytesRead = 0;
+    while (bytesRead < length)
+    {
+        const auto result = ::pread(fileDescriptor, destination + bytesRead, length - bytesRead, static_cast<off_t>(offset + bytesRead));
+        if (result < 0)
+        {
+            if (EINTR == errno)
+                continue;
+            throw std::runtime_error(std::format("Failed to read '{}' at position {}: {}", filePath, offset + bytesRead, std::strerror(errno)));
+        }
+        if (0 == result) // end of file
+            break;
+
+        bytesRead += static_cast<std::size_t>(result);
+    }
+    return bytesRead;
+}
+
+void NodeFile::prefetch(FilePosition offset, std::size_t length) const
+{
+#ifdef POSIX_FADV_WILLNEED
+    ::posix_fadvise(fileDescriptor, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#endif
+}
+
+
+NodeFilePool::NodeFilePool(std::size_t maxOpenFiles)
+    : openFilesLimit{ std::max<std::size_t>(maxOpenFiles, 1) }
+{
+}
+
+void NodeFilePool::reset(std::size_t nodesCount)
+{
+    std::lock_guard lock(mutex);
+    recentlyUsedNodes.clear();
+    slots.clear();
+    slots.resize(nodesCount);
+}
+
+void NodeFilePool::setMaxOpenFiles(std::size_t maxOpenFiles)
+{
+    std::lock_guard lock(mutex);
+    openFilesLimit = std::max<std::size_t>(maxOpenFiles, 1);
+    closeFilesAboveLimit();
+}
+
+std::size_t NodeFilePool::maxOpenFiles() const
+{
+    std::lock_guard lock(mutex);
+    return openFilesLimit;
+}
+
+std::size_t NodeFilePool::openFiles() const
+{
+    std::lock_guard lock(mutex);
+    return recentlyUsedNodes.size();
+}
+
+std::shared_ptr<const NodeFile> NodeFilePool::file(NodeIndex node, const std::string& filePath)
+{
+    {
+        std::lock_guard lock(mutex);
+        if (node >= slots.size())
+        {
+            throw std::out_of_range(std::format("Invalid node index {} (available nodes: {})", node, slots.size()));
+        }
+
+        auto& slot = slots[node];
+        if (slot.file && slot.file->path() == filePath)
+        {
+            recentlyUsedNodes.splice(recentlyUsedNodes.begin(), recentlyUsedNodes, slot.recentUse);
+            return slot.file;
+        }
+    }
+
+    // opened without the lock: on a network file system it can take long and other nodes must not wait
+    auto openedFile = std::make_shared<const NodeFile>(filePath);
+
+    std::lock_guard lock(mutex);
+    if (node >= slots.size()) // the stage was reset meanwhile, the file is used only by this reader
+        return openedFile;
+
+    auto& slot = slots[node];
+    if (slot.file)
+    {
+        if (slot.file->path() == filePath) // opened by another reader meanwhile
+        {
+            recentlyUsedNodes.splice(recentlyUsedNodes.begin(), recentlyUsedNodes, slot.recentUse);
+            return slot.file;
+        }
+        recentlyUsedNodes.erase(slot.recentUse);
+    }
+
+    slot.file = std::move(openedFile);
+    recentlyUsedNodes.push_front(node);
+    slot.recentUse = recentlyUsedNodes.begin();
+
+    closeFilesAboveLimit(); // the just opened file is the most recently used one, it stays open
+    return slot.file;
+}
+
+void NodeFilePool::closeFilesAboveLimit()
+{
+    while (recentlyUsedNodes.size() > openFilesLimit)
+    {
+        slots[recentlyUsedNodes.back()].file.reset();
+        recentlyUsedNodes.pop_back();
+    }
+}
@@ -0,0 +1,106 @@
+/** @file NodeFilePool.h
+ * @brief Declaration of the NodeFile and NodeFilePool classes - node data files kept open for the whole stage. */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+/** @class NodeFile
+ * @brief Read-only file descriptor with positional reads (POSIX pread).
+ *
+ * Reads do not use (and do not move) a shared file position, so one descriptor can be used
+ * by many threads at the same time, e.g. the GUI thread and the prefetching worker.
+ * There is no user-space buffer: callers read big blocks straight into their own memory. */
+class NodeFile
+{
+public:
+    /** @brief Opens the file for reading.
+     *  @throws std::runtime_error If the file cannot be opened */
+    explicit NodeFile(const std::string& filePath);
+
+    ~NodeFile();
+
+    NodeFile(const NodeFile&) = delete;
+    NodeFile& operator=(const NodeFile&) = delete;
+
+    /** @brief Reads up to length bytes starting at offset of the file.
+     *  @return Number of bytes read, smaller than length only at the end of the file
+     *  @throws std::runtime_error If reading fails */
+    std::size_t readAt(FilePosition offset, char* destination, std::size_t length) const;
+
+    /// @brief Asks the kernel to read bytes [offset, offset + length) into the page cache in background, length 0 means to the end (a hint)
+    void prefetch(FilePosition offset, std::size_t length) const;
+
+    const std::string& path() const
+    {
+        return filePath;
+    }
+
+private:
+    std::string filePath;
+    int fileDescriptor = -1;
+};
+
+/** @class NodeFilePool
+ * @brief Open data files of the stage's nodes, reused for every step instead of opening them again.
+ *
+ * On network file systems (NFS, Lustre) opening and closing a file costs more than reading it,
+ * so each node's file is opened on first use and kept open until the stage is cleared.
+ * The number of open files is limited (so big node grids do not hit `ulimit -n`),
+ * when the limit is reached the least recently used file is closed.
+ *
+ * @note Files are handed out as shared pointers, so a file closed by the pool stays open
+ *       until its last reader finishes. For a short time more files than the limit can be open. */
+class NodeFilePool
+{
+public:
+    static constexpr std::size_t DEFAULT_MAX_OPEN_FILES = 256;
+
+    explicit NodeFilePool(std::size_t maxOpenFiles = DEFAULT_MAX_OPEN_FILES);
+
+    /// @brief Closes all files and prepares slots for nodesCount nodes
+    void reset(std::size_t nodesCount);
+
+    /// @brief Closes all files (used when the stage is cleared)
+    void clear()
+    {
+        reset(0);
+    }
+
+    /// @brief Sets maximum number of files kept open (at least 1), closes the least recently used ones above it
+    void setMaxOpenFiles(std::size_t maxOpenFiles);
+
+    std::size_t maxOpenFiles() const;
+
+    /// @brief Number of files currently kept open by the pool
+    std::size_t openFiles() const;
+
+    /** @brief Returns open file of the node, opens it if needed.
+     *  @param node Node index (lower than nodes count passed to reset())
+     *  @param filePath File of the node, the file is opened again if it differs from the kept one
+     *  @throws std::out_of_range If the node index is invalid
+     *  @throws std::runtime_error If the file cannot be opened */
+    std::shared_ptr<const NodeFile> file(NodeIndex node, const std::string& filePath);
+
+private:
+    /// @brief Closes least recently used files until there is at most openFilesLimit of them (mutex has to be locked)
+    void closeFilesAboveLimit();
+
+    struct Slot
+    {
+        std::shared_ptr<const NodeFile> file;
+        std::list<NodeIndex>::iterator recentUse; ///< position in recentlyUsedNodes, valid when file is set
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Slot> slots;
+    std::list<NodeIndex> recentlyUsedNodes; ///< nodes with open file, the most recently used first
+    std::size_t openFilesLimit;
+};
@@ -0,0 +1,426 @@
+/** @file NodeStepOffsets.cpp
+ * @brief Implementation of the NodeStepOffsets class. */
+
+#include "NodeStepOffsets.h"
+
+#include <algorithm> // std::ranges::stable_sort, std::ranges::lower_bound
+#include <charconv>  // std::from_chars
+#include <cstdint>
+#include <cstring> // std::memcpy, std::memchr
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "MappedFile.h"
+#include "NodeFilePool.h" // NodeFile
+
+
+namespace
+{
+/// Layout of the sidecar file: CacheHeader followed by CacheHeader::entriesCount CacheEntry records (native byte order)
+struct CacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entrySize;
+    std::uint64_t sourceFileSize;
+    std::int64_t sourceModificationTime;
+    std::uint64_t entriesCount;
+    std::uint64_t parsedTextBytes;
+    std::uint32_t hasUnterminatedLastLine;
+    std::uint32_t unterminatedLastLineStep;
+};
+
+struct CacheEntry
+{
+    std::int64_t position;
+    std::uint32_t step;
+    std::uint32_t hasSceneSize;
+    std::int32_t columns;
+    std::int32_t rows;
+};
+
+constexpr char CACHE_MAGIC[8] = { 'O', 'O', 'C', 'V', 'I', 'D', 'X', '\0' };
+constexpr std::uint32_t CACHE_VERSION = 2;
+
+/// Size and modification time of the text index, the sidecar is valid only for exactly this state of the source
+struct SourceFileStamp
+{
+    std::uint64_t size;
+    std::int64_t modificationTime;
+};
+
+std::optional<SourceFileStamp> readSourceFileStamp(const std::string& fileName)
+{
+    std::error_code error;
+    const auto size = std::filesystem::file_size(fileName, error);
+    if (error)
+        return std::nullopt;
+
+    const auto modificationTime = std::filesystem::last_write_time(fileName, error);
+    if (error)
+        return std::nullopt;
+
+    return SourceFileStamp{ .size = static_cast<std::uint64_t>(size),
+                            .modificationTime = static_cast<std::int64_t>(modificationTime.time_since_epoch().count()) };
+}
+
+bool isBlank(char c)
+{
+    return ' ' == c || '\t' == c || '\r' == c;
+}
+
+std::string_view trimmedLeft(std::string_view text)
+{
+    while (! text.empty() && isBlank(text.front()))
+        text.remove_prefix(1);
+    return text;
+}
+
+/// @brief Parses a number at the beginning of text and removes it from the text, returns false if there is no number
+template<typename Number>
+bool consumeNumber(std::string_view& text, Number& value)
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{})
+        return false;
+    text.remove_prefix(static_cast<std::size_t>(end - text.data()));
+    return true;
+}
+
+/** @brief Parses one line of the text index: <step> <position> [(<columns>-<rows>)]
+ *  @return false if the line is blank */
+bool parseIndexLine(std::string_view line, NodeStepOffsets::Entry& entry, const std::string& fileNameIndex)
+{
+    line = trimmedLeft(line);
+    if (line.empty())
+        return false;
+
+    auto text = line;
+    if (! consumeNumber(text, entry.step) || text.empty() || ! isBlank(text.front()))
+        throw std::runtime_error("Invalid line format in file: " + fileNameIndex);
+    text = trimmedLeft(text);
+    if (! consumeNumber(text, entry.info.position) || (! text.empty() && ! isBlank(text.front())))
+        throw std::runtime_error("Invalid line format in file: " + fileNameIndex);
+
+    entry.info.sceneSize = std::nullopt;
+
+    // Optional "(columns-rows)" part
+    text = trimmedLeft(text);
+    if (text.empty())
+        return true;
+
+    auto rangePart = text.substr(0, static_cast<std::size_t>(std::ranges::find_if(text, isBlank) - text.begin()));
+    const auto invalidRange = [&]
+    {
+        return std::runtime_error(std::format("Invalid range format in file: {} line: {}", fileNameIndex, line));
+    };
+
+    ColumnAndRow sceneSize{};
+    if (! rangePart.starts_with('('))
+        throw invalidRange();
+    rangePart.remove_prefix(1);
+    if (! consumeNumber(rangePart, sceneSize.column) || ! rangePart.starts_with('-'))
+        throw invalidRange();
+    rangePart.remove_prefix(1);
+    if (! consumeNumber(rangePart, sceneSize.row) || rangePart != ")" || sceneSize.column < 0 || sceneSize.row < 0)
+        throw invalidRange();
+
+    entry.info.sceneSize = sceneSize;
+    return true;
+}
+
+/** @brief Parses lines of the text index.
+ *  @param parseUnterminatedLastLine If false, content after the last '\n' is left for later
+ *  @param[out] unterminatedLastLineStep Step of the parsed last line without '\n', if any
+ *  @return Number of bytes of complete (terminated) lines */
+std::size_t parseIndexLines(std::string_view content,
+                            bool parseUnterminatedLastLine,
+                            std::vector<NodeStepOffsets::Entry>& entries,
+                            std::optional<StepIndex>& unterminatedLastLineStep,
+                            const std::string& fileNameIndex)
+{
+    entries.reserve(entries.size() + std::ranges::count(content, '\n') + 1);
+
+    std::size_t lineBegin = 0;
+    while (lineBegin < content.size())
+    {
+        const auto* newLine = static_cast<const char*>(std::memchr(content.data() + lineBegin, '\n', content.size() - lineBegin));
+        if (! newLine && ! parseUnterminatedLastLine)
+            break;
+
+        const std::size_t lineEnd = newLine ? static_cast<std::size_t>(newLine - content.data()) : content.size();
+
+        NodeStepOffsets::Entry entry{};
+        if (parseIndexLine(content.substr(lineBegin, lineEnd - lineBegin), entry, fileNameIndex))
+        {
+            entries.push_back(entry);
+            if (! newLine)
+                unterminatedLastLineStep = entry.step;
+        }
+
+        if (! newLine)
+            break;
+        lineBegin = lineEnd + 1;
+    }
+    return lineBegin;
+}
+} // namespace
+
+
+NodeStepOffsets NodeStepOffsets::loadFromIndexFile(const std::string& indexFileName)
+{
+    if (auto cachedOffsets = loadFromCacheFile(indexFileName))
+        return std::move(*cachedOffsets);
+
+    auto offsets = parseTextIndexFile(indexFileName);
+    if (! offsets.writeCacheFile(indexFileName))
+    {
+        std::cerr << std::format("Warning: can't write index cache '{}', the text index will be parsed again next time", cacheFileName(indexFileName))
+                  << std::endl;
+    }
+    return offsets;
+}
+
+NodeStepOffsets NodeStepOffsets::parseTextIndexFile(const std::string& indexFileName)
+{
+    if (! std::filesystem::exists(indexFileName))
+        throw std::runtime_error("File not found: " + indexFileName);
+
+    // read before mapping: when the file is appended to meanwhile, the sidecar has an older time than the file and is not used
+    const auto sourceStamp = readSourceFileStamp(indexFileName);
+    const MappedFile indexFile(indexFileName);
+    const std::string_view content(indexFile.data(), indexFile.size());
+
+    NodeStepOffsets offsets;
+    if (sourceStamp)
+        offsets.parsedSource = ParsedSource{ .size = indexFile.size(), .modificationTime = sourceStamp->modificationTime };
+    std::vector<Entry> entries;
+    offsets.parsedTextBytes = parseIndexLines(content, /*parseUnterminatedLastLine=*/true, entries, offsets.unterminatedLastLineStep, indexFileName);
+    offsets.assign(std::move(entries), indexFileName);
+    return offsets;
+}
+
+IndexAppendResult NodeStepOffsets::appendFromTextIndexFile(const std::string& indexFileName)
+{
+    std::error_code error;
+    const auto fileSize = static_cast<std::uint64_t>(std::filesystem::file_size(indexFileName, error));
+    if (error)
+        throw std::runtime_error(std::format("Can't read size of '{}': {}", indexFileName, error.message()));
+
+    if (fileSize < parsedTextBytes) // rewritten, e.g. the simulation was started again
+    {
+        *this = parseTextIndexFile(indexFileName);
+        return { .appendedEntries = size(), .reloaded = true };
+    }
+    if (fileSize == parsedTextBytes)
+        return {};
+
+    std::string appendedText(fileSize - parsedTextBytes, '\0');
+    const NodeFile indexFile(indexFileName);
+    appendedText.resize(indexFile.readAt(static_cast<FilePosition>(parsedTextBytes), appendedText.data(), appendedText.size()));
+
+    std::vector<Entry> newEntries;
+    std::optional<StepIndex> ignoredUnterminatedStep;
+    const auto completeLinesBytes = parseIndexLines(appendedText, /*parseUnterminatedLastLine=*/false, newEntries, ignoredUnterminatedStep, indexFileName);
+    if (0 == completeLinesBytes) // only a part of a line was written so far
+        return {};
+
+    parsedTextBytes += completeLinesBytes;
+
+    // the line parsed without '\n' by the initial load starts the appended part, so it is in newEntries again
+    if (unterminatedLastLineStep)
+    {
+        if (auto it = std::ranges::lower_bound(sortedEntries, *unterminatedLastLineStep, {}, &Entry::step);
+            it != sortedEntries.end() && it->step == *unterminatedLastLineStep)
+        {
+            sortedEntries.erase(it);
+        }
+        unterminatedLastLineStep.reset();
+    }
+
+    const auto appendedEntries = newEntries.size();
+    const bool appendedInOrder = std::ranges::adjacent_find(newEntries,
+                                                            [](const Entry& lhs, const Entry& rhs)
+                                                            {
+                                                                return lhs.step >= rhs.step;
+                                                            })
+                                     == newEntries.end()
+                                 && (sortedEntries.empty() || newEntries.empty() || sortedEntries.back().step < newEntries.front().step);
+    if (appendedInOrder) // usual case: the simulation writes steps one after another
+    {
+        sortedEntries.insert(sortedEntries.end(), newEntries.begin(), newEntries.end());
+    }
+    else
+    {
+        auto allEntries = std::move(sortedEntries);
+        allEntries.insert(allEntries.end(), newEntries.begin(), newEntries.end());
+        assign(std::move(allEntries), indexFileName);
+    }
+
+    return { .appendedEntries = appendedEntries };
+}
+
+std::string NodeStepOffsets::cacheFileName(const std::string& indexFileName)
+{
+    constexpr std::string_view textIndexSuffix = ".txt";
+    std::string_view baseName = indexFileName;
+    if (baseName.ends_with(textIndexSuffix))
+        baseName.remove_suffix(textIndexSuffix.size());
+    return std::format("{}.cache", baseName);
+}
+
+void NodeStepOffsets::assign(std::vector<Entry> newEntries, const std::string& sourceName)
+{
+    // stable: for duplicated steps the entry from the earlier line stays first (as the first insertion to a map)
+    std::ranges::stable_sort(newEntries, {}, &Entry::step);
+
+    const auto duplicates = std::ranges::unique(newEntries, {}, &Entry::step);
+    for (auto it = duplicates.begin(); it != duplicates.end(); ++it)
+    {
+        std::cerr << std::format("Duplicate stepNumber {} in file '{}'", it->step, sourceName) << std::endl;
+    }
+    newEntries.erase(duplicates.begin(), duplicates.end());
+
+    sortedEntries = std::move(newEntries);
+}
+
+const StepOffsetInfo* NodeStepOffsets::find(StepIndex step) const
+{
+    const auto it = std::ranges::lower_bound(sortedEntries, step, {}, &Entry::step);
+    if (it != sortedEntries.end() && it->step == step)
+        return &it->info;
+    return nullptr;
+}
+
+std::vector<StepIndex> NodeStepOffsets::steps() const
+{
+    std::vector<StepIndex> allSteps;
+    allSteps.reserve(sortedEntries.size());
+    for (const auto& entry : sortedEntries)
+        allSteps.push_back(entry.step);
+    return allSteps;
+}
+
+std::optional<NodeStepOffsets> NodeStepOffsets::loadFromCacheFile(const std::string& indexFileName)
+{
+    const auto cacheName = cacheFileName(indexFileName);
+    const auto sourceStamp = readSourceFileStamp(indexFileName);
+    if (! sourceStamp || ! std::filesystem::exists(cacheName))
+        return std::nullopt;
+
+    try
+    {
+        const MappedFile cacheFile(cacheName);
+
+        CacheHeader header{};
+        if (cacheFile.size() < sizeof(header))
+            return std::nullopt;
+        std::memcpy(&header, cacheFile.data(), sizeof(header));
+
+        const bool upToDate = std::ranges::equal(header.magic, CACHE_MAGIC) && CACHE_VERSION == header.version
+                              && sizeof(CacheEntry) == header.entrySize && sourceStamp->size == header.sourceFileSize
+                              && sourceStamp->modificationTime == header.sourceModificationTime
+                              && (cacheFile.size() - sizeof(header)) / sizeof(CacheEntry) == header.entriesCount
+                              && (cacheFile.size() - sizeof(header)) % sizeof(CacheEntry) == 0;
+        if (! upToDate)
+            return std::nullopt;
+
+        NodeStepOffsets offsets;
+        offsets.parsedTextBytes = header.parsedTextBytes;
+        if (header.hasUnterminatedLastLine)
+            offsets.unterminatedLastLineStep = header.unterminatedLastLineStep;
+        offsets.sortedEntries.resize(header.entriesCount);
+
+        const char* packedEntry = cacheFile.data() + sizeof(header);
+        for (auto& entry : offsets.sortedEntries)
+        {
+            CacheEntry cached;
+            std::memcpy(&cached, packedEntry, sizeof(cached));
+            packedEntry += sizeof(cached);
+
+            entry.step = cached.step;
+            entry.info.position = cached.position;
+            if (cached.hasSceneSize)
+                entry.info.sceneSize = ColumnAndRow{ .column = cached.columns, .row = cached.rows };
+        }
+
+        // the sidecar is written only from sorted unique entries, anything else means a damaged file
+        const bool sortedAndUnique = std::ranges::adjacent_find(offsets.sortedEntries,
+                                                                [](const Entry& lhs, const Entry& rhs)
+                                                                {
+                                                                    return lhs.step >= rhs.step;
+                                                                })
+                                     == offsets.sortedEntries.end();
+        if (! sortedAndUnique)
+            return std::nullopt;
+
+        return offsets;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << std::format("Warning: ignoring index cache '{}': {}", cacheName, e.what()) << std::endl;
+        return std::nullopt;
+    }
+}
+
+bool NodeStepOffsets::writeCacheFile(const std::string& indexFileName) const
+{
+    if (! parsedSource) // the entries have to be exactly those of the parsed text
+        return false;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.entrySize = sizeof(CacheEntry);
+    header.sourceFileSize = parsedSource->size;
+    header.sourceModificationTime = parsedSource->modificationTime;
+    header.entriesCount = sortedEntries.size();
+    header.parsedTextBytes = parsedTextBytes;
+    header.hasUnterminatedLastLine = unterminatedLastLineStep.has_value();
+    header.unterminatedLastLineStep = unterminatedLastLineStep.value_or(0);
+
+    std::vector<CacheEntry> packedEntries;
+    packedEntries.reserve(sortedEntries.size());
+    for (const auto& entry : sortedEntries)
+    {
+        const auto sceneSize = entry.info.sceneSize.value_or(ColumnAndRow{});
+        packedEntries.push_back(CacheEntry{ .position = entry.info.position,
+                                            .step = entry.step,
+                                            .hasSceneSize = entry.info.sceneSize.has_value(),
+                                            .columns = sceneSize.column,
+                                            .rows = sceneSize.row });
+    }
+
+    // written under temporary name and renamed, so a reader never sees a half-written sidecar
+    const auto cacheName = cacheFileName(indexFileName);
+    const auto temporaryName = cacheName + ".tmp";
+    {
+        std::ofstream cacheFile(temporaryName, std::ios::binary | std::ios::trunc);
+        if (! cacheFile)
+            return false;
+
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        cacheFile.write(reinterpret_cast<const char*>(packedEntries.data()), static_cast<std::streamsize>(packedEntries.size() * sizeof(CacheEntry)));
+        if (! cacheFile.flush())
+        {
+            cacheFile.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryName, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryName, cacheName, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryName, error);
+        return false;
+    }
+    return true;
+}
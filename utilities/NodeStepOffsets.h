@@ -0,0 +1,143 @@
+/** @file NodeStepOffsets.h
+ * @brief Declaration of the NodeStepOffsets class - sorted index of steps in a node's data file. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+/** @struct StepOffsetInfo
+ * @brief Location of one step in the node's data file. */
+struct StepOffsetInfo
+{
+    FilePosition position;                 ///< Byte offset of the step in the data file
+    std::optional<ColumnAndRow> sceneSize; ///< Node dimensions (required in binary mode, optional in text mode)
+};
+
+/** @brief Called while indices of nodes are loaded (possibly from worker threads, one call per loaded node).
+ *  @param loadedNodes Number of nodes already in memory
+ *  @param totalNodes Number of all nodes of the stage */
+using IndexLoadingProgressCallback = std::function<void(std::size_t loadedNodes, std::size_t totalNodes)>;
+
+/// @brief Result of reading lines appended to text index files (see NodeStepOffsets::appendFromTextIndexFile())
+struct IndexAppendResult
+{
+    std::size_t appendedEntries = 0; ///< Number of lines parsed from the appended part
+    bool reloaded = false;           ///< The file got shorter (it was rewritten), so it was parsed again from the start
+
+    IndexAppendResult& operator+=(const IndexAppendResult& other)
+    {
+        appendedEntries += other.appendedEntries;
+        reloaded = reloaded || other.reloaded;
+        return *this;
+    }
+};
+
+/** @class NodeStepOffsets
+ * @brief Index of one node: step number -> StepOffsetInfo, kept as a dense array sorted by step.
+ *
+ * The index is read from the text file `<output>N_index.txt` with lines:
+ *      <stepNumber:int> <positionInFile:long> [(<columns:int>-<rows:int>)]
+ *
+ * Parsing is done once; the result is stored next to the text file in a binary sidecar
+ * `<output>N_index.cache`, validated with size and modification time of the text index.
+ * Following loads of unchanged index are a single memory mapping of the sidecar.
+ *
+ * For simulations which are still running, appendFromTextIndexFile() parses only the bytes
+ * written after the already parsed part, so refreshing costs only the new lines. */
+class NodeStepOffsets
+{
+public:
+    struct Entry
+    {
+        StepIndex step;
+        StepOffsetInfo info;
+    };
+
+    /** @brief Loads index of the node, from the binary sidecar when it is up to date, otherwise from the text file.
+     *
+     * After parsing the text file the sidecar is (re)written; failure to write it is not an error.
+     * @param indexFileName Path of the text index file (`<output>N_index.txt`)
+     * @throws std::runtime_error If the text index does not exist or has an invalid format */
+    static NodeStepOffsets loadFromIndexFile(const std::string& indexFileName);
+
+    /** @brief Parses the text index file (without using the sidecar).
+     * @throws std::runtime_error If the file cannot be opened or has an invalid format */
+    static NodeStepOffsets parseTextIndexFile(const std::string& indexFileName);
+
+    /** @brief Parses only complete lines appended to the text index since it was loaded or last appended.
+     *
+     * The last line without end of line character may be still being written: it is not parsed
+     * (if it was parsed by the initial load, it is parsed again when completed).
+     * The binary sidecar is not updated; it is rebuilt on the next load of the index.
+     * @throws std::runtime_error If the file cannot be read or a new line has an invalid format */
+    IndexAppendResult appendFromTextIndexFile(const std::string& indexFileName);
+
+    /// @brief Returns name of the binary sidecar for the text index file
+    static std::string cacheFileName(const std::string& indexFileName);
+
+    /** @brief Replaces content of the index. Entries are sorted by step;
+     *  for duplicated steps the first one is kept and a warning is printed.
+     *  @param sourceName Used in warnings only */
+    void assign(std::vector<Entry> newEntries, const std::string& sourceName = {});
+
+    /// @brief Returns information about the step or nullptr if the step is not in the index (binary search)
+    const StepOffsetInfo* find(StepIndex step) const;
+
+    bool contains(StepIndex step) const
+    {
+        return find(step) != nullptr;
+    }
+
+    /// @brief Returns all steps in ascending order
+    std::vector<StepIndex> steps() const;
+
+    const std::vector<Entry>& entries() const
+    {
+        return sortedEntries;
+    }
+
+    std::size_t size() const
+    {
+        return sortedEntries.size();
+    }
+
+    bool empty() const
+    {
+        return sortedEntries.empty();
+    }
+
+    void clear()
+    {
+        sortedEntries.clear();
+        parsedTextBytes = 0;
+        unterminatedLastLineStep.reset();
+        parsedSource.reset();
+    }
+
+private:
+    /// @brief Returns index read from the sidecar, or std::nullopt if it is missing, outdated or damaged
+    static std::optional<NodeStepOffsets> loadFromCacheFile(const std::string& indexFileName);
+
+    /// @brief Writes the sidecar atomically (temporary file + rename), returns false on failure or when the index was not parsed from the text
+    bool writeCacheFile(const std::string& indexFileName) const;
+
+    /// State of the text index parsed by parseTextIndexFile(), the sidecar is valid only for it
+    struct ParsedSource
+    {
+        std::uint64_t size;            ///< bytes of the mapped file
+        std::int64_t modificationTime; ///< read before the file was mapped
+    };
+
+    std::vector<Entry> sortedEntries; ///< sorted by step, steps are unique
+
+    std::uint64_t parsedTextBytes = 0;                ///< end of the last complete line parsed from the text index
+    std::optional<StepIndex> unterminatedLastLineStep; ///< step parsed from the last line without '\n' (maybe incomplete)
+    std::optional<ParsedSource> parsedSource;          ///< std::nullopt when loaded from the sidecar
+};
@@ -0,0 +1,343 @@
+/** @file OutputContainer.cpp
+ * @brief Implementation of the OutputContainer class. */
+
+#include "OutputContainer.h"
+
+#include <algorithm> // std::ranges::sort, std::ranges::upper_bound, std::min
+#include <cstring>   // std::memcpy, std::memcmp, std::memchr
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "ModelReader.hpp" // ReaderHelpers
+#include "ThreadPool.h"
+
+
+namespace
+{
+/// Layout of the container: ContainerHeader, ContainerHeader::entriesCount ContainerEntry records, chunks (native byte order)
+struct ContainerHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entrySize;
+    std::uint32_t compression;
+    std::uint32_t nodesCount;
+    std::uint64_t entriesCount;
+};
+
+struct ContainerEntry
+{
+    std::uint64_t offset;
+    std::uint64_t storedSize;
+    std::uint64_t rawSize;
+    std::uint32_t node;
+    std::uint32_t step;
+    std::int32_t columns;
+    std::int32_t rows;
+};
+
+constexpr char CONTAINER_MAGIC[8] = { 'O', 'O', 'C', 'P', 'A', 'C', 'K', '\0' };
+constexpr std::uint32_t CONTAINER_VERSION = 1;
+
+/// Chunks of a node compressed at once by pack(), per worker thread (limits memory used for compressed data)
+constexpr std::size_t CHUNKS_PER_THREAD_IN_BATCH = 4;
+
+/// Removes the file when destroyed, unless dismissed (the temporary container of a failed pack())
+struct TemporaryFileRemover
+{
+    const std::string& fileName;
+    bool dismissed = false;
+
+    ~TemporaryFileRemover()
+    {
+        std::error_code error;
+        if (! dismissed)
+            std::filesystem::remove(fileName, error);
+    }
+};
+} // namespace
+
+std::vector<char> compressChunkText(std::string_view text, ContainerCompression compression)
+{
+    std::vector<char> compressed;
+#ifdef HAVE_LZ4
+    if (ContainerCompression::Lz4 == compression && ! text.empty())
+    {
+        if (text.size() > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+            throw std::runtime_error(std::format("Chunk of {} bytes is too big for LZ4 compression", text.size()));
+
+        compressed.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(text.size()))));
+        const int compressedSize = LZ4_compress_default(text.data(), compressed.data(), static_cast<int>(text.size()), static_cast<int>(compressed.size()));
+        if (compressedSize <= 0 || static_cast<std::size_t>(compressedSize) >= text.size())
+            compressed.clear();
+        else
+            compressed.resize(static_cast<std::size_t>(compressedSize));
+    }
+#else
+    (void)text;
+    (void)compression;
+#endif
+    return compressed;
+}
+
+std::optional<std::string_view> decompressChunkText(std::string_view stored, std::uint64_t rawSize, ContainerCompression compression, std::vector<char>& buffer)
+{
+    if (stored.size() == rawSize)
+        return stored;
+
+#ifdef HAVE_LZ4
+    if (ContainerCompression::Lz4 == compression && rawSize <= static_cast<std::uint64_t>(std::numeric_limits<int>::max())
+        && stored.size() <= static_cast<std::size_t>(std::numeric_limits<int>::max()))
+    {
+        buffer.resize(rawSize);
+        const int decompressedSize = LZ4_decompress_safe(stored.data(), buffer.data(), static_cast<int>(stored.size()), static_cast<int>(buffer.size()));
+        if (decompressedSize >= 0 && static_cast<std::uint64_t>(decompressedSize) == rawSize)
+            return std::string_view(buffer.data(), buffer.size());
+    }
+#else
+    (void)compression;
+    (void)buffer;
+#endif
+    return std::nullopt;
+}
+
+ContainerCompression containerCompressionFromName(std::string_view name)
+{
+    if ("none" == name)
+        return ContainerCompression::None;
+    if ("lz4" == name)
+        return ContainerCompression::Lz4;
+    throw std::invalid_argument(std::format("Unknown container compression '{}' (expected 'none' or 'lz4')", name));
+}
+
+bool isContainerCompressionAvailable(ContainerCompression compression)
+{
+    switch (compression)
+    {
+    case ContainerCompression::None:
+        return true;
+    case ContainerCompression::Lz4:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+
+OutputContainer::OutputContainer(const std::string& containerPath)
+    : file{ containerPath }
+{
+    ContainerHeader header{};
+    if (file.size() < sizeof(header))
+        throw std::runtime_error(std::format("'{}' is not an output container (too short)", containerPath));
+
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (0 != std::memcmp(header.magic, CONTAINER_MAGIC, sizeof(header.magic)) || header.version != CONTAINER_VERSION
+        || header.entrySize != sizeof(ContainerEntry))
+    {
+        throw std::runtime_error(std::format("'{}' is not an output container of a supported version", containerPath));
+    }
+    if (header.entriesCount > (file.size() - sizeof(header)) / sizeof(ContainerEntry))
+        throw std::runtime_error(std::format("Index of the output container '{}' is truncated", containerPath));
+
+    chunksCompression = static_cast<ContainerCompression>(header.compression);
+    if (! isContainerCompressionAvailable(chunksCompression))
+        throw std::runtime_error(std::format("Output container '{}' uses compression {} which is not available in this build", containerPath, header.compression));
+
+    nodeChunks.resize(header.nodesCount);
+    const char* entryData = file.data() + sizeof(header);
+    for (std::uint64_t i = 0; i < header.entriesCount; ++i, entryData += sizeof(ContainerEntry))
+    {
+        ContainerEntry entry;
+        std::memcpy(&entry, entryData, sizeof(entry));
+        if (entry.node >= header.nodesCount || entry.offset > file.size() || entry.storedSize > file.size() - entry.offset)
+            throw std::runtime_error(std::format("Damaged entry {} in the index of the output container '{}'", i, containerPath));
+
+        nodeChunks[entry.node].push_back(Chunk{ .step = entry.step,
+                                                .sceneSize = ColumnAndRow::xy(entry.columns, entry.rows),
+                                                .offset = entry.offset,
+                                                .storedSize = entry.storedSize,
+                                                .rawSize = entry.rawSize });
+    }
+
+    for (auto& chunks : nodeChunks)
+        std::ranges::sort(chunks, {}, &Chunk::step);
+}
+
+NodeStepOffsets OutputContainer::nodeStepOffsets(NodeIndex node) const
+{
+    std::vector<NodeStepOffsets::Entry> entries;
+    entries.reserve(nodeChunks.at(node).size());
+    for (const auto& chunk : nodeChunks[node])
+    {
+        entries.push_back(NodeStepOffsets::Entry{
+            .step = chunk.step,
+            .info = StepOffsetInfo{ .position = static_cast<FilePosition>(chunk.offset), .sceneSize = chunk.sceneSize } });
+    }
+
+    NodeStepOffsets offsets;
+    offsets.assign(std::move(entries), path());
+    return offsets;
+}
+
+auto OutputContainer::findChunk(NodeIndex node, StepIndex step) const -> const Chunk*
+{
+    if (node >= nodeChunks.size())
+        return nullptr;
+
+    const auto& chunks = nodeChunks[node];
+    const auto it = std::ranges::lower_bound(chunks, step, {}, &Chunk::step);
+    return (it != chunks.end() && it->step == step) ? &*it : nullptr;
+}
+
+std::string_view OutputContainer::chunkData(const Chunk& chunk, std::vector<char>& buffer) const
+{
+    if (const auto text = decompressChunkText(file.view(chunk.offset, chunk.storedSize), chunk.rawSize, chunksCompression, buffer))
+        return *text;
+    throw std::runtime_error(std::format("Damaged chunk of step {} in the output container '{}'", chunk.step, path()));
+}
+
+ContainerPackingStatistics OutputContainer::pack(const std::string& outputFileName,
+                                                 NodeIndex nodesCount,
+                                                 const std::string& containerPath,
+                                                 ContainerCompression compression,
+                                                 const ContainerPackingProgressCallback& progress)
+{
+    if (! isContainerCompressionAvailable(compression))
+        throw std::runtime_error("LZ4 compression is not available in this build (liblz4 was not found)");
+
+    ThreadPool threadPool;
+
+    std::vector<NodeStepOffsets> indices(nodesCount);
+    threadPool.parallelFor(nodesCount,
+                           [&](std::size_t node)
+                           {
+                               indices[node] = NodeStepOffsets::loadFromIndexFile(ReaderHelpers::giveMeFileNameIndex(outputFileName, static_cast<NodeIndex>(node)));
+                           });
+
+    std::size_t entriesCount = 0;
+    for (const auto& index : indices)
+        entriesCount += index.size();
+
+    // written under temporary name and renamed, so a reader never sees a half-written container
+    const auto temporaryName = containerPath + ".tmp";
+    TemporaryFileRemover removeOnFailure{ temporaryName }; // declared before the stream, so the file is closed first
+    std::ofstream container(temporaryName, std::ios::binary | std::ios::trunc);
+    if (! container)
+        throw std::runtime_error(std::format("Can't create output container '{}'", temporaryName));
+
+    // the index is written at the end, when locations of all chunks are known
+    const std::uint64_t indexEnd = sizeof(ContainerHeader) + entriesCount * sizeof(ContainerEntry);
+    container.seekp(static_cast<std::streamoff>(indexEnd));
+
+    ContainerPackingStatistics statistics;
+    std::vector<ContainerEntry> entries;
+    entries.reserve(entriesCount);
+    std::uint64_t writePosition = indexEnd;
+
+    const std::size_t batchSize = CHUNKS_PER_THREAD_IN_BATCH * threadPool.size();
+    for (NodeIndex node = 0; node < nodesCount; ++node)
+    {
+        const auto dataFileName = ReaderHelpers::giveMeFileName(outputFileName, node);
+        const MappedFile dataFile(dataFileName);
+        const auto& nodeEntries = indices[node].entries();
+
+        // a step's text ends where the next step (in the file) starts
+        std::vector<FilePosition> positions;
+        positions.reserve(nodeEntries.size());
+        for (const auto& entry : nodeEntries)
+            positions.push_back(entry.info.position);
+        std::ranges::sort(positions);
+
+        for (std::size_t batchBegin = 0; batchBegin < nodeEntries.size(); batchBegin += batchSize)
+        {
+            const auto batchEntries = std::min(batchSize, nodeEntries.size() - batchBegin);
+            std::vector<std::string_view> texts(batchEntries);
+            std::vector<std::vector<char>> compressed(batchEntries);
+            std::vector<ContainerEntry> packed(batchEntries);
+
+            threadPool.parallelFor(batchEntries,
+                                   [&](std::size_t i)
+                                   {
+                                       const auto& entry = nodeEntries[batchBegin + i];
+                                       const auto nextPosition = std::ranges::upper_bound(positions, entry.info.position);
+                                       const auto begin = static_cast<std::size_t>(entry.info.position);
+                                       const auto end = (nextPosition != positions.end()) ? static_cast<std::size_t>(*nextPosition) : dataFile.size();
+                                       if (begin > dataFile.size() || end > dataFile.size())
+                                           throw std::runtime_error(std::format("Step {} is beyond the end of '{}'", entry.step, dataFileName));
+
+                                       texts[i] = dataFile.view(begin, end - begin);
+                                       ColumnAndRow sceneSize;
+                                       if (entry.info.sceneSize)
+                                       {
+                                           sceneSize = *entry.info.sceneSize;
+                                       }
+                                       else // header line of the step
+                                       {
+                                           const auto headerEnd = texts[i].find('\n');
+                                           sceneSize = ReaderHelpers::getColumnAndRowFromLine(std::string(texts[i].substr(0, headerEnd)));
+                                       }
+
+                                       compressed[i] = compressChunkText(texts[i], compression);
+                                       packed[i] = ContainerEntry{ .offset = 0,
+                                                                   .storedSize = compressed[i].empty() ? texts[i].size() : compressed[i].size(),
+                                                                   .rawSize = texts[i].size(),
+                                                                   .node = node,
+                                                                   .step = entry.step,
+                                                                   .columns = sceneSize.column,
+                                                                   .rows = sceneSize.row };
+                                   });
+
+            for (std::size_t i = 0; i < batchEntries; ++i)
+            {
+                packed[i].offset = writePosition;
+                if (compressed[i].empty())
+                    container.write(texts[i].data(), static_cast<std::streamsize>(texts[i].size()));
+                else
+                    container.write(compressed[i].data(), static_cast<std::streamsize>(compressed[i].size()));
+
+                writePosition += packed[i].storedSize;
+                statistics.rawBytes += packed[i].rawSize;
+                statistics.storedBytes += packed[i].storedSize;
+                entries.push_back(packed[i]);
+            }
+        }
+
+        if (progress)
+            progress(node + 1, nodesCount);
+    }
+    statistics.chunks = entries.size();
+
+    ContainerHeader header{};
+    std::memcpy(header.magic, CONTAINER_MAGIC, sizeof(header.magic));
+    header.version = CONTAINER_VERSION;
+    header.entrySize = sizeof(ContainerEntry);
+    header.compression = static_cast<std::uint32_t>(compression);
+    header.nodesCount = nodesCount;
+    header.entriesCount = entries.size();
+
+    container.seekp(0);
+    container.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    container.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ContainerEntry)));
+    if (! container.flush())
+        throw std::runtime_error(std::format("Can't write output container '{}'", temporaryName));
+    container.close();
+
+    std::error_code error;
+    std::filesystem::rename(temporaryName, containerPath, error);
+    if (error)
+        throw std::runtime_error(std::format("Can't rename '{}' to '{}'", temporaryName, containerPath));
+    removeOnFailure.dismissed = true;
+    return statistics;
+}
@@ -0,0 +1,131 @@
+/** @file OutputContainer.h
+ * @brief Declaration of the OutputContainer class - all nodes and steps of a simulation output packed into one file. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+#include "NodeStepOffsets.h"
+#include "types.h"
+
+/// @brief Compression of chunks in the output container
+enum class ContainerCompression : std::uint32_t
+{
+    None = 0, ///< chunks are stored as they are
+    Lz4 = 1   ///< LZ4 block compression (available when the application is built with liblz4)
+};
+
+/** @brief Parses compression name used on the command line ("none" or "lz4").
+ *  @throws std::invalid_argument For other names */
+ContainerCompression containerCompressionFromName(std::string_view name);
+
+/// @brief Whether chunks compressed this way can be written and read by this build
+bool isContainerCompressionAvailable(ContainerCompression compression);
+
+/** @brief Compresses text of one chunk (also used for chunks sent by RemoteOutputAgent).
+ *  @return Compressed bytes, or an empty vector when the chunk is to be stored uncompressed (no compression or no gain)
+ *  @throws std::runtime_error If the text is too big for the compression */
+std::vector<char> compressChunkText(std::string_view text, ContainerCompression compression);
+
+/** @brief Returns text of a chunk: the stored bytes when they are not compressed (rawSize equals their size),
+ *         otherwise decompressed into buffer.
+ *  @return The text, or std::nullopt when the chunk is damaged or its compression is not available */
+std::optional<std::string_view> decompressChunkText(std::string_view stored, std::uint64_t rawSize, ContainerCompression compression, std::vector<char>& buffer);
+
+/// @brief Summary of OutputContainer::pack()
+struct ContainerPackingStatistics
+{
+    std::size_t chunks = 0;
+    std::uint64_t rawBytes = 0;    ///< Size of the packed text data
+    std::uint64_t storedBytes = 0; ///< Size of the chunks in the container (without its header)
+};
+
+/** @brief Called by OutputContainer::pack() after every packed node.
+ *  @param packedNodes Number of nodes already written
+ *  @param totalNodes Number of all nodes */
+using ContainerPackingProgressCallback = std::function<void(std::size_t packedNodes, std::size_t totalNodes)>;
+
+/** @class OutputContainer
+ * @brief Read-only access to a container file holding the text output of all nodes for all steps.
+ *
+ * Instead of `<output>N.txt` and `<output>N_index.txt` for every node the container `<output>.oocpack` has:
+ * - a header with the index of all nodes (step, node size, location of the chunk),
+ * - one chunk per node and step: the text of the node's step (header line and rows of cells),
+ *   compressed separately, so any step of any node is read without touching the others.
+ *
+ * The file is memory mapped, chunks are decompressed by the caller's threads (ModelReader reads nodes in parallel).
+ * A chunk whose compression does not save space is stored uncompressed (its stored size equals raw size). */
+class OutputContainer
+{
+public:
+    /// Location of one node's step in the container
+    struct Chunk
+    {
+        StepIndex step;
+        ColumnAndRow sceneSize;
+        std::uint64_t offset;     ///< Byte offset of the chunk in the container
+        std::uint64_t storedSize; ///< Bytes of the chunk in the container
+        std::uint64_t rawSize;    ///< Bytes of the text after decompression
+    };
+
+    /// @brief Name of the container packed from the output with the basename (the `output_file_name` setting)
+    static std::string fileName(const std::string& outputFileName)
+    {
+        return outputFileName + ".oocpack";
+    }
+
+    /** @brief Maps the container and reads its index.
+     *  @throws std::runtime_error If the file cannot be mapped, is not a container, or its compression is not available */
+    explicit OutputContainer(const std::string& containerPath);
+
+    /** @brief Packs text output of the nodes (`<output>N.txt` and `<output>N_index.txt`) into a container.
+     *
+     * Chunks of a node are compressed in parallel, nodes are written one after another, so the memory needed
+     * is about the size of a few chunks. The container is written under a temporary name and renamed at the end.
+     * @param outputFileName Basename of the node files
+     * @param nodesCount Number of nodes (number_node_x * number_node_y)
+     * @throws std::runtime_error If a node file cannot be read, the container cannot be written or the compression is not available */
+    static ContainerPackingStatistics pack(const std::string& outputFileName,
+                                           NodeIndex nodesCount,
+                                           const std::string& containerPath,
+                                           ContainerCompression compression,
+                                           const ContainerPackingProgressCallback& progress = {});
+
+    NodeIndex nodesCount() const
+    {
+        return static_cast<NodeIndex>(nodeChunks.size());
+    }
+
+    ContainerCompression compression() const
+    {
+        return chunksCompression;
+    }
+
+    /// @brief Index of the node (positions are offsets of chunks in the container, all entries have their node size)
+    NodeStepOffsets nodeStepOffsets(NodeIndex node) const;
+
+    /// @brief Returns chunk of the node's step or nullptr if there is none (binary search)
+    const Chunk* findChunk(NodeIndex node, StepIndex step) const;
+
+    /** @brief Returns text of the chunk: a view of the mapping for uncompressed chunks, otherwise decompressed into buffer.
+     *  @param buffer Storage for decompressed data (reused by the caller, e.g. buffers of ModelReader workers), the view is valid until it is modified
+     *  @throws std::runtime_error If the chunk is damaged */
+    std::string_view chunkData(const Chunk& chunk, std::vector<char>& buffer) const;
+
+    const std::string& path() const
+    {
+        return file.path();
+    }
+
+private:
+    MappedFile file;
+    ContainerCompression chunksCompression = ContainerCompression::None;
+    std::vector<std::vector<Chunk>> nodeChunks; ///< sorted by step for every node
+};
@@ -0,0 +1,145 @@
+/** @file PlaybackScheduler.cpp
+ * @brief Implementation of the PlaybackScheduler class. */
+
+#include "PlaybackScheduler.h"
+
+#include <algorithm> // std::max, std::min, std::ranges::count_if
+#include <cstdlib>   // std::llabs
+#include <stdexcept>
+
+
+namespace
+{
+constexpr auto STATISTICS_PERIOD = std::chrono::seconds(1);
+} // namespace
+
+void PlaybackScheduler::start(StepIndex shownStep, int stride, StepIndex endStep, Clock::duration frameInterval, Clock::time_point now)
+{
+    if (0 == stride)
+        throw std::invalid_argument("Stride of the playback must not be zero");
+
+    this->stride = stride;
+    this->endStep = endStep;
+    this->frameInterval = std::max(frameInterval, Clock::duration::zero());
+    this->shownStep = shownStep;
+    shownTime = now;
+    timelineStep = shownStep;
+    timelineStart = now;
+    shownFrames = 0;
+    droppedSteps = 0;
+    recentFrames.clear();
+}
+
+void PlaybackScheduler::setPace(int stride, Clock::duration frameInterval, Clock::time_point now)
+{
+    frameInterval = std::max(frameInterval, Clock::duration::zero());
+    if (stride == this->stride && frameInterval == this->frameInterval)
+        return;
+    if (0 == stride)
+        throw std::invalid_argument("Stride of the playback must not be zero");
+
+    this->stride = stride;
+    this->frameInterval = frameInterval;
+    timelineStep = shownStep;
+    timelineStart = now;
+}
+
+PlaybackScheduler::Frame PlaybackScheduler::nextFrame(Clock::time_point now, Clock::duration decodeTime, const std::function<bool(StepIndex)>& isDecoded) const
+{
+    if (finished())
+        return {};
+
+    const auto shownFrame = frameOfStep(shownStep);
+    const auto dueFrame = std::min(frameDueAt(now), frameOfStep(endStep));
+    if (dueFrame <= shownFrame) // the shown step is still on time
+        return {};
+
+    for (auto frame = dueFrame; frame > shownFrame && dueFrame - frame < MAX_CHECKED_FRAMES; --frame)
+    {
+        const auto step = stepOfFrame(frame);
+        if (isDecoded(step))
+            return Frame{ .step = step, .decoded = true };
+    }
+
+    // nothing was decoded in time for too long (the decoding may have failed): the due step has to be read
+    if (now - shownTime >= std::max(MIN_WAITING_FOR_DECODING, 2 * decodeTime))
+        return Frame{ .step = stepOfFrame(dueFrame), .decoded = false };
+    return {};
+}
+
+void PlaybackScheduler::frameShown(StepIndex step, Clock::time_point now)
+{
+    const auto skippedFrames = frameOfStep(step) - frameOfStep(shownStep) - 1;
+    if (skippedFrames > 0)
+        droppedSteps += static_cast<std::size_t>(skippedFrames);
+
+    shownStep = step;
+    shownTime = now;
+    ++shownFrames;
+
+    recentFrames.push_back(now);
+    while (recentFrames.front() < now - STATISTICS_PERIOD)
+        recentFrames.pop_front();
+}
+
+std::vector<StepIndex> PlaybackScheduler::stepsToDecode(Clock::time_point now, Clock::duration decodeTime, std::size_t count) const
+{
+    std::vector<StepIndex> steps;
+    if (finished() || 0 == count)
+        return steps;
+
+    // the decoder finishes one step per decode time: only every framesPerDecode-th frame can be on time,
+    // frames are aligned to the timeline, so the following ticks ask for the same steps
+    long long framesPerDecode = 1;
+    if (frameInterval > Clock::duration::zero() && decodeTime > frameInterval)
+        framesPerDecode = (decodeTime + frameInterval - Clock::duration(1)) / frameInterval;
+
+    auto frame = std::max(frameDueAt(now + decodeTime), frameOfStep(shownStep) + 1);
+    frame = (frame + framesPerDecode - 1) / framesPerDecode * framesPerDecode;
+
+    const auto lastFrame = frameOfStep(endStep);
+    for (; steps.size() < count; frame += framesPerDecode)
+    {
+        if (frame >= lastFrame)
+        {
+            steps.push_back(endStep); // the playback ends with the last step
+            break;
+        }
+        steps.push_back(stepOfFrame(frame));
+    }
+    return steps;
+}
+
+PlaybackStatistics PlaybackScheduler::statistics(Clock::time_point now) const
+{
+    const auto framesInPeriod = std::ranges::count_if(recentFrames,
+                                                      [periodStart = now - STATISTICS_PERIOD](Clock::time_point frameTime)
+                                                      {
+                                                          return frameTime >= periodStart;
+                                                      });
+    return PlaybackStatistics{ .framesPerSecond = static_cast<double>(framesInPeriod) / std::chrono::duration<double>(STATISTICS_PERIOD).count(),
+                               .shownFrames = shownFrames,
+                               .droppedSteps = droppedSteps };
+}
+
+long long PlaybackScheduler::frameOfStep(StepIndex step) const
+{
+    const auto distance = std::llabs(static_cast<long long>(step) - static_cast<long long>(timelineStep));
+    const auto strideLength = std::llabs(stride);
+    return (distance + strideLength - 1) / strideLength;
+}
+
+StepIndex PlaybackScheduler::stepOfFrame(long long frame) const
+{
+    const auto step = static_cast<long long>(timelineStep) + frame * stride;
+    if (stride > 0)
+        return static_cast<StepIndex>(std::min(step, static_cast<long long>(endStep)));
+    return static_cast<StepIndex>(std::max(step, static_cast<long long>(endStep)));
+}
+
+long long PlaybackScheduler::frameDueAt(Clock::time_point time) const
+{
+    if (Clock::duration::zero() == frameInterval) // no deadline: the frame after the shown one
+        return frameOfStep(shownStep) + 1;
+    return std::max<long long>(0, (time - timelineStart) / frameInterval);
+}
@@ -0,0 +1,102 @@
+/** @file PlaybackScheduler.h
+ * @brief Declaration of the PlaybackScheduler class - steps shown by the playback with a target frame rate. */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "types.h"
+
+/// @brief Frames shown and steps skipped by the playback (see PlaybackScheduler)
+struct PlaybackStatistics
+{
+    double framesPerSecond = 0;   ///< frames shown during the last second
+    std::size_t shownFrames = 0;  ///< since the start of the playback
+    std::size_t droppedSteps = 0; ///< steps of the stride which were skipped, because they would not be decoded in time
+};
+
+/** @class PlaybackScheduler
+ * @brief Chooses the step shown on every tick of the playback, so the playback keeps its pace on any hardware.
+ *
+ * The playback has a timeline: its k-th frame is the step `start + k * stride`, due k frame intervals after the start.
+ * On every tick the newest step which is due and already decoded is shown, the steps before it are dropped.
+ * When none of them is decoded, the shown step stays (the GUI does not wait for files in the tick).
+ * Steps to decode are the ones due when the decoder (one step per decode time) finishes them, so when decoding
+ * is slower than the frame rate every m-th step is decoded on time, instead of all steps being late.
+ *
+ * A zero frame interval has no deadline: every step is shown as soon as it is decoded and nothing is dropped.
+ * When nothing could be shown for a while (e.g. the first frame, or decoding failed), the due step is shown anyway,
+ * loaded by the caller without decoding in the tick.
+ * The scheduler does not touch Qt, time is given by the caller. */
+class PlaybackScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief What to show on the tick
+    struct Frame
+    {
+        std::optional<StepIndex> step; ///< Step to show, empty when the shown one stays
+        bool decoded = false;          ///< The step is decoded already (otherwise it has to be read)
+    };
+
+    /// How long the display waits at least for a decoded step, before the due step is shown anyway
+    static constexpr Clock::duration MIN_WAITING_FOR_DECODING = std::chrono::milliseconds(500);
+
+    /// At most this many due steps (from the newest) are checked on one tick
+    static constexpr long long MAX_CHECKED_FRAMES = 64;
+
+    /** @brief Starts the playback from the shown step.
+     *  @param stride Steps between frames, negative for backward playback
+     *  @param endStep The last step of the playback (the first step of the data when going backward) */
+    void start(StepIndex shownStep, int stride, StepIndex endStep, Clock::duration frameInterval, Clock::time_point now);
+
+    /// @brief Changes the pace, the timeline continues from the shown step (nothing happens when the pace is the same)
+    void setPace(int stride, Clock::duration frameInterval, Clock::time_point now);
+
+    /** @brief Chooses the step shown on this tick.
+     *  @param decodeTime Time of decoding one step (zero when not known yet)
+     *  @param isDecoded Whether the step is decoded, so showing it does not read files */
+    Frame nextFrame(Clock::time_point now, Clock::duration decodeTime, const std::function<bool(StepIndex)>& isDecoded) const;
+
+    /// @brief Records the shown step: the playback continues from it
+    void frameShown(StepIndex step, Clock::time_point now);
+
+    /// @brief Steps which should be decoded in background, in the order in which they will be shown (at most count)
+    std::vector<StepIndex> stepsToDecode(Clock::time_point now, Clock::duration decodeTime, std::size_t count) const;
+
+    /// @brief Whether the last step of the playback was shown
+    bool finished() const
+    {
+        return shownStep == endStep;
+    }
+
+    PlaybackStatistics statistics(Clock::time_point now) const;
+
+private:
+    /// @brief Frame of the timeline showing the step (rounded up, towards the end)
+    long long frameOfStep(StepIndex step) const;
+
+    /// @brief Step of the frame of the timeline, the end step for frames after it
+    StepIndex stepOfFrame(long long frame) const;
+
+    /// @brief Newest frame of the timeline which is due at the time
+    long long frameDueAt(Clock::time_point time) const;
+
+    StepIndex timelineStep{};                ///< Step shown when the timeline started
+    Clock::time_point timelineStart{};
+    int stride = 1;
+    StepIndex endStep{};
+    Clock::duration frameInterval{};
+
+    StepIndex shownStep{};
+    Clock::time_point shownTime{};
+    std::size_t shownFrames = 0;
+    std::size_t droppedSteps = 0;
+    std::deque<Clock::time_point> recentFrames; ///< times of frames shown during the last second
+};
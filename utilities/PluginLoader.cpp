@@ -2,14 +2,125 @@
  * @brief Implementation of the plugin loading system. */
 
 #include "PluginLoader.h"
+#include "CellRowDecoding.h"
+#include "visualiserProxy/SceneWidgetVisualizerFactory.h"
 
+#include <algorithm> // std::ranges::find
+#include <charconv>  // std::from_chars
+#include <cstdlib>   // std::getenv
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string_view>
 
 #include <dlfcn.h>
 
 namespace fs = std::filesystem;
 
+namespace
+{
+constexpr char MANIFEST_HEADER[] = "OOpenCal-Viewer plugin manifest 1";
+
+/// @brief Default location of the manifest: the user's cache directory (empty if unknown)
+std::string defaultManifestPath()
+{
+    fs::path cacheDirectory;
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache)
+        cacheDirectory = xdgCache;
+    else if (const char* home = std::getenv("HOME"); home && *home)
+        cacheDirectory = fs::path(home) / ".cache";
+    else
+        return {};
+    return (cacheDirectory / "OOpenCal-Viewer" / "plugins.manifest").string();
+}
+
+/// @brief Key of the plugin in the manifest (the same file found through different relative paths has one entry)
+std::string manifestKey(const std::string& pluginPath)
+{
+    std::error_code error;
+    const auto canonicalPath = fs::weakly_canonical(pluginPath, error);
+    return error ? pluginPath : canonicalPath.string();
+}
+
+/// @brief Modification time and size of the file, false if it cannot be read
+bool fileStamp(const std::string& path, std::int64_t& modificationTime, std::uintmax_t& size)
+{
+    std::error_code error;
+    const auto time = fs::last_write_time(path, error);
+    if (error)
+        return false;
+    size = fs::file_size(path, error);
+    if (error)
+        return false;
+    modificationTime = static_cast<std::int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+/// @brief Fields of the manifest are separated by tabs, so tabs, new lines and backslashes are escaped
+std::string escapeField(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '\\': escaped += "\\\\"; break;
+        case '\t': escaped += "\\t"; break;
+        case '\n': escaped += "\\n"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string unescapeField(std::string_view text)
+{
+    std::string unescaped;
+    unescaped.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        if ('\\' == text[i] && i + 1 < text.size())
+        {
+            const char next = text[++i];
+            unescaped += ('t' == next) ? '\t' : ('n' == next) ? '\n' : next;
+        }
+        else
+        {
+            unescaped += text[i];
+        }
+    }
+    return unescaped;
+}
+
+std::vector<std::string_view> splitFields(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    std::size_t start = 0;
+    while (true)
+    {
+        const auto tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string_view::npos ? std::string_view::npos : tab - start));
+        if (tab == std::string_view::npos)
+            return fields;
+        start = tab + 1;
+    }
+}
+
+template<class Number>
+bool parseNumber(std::string_view text, Number& number)
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    return error == std::errc{} && end == text.data() + text.size();
+}
+} // namespace
+
+
+PluginLoader::PluginLoader()
+    : manifestPath{ defaultManifestPath() }
+{
+}
+
 PluginLoader& PluginLoader::instance()
 {
     static PluginLoader loader;
@@ -19,8 +130,11 @@ PluginLoader& PluginLoader::instance()
 bool PluginLoader::loadPlugin(const std::string& pluginPath)
 {
     // Check if already loaded
-    if (isPluginLoaded(pluginPath))
+    if (auto plugin = std::ranges::find(loadedPlugins, pluginPath, &PluginInfo::path); plugin != loadedPlugins.end())
     {
+        if (plugin->isDeferred) // known from the manifest: load it now
+            return loadDeferredPlugin(pluginPath);
+
         lastError = "Plugin already loaded: " + pluginPath;
         std::cerr << "Warning: " << lastError << std::endl;
         return false;
@@ -34,9 +148,25 @@ bool PluginLoader::loadPlugin(const std::string& pluginPath)
         return false;
     }
 
+    PluginInfo info;
+    info.path = pluginPath;
+    if (! openPlugin(info))
+        return false;
+
+    rememberInManifest(info);
+
+    // Store plugin info
+    loadedPlugins.push_back(info);
+
+    clearError();
+    return true;
+}
+
+bool PluginLoader::openPlugin(PluginInfo& info)
+{
     // Load the shared library
     // RTLD_GLOBAL allows plugin to use symbols from main app
-    void* handle = dlopen(pluginPath.c_str(), RTLD_LAZY | RTLD_GLOBAL);
+    void* handle = dlopen(info.path.c_str(), RTLD_LAZY | RTLD_GLOBAL);
     if (! handle)
     {
         lastError = std::string("Failed to load plugin: ") + dlerror();
@@ -62,9 +192,6 @@ bool PluginLoader::loadPlugin(const std::string& pluginPath)
         return false;
     }
 
-    // Create plugin info
-    PluginInfo info;
-    info.path = pluginPath;
     info.handle = handle;
     info.isLoaded = false;
 
@@ -73,26 +200,177 @@ bool PluginLoader::loadPlugin(const std::string& pluginPath)
     {
         registerPlugin();
         info.isLoaded = true;
-        std::cout << "✓ Loaded plugin: " << pluginPath << std::endl;
+        info.isDeferred = false;
+        std::cout << "✓ Loaded plugin: " << info.path << std::endl;
     }
     catch (const std::exception& e)
     {
         lastError = std::string("Exception while registering plugin: ") + e.what();
         std::cerr << "Error: " << lastError << std::endl;
         dlclose(handle);
+        info.handle = nullptr;
         return false;
     }
 
     // Extract metadata (optional functions)
     extractPluginMetadata(info);
+    return true;
+}
 
-    // Store plugin info
-    loadedPlugins.push_back(info);
+bool PluginLoader::loadDeferredPlugin(const std::string& pluginPath)
+{
+    auto plugin = std::ranges::find(loadedPlugins, pluginPath, &PluginInfo::path);
+    if (plugin == loadedPlugins.end() || ! plugin->isDeferred)
+        return plugin != loadedPlugins.end() && plugin->isLoaded;
 
+    const auto expectedModel = plugin->name;
+    if (! openPlugin(*plugin))
+    {
+        plugin->isDeferred = false; // not tried again, the model stays unavailable
+        return false;
+    }
+    if (plugin->name != expectedModel)
+    {
+        std::cerr << "Warning: plugin " << pluginPath << " provides model '" << plugin->name << "' instead of '" << expectedModel
+                  << "' remembered in the plugin manifest" << std::endl;
+    }
+
+    rememberInManifest(*plugin);
+    writeManifest();
     clearError();
     return true;
 }
 
+bool PluginLoader::deferPluginFromManifest(const PluginFile& plugin)
+{
+    const auto entry = manifest.find(plugin.manifestKey);
+    if (entry == manifest.end() || entry->second.name.empty())
+        return false;
+
+    if (! plugin.hasStamp || plugin.modificationTime != entry->second.modificationTime || plugin.size != entry->second.size)
+        return false; // the plugin was rebuilt: its metadata is read again
+
+    const auto& pluginPath = plugin.path;
+
+    const bool registered = SceneWidgetVisualizerFactory::registerDeferredModel(entry->second.name,
+                                                                                 [pluginPath]
+                                                                                 {
+                                                                                     PluginLoader::instance().loadDeferredPlugin(pluginPath);
+                                                                                 });
+    if (! registered)
+    {
+        std::cerr << "Warning: model '" << entry->second.name << "' of plugin " << pluginPath << " is already registered" << std::endl;
+        return false;
+    }
+
+    PluginInfo info;
+    info.path = pluginPath;
+    info.name = entry->second.name;
+    info.info = entry->second.info;
+    info.version = entry->second.version;
+    info.rowDecodingVersion = entry->second.rowDecodingVersion;
+    info.isDeferred = true;
+    loadedPlugins.push_back(info);
+
+    std::cout << "✓ Found plugin: " << pluginPath << " (model '" << info.name << "', loaded when used)" << std::endl;
+    return true;
+}
+
+void PluginLoader::rememberInManifest(const PluginInfo& info)
+{
+    ManifestEntry entry;
+    if (manifestPath.empty() || ! fileStamp(info.path, entry.modificationTime, entry.size))
+        return;
+
+    entry.name = info.name;
+    entry.info = info.info;
+    entry.version = info.version;
+    entry.rowDecodingVersion = info.rowDecodingVersion;
+    manifest[manifestKey(info.path)] = std::move(entry);
+    manifestChanged = true;
+}
+
+void PluginLoader::setManifestPath(const std::string& path)
+{
+    manifestPath = path;
+    manifest.clear();
+    manifestRead = false;
+    manifestChanged = false;
+}
+
+std::map<std::string, PluginLoader::ManifestEntry> PluginLoader::readManifestFile(const std::string& path)
+{
+    std::map<std::string, ManifestEntry> entries;
+    std::ifstream file(path);
+    std::string line;
+    if (path.empty() || ! file || ! std::getline(file, line) || line != MANIFEST_HEADER)
+        return entries; // missing or of another version: it is written again
+
+    while (std::getline(file, line))
+    {
+        const auto fields = splitFields(line);
+        ManifestEntry entry;
+        if (fields.size() != 7 || ! parseNumber(fields[1], entry.modificationTime) || ! parseNumber(fields[2], entry.size)
+            || ! parseNumber(fields[3], entry.version) || ! parseNumber(fields[4], entry.rowDecodingVersion))
+        {
+            std::cerr << "Warning: skipping invalid line of the plugin manifest " << path << std::endl;
+            continue;
+        }
+        entry.name = unescapeField(fields[5]);
+        entry.info = unescapeField(fields[6]);
+        entries[unescapeField(fields[0])] = std::move(entry);
+    }
+    return entries;
+}
+
+void PluginLoader::readManifest()
+{
+    if (manifestRead)
+        return;
+    manifestRead = true;
+
+    auto entries = readManifestFile(manifestPath);
+    manifest.merge(entries); // entries of plugins loaded before are newer than the file
+}
+
+void PluginLoader::writeManifest()
+{
+    if (manifestPath.empty() || ! manifestChanged)
+        return;
+
+    std::error_code error;
+    fs::create_directories(fs::path(manifestPath).parent_path(), error);
+
+    // written under a temporary name, so other running viewers never read a partial manifest
+    const auto temporaryPath = manifestPath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        file << MANIFEST_HEADER << '\n';
+        for (const auto& [path, entry] : manifest)
+        {
+            if (! fs::exists(path, error))
+                continue; // removed plugins are forgotten
+
+            file << escapeField(path) << '\t' << entry.modificationTime << '\t' << entry.size << '\t' << entry.version << '\t'
+                 << entry.rowDecodingVersion << '\t' << escapeField(entry.name) << '\t' << escapeField(entry.info) << '\n';
+        }
+        if (! file.flush())
+        {
+            std::cerr << "Warning: can't write the plugin manifest " << temporaryPath << std::endl;
+            fs::remove(temporaryPath, error);
+            return;
+        }
+    }
+    fs::rename(temporaryPath, manifestPath, error);
+    if (error)
+    {
+        std::cerr << "Warning: can't write the plugin manifest " << manifestPath << ": " << error.message() << std::endl;
+        fs::remove(temporaryPath, error);
+        return;
+    }
+    manifestChanged = false;
+}
+
 void PluginLoader::extractPluginMetadata(PluginInfo& info)
 {
     // Get plugin info string
@@ -118,18 +396,33 @@ void PluginLoader::extractPluginMetadata(PluginInfo& info)
     {
         info.name = getModelName();
     }
+
+    // Get version of the row decoding hook (plugins without this function decode cell by cell)
+    VersionFunc getRowDecodingVersion = (VersionFunc) dlsym(info.handle, "getRowDecodingVersion");
+    if (getRowDecodingVersion)
+    {
+        info.rowDecodingVersion = getRowDecodingVersion();
+        if (info.rowDecodingVersion == CELL_ROW_DECODING_VERSION)
+        {
+            std::cout << "  Row decoding: version " << info.rowDecodingVersion << std::endl;
+        }
+        else if (info.rowDecodingVersion != 0)
+        {
+            std::cerr << "Warning: plugin " << info.path << " was built for row decoding version " << info.rowDecodingVersion
+                      << ", this viewer supports version " << CELL_ROW_DECODING_VERSION << " (rebuild the plugin with the current headers)" << std::endl;
+        }
+    }
 }
 
-int PluginLoader::loadPluginsFromDirectory(const std::string& directory)
+std::vector<PluginLoader::PluginFile> PluginLoader::findPluginFiles(const std::string& directory)
 {
-    if (! fs::exists(directory) || ! fs::is_directory(directory))
+    std::vector<PluginFile> pluginFiles;
+    std::error_code error;
+    if (! fs::is_directory(directory, error))
     {
-        return 0;
+        return pluginFiles;
     }
 
-    int loadedCount = 0;
-    std::cout << "Scanning for plugins in: " << directory << std::endl;
-
     try
     {
         for (const auto& entry : fs::directory_iterator(directory))
@@ -143,34 +436,94 @@ int PluginLoader::loadPluginsFromDirectory(const std::string& directory)
             if (path.extension() != ".so")
                 continue;
 
-            if (loadPlugin(path.string()))
-            {
-                loadedCount++;
-            }
-        }
-
-        if (loadedCount > 0)
-        {
-            std::cout << "Loaded " << loadedCount << " plugin(s) from " << directory << std::endl;
+            PluginFile pluginFile;
+            pluginFile.path = path.string();
+            pluginFile.manifestKey = manifestKey(pluginFile.path);
+            pluginFile.hasStamp = fileStamp(pluginFile.path, pluginFile.modificationTime, pluginFile.size);
+            pluginFiles.push_back(std::move(pluginFile));
         }
     }
     catch (const std::exception& e)
     {
         std::cerr << "Error scanning directory " << directory << ": " << e.what() << std::endl;
     }
+    return pluginFiles;
+}
+
+int PluginLoader::loadPluginFiles(const std::string& directory, const std::vector<PluginFile>& pluginFiles)
+{
+    int loadedCount = 0;
+    std::cout << "Scanning for plugins in: " << directory << std::endl;
 
+    for (const auto& pluginFile : pluginFiles)
+    {
+        if (isPluginLoaded(pluginFile.path))
+            continue; // e.g. the same directory given twice
+
+        if (deferPluginFromManifest(pluginFile) || loadPlugin(pluginFile.path))
+        {
+            loadedCount++;
+        }
+    }
+
+    if (loadedCount > 0)
+    {
+        std::cout << "Loaded " << loadedCount << " plugin(s) from " << directory << std::endl;
+    }
     return loadedCount;
 }
 
+int PluginLoader::loadPluginsFromDirectory(const std::string& directory)
+{
+    std::error_code error;
+    if (! fs::is_directory(directory, error))
+    {
+        return 0;
+    }
+
+    readManifest();
+    return loadPluginFiles(directory, findPluginFiles(directory));
+}
+
 int PluginLoader::loadFromStandardDirectories(const std::vector<std::string>& directories)
 {
-    int totalLoaded = 0;
+    return loadDiscoveredPlugins(discoverPlugins(directories, manifestPath));
+}
 
+PluginLoader::PluginDiscovery PluginLoader::discoverPlugins(const std::vector<std::string>& directories, const std::string& manifestPath)
+{
+    PluginDiscovery discovery;
+    discovery.manifestPath = manifestPath;
     for (const auto& dir : directories)
     {
-        totalLoaded += loadPluginsFromDirectory(dir);
+        std::error_code error;
+        if (fs::is_directory(dir, error))
+            discovery.directories.emplace_back(dir, findPluginFiles(dir));
+    }
+    if (! discovery.directories.empty())
+        discovery.manifest = readManifestFile(manifestPath);
+    return discovery;
+}
+
+int PluginLoader::loadDiscoveredPlugins(PluginDiscovery discovery)
+{
+    if (! discovery.directories.empty())
+    {
+        if (! manifestRead && discovery.manifestPath == manifestPath) // otherwise the manifest path was changed meanwhile
+        {
+            manifestRead = true;
+            manifest.merge(discovery.manifest); // entries of plugins loaded before are newer than the file
+        }
+        readManifest();
+    }
+
+    int totalLoaded = 0;
+    for (const auto& [dir, pluginFiles] : discovery.directories)
+    {
+        totalLoaded += loadPluginFiles(dir, pluginFiles);
     }
 
+    writeManifest(); // metadata of plugins loaded now, so they are deferred the next time
     return totalLoaded;
 }
 
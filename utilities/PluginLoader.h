@@ -6,7 +6,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <map>
 #include <string>
+#include <utility> // std::pair
 #include <vector>
 
 /** @brief Information about a loaded plugin */
@@ -16,8 +19,10 @@ struct PluginInfo
     std::string name; ///< Plugin name (from getModelName)
     std::string info; ///< Plugin description (from getPluginInfo)
     int version{};    ///< Plugin version (from getPluginVersion)
+    int rowDecodingVersion{}; ///< Version of the row decoding hook of the model (from getRowDecodingVersion, see CellRowDecoding.h), 0 if none
     void* handle{};   ///< dlopen handle
     bool isLoaded{};  ///< Load status
+    bool isDeferred{}; ///< Known from the plugin manifest, loaded when its model is used for the first time
 };
 
 /** @brief Manages plugin loading and lifecycle
@@ -28,6 +33,12 @@ struct PluginInfo
  * - Query plugin information
  * - Handle errors gracefully
  * 
+ * Plugins found in directories are not loaded when their metadata is in the plugin manifest
+ * (a cache keyed by path, modification time and size of the file): their models are only registered
+ * as deferred in SceneWidgetVisualizerFactory, so the plugin and its dependencies are loaded
+ * when the model is chosen (model menu, `--startingModel`). Plugins not in the manifest yet are loaded
+ * immediately and added to it, as are plugins loaded explicitly by loadPlugin().
+ *
  * Example usage:
  * @code
  * PluginLoader& loader = PluginLoader::instance();
@@ -46,9 +57,9 @@ public:
      * @return true if loaded successfully, false otherwise */
     bool loadPlugin(const std::string& pluginPath);
 
-    /** @brief Load all plugins from a directory
+    /** @brief Load all plugins from a directory (plugins in the manifest are registered as deferred)
      * @param directory Path to directory containing .so files
-     * @return Number of successfully loaded plugins */
+     * @return Number of successfully loaded or deferred plugins */
     int loadPluginsFromDirectory(const std::string& directory);
 
     /** @brief Load plugins from multiple standard directories
@@ -56,6 +67,55 @@ public:
      * @return Total number of loaded plugins */
     int loadFromStandardDirectories(const std::vector<std::string>& directories);
 
+    /// Plugin metadata cached in the manifest, valid while the file has the same modification time and size
+    struct ManifestEntry
+    {
+        std::int64_t modificationTime{};
+        std::uintmax_t size{};
+        std::string name;
+        std::string info;
+        int version{};
+        int rowDecodingVersion{};
+    };
+
+    /// Plugin file found in a directory, with the data used to look it up in the manifest
+    struct PluginFile
+    {
+        std::string path;
+        std::string manifestKey; ///< canonical path of the file
+        std::int64_t modificationTime{};
+        std::uintmax_t size{};
+        bool hasStamp{}; ///< false if the modification time or size cannot be read
+    };
+
+    /// Result of discoverPlugins(): everything read from the file system before the plugins are registered
+    struct PluginDiscovery
+    {
+        std::vector<std::pair<std::string, std::vector<PluginFile>>> directories; ///< scanned directories with their .so files
+        std::string manifestPath;                                                 ///< the manifest read into `manifest`
+        std::map<std::string, ManifestEntry> manifest;
+    };
+
+    /** @brief Scans the directories for plugin files and reads the manifest at manifestPath, without loading or registering anything.
+     *
+     * The slow part of loadFromStandardDirectories() (directory listing, file stamps, canonical paths, the manifest file)
+     * touches no state of the loader, so it can run in a background thread while the window is created.
+     * The result is passed to loadDiscoveredPlugins() in the GUI thread. */
+    static PluginDiscovery discoverPlugins(const std::vector<std::string>& directories, const std::string& manifestPath);
+
+    /** @brief Registers the plugins found by discoverPlugins() like loadFromStandardDirectories() does
+     * @return Total number of loaded or deferred plugins */
+    int loadDiscoveredPlugins(PluginDiscovery discovery);
+
+    /** @brief Sets the file of the plugin manifest (empty disables it), it is read on the next scan of a directory.
+     *  By default `$XDG_CACHE_HOME/OOpenCal-Viewer/plugins.manifest` (or in `~/.cache`). */
+    void setManifestPath(const std::string& path);
+
+    const std::string& getManifestPath() const
+    {
+        return manifestPath;
+    }
+
     /** @brief Get list of all loaded plugins */
     const std::vector<PluginInfo>& getLoadedPlugins() const;
 
@@ -73,7 +133,7 @@ public:
     ~PluginLoader();
 
 private:
-    PluginLoader() = default;
+    PluginLoader();
 
     // Prevent copying
     PluginLoader(const PluginLoader&) = delete;
@@ -82,6 +142,36 @@ private:
     std::vector<PluginInfo> loadedPlugins;
     std::string lastError;
 
+    std::string manifestPath;
+    std::map<std::string, ManifestEntry> manifest; ///< by canonical path of the plugin
+    bool manifestRead = false;
+    bool manifestChanged = false;
+
     /** @brief Extract plugin metadata after loading */
     void extractPluginMetadata(PluginInfo& info);
+
+    /** @brief Opens the plugin, registers its models and reads its metadata (the common part of loading)
+     * @return true if loaded successfully, false otherwise (lastError is set) */
+    bool openPlugin(PluginInfo& info);
+
+    /// @brief Loads the plugin known from the manifest, called by the factory when its model is used
+    bool loadDeferredPlugin(const std::string& pluginPath);
+
+    /// @brief Registers the plugin's model as deferred if the manifest has up-to-date metadata of the file
+    bool deferPluginFromManifest(const PluginFile& plugin);
+
+    /// @brief .so files in the directory (empty if it does not exist or cannot be read)
+    static std::vector<PluginFile> findPluginFiles(const std::string& directory);
+
+    /// @brief Defers or loads the plugin files found in the directory, returns how many of them succeeded
+    int loadPluginFiles(const std::string& directory, const std::vector<PluginFile>& pluginFiles);
+
+    /// @brief Stores metadata of the loaded plugin in the manifest
+    void rememberInManifest(const PluginInfo& info);
+
+    /// @brief Entries of the manifest file (empty if it is missing or of another version)
+    static std::map<std::string, ManifestEntry> readManifestFile(const std::string& path);
+
+    void readManifest();
+    void writeManifest();
 };
@@ -0,0 +1,754 @@
+/** @file RemoteOutput.cpp
+ * @brief Implementation of the RemoteOutputClient and RemoteOutputAgent classes. */
+
+#include "RemoteOutput.h"
+
+#include <algorithm> // std::ranges::sort, std::ranges::lower_bound, std::ranges::upper_bound, std::ranges::includes
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring> // std::memcpy, std::memcmp, std::strerror
+#include <format>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ModelReader.hpp" // ReaderHelpers
+
+
+namespace
+{
+/** Layout of the messages (native byte order):
+ *  request: RequestHeader, for RequestType::Step followed by RequestHeader::nodesCount node numbers (std::uint32_t)
+ *  reply:   ReplyHeader, then
+ *           - error: ReplyHeader::count bytes of the message,
+ *           - index: ReplyHeader::count IndexEntry records,
+ *           - step:  ReplyHeader::count times NodeTextHeader followed by NodeTextHeader::storedSize bytes */
+struct RequestHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t type;
+    std::uint32_t step;
+    std::uint32_t nodesCount;
+};
+
+struct ReplyHeader
+{
+    std::uint32_t status;
+    std::uint32_t compression;
+    std::uint32_t nodesCount;
+    std::uint32_t reserved;
+    std::uint64_t count;
+};
+
+struct IndexEntry
+{
+    std::uint32_t node;
+    std::uint32_t step;
+    std::int32_t columns;
+    std::int32_t rows;
+};
+
+struct NodeTextHeader
+{
+    std::uint32_t node;
+    std::uint32_t reserved;
+    std::uint64_t storedSize;
+    std::uint64_t rawSize;
+};
+
+enum class RequestType : std::uint32_t
+{
+    Index = 1,
+    Step = 2
+};
+
+enum class ReplyStatus : std::uint32_t
+{
+    Ok = 0,
+    Error = 1
+};
+
+constexpr char PROTOCOL_MAGIC[4] = { 'O', 'O', 'C', 'R' };
+constexpr std::uint32_t PROTOCOL_VERSION = 1;
+
+/// Limits protecting against damaged messages (a node's step above 4 GiB is not expected)
+constexpr std::uint64_t MAX_TEXT_SIZE = std::uint64_t{ 1 } << 32;
+constexpr std::uint64_t MAX_MESSAGE_SIZE = 64 * 1024;
+
+/// Reply of the agent taking longer is treated as a lost connection
+constexpr int RECEIVE_TIMEOUT_SECONDS = 120;
+
+/// How often waiting agent threads check whether stop was requested
+constexpr int STOP_POLL_MILLISECONDS = 200;
+constexpr auto STOP_POLL_INTERVAL = std::chrono::milliseconds(20);
+
+[[noreturn]] void throwSocketError(std::string_view operation, const std::string& address)
+{
+    throw std::runtime_error(std::format("{} '{}' failed: {}", operation, address, std::strerror(errno)));
+}
+
+void sendAll(int socket, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const auto sent = ::send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (EINTR == errno)
+                continue;
+            throw std::runtime_error(std::format("Sending to remote output failed: {}", std::strerror(errno)));
+        }
+        bytes += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+}
+
+/// @brief Receives exactly size bytes, returns false when the peer closed the connection before the first byte
+bool receiveAll(int socket, void* data, std::size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    std::size_t received = 0;
+    while (received < size)
+    {
+        const auto result = ::recv(socket, bytes + received, size - received, 0);
+        if (result < 0)
+        {
+            if (EINTR == errno)
+                continue;
+            if (EAGAIN == errno || EWOULDBLOCK == errno)
+                throw std::runtime_error("Remote output did not answer in time");
+            throw std::runtime_error(std::format("Receiving from remote output failed: {}", std::strerror(errno)));
+        }
+        if (0 == result)
+        {
+            if (0 == received)
+                return false;
+            throw std::runtime_error("Remote output closed the connection in the middle of a message");
+        }
+        received += static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+void receiveExactly(int socket, void* data, std::size_t size)
+{
+    if (! receiveAll(socket, data, size))
+        throw std::runtime_error("Remote output closed the connection");
+}
+
+/// @brief Reads the rest of an error reply and throws it
+[[noreturn]] void throwErrorReply(int socket, const ReplyHeader& reply, const std::string& address)
+{
+    std::string message(std::min(reply.count, MAX_MESSAGE_SIZE), '\0');
+    receiveExactly(socket, message.data(), message.size());
+    throw std::runtime_error(std::format("Remote output '{}': {}", address, message));
+}
+
+RequestHeader makeRequest(RequestType type, StepIndex step = 0, std::size_t nodesCount = 0)
+{
+    RequestHeader request{};
+    std::memcpy(request.magic, PROTOCOL_MAGIC, sizeof(request.magic));
+    request.version = PROTOCOL_VERSION;
+    request.type = static_cast<std::uint32_t>(type);
+    request.step = step;
+    request.nodesCount = static_cast<std::uint32_t>(nodesCount);
+    return request;
+}
+
+void sendErrorReply(int socket, std::string_view message)
+{
+    ReplyHeader reply{};
+    reply.status = static_cast<std::uint32_t>(ReplyStatus::Error);
+    reply.count = std::min<std::uint64_t>(message.size(), MAX_MESSAGE_SIZE);
+    sendAll(socket, &reply, sizeof(reply));
+    sendAll(socket, message.data(), reply.count);
+}
+
+/// @brief Waits until the socket is readable, returns false when stop was requested first
+bool waitReadable(int socket, const std::stop_token& stopToken)
+{
+    while (! stopToken.stop_requested())
+    {
+        pollfd descriptor{ .fd = socket, .events = POLLIN, .revents = 0 };
+        const auto result = ::poll(&descriptor, 1, STOP_POLL_MILLISECONDS);
+        if (result > 0)
+            return true;
+        if (result < 0 && EINTR != errno)
+            throw std::runtime_error(std::format("Waiting for remote output request failed: {}", std::strerror(errno)));
+    }
+    return false;
+}
+} // namespace
+
+
+/** @class RemoteOutputClient::Connection
+ * @brief Connected TCP socket to the agent. */
+class RemoteOutputClient::Connection
+{
+public:
+    Connection(const std::string& host, const std::string& port, const std::string& address)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (const auto error = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses); error != 0)
+            throw std::runtime_error(std::format("Can't resolve remote output '{}': {}", address, ::gai_strerror(error)));
+
+        int lastError = 0;
+        for (const addrinfo* candidate = addresses; candidate && socket < 0; candidate = candidate->ai_next)
+        {
+            socket = ::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+            if (socket < 0)
+            {
+                lastError = errno;
+                continue;
+            }
+            if (::connect(socket, candidate->ai_addr, candidate->ai_addrlen) != 0)
+            {
+                lastError = errno;
+                ::close(socket);
+                socket = -1;
+            }
+        }
+        ::freeaddrinfo(addresses);
+        if (socket < 0)
+        {
+            errno = lastError;
+            throwSocketError("Connecting to remote output", address);
+        }
+
+        const int noDelay = 1; // requests are small, they should not wait for more data
+        ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        const timeval timeout{ .tv_sec = RECEIVE_TIMEOUT_SECONDS, .tv_usec = 0 };
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    ~Connection()
+    {
+        if (socket >= 0)
+            ::close(socket);
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    int descriptor() const
+    {
+        return socket;
+    }
+
+private:
+    int socket = -1;
+};
+
+
+RemoteStepData::RemoteStepData(StepIndex step, ContainerCompression compression, std::vector<NodeText> nodeTexts)
+    : stepNumber{ step }
+    , compression{ compression }
+    , nodeTexts{ std::move(nodeTexts) }
+{
+    std::ranges::sort(this->nodeTexts, {}, &NodeText::node);
+}
+
+bool RemoteStepData::hasNodes(std::span<const NodeIndex> nodes) const
+{
+    for (const auto node : nodes)
+    {
+        const auto found = std::ranges::lower_bound(nodeTexts, node, {}, &NodeText::node);
+        if (found == nodeTexts.end() || found->node != node)
+            return false;
+    }
+    return true;
+}
+
+std::string_view RemoteStepData::nodeText(NodeIndex node, std::vector<char>& buffer) const
+{
+    const auto found = std::ranges::lower_bound(nodeTexts, node, {}, &NodeText::node);
+    if (found == nodeTexts.end() || found->node != node)
+        throw std::out_of_range(std::format("Node {} of step {} was not received from remote output", node, stepNumber));
+
+    const std::string_view stored(found->stored.data(), found->stored.size());
+    const auto text = decompressChunkText(stored, found->rawSize, compression, buffer);
+    if (! text)
+        throw std::runtime_error(std::format("Damaged text of node {} in step {} received from remote output", node, stepNumber));
+    return *text;
+}
+
+std::size_t RemoteStepData::receivedBytes() const
+{
+    std::size_t bytes = 0;
+    for (const auto& nodeText : nodeTexts)
+        bytes += nodeText.stored.size();
+    return bytes;
+}
+
+
+RemoteOutputClient::RemoteOutputClient(const std::string& address)
+    : agentAddress{ address }
+{
+    // "host:port", the host may be an IPv6 address in brackets: "[::1]:port"
+    const auto separator = address.rfind(':');
+    if (separator == std::string::npos || separator == 0 || separator + 1 == address.size())
+        throw std::invalid_argument(std::format("Invalid remote output address '{}' (expected host:port)", address));
+
+    host = address.substr(0, separator);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+    port = address.substr(separator + 1);
+}
+
+RemoteOutputClient::~RemoteOutputClient() = default;
+
+std::vector<NodeStepOffsets> RemoteOutputClient::readIndex(NodeIndex nodesCount)
+{
+    auto connection = takeConnection();
+    const int socket = connection->descriptor();
+
+    const auto request = makeRequest(RequestType::Index);
+    sendAll(socket, &request, sizeof(request));
+
+    ReplyHeader reply{};
+    receiveExactly(socket, &reply, sizeof(reply));
+    if (static_cast<std::uint32_t>(ReplyStatus::Ok) != reply.status)
+        throwErrorReply(socket, reply, agentAddress);
+
+    if (reply.count > MAX_TEXT_SIZE / sizeof(IndexEntry))
+        throw std::runtime_error(std::format("Remote output '{}' sent an index of {} steps, the message is damaged", agentAddress, reply.count));
+    std::vector<IndexEntry> received(reply.count);
+    receiveExactly(socket, received.data(), received.size() * sizeof(IndexEntry));
+    returnConnection(std::move(connection));
+
+    if (reply.nodesCount != nodesCount)
+        throw std::runtime_error(std::format("Remote output '{}' has {} nodes, the configuration expects {}", agentAddress, reply.nodesCount, nodesCount));
+    const auto agentCompression = static_cast<ContainerCompression>(reply.compression);
+    if (! isContainerCompressionAvailable(agentCompression))
+        throw std::runtime_error(std::format("Remote output '{}' sends LZ4-compressed data, which is not available in this build", agentAddress));
+
+    std::vector<std::vector<NodeStepOffsets::Entry>> nodeEntries(nodesCount);
+    for (const auto& entry : received)
+    {
+        if (entry.node >= nodesCount)
+            throw std::runtime_error(std::format("Remote output '{}' sent index of unknown node {}", agentAddress, entry.node));
+        nodeEntries[entry.node].push_back(NodeStepOffsets::Entry{
+            .step = entry.step,
+            .info = StepOffsetInfo{ .position = 0, .sceneSize = ColumnAndRow::xy(entry.columns, entry.rows) } });
+    }
+
+    std::vector<NodeStepOffsets> indices(nodesCount);
+    for (NodeIndex node = 0; node < nodesCount; ++node)
+        indices[node].assign(std::move(nodeEntries[node]), std::format("{} node {}", agentAddress, node));
+
+    {
+        std::lock_guard lock(mutex);
+        compression = agentCompression;
+        pendingSteps.clear(); // steps requested before may have changed
+    }
+    return indices;
+}
+
+void RemoteOutputClient::fetchAhead(StepIndex step, std::vector<NodeIndex> nodes)
+{
+    std::ranges::sort(nodes);
+
+    std::lock_guard lock(mutex);
+    for (const auto& pending : pendingSteps)
+    {
+        if (pending.step == step && std::ranges::includes(pending.nodes, nodes))
+            return;
+    }
+    if (pendingSteps.size() >= PIPELINED_STEPS)
+        pendingSteps.pop_front(); // its reply is still read, but then thrown away
+
+    auto promise = std::make_shared<std::promise<std::shared_ptr<const RemoteStepData>>>();
+    pendingSteps.push_back(PendingStep{ .step = step, .nodes = nodes, .data = promise->get_future().share() });
+    fetchers.submit(
+        [this, promise, step, nodes = std::move(nodes)]
+        {
+            try
+            {
+                promise->set_value(readStep(step, nodes));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+}
+
+std::shared_ptr<const RemoteStepData> RemoteOutputClient::takeStep(StepIndex step, std::span<const NodeIndex> nodes, std::stop_token stopToken)
+{
+    std::vector<NodeIndex> sortedNodes(nodes.begin(), nodes.end());
+    std::ranges::sort(sortedNodes);
+
+    std::optional<std::shared_future<std::shared_ptr<const RemoteStepData>>> pendingData;
+    {
+        std::lock_guard lock(mutex);
+        const auto pending = std::ranges::find_if(pendingSteps,
+                                                   [&](const PendingStep& pending)
+                                                   {
+                                                       return pending.step == step && std::ranges::includes(pending.nodes, sortedNodes);
+                                                   });
+        if (pending != pendingSteps.end())
+        {
+            pendingData = pending->data;
+            pendingSteps.erase(pending);
+        }
+    }
+
+    if (! pendingData)
+    {
+        if (stopToken.stop_requested())
+            return nullptr;
+        return readStep(step, sortedNodes);
+    }
+
+    while (pendingData->wait_for(STOP_POLL_INTERVAL) != std::future_status::ready)
+    {
+        if (stopToken.stop_requested())
+            return nullptr;
+    }
+    return pendingData->get();
+}
+
+std::shared_ptr<const RemoteStepData> RemoteOutputClient::readStep(StepIndex step, std::span<const NodeIndex> nodes)
+{
+    ContainerCompression stepCompression;
+    {
+        std::lock_guard lock(mutex);
+        stepCompression = compression;
+    }
+
+    auto connection = takeConnection();
+    const int socket = connection->descriptor();
+
+    const auto request = makeRequest(RequestType::Step, step, nodes.size());
+    std::vector<std::uint32_t> requestedNodes(nodes.begin(), nodes.end());
+    sendAll(socket, &request, sizeof(request));
+    sendAll(socket, requestedNodes.data(), requestedNodes.size() * sizeof(std::uint32_t));
+
+    ReplyHeader reply{};
+    receiveExactly(socket, &reply, sizeof(reply));
+    if (static_cast<std::uint32_t>(ReplyStatus::Ok) != reply.status)
+    {
+        try
+        {
+            throwErrorReply(socket, reply, agentAddress);
+        }
+        catch (...)
+        {
+            returnConnection(std::move(connection)); // the whole reply was read, the connection can be used again
+            throw;
+        }
+    }
+    if (reply.count != nodes.size())
+        throw std::runtime_error(std::format("Remote output '{}' sent {} nodes of step {}, {} were requested", agentAddress, reply.count, step, nodes.size()));
+
+    std::vector<RemoteStepData::NodeText> nodeTexts(nodes.size());
+    for (auto& nodeText : nodeTexts)
+    {
+        NodeTextHeader header{};
+        receiveExactly(socket, &header, sizeof(header));
+        if (header.storedSize > MAX_TEXT_SIZE || header.rawSize > MAX_TEXT_SIZE)
+            throw std::runtime_error(std::format("Remote output '{}' sent invalid size of node {} in step {}", agentAddress, header.node, step));
+
+        nodeText.node = header.node;
+        nodeText.rawSize = header.rawSize;
+        nodeText.stored.resize(header.storedSize);
+        receiveExactly(socket, nodeText.stored.data(), nodeText.stored.size());
+    }
+    returnConnection(std::move(connection));
+
+    return std::make_shared<const RemoteStepData>(step, stepCompression, std::move(nodeTexts));
+}
+
+std::unique_ptr<RemoteOutputClient::Connection> RemoteOutputClient::takeConnection()
+{
+    {
+        std::lock_guard lock(mutex);
+        if (! idleConnections.empty())
+        {
+            auto connection = std::move(idleConnections.back());
+            idleConnections.pop_back();
+            return connection;
+        }
+    }
+    return std::make_unique<Connection>(host, port, agentAddress);
+}
+
+void RemoteOutputClient::returnConnection(std::unique_ptr<Connection> connection)
+{
+    std::lock_guard lock(mutex);
+    idleConnections.push_back(std::move(connection));
+}
+
+
+RemoteOutputAgent::RemoteOutputAgent(const std::string& outputFileName, NodeIndex nodesCount, ContainerCompression compression, std::uint16_t port)
+    : outputFileName{ outputFileName }
+    , nodesCount{ nodesCount }
+    , compression{ compression }
+{
+    if (! isContainerCompressionAvailable(compression))
+        throw std::runtime_error("LZ4 compression is not available in this build (liblz4 was not found)");
+
+    outputs = loadOutputs();
+
+    const auto portText = std::to_string(port);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    if (const auto error = ::getaddrinfo(nullptr, portText.c_str(), &hints, &addresses); error != 0)
+        throw std::runtime_error(std::format("Can't resolve listening address of port {}: {}", port, ::gai_strerror(error)));
+
+    int lastError = 0;
+    for (const addrinfo* candidate = addresses; candidate && listeningSocket < 0; candidate = candidate->ai_next)
+    {
+        listeningSocket = ::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+        if (listeningSocket < 0)
+        {
+            lastError = errno;
+            continue;
+        }
+        const int enabled = 1;
+        ::setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+        if (AF_INET6 == candidate->ai_family)
+        {
+            const int dualStack = 0; // accept also IPv4 clients
+            ::setsockopt(listeningSocket, IPPROTO_IPV6, IPV6_V6ONLY, &dualStack, sizeof(dualStack));
+        }
+        if (::bind(listeningSocket, candidate->ai_addr, candidate->ai_addrlen) != 0 || ::listen(listeningSocket, SOMAXCONN) != 0)
+        {
+            lastError = errno;
+            ::close(listeningSocket);
+            listeningSocket = -1;
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (listeningSocket < 0)
+    {
+        errno = lastError;
+        throwSocketError("Listening on port", portText);
+    }
+
+    sockaddr_storage boundAddress{};
+    socklen_t boundAddressSize = sizeof(boundAddress);
+    ::getsockname(listeningSocket, reinterpret_cast<sockaddr*>(&boundAddress), &boundAddressSize);
+    if (AF_INET6 == boundAddress.ss_family)
+        listeningPort = ntohs(reinterpret_cast<const sockaddr_in6*>(&boundAddress)->sin6_port);
+    else
+        listeningPort = ntohs(reinterpret_cast<const sockaddr_in*>(&boundAddress)->sin_port);
+}
+
+RemoteOutputAgent::~RemoteOutputAgent()
+{
+    if (listeningSocket >= 0)
+        ::close(listeningSocket);
+}
+
+void RemoteOutputAgent::serve(std::stop_token stopToken)
+{
+    struct ClientThread
+    {
+        std::unique_ptr<std::atomic<bool>> finished; ///< set by the thread when the client is served (not moved with the thread)
+        std::jthread thread;
+    };
+    std::vector<ClientThread> clients; // joined (after stop is requested) when leaving
+    while (waitReadable(listeningSocket, stopToken))
+    {
+        const int clientSocket = ::accept4(listeningSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientSocket < 0)
+        {
+            if (EINTR != errno && ECONNABORTED != errno)
+                std::cerr << "Warning: Accepting remote output client failed: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        const int noDelay = 1;
+        ::setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        // threads of disconnected clients are joined now, so a long running agent does not keep one per client ever served
+        std::erase_if(clients,
+                      [](const ClientThread& client)
+                      {
+                          return client.finished->load(std::memory_order_acquire);
+                      });
+
+        auto finished = std::make_unique<std::atomic<bool>>(false);
+        auto thread = std::jthread(
+            [this, clientSocket, finished = finished.get()](std::stop_token clientStopToken)
+            {
+                try
+                {
+                    serveClient(clientSocket, clientStopToken);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Warning: Remote output client disconnected: " << e.what() << std::endl;
+                }
+                ::close(clientSocket);
+                finished->store(true, std::memory_order_release);
+            });
+        clients.push_back(ClientThread{ std::move(finished), std::move(thread) });
+    }
+}
+
+std::shared_ptr<const RemoteOutputAgent::Outputs> RemoteOutputAgent::loadOutputs()
+{
+    auto loaded = std::make_shared<Outputs>(nodesCount);
+    threadPool.parallelFor(nodesCount,
+                           [&](std::size_t node)
+                           {
+                               auto& output = (*loaded)[node];
+                               output.index = NodeStepOffsets::loadFromIndexFile(ReaderHelpers::giveMeFileNameIndex(outputFileName, static_cast<NodeIndex>(node)));
+                               output.dataFile = std::make_shared<const MappedFile>(ReaderHelpers::giveMeFileName(outputFileName, static_cast<NodeIndex>(node)));
+
+                               for (const auto& entry : output.index.entries())
+                                   output.positions.push_back(entry.info.position);
+                               std::ranges::sort(output.positions);
+
+                               // clients get the size of every step, so they do not have to ask for header lines
+                               std::vector<NodeStepOffsets::Entry> entries = output.index.entries();
+                               for (auto& entry : entries)
+                               {
+                                   if (entry.info.sceneSize)
+                                       continue;
+                                   const auto begin = static_cast<std::size_t>(entry.info.position);
+                                   if (begin >= output.dataFile->size())
+                                       continue; // not written completely yet, left out below
+                                   const auto header = std::string_view(output.dataFile->data() + begin, output.dataFile->size() - begin);
+                                   entry.info.sceneSize = ReaderHelpers::getColumnAndRowFromLine(std::string(header.substr(0, header.find('\n'))));
+                               }
+                               std::erase_if(entries,
+                                             [](const NodeStepOffsets::Entry& entry)
+                                             {
+                                                 return ! entry.info.sceneSize;
+                                             });
+                               output.index.assign(std::move(entries));
+                           });
+    return loaded;
+}
+
+void RemoteOutputAgent::serveClient(int socket, std::stop_token stopToken)
+{
+    while (waitReadable(socket, stopToken))
+    {
+        RequestHeader request{};
+        if (! receiveAll(socket, &request, sizeof(request)))
+            return; // the client disconnected
+        if (std::memcmp(request.magic, PROTOCOL_MAGIC, sizeof(request.magic)) != 0 || PROTOCOL_VERSION != request.version)
+            throw std::runtime_error("Unknown protocol of the client");
+
+        std::vector<std::uint32_t> nodes;
+        if (static_cast<std::uint32_t>(RequestType::Step) == request.type)
+        {
+            if (request.nodesCount > nodesCount)
+                throw std::runtime_error(std::format("Client requested {} nodes, the output has {}", request.nodesCount, nodesCount));
+            nodes.resize(request.nodesCount);
+            receiveExactly(socket, nodes.data(), nodes.size() * sizeof(std::uint32_t));
+        }
+
+        std::shared_ptr<const Outputs> currentOutputs;
+        try
+        {
+            if (static_cast<std::uint32_t>(RequestType::Index) == request.type)
+            {
+                currentOutputs = loadOutputs();
+                std::lock_guard lock(outputsMutex);
+                outputs = currentOutputs;
+            }
+            else
+            {
+                std::lock_guard lock(outputsMutex);
+                currentOutputs = outputs;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            sendErrorReply(socket, e.what());
+            continue;
+        }
+
+        ReplyHeader reply{};
+        reply.status = static_cast<std::uint32_t>(ReplyStatus::Ok);
+        reply.compression = static_cast<std::uint32_t>(compression);
+        reply.nodesCount = nodesCount;
+
+        if (static_cast<std::uint32_t>(RequestType::Index) == request.type)
+        {
+            std::vector<IndexEntry> entries;
+            for (NodeIndex node = 0; node < nodesCount; ++node)
+            {
+                for (const auto& entry : (*currentOutputs)[node].index.entries())
+                {
+                    entries.push_back(IndexEntry{ .node = node,
+                                                  .step = entry.step,
+                                                  .columns = entry.info.sceneSize->column,
+                                                  .rows = entry.info.sceneSize->row });
+                }
+            }
+            reply.count = entries.size();
+            sendAll(socket, &reply, sizeof(reply));
+            sendAll(socket, entries.data(), entries.size() * sizeof(IndexEntry));
+        }
+        else if (static_cast<std::uint32_t>(RequestType::Step) == request.type)
+        {
+            std::vector<std::string_view> texts(nodes.size());
+            std::vector<std::vector<char>> compressed(nodes.size());
+            try
+            {
+                threadPool.parallelFor(nodes.size(),
+                                       [&](std::size_t i)
+                                       {
+                                           if (nodes[i] >= nodesCount)
+                                               throw std::runtime_error(std::format("Unknown node {}", nodes[i]));
+                                           const auto& output = (*currentOutputs)[nodes[i]];
+                                           const auto* info = output.index.find(request.step);
+                                           if (! info)
+                                               throw std::runtime_error(std::format("Step {} is not in the index of node {}", request.step, nodes[i]));
+
+                                           const auto nextPosition = std::ranges::upper_bound(output.positions, info->position);
+                                           const auto begin = static_cast<std::size_t>(info->position);
+                                           const auto end = (nextPosition != output.positions.end()) ? static_cast<std::size_t>(*nextPosition) : output.dataFile->size();
+                                           if (end > output.dataFile->size())
+                                               throw std::runtime_error(std::format("Step {} is beyond the end of '{}'", request.step, output.dataFile->path()));
+
+                                           texts[i] = output.dataFile->view(begin, end - begin);
+                                           compressed[i] = compressChunkText(texts[i], compression);
+                                       });
+            }
+            catch (const std::exception& e)
+            {
+                sendErrorReply(socket, e.what());
+                continue;
+            }
+
+            reply.count = nodes.size();
+            sendAll(socket, &reply, sizeof(reply));
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+            {
+                const auto stored = compressed[i].empty() ? texts[i] : std::string_view(compressed[i].data(), compressed[i].size());
+                const NodeTextHeader header{ .node = nodes[i], .reserved = 0, .storedSize = stored.size(), .rawSize = texts[i].size() };
+                sendAll(socket, &header, sizeof(header));
+                sendAll(socket, stored.data(), stored.size());
+            }
+        }
+        else
+        {
+            sendErrorReply(socket, std::format("Unknown request {}", request.type));
+        }
+    }
+}
@@ -0,0 +1,201 @@
+/** @file RemoteOutput.h
+ * @brief Declaration of the RemoteOutputClient and RemoteOutputAgent classes - output read over the network (`mode = remote`). */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+#include "NodeStepOffsets.h"
+#include "OutputContainer.h" // ContainerCompression
+#include "ThreadPool.h"
+#include "types.h"
+
+/** @class RemoteStepData
+ * @brief Text of the nodes of one step received from the agent, still compressed (nodes are decompressed by the reading workers).
+ *
+ * Only the nodes requested for the step are present (e.g. the nodes intersecting the visible part of the grid). */
+class RemoteStepData
+{
+public:
+    struct NodeText
+    {
+        NodeIndex node;
+        std::vector<char> stored;  ///< Bytes as sent by the agent
+        std::uint64_t rawSize = 0; ///< Bytes of the text after decompression
+    };
+
+    RemoteStepData(StepIndex step, ContainerCompression compression, std::vector<NodeText> nodeTexts);
+
+    StepIndex step() const
+    {
+        return stepNumber;
+    }
+
+    /// @brief Whether every node of the list was received
+    bool hasNodes(std::span<const NodeIndex> nodes) const;
+
+    /** @brief Text of the node's step (header line and rows of cells, as in the node's text file).
+     *  @param buffer Storage for decompressed data (reused by the caller, e.g. buffers of ModelReader workers), the view is valid until it is modified
+     *  @throws std::out_of_range If the node was not requested
+     *  @throws std::runtime_error If the received text is damaged */
+    std::string_view nodeText(NodeIndex node, std::vector<char>& buffer) const;
+
+    /// @brief Number of bytes received for the step
+    std::size_t receivedBytes() const;
+
+private:
+    StepIndex stepNumber;
+    ContainerCompression compression;
+    std::vector<NodeText> nodeTexts; ///< sorted by node
+};
+
+/** @class RemoteOutputClient
+ * @brief Reads the index and steps of the output from a RemoteOutputAgent running where the output is (e.g. a cluster).
+ *
+ * Only the requested nodes of the requested steps cross the network, compressed by the agent. Every step is one request
+ * (all its nodes in one batch). Steps which will be read soon can be requested ahead with fetchAhead(): up to
+ * PIPELINED_STEPS requests run at the same time, each on its own connection, and takeStep() then only waits for
+ * the rest of the reply. Connections are kept open between requests.
+ *
+ * All methods can be called from any thread. */
+class RemoteOutputClient
+{
+public:
+    /// Requests sent ahead and in flight at the same time, also the number of steps kept when they are not taken
+    static constexpr std::size_t PIPELINED_STEPS = 4;
+
+    /** @param address Address of the agent: "host:port"
+     *  @throws std::invalid_argument If the address has no port */
+    explicit RemoteOutputClient(const std::string& address);
+
+    /// @brief Waits for requests still in flight
+    ~RemoteOutputClient();
+
+    RemoteOutputClient(const RemoteOutputClient&) = delete;
+    RemoteOutputClient& operator=(const RemoteOutputClient&) = delete;
+
+    /** @brief Reads the index of all nodes from the agent (every entry has the node's size, positions are not used).
+     *  @throws std::runtime_error If the agent cannot be reached, its output has other number of nodes,
+     *                             or it uses a compression which is not available in this build */
+    std::vector<NodeStepOffsets> readIndex(NodeIndex nodesCount);
+
+    /** @brief Starts reading the nodes of the step in background, unless the step is already being read.
+     *  When PIPELINED_STEPS steps are waiting, the oldest one is dropped. Errors are reported by takeStep(). */
+    void fetchAhead(StepIndex step, std::vector<NodeIndex> nodes);
+
+    /** @brief Returns the nodes of the step: read ahead by fetchAhead(), or read right now when they were not requested.
+     *  @return nullptr when stop was requested while waiting
+     *  @throws std::runtime_error If the step could not be read */
+    std::shared_ptr<const RemoteStepData> takeStep(StepIndex step, std::span<const NodeIndex> nodes, std::stop_token stopToken = {});
+
+    const std::string& address() const
+    {
+        return agentAddress;
+    }
+
+private:
+    class Connection;
+
+    /// @brief Sends one request on a pooled connection and reads the reply
+    std::shared_ptr<const RemoteStepData> readStep(StepIndex step, std::span<const NodeIndex> nodes);
+
+    /// @brief Idle connection from the pool, or a new one
+    std::unique_ptr<Connection> takeConnection();
+
+    /// @brief Gives back a connection whose reply was read completely
+    void returnConnection(std::unique_ptr<Connection> connection);
+
+    struct PendingStep
+    {
+        StepIndex step;
+        std::vector<NodeIndex> nodes;
+        std::shared_future<std::shared_ptr<const RemoteStepData>> data;
+    };
+
+    std::string agentAddress;
+    std::string host;
+    std::string port;
+    ContainerCompression compression = ContainerCompression::None; ///< of the texts sent by the agent, known from readIndex()
+
+    std::mutex mutex;
+    std::deque<PendingStep> pendingSteps;                 ///< guarded by mutex, oldest first
+    std::vector<std::unique_ptr<Connection>> idleConnections; ///< guarded by mutex
+
+    /// Workers sending the requests ahead (declared last, so they finish before the rest is destroyed)
+    ThreadPool fetchers{ static_cast<unsigned>(PIPELINED_STEPS) };
+};
+
+/** @class RemoteOutputAgent
+ * @brief Small server run where the output is (`--headless --serveOutput`), it sends the index and nodes of steps to RemoteOutputClient.
+ *
+ * The agent reads the text node files (`<output>N.txt` and `<output>N_index.txt`) like OutputContainer::pack():
+ * the text of a node's step ends where the next step starts. The texts are compressed node by node in parallel
+ * and sent in one reply per step. Each connection is served by its own thread. The index is read again on every
+ * index request, so a client opening the output later sees steps written meanwhile.
+ *
+ * The protocol is a little binary one over TCP in the native byte order (like the container), meant for
+ * the trusted network between a cluster and workstations: anyone reaching the port can read the output. */
+class RemoteOutputAgent
+{
+public:
+    /** @brief Listens on the port and loads the index of the nodes.
+     *  @param port TCP port, 0 chooses a free one (see port())
+     *  @throws std::runtime_error If the port cannot be opened or an index cannot be read */
+    RemoteOutputAgent(const std::string& outputFileName, NodeIndex nodesCount, ContainerCompression compression, std::uint16_t port);
+
+    ~RemoteOutputAgent();
+
+    RemoteOutputAgent(const RemoteOutputAgent&) = delete;
+    RemoteOutputAgent& operator=(const RemoteOutputAgent&) = delete;
+
+    /// @brief Port on which the agent listens
+    std::uint16_t port() const
+    {
+        return listeningPort;
+    }
+
+    /// @brief Accepts clients until stop is requested (checked a few times per second), then waits for their threads
+    /// (threads of disconnected clients are joined on every accept)
+    void serve(std::stop_token stopToken = {});
+
+private:
+    /// Node files as seen by the last index request
+    struct NodeOutput
+    {
+        NodeStepOffsets index;           ///< every entry has the node's size
+        std::vector<FilePosition> positions; ///< sorted positions of the steps, a step ends where the next one starts
+        std::shared_ptr<const MappedFile> dataFile;
+    };
+    using Outputs = std::vector<NodeOutput>;
+
+    /// @brief Reads indices of all nodes and maps their data files
+    std::shared_ptr<const Outputs> loadOutputs();
+
+    /// @brief Answers requests of one client until it disconnects
+    void serveClient(int socket, std::stop_token stopToken);
+
+    std::string outputFileName;
+    NodeIndex nodesCount;
+    ContainerCompression compression;
+    int listeningSocket = -1;
+    std::uint16_t listeningPort = 0;
+
+    std::mutex outputsMutex;
+    std::shared_ptr<const Outputs> outputs; ///< guarded by outputsMutex, replaced by index requests
+
+    /// Compresses texts of the nodes
+    ThreadPool threadPool;
+};
@@ -0,0 +1,97 @@
+/** @file SparseDelta.h
+ * @brief Declaration of the SparseDelta class template - difference of a contiguous buffer from a reference one. */
+
+#pragma once
+
+#include <algorithm> // std::copy_n, std::min, std::max
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memcmp
+#include <span>
+#include <vector>
+
+/** @class SparseDelta
+ * @brief Contiguous buffer stored as the blocks in which it differs from a reference buffer.
+ *
+ * The buffers are split into blocks of BLOCK_BYTES, a block is kept only when its bytes differ from the block
+ * at the same position in the reference (or when the reference is shorter). Consecutive steps of a simulation
+ * usually change a small part of the grid, so a step takes a fraction of its size next to a similar step.
+ * Encoding compares whole blocks with memcmp() and decoding copies the reference and then the changed blocks,
+ * so both stream through contiguous memory.
+ *
+ * Elements are compared by their bytes: equal bytes have to mean equal elements (true for numbers and for cells
+ * owning their data), while different bytes of equal elements (e.g. padding) only keep a block which was not needed.
+ * @tparam T Copyable type of the elements */
+template<typename T>
+class SparseDelta
+{
+public:
+    static constexpr std::size_t BLOCK_BYTES = 256;
+    static constexpr std::size_t BLOCK_ELEMENTS = std::max<std::size_t>(1, BLOCK_BYTES / sizeof(T));
+
+    SparseDelta() = default;
+
+    /** @brief Difference of the values from the reference (an empty reference keeps all blocks, i.e. a full copy).
+     *  Buffers of different sizes are allowed, blocks beyond the end of the reference are always kept. */
+    static SparseDelta encode(std::span<const T> reference, std::span<const T> values)
+    {
+        SparseDelta delta;
+        delta.elements = values.size();
+        if (reference.data() == values.data() && reference.size() == values.size())
+            return delta; // the same buffer
+
+        for (std::size_t begin = 0; begin < values.size(); begin += BLOCK_ELEMENTS)
+        {
+            const auto count = std::min(BLOCK_ELEMENTS, values.size() - begin);
+            const bool changed = begin + count > reference.size()
+                              || std::memcmp(static_cast<const void*>(values.data() + begin), static_cast<const void*>(reference.data() + begin), count * sizeof(T)) != 0;
+            if (! changed)
+                continue;
+
+            delta.changedBlocks.push_back(static_cast<std::uint32_t>(begin / BLOCK_ELEMENTS));
+            delta.changedValues.insert(delta.changedValues.end(), values.begin() + begin, values.begin() + begin + count);
+        }
+        delta.changedBlocks.shrink_to_fit();
+        delta.changedValues.shrink_to_fit();
+        return delta;
+    }
+
+    /** @brief Reconstructs the encoded buffer from the same reference as given to encode().
+     *  @param destination Buffer of size() elements */
+    void apply(std::span<const T> reference, std::span<T> destination) const
+    {
+        std::copy_n(reference.begin(), std::min(reference.size(), elements), destination.begin());
+
+        const T* changed = changedValues.data();
+        for (const auto block : changedBlocks)
+        {
+            const auto begin = static_cast<std::size_t>(block) * BLOCK_ELEMENTS;
+            const auto count = std::min(BLOCK_ELEMENTS, elements - begin);
+            std::copy_n(changed, count, destination.begin() + begin);
+            changed += count;
+        }
+    }
+
+    /// @brief Number of elements of the encoded buffer
+    std::size_t size() const
+    {
+        return elements;
+    }
+
+    /// @brief Whether the encoded buffer is equal to the reference of the given size (so the reference can be used instead)
+    bool isUnchanged(std::size_t referenceSize) const
+    {
+        return changedBlocks.empty() && referenceSize == elements;
+    }
+
+    /// @brief Approximate number of bytes occupied
+    std::size_t memoryUsage() const
+    {
+        return sizeof(*this) + changedBlocks.size() * sizeof(std::uint32_t) + changedValues.size() * sizeof(T);
+    }
+
+private:
+    std::size_t elements = 0;
+    std::vector<std::uint32_t> changedBlocks; ///< indices of the kept blocks, ascending
+    std::vector<T> changedValues;             ///< elements of the kept blocks one after another (the last block may be shorter)
+};
@@ -0,0 +1,172 @@
+/** @file StageProfiler.cpp
+ * @brief Implementation of the StageProfiler class. */
+
+#include <algorithm> // std::ranges::find_if
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "StageProfiler.h"
+
+
+namespace
+{
+/// Frames finished during this time are counted in the frame rate
+constexpr auto FRAME_RATE_WINDOW = std::chrono::seconds(1);
+
+double toMilliseconds(StageProfiler::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+
+StageProfiler::StageProfiler()
+    : creationTime{ Clock::now() }
+{
+}
+
+StageProfiler& StageProfiler::instance()
+{
+    static StageProfiler profiler;
+    return profiler;
+}
+
+unsigned StageProfiler::currentThreadIndex()
+{
+    static std::atomic<unsigned> threadsCount{ 0 };
+    thread_local const unsigned index = threadsCount.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void StageProfiler::setEnabled(bool enable)
+{
+    std::lock_guard lock(mutex);
+    currentFrame.clear();
+    finishedFrame = {};
+    frameEnds.clear();
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+void StageProfiler::setTraceRecording(bool record)
+{
+    std::lock_guard lock(mutex);
+    recordTrace = record;
+}
+
+bool StageProfiler::isTraceRecording() const
+{
+    std::lock_guard lock(mutex);
+    return recordTrace;
+}
+
+void StageProfiler::record(const char* stage, Clock::time_point start, Clock::time_point end, std::uint64_t allocations)
+{
+    const auto duration = end - start;
+    AllocationCounter::ExcludedScope ownAllocations; // growing sums or the trace must not count in an enclosing stage
+
+    std::lock_guard lock(mutex);
+    auto total = std::ranges::find_if(currentFrame,
+                                      [stage](const StageTotal& total)
+                                      {
+                                          return std::string_view(total.stage) == stage;
+                                      });
+    if (total == currentFrame.end())
+        total = currentFrame.insert(currentFrame.end(), StageTotal{ stage });
+    total->milliseconds += toMilliseconds(duration);
+    ++total->calls;
+    total->allocations += allocations;
+
+    if (recordTrace)
+        appendTraceEvent(stage, start, end, allocations);
+}
+
+void StageProfiler::recordTraceEvent(const char* stage, Clock::time_point start, Clock::time_point end)
+{
+    AllocationCounter::ExcludedScope ownAllocations;
+
+    std::lock_guard lock(mutex);
+    if (recordTrace)
+        appendTraceEvent(stage, start, end, 0);
+}
+
+void StageProfiler::appendTraceEvent(const char* stage, Clock::time_point start, Clock::time_point end, std::uint64_t allocations)
+{
+    if (traceEvents.size() < MAX_TRACE_EVENTS)
+    {
+        traceEvents.push_back({ stage,
+                                std::chrono::duration_cast<std::chrono::microseconds>(start - creationTime).count(),
+                                std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+                                currentThreadIndex(),
+                                allocations });
+    }
+    else
+    {
+        ++droppedTraceEvents;
+    }
+}
+
+void StageProfiler::finishFrame()
+{
+    if (! isEnabled())
+        return;
+
+    const auto now = Clock::now();
+
+    std::lock_guard lock(mutex);
+    finishedFrame.frameMilliseconds = frameEnds.empty() ? 0 : toMilliseconds(now - frameEnds.back());
+    frameEnds.push_back(now);
+    while (now - frameEnds.front() > FRAME_RATE_WINDOW)
+        frameEnds.pop_front();
+    finishedFrame.framesPerSecond = static_cast<double>(frameEnds.size() - 1) / std::chrono::duration<double>(FRAME_RATE_WINDOW).count();
+
+    finishedFrame.stages.swap(currentFrame);
+    currentFrame.clear();
+}
+
+StageProfiler::FrameBreakdown StageProfiler::lastFrame() const
+{
+    std::lock_guard lock(mutex);
+    return finishedFrame;
+}
+
+std::string StageProfiler::FrameBreakdown::toText() const
+{
+    std::string text;
+    for (const auto& total : stages)
+    {
+        text += std::format("{:<18} {:8.2f} ms {:>6} alloc", total.stage, total.milliseconds, total.allocations);
+        text += total.calls > 1 ? std::format("  ({}x)\n", total.calls) : std::string("\n");
+    }
+    text += std::format("{:<18} {:8.2f} ms  {:.1f} FPS", "frame", frameMilliseconds, framesPerSecond);
+    return text;
+}
+
+void StageProfiler::writeChromeTrace(const std::string& path) const
+{
+    std::lock_guard lock(mutex);
+
+    std::ofstream file(path, std::ios::trunc);
+    if (! file)
+        throw std::runtime_error(std::format("Can't write trace file '{}'", path));
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < traceEvents.size(); ++i)
+    {
+        const auto& event = traceEvents[i];
+        file << std::format(R"({}{{"name":"{}","cat":"stage","ph":"X","ts":{},"dur":{},"pid":1,"tid":{},"args":{{"allocations":{}}}}})",
+                            i ? ",\n" : "\n",
+                            event.stage,
+                            event.startMicroseconds,
+                            event.durationMicroseconds,
+                            event.thread,
+                            event.allocations);
+    }
+    file << "\n]}\n";
+
+    if (! file.flush())
+        throw std::runtime_error(std::format("Can't write trace file '{}'", path));
+    if (droppedTraceEvents)
+        std::cerr << std::format("Warning: {} intervals were not recorded in the trace (limit of {} reached)", droppedTraceEvents, MAX_TRACE_EVENTS) << std::endl;
+}
@@ -0,0 +1,171 @@
+/** @file StageProfiler.h
+ * @brief Declaration of the StageProfiler class - timing of stages of reading and showing steps. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AllocationCounter.h"
+
+/// @brief Names of the measured stages (their addresses are the same in all translation units)
+namespace ProfiledStage
+{
+inline constexpr char LoadStep[] = "loadStep";          ///< SceneWidget::loadAndUpdateVisualizationForCurrentStep()
+inline constexpr char DecodeStep[] = "decodeStep";      ///< decoding of a step in background (StepPrefetcher)
+inline constexpr char ReadNode[] = "readNode";          ///< reading of one node's part of a step (ModelReader)
+inline constexpr char OpenNode[] = "openNode";          ///< locating the node's step in its file (part of readNode)
+inline constexpr char RefreshGrid[] = "refreshWindowsVTK"; ///< colours of the cells (Visualizer::refreshWindowsVTK())
+inline constexpr char RefreshLines[] = "refreshLines";  ///< lines between nodes (Visualizer::refreshBuildLoadBalanceLine())
+inline constexpr char RefreshHeights[] = "refreshHeights"; ///< elevation of the heightfield mesh (Visualizer::refreshHeightfield())
+inline constexpr char AggregateNode[] = "aggregateNode"; ///< adding one node's part of a step to a temporal aggregation (TemporalAggregator)
+inline constexpr char ProbeNode[] = "probeNode";      ///< reading of the cells of a probed window from one node in one step (ModelReader::readCellsOfSteps())
+inline constexpr char Render[] = "render";              ///< rendering by VTK
+inline constexpr char WriteImage[] = "writeImage";      ///< compression and writing of one image of a sequence (ImageSequenceExporter)
+} // namespace ProfiledStage
+
+/** @class StageProfiler
+ * @brief Collects durations of stages measured by ScopedStageTimer, summed per frame and optionally kept as a trace.
+ *
+ * The profiler is disabled by default, then a timer costs one relaxed atomic load. When enabled:
+ * - durations of every stage are summed until finishFrame() (called after every rendered frame),
+ *   the sums of the last finished frame and the rolling frame rate are returned by lastFrame(),
+ * - with trace recording every measured interval is kept, to be written with writeChromeTrace()
+ *   (JSON read by chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Stages measured on worker threads (e.g. nodes read in parallel) are summed too, so their sum can exceed the frame time.
+ * Heap allocations made inside every stage (see AllocationCounter) are summed the same way: stages of the hot path
+ * of playback show 0 once the first step of a stage has filled the reused buffers. */
+class StageProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Sum of durations of one stage in a frame
+    struct StageTotal
+    {
+        const char* stage;
+        double milliseconds = 0;
+        unsigned calls = 0;
+        std::uint64_t allocations = 0; ///< heap allocations made inside the stage (nested stages included)
+    };
+
+    /// @brief Stages of the last finished frame (in order of their first measurement) and the frame rate
+    struct FrameBreakdown
+    {
+        std::vector<StageTotal> stages;
+        double frameMilliseconds = 0; ///< Time between the last two finished frames
+        double framesPerSecond = 0;   ///< Frames finished during the last second
+
+        /// @brief Text of the overlay: one line per stage, then the frame rate
+        std::string toText() const;
+    };
+
+    static StageProfiler& instance();
+
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Enables measurement (and clears the sums), when disabled timers do nothing
+    void setEnabled(bool enable);
+
+    /// @brief Keeps every measured interval (at most MAX_TRACE_EVENTS) for writeChromeTrace()
+    void setTraceRecording(bool record);
+
+    bool isTraceRecording() const;
+
+    /** @brief Adds the interval to the sums of the current frame (and to the trace when recorded); thread-safe
+     *  @param allocations Heap allocations made by the thread during the interval */
+    void record(const char* stage, Clock::time_point start, Clock::time_point end, std::uint64_t allocations = 0);
+
+    /// @brief Adds the interval only to the trace when it is recorded, not to the sums of the frame (e.g. phases of the startup); thread-safe
+    void recordTraceEvent(const char* stage, Clock::time_point start, Clock::time_point end);
+
+    /// @brief Ends the current frame: its sums become lastFrame() (nothing is done when disabled)
+    void finishFrame();
+
+    FrameBreakdown lastFrame() const;
+
+    /** @brief Writes recorded intervals in Chrome trace event format ("X" events, microseconds).
+     *  @throws std::runtime_error If the file cannot be written */
+    void writeChromeTrace(const std::string& path) const;
+
+    static constexpr std::size_t MAX_TRACE_EVENTS = 1'000'000;
+
+private:
+    StageProfiler();
+
+    struct TraceEvent
+    {
+        const char* stage;
+        std::int64_t startMicroseconds;
+        std::int64_t durationMicroseconds;
+        unsigned thread;
+        std::uint64_t allocations;
+    };
+
+    static unsigned currentThreadIndex();
+
+    /// @brief Appends the event to the trace, or counts it as dropped when the trace is full (mutex has to be locked)
+    void appendTraceEvent(const char* stage, Clock::time_point start, Clock::time_point end, std::uint64_t allocations);
+
+    inline static std::atomic<bool> enabled{ false };
+
+    const Clock::time_point creationTime;
+    mutable std::mutex mutex;
+    std::vector<StageTotal> currentFrame;
+    FrameBreakdown finishedFrame;
+    std::deque<Clock::time_point> frameEnds; ///< ends of frames during the last second
+    bool recordTrace = false;
+    std::vector<TraceEvent> traceEvents;
+    std::size_t droppedTraceEvents = 0;
+};
+
+/** @class ScopedStageTimer
+ * @brief Measures the stage from construction to destruction, when StageProfiler is enabled.
+ *
+ * Heap allocations of the thread in this time are reported with the duration.
+ *
+ * Example:
+ * @code
+ *     ScopedStageTimer timer(ProfiledStage::RefreshGrid);
+ * @endcode */
+class ScopedStageTimer
+{
+public:
+    /// @param stage Name with static storage duration (usually from ProfiledStage)
+    explicit ScopedStageTimer(const char* stage)
+        : stage{ StageProfiler::isEnabled() ? stage : nullptr }
+    {
+        if (this->stage)
+        {
+            allocationsAtStart = AllocationCounter::threadAllocations();
+            start = StageProfiler::Clock::now();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (stage)
+        {
+            const auto end = StageProfiler::Clock::now();
+            StageProfiler::instance().record(stage, start, end, AllocationCounter::threadAllocations() - allocationsAtStart);
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    const char* stage;
+    StageProfiler::Clock::time_point start{};
+    std::uint64_t allocationsAtStart = 0;
+};
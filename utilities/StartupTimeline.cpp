@@ -0,0 +1,99 @@
+/** @file StartupTimeline.cpp
+ * @brief Implementation of the StartupTimeline class. */
+
+#include <algorithm> // std::ranges::sort
+#include <format>
+#include <iostream>
+
+#include "StartupTimeline.h"
+
+
+namespace
+{
+double toMilliseconds(StartupTimeline::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+
+StartupTimeline::StartupTimeline()
+    : startTime{ Clock::now() }
+{
+    StageProfiler::instance(); // times of the trace are counted from the creation of the profiler: at the same moment
+}
+
+StartupTimeline& StartupTimeline::instance()
+{
+    static StartupTimeline timeline;
+    return timeline;
+}
+
+void StartupTimeline::record(const char* phase, Clock::time_point start, Clock::time_point end)
+{
+    std::lock_guard lock(mutex);
+    if (finishMilliseconds)
+        return;
+    recordedPhases.push_back({ phase, toMilliseconds(start - startTime), toMilliseconds(end - start) });
+}
+
+void StartupTimeline::finish()
+{
+    const auto now = Clock::now();
+    bool print = false;
+    {
+        std::lock_guard lock(mutex);
+        if (finishMilliseconds)
+            return;
+        finishMilliseconds = toMilliseconds(now - startTime);
+        print = printedOnFinish;
+    }
+
+    // added to the trace only now: tracing is started by the command line, after the first phases began
+    for (const auto& [name, startMilliseconds, milliseconds] : phases())
+    {
+        const auto start = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(startMilliseconds));
+        const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+        StageProfiler::instance().recordTraceEvent(name, start, end);
+    }
+
+    if (print)
+        std::cout << toText() << std::flush;
+}
+
+bool StartupTimeline::isFinished() const
+{
+    std::lock_guard lock(mutex);
+    return finishMilliseconds.has_value();
+}
+
+void StartupTimeline::setPrintedOnFinish(bool print)
+{
+    std::lock_guard lock(mutex);
+    printedOnFinish = print;
+}
+
+std::vector<StartupTimeline::Phase> StartupTimeline::phases() const
+{
+    std::lock_guard lock(mutex);
+    auto sortedPhases = recordedPhases;
+    std::ranges::sort(sortedPhases, {}, &Phase::startMilliseconds);
+    return sortedPhases;
+}
+
+std::optional<double> StartupTimeline::timeToFirstFrameMilliseconds() const
+{
+    std::lock_guard lock(mutex);
+    return finishMilliseconds;
+}
+
+std::string StartupTimeline::toText() const
+{
+    std::string text = "Startup phases:\n";
+    for (const auto& [name, startMilliseconds, milliseconds] : phases())
+        text += std::format("  {:<26} {:8.2f} ms  (at {:8.2f} ms)\n", name, milliseconds, startMilliseconds);
+
+    if (const auto firstFrame = timeToFirstFrameMilliseconds())
+        text += std::format("  {:<26} {:8.2f} ms\n", "first frame after", *firstFrame);
+    return text;
+}
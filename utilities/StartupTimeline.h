@@ -0,0 +1,102 @@
+/** @file StartupTimeline.h
+ * @brief Declaration of the StartupTimeline class - durations of the phases of the start of the viewer until its first frame. */
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "StageProfiler.h"
+
+/// @brief Names of the startup phases (they are also the names of their events in the trace of StageProfiler)
+namespace StartupPhase
+{
+inline constexpr char Window[] = "startupWindow";                 ///< QApplication and MainWindow created, the window shown
+inline constexpr char PluginDiscovery[] = "startupPluginDiscovery"; ///< plugin directories and the manifest read (background thread)
+inline constexpr char PluginRegistration[] = "startupPluginRegistration"; ///< models of the found plugins registered (GUI thread)
+inline constexpr char Configuration[] = "startupConfiguration";   ///< config file read, stage and VTK scene prepared
+inline constexpr char StepIndices[] = "startupStepIndices";       ///< index files of all nodes loaded (the first step is read meanwhile)
+inline constexpr char FirstStep[] = "startupFirstStep";           ///< the first step decoded, drawn with VTK and rendered
+} // namespace StartupPhase
+
+/** @class StartupTimeline
+ * @brief Phases of the start of the viewer, measured from the creation of the timeline (the beginning of main()) to the first frame.
+ *
+ * Phases may overlap (e.g. plugin discovery runs in a background thread while the window is created).
+ * finish() ends the timeline, later phases (e.g. of configurations opened from the menu) are ignored.
+ * With `--profile` the timeline is printed at the first frame, with `--profile-trace` the phases are in the trace too. */
+class StartupTimeline
+{
+public:
+    using Clock = StageProfiler::Clock;
+
+    struct Phase
+    {
+        const char* name;
+        double startMilliseconds; ///< since the start of the viewer
+        double milliseconds;
+    };
+
+    static StartupTimeline& instance();
+
+    /// @brief Adds the phase (thread-safe), it is ignored when the timeline is finished
+    void record(const char* phase, Clock::time_point start, Clock::time_point end);
+
+    /// @brief Ends the timeline: the first frame is shown (or there is none to wait for), prints it when setPrintedOnFinish() was set
+    void finish();
+
+    bool isFinished() const;
+
+    /// @brief Prints the timeline to the standard output when it is finished (`--profile`)
+    void setPrintedOnFinish(bool print);
+
+    std::vector<Phase> phases() const;
+
+    /// @brief Time from the start of the viewer to finish(), std::nullopt while it is not finished
+    std::optional<double> timeToFirstFrameMilliseconds() const;
+
+    /// @brief One line per phase (in order of their starts), then the time to the first frame
+    std::string toText() const;
+
+private:
+    StartupTimeline();
+
+    const Clock::time_point startTime;
+    mutable std::mutex mutex;
+    std::vector<Phase> recordedPhases;
+    std::optional<double> finishMilliseconds;
+    bool printedOnFinish = false;
+};
+
+/** @class ScopedStartupPhase
+ * @brief Measures the startup phase from construction to destruction (nothing is kept once the timeline is finished).
+ *
+ * Example:
+ * @code
+ *     ScopedStartupPhase phase(StartupPhase::Configuration);
+ * @endcode */
+class ScopedStartupPhase
+{
+public:
+    /// @param phase Name with static storage duration (usually from StartupPhase)
+    explicit ScopedStartupPhase(const char* phase)
+        : phase{ StartupTimeline::instance().isFinished() ? nullptr : phase }
+        , start{ StartupTimeline::Clock::now() }
+    {
+    }
+
+    ~ScopedStartupPhase()
+    {
+        if (phase)
+            StartupTimeline::instance().record(phase, start, StartupTimeline::Clock::now());
+    }
+
+    ScopedStartupPhase(const ScopedStartupPhase&) = delete;
+    ScopedStartupPhase& operator=(const ScopedStartupPhase&) = delete;
+
+private:
+    const char* phase;
+    const StartupTimeline::Clock::time_point start;
+};
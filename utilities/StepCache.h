@@ -0,0 +1,173 @@
+/** @file StepCache.h
+ * @brief Declaration of the StepCache class template - memory-bounded LRU cache of decoded steps. */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h" // StepIndex
+
+/** @struct StepCacheStatistics
+ * @brief Snapshot of the step cache state, used for diagnostics. */
+struct StepCacheStatistics
+{
+    std::size_t hits{};         ///< Number of lookups which found the step in the cache
+    std::size_t misses{};       ///< Number of lookups which had to decode the step
+    std::size_t cachedSteps{};  ///< Number of steps currently kept in the cache
+    std::size_t memoryUsage{};  ///< Bytes occupied by cached steps
+    std::size_t memoryBudget{}; ///< Maximum number of bytes the cache may occupy
+    std::size_t compressedSteps{}; ///< Number of steps kept delta-compressed behind the cache (see DeltaStepCache), in memoryUsage too
+};
+
+/** @class StepCache
+ * @brief Thread-safe LRU cache of values keyed by StepIndex with a memory budget.
+ *
+ * Every value is inserted with its size in bytes. When the total size exceeds the budget,
+ * least recently used steps are evicted. Values are shared (std::shared_ptr), so a step
+ * evicted while still displayed stays alive until its last user releases it.
+ *
+ * @tparam Value Type of the cached value (e.g. DecodedStep<Cell>) */
+template<typename Value>
+class StepCache
+{
+public:
+    using ValuePtr = std::shared_ptr<const Value>;
+
+    struct Evicted
+    {
+        StepIndex step;
+        ValuePtr value;
+    };
+
+    explicit StepCache(std::size_t memoryBudgetBytes)
+        : memoryBudgetBytes{ memoryBudgetBytes }
+    {
+    }
+
+    /** @brief Returns cached step and marks it as the most recently used one.
+     *  The lookup is counted as a hit or a miss.
+     *  @return The value or nullptr if the step is not in the cache */
+    ValuePtr find(StepIndex step)
+    {
+        std::lock_guard lock(mutex);
+        const auto it = entriesByStep.find(step);
+        if (it == entriesByStep.end())
+        {
+            ++missesCount;
+            return nullptr;
+        }
+
+        ++hitsCount;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->value;
+    }
+
+    /// @brief Checks presence of the step without changing its position and without counting the lookup
+    bool contains(StepIndex step) const
+    {
+        std::lock_guard lock(mutex);
+        return entriesByStep.contains(step);
+    }
+
+    /// @brief Returns cached step without changing its position and without counting the lookup (nullptr if absent)
+    ValuePtr peek(StepIndex step) const
+    {
+        std::lock_guard lock(mutex);
+        const auto it = entriesByStep.find(step);
+        return (it == entriesByStep.end()) ? nullptr : it->second->value;
+    }
+
+    /** @brief Inserts (or replaces) the step as the most recently used one and evicts the oldest steps above budget.
+     *  Values bigger than the whole budget are not stored at all.
+     *  @return The evicted steps and the value itself when it was not stored (e.g. to keep them in another tier),
+     *          the replaced value of the same step is not among them */
+    std::vector<Evicted> insert(StepIndex step, ValuePtr value, std::size_t sizeInBytes)
+    {
+        std::vector<Evicted> evicted;
+        std::lock_guard lock(mutex);
+        eraseUnlocked(step);
+        if (sizeInBytes > memoryBudgetBytes)
+        {
+            evicted.push_back({ step, std::move(value) });
+            return evicted;
+        }
+
+        entries.push_front(Entry{ step, std::move(value), sizeInBytes });
+        entriesByStep[step] = entries.begin();
+        usedBytes += sizeInBytes;
+        evictAboveBudgetUnlocked(&evicted);
+        return evicted;
+    }
+
+    /// @brief Removes all cached steps (counters are kept)
+    void clear()
+    {
+        std::lock_guard lock(mutex);
+        entries.clear();
+        entriesByStep.clear();
+        usedBytes = 0;
+    }
+
+    /// @return The evicted steps (see insert())
+    std::vector<Evicted> setMemoryBudget(std::size_t newMemoryBudgetBytes)
+    {
+        std::vector<Evicted> evicted;
+        std::lock_guard lock(mutex);
+        memoryBudgetBytes = newMemoryBudgetBytes;
+        evictAboveBudgetUnlocked(&evicted);
+        return evicted;
+    }
+
+    StepCacheStatistics statistics() const
+    {
+        std::lock_guard lock(mutex);
+        return StepCacheStatistics{
+            .hits = hitsCount,
+            .misses = missesCount,
+            .cachedSteps = entries.size(),
+            .memoryUsage = usedBytes,
+            .memoryBudget = memoryBudgetBytes
+        };
+    }
+
+private:
+    struct Entry
+    {
+        StepIndex step;
+        ValuePtr value;
+        std::size_t sizeInBytes;
+    };
+
+    void eraseUnlocked(StepIndex step)
+    {
+        if (const auto it = entriesByStep.find(step); it != entriesByStep.end())
+        {
+            usedBytes -= it->second->sizeInBytes;
+            entries.erase(it->second);
+            entriesByStep.erase(it);
+        }
+    }
+
+    void evictAboveBudgetUnlocked(std::vector<Evicted>* evicted = nullptr)
+    {
+        while (usedBytes > memoryBudgetBytes && ! entries.empty())
+        {
+            if (evicted)
+                evicted->push_back({ entries.back().step, entries.back().value });
+            eraseUnlocked(entries.back().step);
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; ///< most recently used first
+    std::unordered_map<StepIndex, typename std::list<Entry>::iterator> entriesByStep;
+    std::size_t usedBytes = 0;
+    std::size_t memoryBudgetBytes;
+    std::size_t hitsCount = 0;
+    std::size_t missesCount = 0;
+};
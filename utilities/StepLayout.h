@@ -0,0 +1,93 @@
+/** @file StepLayout.h
+ * @brief Declaration of the CellRegion, StepLayout and StepContents structures - placement and content identity of nodes in a step. */
+
+#pragma once
+
+#include <algorithm> // std::clamp
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "types.h"
+
+/** @struct CellRegion
+ * @brief Rectangle of cells of the whole grid, in matrix coordinates (row 0 is the first row of the matrix). */
+struct CellRegion
+{
+    int firstRow;
+    int firstColumn;
+    int rows;
+    int columns;
+
+    /// @brief Cells of the node placed at offsetXY with sceneSize columns and rows, clipped to the grid (rows or columns may be 0)
+    static CellRegion ofNode(ColumnAndRow offsetXY, ColumnAndRow sceneSize, int gridRows, int gridColumns)
+    {
+        const int firstRow = std::clamp(offsetXY.y(), 0, gridRows);
+        const int firstColumn = std::clamp(offsetXY.x(), 0, gridColumns);
+        return CellRegion{ .firstRow = firstRow,
+                           .firstColumn = firstColumn,
+                           .rows = std::clamp(offsetXY.y() + sceneSize.row, 0, gridRows) - firstRow,
+                           .columns = std::clamp(offsetXY.x() + sceneSize.column, 0, gridColumns) - firstColumn };
+    }
+
+    /// @brief Whether the rectangle starting at offsetXY with sceneSize columns and rows shares any cell with the region
+    bool intersects(ColumnAndRow offsetXY, ColumnAndRow sceneSize) const
+    {
+        return offsetXY.x() < firstColumn + columns && firstColumn < offsetXY.x() + sceneSize.column
+            && offsetXY.y() < firstRow + rows && firstRow < offsetXY.y() + sceneSize.row;
+    }
+
+    /// @brief Whether the other region is completely inside this one
+    bool contains(const CellRegion& other) const
+    {
+        return firstRow <= other.firstRow && other.firstRow + other.rows <= firstRow + rows
+            && firstColumn <= other.firstColumn && other.firstColumn + other.columns <= firstColumn + columns;
+    }
+
+    bool operator==(const CellRegion&) const = default;
+};
+
+/// Placement of all nodes in one step (same for all steps in most runs, but the load balancer may change it)
+struct StepLayout
+{
+    std::vector<ColumnAndRow> sceneSizes; ///< columns and rows of every node
+    std::vector<ColumnAndRow> offsetsXY;  ///< position of every node's first cell in the whole grid
+
+    bool operator==(const StepLayout&) const = default;
+};
+
+/** @struct StepContents
+ * @brief What was read for every node of a step (optional output of ModelReader::readStageStateFromFilesForStep()).
+ *
+ * Nodes with the same placement and equal hash in two steps have the same data, so whatever was
+ * derived from them (e.g. colours) can be reused instead of being computed again.
+ * Passed again with the same layout, nodes already read are skipped (loading a step part by part). */
+struct StepContents
+{
+    std::shared_ptr<const StepLayout> layout; ///< placement of the nodes
+    std::vector<std::uint64_t> nodeHashes;   ///< hash of the raw data (text lines or binary slab) of every node
+    std::vector<unsigned char> nodesRead;    ///< 1 for nodes which were read (others are skipped, outside of the region of interest)
+
+    /// @brief Whether the node was read, or its data is the same as in the node of the other contents
+    bool sameNodeData(const StepContents& other, std::size_t node) const
+    {
+        if (nodesRead[node] != other.nodesRead[node])
+            return false;
+        return ! nodesRead[node] || nodeHashes[node] == other.nodeHashes[node]; // not read: both have default cells
+    }
+
+    /// @brief Whether all nodes intersecting the region were read (all nodes when there is no region)
+    bool covers(const std::optional<CellRegion>& region) const
+    {
+        if (! layout)
+            return false;
+
+        for (std::size_t node = 0; node < nodesRead.size(); ++node)
+        {
+            if (! nodesRead[node] && (! region || region->intersects(layout->offsetsXY[node], layout->sceneSizes[node])))
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,85 @@
+/** @file TextBlockReader.cpp
+ * @brief Implementation of the TextBlockReader class. */
+
+#include "TextBlockReader.h"
+
+#include <algorithm> // std::max
+#include <cstring>   // std::memchr, std::memmove
+#include <istream>
+#include <utility> // std::move
+
+
+TextBlockReader::TextBlockReader(Source source, std::vector<char>& buffer, std::size_t blockSize, std::shared_ptr<const void> owner)
+    : source{ std::move(source) }
+    , owner{ std::move(owner) }
+    , buffer{ buffer }
+{
+    if (this->buffer.size() < blockSize + 1)
+        this->buffer.resize(blockSize + 1); // +1: room for terminating byte after the last line
+}
+
+TextBlockReader::TextBlockReader(std::istream& input, std::vector<char>& buffer, std::size_t blockSize)
+    : TextBlockReader(
+          [&input](char* destination, std::size_t maxBytes)
+          {
+              input.read(destination, static_cast<std::streamsize>(maxBytes));
+              return static_cast<std::size_t>(input.gcount());
+          },
+          buffer,
+          blockSize)
+{
+}
+
+bool TextBlockReader::readLine(std::span<char>& line)
+{
+    while (true)
+    {
+        char* begin = buffer.data() + dataBegin;
+        const std::size_t available = dataEnd - dataBegin;
+
+        if (auto* newLine = static_cast<char*>(std::memchr(begin, '\n', available)))
+        {
+            dataBegin += static_cast<std::size_t>(newLine - begin) + 1;
+
+            char* end = newLine;
+            if (end > begin && '\r' == end[-1])
+                --end;
+            line = std::span<char>(begin, end);
+            return true;
+        }
+
+        if (endOfInput)
+        {
+            if (0 == available)
+                return false;
+
+            // last line without '\n'; there is always one spare byte after valid data
+            dataBegin = dataEnd;
+            line = std::span<char>(begin, available);
+            return true;
+        }
+
+        readNextBlock();
+    }
+}
+
+void TextBlockReader::readNextBlock()
+{
+    const std::size_t unread = dataEnd - dataBegin;
+    if (dataBegin > 0)
+    {
+        std::memmove(buffer.data(), buffer.data() + dataBegin, unread);
+        dataBegin = 0;
+        dataEnd = unread;
+    }
+
+    if (dataEnd + 1 >= buffer.size()) // line longer than the whole buffer
+        buffer.resize(std::max<std::size_t>(2 * buffer.size(), 2));
+
+    const std::size_t freeSpace = buffer.size() - 1 - dataEnd; // keep one spare byte
+    const std::size_t bytesRead = source(buffer.data() + dataEnd, freeSpace);
+
+    dataEnd += bytesRead;
+    if (bytesRead < freeSpace)
+        endOfInput = true;
+}
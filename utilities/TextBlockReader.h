@@ -0,0 +1,56 @@
+/** @file TextBlockReader.h
+ * @brief Declaration of the TextBlockReader class - line splitting of a stream read in large blocks. */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <vector>
+
+/** @class TextBlockReader
+ * @brief Reads a stream in large blocks and hands out its lines without copying them.
+ *
+ * Compared to std::getline the data is not copied character by character into a std::string:
+ * end of line is found with std::memchr (vectorised by the C library) directly in the block.
+ * Returned lines are mutable, so a parser can terminate tokens in place (see composeElement(char*)).
+ *
+ * @note There is always at least one writable byte just after the returned line
+ *       (where the '\n' was), so `line.data()[line.size()] = '\0'` is allowed. */
+class TextBlockReader
+{
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    /** @brief Source of the data: fills destination with up to maxBytes next bytes,
+     *  returns number of bytes written (less than maxBytes only at the end of the data) */
+    using Source = std::function<std::size_t(char* destination, std::size_t maxBytes)>;
+
+    /** @param source Data to read, starting at the first line to return (e.g. positional reads of a NodeFile)
+     *  @param buffer Storage for blocks (reused by the caller, so it is allocated once per thread),
+     *         its capacity grows when a line is longer than a block
+     *  @param owner Kept alive as long as the reader (e.g. the file read by source), so the source can capture
+     *         only plain pointers and fit into std::function without a heap allocation */
+    TextBlockReader(Source source, std::vector<char>& buffer, std::size_t blockSize = DEFAULT_BLOCK_SIZE, std::shared_ptr<const void> owner = {});
+
+    /// @param input Stream to read from, positioned at the first line to return
+    TextBlockReader(std::istream& input, std::vector<char>& buffer, std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    /** @brief Returns next line (without the trailing "\n" or "\r\n").
+     *  @param[out] line View of the line, valid until next call
+     *  @return false if there is no more data */
+    bool readLine(std::span<char>& line);
+
+private:
+    /// @brief Moves unread data to the beginning of the buffer and appends next block from the stream
+    void readNextBlock();
+
+    Source source;
+    std::shared_ptr<const void> owner;
+    std::vector<char>& buffer;
+    std::size_t dataBegin = 0; ///< first unread byte in buffer
+    std::size_t dataEnd = 0;   ///< end of valid bytes in buffer
+    bool endOfInput = false;
+};
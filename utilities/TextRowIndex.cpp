@@ -0,0 +1,98 @@
+/** @file TextRowIndex.cpp
+ * @brief Implementation of the TextRowIndex class. */
+
+#include "TextRowIndex.h"
+
+#include <cstring> // std::memchr
+
+
+std::optional<std::span<char>> TextRowIndex::readRow(const NodeFile& file, NodeIndex node, StepIndex step, FilePosition stepPosition, int row, int rows, std::vector<char>& buffer)
+{
+    auto& stepRows = rowsOf(node, step);
+    const auto line = static_cast<std::size_t>(row) + 1; // after the header
+
+    FilePosition lineStart{};
+    FilePosition lineEnd{};
+    {
+        std::lock_guard lock(stepRows.mutex);
+        if (stepRows.lineStarts.empty() || stepRows.stepPosition != stepPosition) // first use, or the index of the node was reloaded
+        {
+            stepRows.stepPosition = stepPosition;
+            stepRows.lineStarts.assign(1, 0);
+            stepRows.reachedEnd = false;
+        }
+        scanUntilLine(file, stepRows, line, static_cast<std::size_t>(rows), buffer);
+        if (stepRows.lineStarts.size() <= line + 1)
+            return std::nullopt;
+
+        lineStart = stepPosition + stepRows.lineStarts[line];
+        lineEnd = stepPosition + stepRows.lineStarts[line + 1] - 1; // the '\n'
+    }
+
+    auto length = static_cast<std::size_t>(lineEnd - lineStart);
+    buffer.resize(length + 1); // writable byte after the line
+    length = file.readAt(lineStart, buffer.data(), length);
+    if (length > 0 && '\r' == buffer[length - 1])
+        --length;
+    return std::span<char>(buffer.data(), length);
+}
+
+void TextRowIndex::scanUntilLine(const NodeFile& file, StepRows& stepRows, std::size_t wantedLine, std::size_t lastLine, std::vector<char>& buffer)
+{
+    auto& lineStarts = stepRows.lineStarts;
+    const auto maxStarts = lastLine + 2; // the end of the last row too
+    FilePosition scanned = lineStarts.back();
+
+    buffer.resize(SCAN_BLOCK_SIZE);
+    while (lineStarts.size() <= wantedLine + 1 && ! stepRows.reachedEnd)
+    {
+        const auto bytesRead = file.readAt(stepRows.stepPosition + scanned, buffer.data(), SCAN_BLOCK_SIZE);
+        const char* const blockEnd = buffer.data() + bytesRead;
+        for (const char* lineFeed = buffer.data(); lineStarts.size() < maxStarts;)
+        {
+            lineFeed = static_cast<const char*>(std::memchr(lineFeed, '\n', blockEnd - lineFeed));
+            if (! lineFeed)
+                break;
+            ++lineFeed;
+            lineStarts.push_back(scanned + (lineFeed - buffer.data()));
+        }
+        scanned += static_cast<FilePosition>(bytesRead);
+
+        if (bytesRead < SCAN_BLOCK_SIZE)
+        {
+            stepRows.reachedEnd = true;
+            if (scanned > lineStarts.back() && lineStarts.size() < maxStarts)
+                lineStarts.push_back(scanned + 1); // the last line without '\n' ends with the file
+        }
+        if (lineStarts.size() >= maxStarts)
+            break;
+    }
+}
+
+TextRowIndex::StepRows& TextRowIndex::rowsOf(NodeIndex node, StepIndex step)
+{
+    const auto key = (static_cast<std::uint64_t>(node) << 32) | step;
+    std::lock_guard lock(mutex);
+    auto& stepRows = stepsRows[key];
+    if (! stepRows)
+        stepRows = std::make_unique<StepRows>();
+    return *stepRows; // owned by a unique_ptr, so it does not move when the map rehashes
+}
+
+void TextRowIndex::clear()
+{
+    std::lock_guard lock(mutex);
+    stepsRows.clear();
+}
+
+std::size_t TextRowIndex::indexedRows() const
+{
+    std::lock_guard lock(mutex);
+    std::size_t rows = 0;
+    for (const auto& [key, stepRows] : stepsRows)
+    {
+        std::lock_guard stepLock(stepRows->mutex);
+        rows += stepRows->lineStarts.empty() ? 0 : stepRows->lineStarts.size() - 1;
+    }
+    return rows;
+}
@@ -0,0 +1,69 @@
+/** @file TextRowIndex.h
+ * @brief Declaration of the TextRowIndex class - positions of the rows of nodes' steps in text data files. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "NodeFilePool.h" // NodeFile
+#include "types.h"
+
+/** @class TextRowIndex
+ * @brief Byte offsets of the rows of nodes' steps in text data files, so a single row is read without the rows before it.
+ *
+ * The index is filled lazily: the first read of a row of a node's step scans line ends (std::memchr on blocks read
+ * with positional reads) from the last known row up to the requested one, and remembers the offsets of all rows passed.
+ * Rows up to the furthest one requested are then read with one positional read each, without any scanning.
+ * Used by cell probes (ModelReader::readCellsOfSteps()), which read a few cells of a node in thousands of steps.
+ * Thread-safe, rows of different steps are indexed in parallel.
+ *
+ * The index takes one FilePosition per indexed row, it is emptied with clear() when the stage changes. */
+class TextRowIndex
+{
+public:
+    /// Bytes read at once while scanning for line ends
+    static constexpr std::size_t SCAN_BLOCK_SIZE = 64 * 1024;
+
+    /** @brief Reads the row of the node's step.
+     *
+     * The step starts with the header line ("C-R"), row 0 is the line after it.
+     * @param stepPosition Position of the step's header line in the file (from the index of the node)
+     * @param row Row of the node's step, smaller than rows
+     * @param rows Rows of the node in the step (lines after them belong to the next step and are not indexed)
+     * @param buffer Storage of the line, keeps its capacity (one more byte is writable after the line)
+     * @return View of the line in the buffer (without "\n" or "\r\n"), std::nullopt when the file ends before the row
+     * @throws std::runtime_error If reading fails */
+    std::optional<std::span<char>> readRow(const NodeFile& file, NodeIndex node, StepIndex step, FilePosition stepPosition, int row, int rows, std::vector<char>& buffer);
+
+    /// @brief Forgets all rows (e.g. when another stage is loaded), no row may be read at the same time
+    void clear();
+
+    /// @brief Number of rows of all steps which are indexed
+    std::size_t indexedRows() const;
+
+private:
+    /// @brief Known line starts of one node's step
+    struct StepRows
+    {
+        std::mutex mutex;
+        FilePosition stepPosition{};
+        std::vector<FilePosition> lineStarts; ///< relative to stepPosition, [0] is the header, [i + 1] row i, the last one may be the end of the last row
+        bool reachedEnd = false;              ///< the file ended, no more lines can be found
+    };
+
+    /** @brief Scans the file until the start of the line after the wanted one is known (or the file ends).
+     *  @param wantedLine Line of the step, 0 is the header
+     *  @param lastLine The last line (the last row) of the step, no line after it is indexed */
+    static void scanUntilLine(const NodeFile& file, StepRows& stepRows, std::size_t wantedLine, std::size_t lastLine, std::vector<char>& buffer);
+
+    StepRows& rowsOf(NodeIndex node, StepIndex step);
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::unique_ptr<StepRows>> stepsRows; ///< keyed by node and step
+};
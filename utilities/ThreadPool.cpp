@@ -0,0 +1,285 @@
+/** @file ThreadPool.cpp
+ * @brief Implementation of the ThreadPool class. */
+
+#include "ThreadPool.h"
+
+#include <algorithm> // std::max, std::min
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <utility> // std::exchange
+
+
+namespace
+{
+/// Pool and queue index of the worker running on the current thread (nullptr outside of any pool)
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local unsigned currentWorkerIndex = 0;
+} // namespace
+
+
+/** Helper tasks refer to the state with the generation of their call: a helper starting after its call has finished
+ *  (and the state was taken by another call) sees a newer generation and does nothing, so it does not keep the state. */
+struct ThreadPool::ParallelForState
+{
+    const std::function<void(std::size_t)>* body = nullptr;
+    std::size_t count = 0;
+    std::atomic<std::size_t> nextIndex{};
+    std::atomic<std::size_t> finishedCount{};
+    std::atomic<bool> failed{};
+    std::exception_ptr firstException;
+    std::mutex mutex;
+    std::condition_variable allFinished;
+
+    std::atomic<bool> inUse{};                ///< taken by a running parallelFor() call
+    std::atomic<std::uint64_t> generation{};  ///< increased by every call taking the state
+    std::atomic<unsigned> runningHelpers{};   ///< helpers between their start and the end of their check or work
+
+    void runItems()
+    {
+        for (std::size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1))
+        {
+            if (! failed.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    (*body)(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(mutex);
+                    if (! firstException)
+                        firstException = std::current_exception();
+                    failed = true;
+                }
+            }
+
+            if (finishedCount.fetch_add(1) + 1 == count)
+            {
+                std::lock_guard lock(mutex);
+                allFinished.notify_all();
+            }
+        }
+    }
+
+    void runAsHelper(std::uint64_t callGeneration)
+    {
+        runningHelpers.fetch_add(1);
+        if (generation.load() == callGeneration)
+            runItems(); // when the call has already finished, there are no items left
+        runningHelpers.fetch_sub(1);
+    }
+};
+
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (0 == threadCount)
+        threadCount = defaultThreadCount();
+
+    queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    workers.clear(); // std::jthread joins in destructor
+}
+
+unsigned ThreadPool::defaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::submit(Task task)
+{
+    const unsigned queueIndex = (currentPool == this) ? currentWorkerIndex
+                                                      : nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+
+    // The counter is increased before the task is visible, so it never drops below zero
+    {
+        std::lock_guard lock(wakeMutex);
+        pendingTasks.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        auto& queue = *queues[queueIndex];
+        std::lock_guard lock(queue.mutex);
+        queue.pushBack(std::move(task));
+    }
+    wakeCondition.notify_one();
+}
+
+std::optional<unsigned> ThreadPool::workerIndex() const
+{
+    if (currentPool != this)
+        return std::nullopt;
+    return currentWorkerIndex;
+}
+
+void ThreadPool::WorkerQueue::pushBack(Task task)
+{
+    if (count == slots.size()) // full: tasks are moved to a bigger ring starting at slot 0
+    {
+        std::vector<Task> biggerSlots(std::max<std::size_t>(2 * slots.size(), 16));
+        for (std::size_t i = 0; i < count; ++i)
+            biggerSlots[i] = std::move(slots[(first + i) % slots.size()]);
+        slots.swap(biggerSlots);
+        first = 0;
+    }
+    slots[(first + count) % slots.size()] = std::move(task);
+    ++count;
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::popBack()
+{
+    --count;
+    return std::move(slots[(first + count) % slots.size()]);
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::popFront()
+{
+    auto task = std::move(slots[first]);
+    first = (first + 1) % slots.size();
+    --count;
+    return task;
+}
+
+bool ThreadPool::tryTakeTask(unsigned workerIndex, Task& task)
+{
+    // own queue: newest task first (its data is most likely still in cache)
+    {
+        auto& queue = *queues[workerIndex];
+        std::lock_guard lock(queue.mutex);
+        if (queue.count > 0)
+        {
+            task = queue.popBack();
+            return true;
+        }
+    }
+
+    // stealing: oldest task of the other queues
+    for (unsigned offset = 1; offset < size(); ++offset)
+    {
+        auto& queue = *queues[(workerIndex + offset) % size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.count > 0)
+        {
+            task = queue.popFront();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned workerIndex)
+{
+    currentPool = this;
+    currentWorkerIndex = workerIndex;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(wakeMutex);
+            wakeCondition.wait(lock,
+                               [this]
+                               {
+                                   return stopping || pendingTasks.load(std::memory_order_acquire) > 0;
+                               });
+            if (stopping && 0 == pendingTasks.load(std::memory_order_acquire))
+                return;
+        }
+
+        Task task;
+        if (tryTakeTask(workerIndex, task))
+        {
+            pendingTasks.fetch_sub(1, std::memory_order_acq_rel);
+            try
+            {
+                task();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Unhandled exception in thread pool task: " << e.what() << std::endl;
+            }
+        }
+        else
+        {
+            std::this_thread::yield(); // other worker took the task in the meantime
+        }
+    }
+}
+
+ThreadPool::ParallelForState& ThreadPool::acquireParallelForState()
+{
+    std::lock_guard lock(parallelForStatesMutex);
+    for (auto& state : parallelForStates)
+    {
+        bool taken = false;
+        if (state->inUse.compare_exchange_strong(taken, true))
+            return *state;
+    }
+    // more calls at the same time than ever before (e.g. nested ones)
+    parallelForStates.push_back(std::make_unique<ParallelForState>());
+    parallelForStates.back()->inUse = true;
+    return *parallelForStates.back();
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& body)
+{
+    if (0 == count)
+        return;
+
+    auto& state = acquireParallelForState();
+    const auto callGeneration = state.generation.fetch_add(1) + 1;
+    while (state.runningHelpers.load() > 0) // late helpers of an earlier call, they are just leaving
+        std::this_thread::yield();
+
+    state.body = &body;
+    state.count = count;
+    state.nextIndex = 0;
+    state.finishedCount = 0;
+    state.failed = false;
+    state.firstException = nullptr;
+
+    const auto helpersCount = std::min<std::size_t>(count - 1, size());
+    for (std::size_t i = 0; i < helpersCount; ++i)
+    {
+        // a pointer and a number are stored inside std::function, without allocation
+        submit(
+            [statePointer = &state, callGeneration]
+            {
+                statePointer->runAsHelper(callGeneration);
+            });
+    }
+
+    state.runItems();
+
+    {
+        std::unique_lock lock(state.mutex);
+        state.allFinished.wait(lock,
+                               [&state]
+                               {
+                                   return state.finishedCount.load() == state.count;
+                               });
+    }
+
+    auto exception = std::exchange(state.firstException, nullptr);
+    state.inUse = false;
+    if (exception)
+        std::rethrow_exception(exception);
+}
@@ -0,0 +1,107 @@
+/** @file ThreadPool.h
+ * @brief Declaration of the ThreadPool class - long-lived worker threads with work stealing.
+ *
+ * The pool is created once (e.g. by ModelReader) and reused for every step, so changing
+ * the visible step costs only the work itself, not creating and destroying OS threads. */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/** @class ThreadPool
+ * @brief Fixed-size pool of worker threads, each one with its own task queue.
+ *
+ * Tasks submitted from outside the pool are distributed round-robin between worker queues,
+ * tasks submitted from a worker go to its own queue. A worker without work steals tasks
+ * from the other queues, so one long task never leaves the remaining cores idle.
+ *
+ * Queueing and parallelFor() do not allocate in the steady state: queues keep their capacity and the shared
+ * state of parallelFor() is reused, so a pool used for every step does not contend for the heap.
+ *
+ * @note The class is neither copyable nor movable - workers keep a pointer to the pool. */
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /** @brief Starts the workers.
+     *  @param threadCount Number of worker threads, 0 means defaultThreadCount() */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /// @brief Finishes all already submitted tasks and joins the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Number of threads matching the hardware (at least 1).
+    static unsigned defaultThreadCount();
+
+    /// @brief Number of worker threads in the pool
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    /// @brief Schedules the task for execution, it does not wait for the result.
+    void submit(Task task);
+
+    /** @brief Calls body(i) for every i in [0, count) and waits until all calls are finished.
+     *
+     * Indices are handed out dynamically one by one, so big items do not block small ones.
+     * The calling thread takes part in the work, which makes nested calls (from inside a task)
+     * safe even when all workers are busy.
+     *
+     * @param count Number of items to process
+     * @param body Function called for each item index
+     * @throws Rethrows the first exception thrown by the body (remaining items are skipped) */
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    /// @brief Index of the calling thread among the workers of this pool, std::nullopt for any other thread
+    std::optional<unsigned> workerIndex() const;
+
+private:
+    /// Ring buffer of tasks, it only grows (std::deque would allocate and free its blocks as tasks pass through)
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::vector<Task> slots;
+        std::size_t first = 0; ///< slot of the oldest task
+        std::size_t count = 0;
+
+        void pushBack(Task task);
+        Task popBack();
+        Task popFront();
+    };
+
+    /// State of one parallelFor() call shared with its helper tasks, reused by later calls
+    struct ParallelForState;
+
+    /// @brief Takes an unused state from parallelForStates (a new one only when all are in use by running calls)
+    ParallelForState& acquireParallelForState();
+
+    void workerLoop(unsigned workerIndex);
+
+    /// @brief Takes the newest task from own queue or steals the oldest one from other queues
+    bool tryTakeTask(unsigned workerIndex, Task& task);
+
+    std::mutex parallelForStatesMutex;
+    std::vector<std::unique_ptr<ParallelForState>> parallelForStates; ///< destroyed after the workers are joined
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::jthread> workers;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<std::size_t> pendingTasks{};
+    std::atomic<unsigned> nextQueue{};
+    bool stopping = false; ///< guarded by wakeMutex
+};
@@ -0,0 +1,135 @@
+/** @file WorkerArenas.h
+ * @brief Declaration of the WorkerArenas class template - scratch objects reused by the threads of a ThreadPool. */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility> // std::move
+#include <vector>
+
+#include "ThreadPool.h"
+
+/** @class WorkerArenas
+ * @brief One scratch object (e.g. a set of buffers) per worker of a ThreadPool, reused for all the work done by it.
+ *
+ * Memory in the objects keeps its capacity between uses, so after the first use (which grows the buffers)
+ * work needs no heap allocations, and workers do not contend in the allocator. A worker takes its own object
+ * without any locking. Other threads taking part in the work (e.g. the thread calling ThreadPool::parallelFor())
+ * get spare objects from a list guarded by a mutex, created on their first use.
+ *
+ * Unlike thread_local buffers, the memory can be released with clear() (e.g. when a stage is closed).
+ *
+ * @tparam T Default constructible type of the scratch objects */
+template<class T>
+class WorkerArenas
+{
+public:
+    /** @class Lease
+     * @brief Scratch object taken by acquire(), given back when the lease is destroyed. */
+    class Lease
+    {
+    public:
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease()
+        {
+            if (spare)
+                arenas.giveBack(std::move(spare));
+            else
+                *workerObjectInUse = false;
+        }
+
+        T& operator*() const
+        {
+            return *object;
+        }
+
+        T* operator->() const
+        {
+            return object;
+        }
+
+    private:
+        friend class WorkerArenas;
+
+        Lease(WorkerArenas& arenas, T* object, bool* workerObjectInUse, std::unique_ptr<T> spare)
+            : arenas{ arenas }
+            , object{ object }
+            , workerObjectInUse{ workerObjectInUse }
+            , spare{ std::move(spare) }
+        {
+        }
+
+        WorkerArenas& arenas;
+        T* object;
+        bool* workerObjectInUse; ///< flag of the worker's own object, nullptr for a spare one
+        std::unique_ptr<T> spare;
+    };
+
+    /// @param pool Pool whose workers get their own objects (it has to outlive the arenas)
+    explicit WorkerArenas(const ThreadPool& pool)
+        : pool{ pool }
+        , workerSlots(pool.size())
+    {
+    }
+
+    WorkerArenas(const WorkerArenas&) = delete;
+    WorkerArenas& operator=(const WorkerArenas&) = delete;
+
+    /** @brief Takes the calling worker's object, or a spare one on other threads.
+     *  A worker taking a second object while it holds its own (nested use) gets a spare one too. */
+    Lease acquire()
+    {
+        if (const auto worker = pool.workerIndex(); worker && ! workerSlots[*worker].inUse)
+        {
+            auto& slot = workerSlots[*worker];
+            slot.inUse = true;
+            return Lease(*this, &slot.object, &slot.inUse, nullptr);
+        }
+
+        std::unique_ptr<T> spare;
+        {
+            std::lock_guard lock(sparesMutex);
+            if (! spares.empty())
+            {
+                spare = std::move(spares.back());
+                spares.pop_back();
+            }
+        }
+        if (! spare)
+            spare = std::make_unique<T>();
+        T* object = spare.get();
+        return Lease(*this, object, nullptr, std::move(spare));
+    }
+
+    /** @brief Releases memory of all objects (they are created again empty).
+     *  @note No lease may be held by a worker at the time, spare objects in use are kept by their threads. */
+    void clear()
+    {
+        for (auto& slot : workerSlots)
+            slot.object = T{};
+
+        std::lock_guard lock(sparesMutex);
+        spares.clear();
+    }
+
+private:
+    struct alignas(64) WorkerSlot // own cache line: workers write their flags without disturbing each other
+    {
+        T object{};
+        bool inUse = false; ///< only accessed by the worker owning the slot
+    };
+
+    void giveBack(std::unique_ptr<T> spare)
+    {
+        std::lock_guard lock(sparesMutex);
+        spares.push_back(std::move(spare)); // capacity of the list is kept, so no allocation after the first uses
+    }
+
+    const ThreadPool& pool;
+    std::vector<WorkerSlot> workerSlots;
+    std::mutex sparesMutex;
+    std::vector<std::unique_ptr<T>> spares;
+};
@@ -55,4 +55,6 @@ struct ColumnAndRow
     {
         return row;
     }
+
+    bool operator==(const ColumnAndRow&) const = default;
 };
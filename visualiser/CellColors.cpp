@@ -0,0 +1,153 @@
+/** @file CellColors.cpp
+ * @brief Implementation of the levels of detail of grid colours. */
+
+#include "CellColors.h"
+
+#include <cmath> // std::isnan
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+
+ColorReduction colorReductionFromName(std::string_view name)
+{
+    if (name.empty() || "average" == name)
+        return ColorReduction::Average;
+    if ("max" == name)
+        return ColorReduction::Max;
+    throw std::invalid_argument(std::format("Unknown colour reduction '{}' (expected 'average' or 'max')", name));
+}
+
+namespace
+{
+/** @brief Halves the colours in both directions (odd last row / column is reduced alone).
+ *  Rows are in VTK image order, so one block is made of image rows 2r and 2r + 1, same as in the matrix. */
+std::vector<unsigned char> halveColors(std::span<const unsigned char> rgb, int rows, int columns, int halvedRows, int halvedColumns, ColorReduction reduction)
+{
+    std::vector<unsigned char> halved(static_cast<std::size_t>(halvedRows) * halvedColumns * 3);
+    for (int r = 0; r < halvedRows; ++r)
+    {
+        const int firstRow = 2 * r;
+        const int rowsInBlock = std::min(2, rows - firstRow);
+        unsigned char* halvedRow = halved.data() + static_cast<std::size_t>(r) * halvedColumns * 3;
+
+        for (int c = 0; c < halvedColumns; ++c)
+        {
+            const int firstColumn = 2 * c;
+            const int columnsInBlock = std::min(2, columns - firstColumn);
+
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                unsigned sum = 0;
+                unsigned char maximum = 0;
+                for (int blockRow = 0; blockRow < rowsInBlock; ++blockRow)
+                {
+                    const unsigned char* source = rgb.data() + (static_cast<std::size_t>(firstRow + blockRow) * columns + firstColumn) * 3 + channel;
+                    for (int blockColumn = 0; blockColumn < columnsInBlock; ++blockColumn)
+                    {
+                        sum += source[3 * blockColumn];
+                        maximum = std::max(maximum, source[3 * blockColumn]);
+                    }
+                }
+
+                const unsigned cellsInBlock = rowsInBlock * columnsInBlock;
+                halvedRow[3 * c + channel] = (ColorReduction::Max == reduction) ? maximum
+                                                                                : static_cast<unsigned char>((sum + cellsInBlock / 2) / cellsInBlock);
+            }
+        }
+    }
+    return halved;
+}
+
+/** @brief Halves raw values in both directions, the same blocks as halveColors(), NaN values are skipped. */
+std::vector<float> halveScalars(std::span<const float> scalars, int rows, int columns, int halvedRows, int halvedColumns, ColorReduction reduction)
+{
+    std::vector<float> halved(static_cast<std::size_t>(halvedRows) * halvedColumns);
+    for (int r = 0; r < halvedRows; ++r)
+    {
+        const int firstRow = 2 * r;
+        const int rowsInBlock = std::min(2, rows - firstRow);
+        float* halvedRow = halved.data() + static_cast<std::size_t>(r) * halvedColumns;
+
+        for (int c = 0; c < halvedColumns; ++c)
+        {
+            const int firstColumn = 2 * c;
+            const int columnsInBlock = std::min(2, columns - firstColumn);
+
+            double sum = 0;
+            float maximum = std::numeric_limits<float>::lowest();
+            unsigned numbers = 0;
+            for (int blockRow = 0; blockRow < rowsInBlock; ++blockRow)
+            {
+                const float* source = scalars.data() + static_cast<std::size_t>(firstRow + blockRow) * columns + firstColumn;
+                for (int blockColumn = 0; blockColumn < columnsInBlock; ++blockColumn)
+                {
+                    const float value = source[blockColumn];
+                    if (std::isnan(value))
+                        continue;
+                    sum += value;
+                    maximum = std::max(maximum, value);
+                    ++numbers;
+                }
+            }
+
+            if (0 == numbers)
+                halvedRow[c] = std::numeric_limits<float>::quiet_NaN();
+            else
+                halvedRow[c] = (ColorReduction::Max == reduction) ? maximum : static_cast<float>(sum / numbers);
+        }
+    }
+    return halved;
+}
+
+/** @brief Halves the finest texels until both dimensions are at most LEVEL_OF_DETAIL_MIN_GRID_SIZE / 4.
+ *  @param texels Member of ColorLevel which keeps the texels (colours or raw values) */
+template<typename T, typename Halve>
+std::vector<ColorLevel> buildPyramid(std::span<const T> finest, int nRows, int nCols, std::shared_ptr<const std::vector<T>> ColorLevel::*texels, Halve halve)
+{
+    std::vector<ColorLevel> levels;
+    if (std::max(nRows, nCols) <= LEVEL_OF_DETAIL_MIN_GRID_SIZE)
+        return levels;
+
+    std::span<const T> finer = finest;
+    int finerRows = nRows;
+    int finerColumns = nCols;
+    for (int factor = 2; std::max(finerRows, finerColumns) > LEVEL_OF_DETAIL_MIN_GRID_SIZE / 4; factor *= 2)
+    {
+        const int rows = (finerRows + 1) / 2;
+        const int columns = (finerColumns + 1) / 2;
+
+        ColorLevel level{ .factor = factor, .rows = rows, .columns = columns, .colors = {}, .scalars = {} };
+        level.*texels = std::make_shared<const std::vector<T>>(halve(finer, finerRows, finerColumns, rows, columns));
+        levels.push_back(std::move(level));
+        finer = *(levels.back().*texels);
+        finerRows = rows;
+        finerColumns = columns;
+    }
+    return levels;
+}
+} // namespace
+
+std::vector<ColorLevel> buildColorPyramid(std::span<const unsigned char> rgb, int nRows, int nCols, ColorReduction reduction)
+{
+    return buildPyramid(rgb,
+                        nRows,
+                        nCols,
+                        &ColorLevel::colors,
+                        [reduction](std::span<const unsigned char> finer, int rows, int columns, int halvedRows, int halvedColumns)
+                        {
+                            return halveColors(finer, rows, columns, halvedRows, halvedColumns, reduction);
+                        });
+}
+
+std::vector<ColorLevel> buildScalarPyramid(std::span<const float> scalars, int nRows, int nCols, ColorReduction reduction)
+{
+    return buildPyramid(scalars,
+                        nRows,
+                        nCols,
+                        &ColorLevel::scalars,
+                        [reduction](std::span<const float> finer, int rows, int columns, int halvedRows, int halvedColumns)
+                        {
+                            return halveScalars(finer, rows, columns, halvedRows, halvedColumns, reduction);
+                        });
+}
@@ -0,0 +1,159 @@
+/** @file CellColors.h
+ * @brief Conversion of cells into RGB bytes shown by the grid texture (independent of VTK). */
+
+#pragma once
+
+#include <algorithm> // std::clamp
+#include <cmath>     // std::lround
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "visualiser/SubstateColumns.h" // cellSubstateValue
+
+/** @concept CellWithRowColoring
+ * @brief Cell type which can colour a whole row of cells at once (optional hook of a model).
+ *
+ * Such a type provides a static function writing 3 bytes (red, green, blue in range 0–255) per cell:
+ * @code
+ * static void outputColorRow(std::span<const MyCell> cells, unsigned char* rgb);
+ * @endcode
+ * It is called instead of outputValue() for every cell, so the model can provide a tight,
+ * non-virtual loop which the compiler can vectorise. */
+template<typename Cell>
+concept CellWithRowColoring = requires(std::span<const Cell> cells, unsigned char* rgb) {
+    Cell::outputColorRow(cells, rgb);
+};
+
+/** @brief Converts a color channel value to a normalized range [0, 1].
+ *
+ * This function is designed to be forward-compatible with upcoming changes in OOpenCal.
+ * Currently, OOpenCal provides color values in the 0–255 integer range. VTK, however,
+ * expects normalized double precision values in the 0–1 range.
+ *
+ * If the input value is greater than 1, it is assumed to be in the 0–255 range
+ * and will be scaled down to [0, 1]. If the value is already in the [0, 1] range
+ * (future OOpenCal format), it will be returned unchanged.
+ *
+ * @param channel The input color component (either in 0–255 or already in 0–1).
+ * @return Normalized color value in the range [0, 1]. */
+inline double toUnitColor(double channel)
+{
+    // Backward compatibility: if value is > 1, assume 0–255 format and scale.
+    if (channel > 1.0)
+        return channel / 255.0;
+
+    // Already normalized (future format) — return as-is.
+    return channel;
+}
+
+/** @brief Converts a color channel value (in any format accepted by toUnitColor()) to a byte [0, 255].
+ * @param channel The input color component (either in 0–255 or already in 0–1).
+ * @return Color value in the range [0, 255]. */
+inline unsigned char toColorByte(double channel)
+{
+    return static_cast<unsigned char>(std::lround(std::clamp(toUnitColor(channel), 0.0, 1.0) * 255.0));
+}
+
+/** @brief Writes RGB colours (3 bytes per cell) of a rectangle of cells into the colours of the whole grid.
+ *
+ * The colours are in VTK image order (rows flipped), 3 * nCols bytes per row; bytes outside the rectangle are not touched.
+ * It does not touch VTK, so the colours can be computed by a decoding thread.
+ * @param p Cells of the whole grid (at least nRows x nCols)
+ * @param firstRow, firstCol Top left cell of the rectangle (in matrix coordinates)
+ * @param rowsCount, colsCount Size of the rectangle, it has to be inside nRows x nCols */
+template<class Matrix>
+void writeCellColorsOfRegion(const Matrix& p, int nRows, int nCols, int firstRow, int firstCol, int rowsCount, int colsCount, unsigned char* rgb)
+{
+    using Cell = typename Matrix::value_type;
+
+    for (int r = firstRow; r < firstRow + rowsCount; ++r)
+    {
+        const auto row = p[r].subspan(firstCol, colsCount); // row view of contiguous storage - cells are read linearly
+        unsigned char* rowRgb = rgb + (static_cast<std::size_t>(nRows - 1 - r) * nCols + firstCol) * 3;
+
+        if constexpr (CellWithRowColoring<Cell>)
+        {
+            Cell::outputColorRow(row, rowRgb);
+        }
+        else
+        {
+            for (int c = 0; c < colsCount; ++c)
+            {
+                // qualified call: the matrix keeps exactly Cell objects, so the virtual dispatch is not needed
+                const auto color = row[c].Cell::outputValue(nullptr);
+                rowRgb[3 * c + 0] = toColorByte(color.getRed());
+                rowRgb[3 * c + 1] = toColorByte(color.getGreen());
+                rowRgb[3 * c + 2] = toColorByte(color.getBlue());
+            }
+        }
+    }
+}
+
+/// @brief Writes RGB colours (3 bytes per cell) of the first nRows x nCols cells in VTK image order (rows flipped)
+template<class Matrix>
+void writeCellColors(const Matrix& p, int nRows, int nCols, unsigned char* rgb)
+{
+    writeCellColorsOfRegion(p, nRows, nCols, 0, 0, nRows, nCols, rgb);
+}
+
+/** @brief Writes raw values of the substate (one float per cell) of a rectangle of cells into the values of the whole grid.
+ *
+ * It is the scalar counterpart of writeCellColorsOfRegion() (the same VTK image order), used when the colours
+ * are applied on the GPU (the `color_substate` setting). Values which are not numbers are written as NaN. */
+template<class Matrix>
+void writeCellScalarsOfRegion(const Matrix& p, const char* substate, int nRows, int nCols, int firstRow, int firstCol, int rowsCount, int colsCount, float* scalars)
+{
+    for (int r = firstRow; r < firstRow + rowsCount; ++r)
+    {
+        const auto row = p[r].subspan(firstCol, colsCount);
+        float* rowScalars = scalars + static_cast<std::size_t>(nRows - 1 - r) * nCols + firstCol;
+        for (const auto& cell : row)
+            *rowScalars++ = static_cast<float>(cellSubstateValue(cell, substate));
+    }
+}
+
+/// @brief How a block of cells is reduced to one texel of a coarser level of detail
+enum class ColorReduction
+{
+    Average, ///< mean of every channel (smooth, small features fade)
+    Max      ///< maximum of every channel (small bright features stay visible)
+};
+
+/** @brief Parses reduction name used in config files ("average" or "max", empty means the default "average").
+ *  @throws std::invalid_argument For other names */
+ColorReduction colorReductionFromName(std::string_view name);
+
+/** @struct ColorLevel
+ * @brief Colours of the grid downsampled by a power of two (one texel per factor x factor block of cells). */
+struct ColorLevel
+{
+    int factor;  ///< cells per texel in each direction
+    int rows;    ///< texel rows, ceil(grid rows / factor)
+    int columns; ///< texel columns, ceil(grid columns / factor)
+    std::shared_ptr<const std::vector<unsigned char>> colors; ///< RGB in VTK image order (rows flipped)
+    std::shared_ptr<const std::vector<float>> scalars;        ///< raw values instead of colours (see buildScalarPyramid())
+};
+
+/// Grids at most this big in both directions are always shown in full resolution (no pyramid is built)
+inline constexpr int LEVEL_OF_DETAIL_MIN_GRID_SIZE = 2048;
+
+/// Texture size supported by common GPUs, bigger grids are shown at a level of detail fitting into it
+inline constexpr int LEVEL_OF_DETAIL_MAX_TEXTURE_SIZE = 16384;
+
+/** @brief Builds coarser levels of detail of full resolution colours (factors 2, 4, 8, ...).
+ *
+ * Every level halves the previous one, until both dimensions are at most LEVEL_OF_DETAIL_MIN_GRID_SIZE / 4.
+ * Nothing is built for grids up to LEVEL_OF_DETAIL_MIN_GRID_SIZE. The levels together take at most
+ * a third of the memory of the full resolution colours.
+ * @param rgb Full resolution colours, nRows * nCols * 3 bytes in VTK image order
+ * @return Levels from the finest (factor 2) to the coarsest */
+std::vector<ColorLevel> buildColorPyramid(std::span<const unsigned char> rgb, int nRows, int nCols, ColorReduction reduction);
+
+/** @brief Builds coarser levels of detail of raw values of cells (see writeCellScalarsOfRegion()), as buildColorPyramid() does.
+ *
+ * Blocks are reduced by the mean or the maximum of their values, NaN values are ignored (a block of NaN values is NaN).
+ * @return Levels with ColorLevel::scalars set, from the finest (factor 2) to the coarsest */
+std::vector<ColorLevel> buildScalarPyramid(std::span<const float> scalars, int nRows, int nCols, ColorReduction reduction);
@@ -0,0 +1,44 @@
+/** @file CellProbe.cpp
+ * @brief Implementation of the time series of probed cells. */
+
+#include "CellProbe.h"
+
+#include <algorithm> // std::min, std::max
+#include <cmath>     // std::isfinite
+#include <format>
+#include <limits>
+
+
+CellRegion CellProbeRequest::window() const
+{
+    return CellRegion{ .firstRow = row - radius, .firstColumn = column - radius, .rows = 2 * radius + 1, .columns = 2 * radius + 1 };
+}
+
+std::string CellProbeRequest::description() const
+{
+    const auto cell = radius > 0 ? std::format("cell ({}, {}) ±{}", row, column, radius) : std::format("cell ({}, {})", row, column);
+    return std::format("{} of {} in steps {}-{}", substate, cell, firstStep, lastStep);
+}
+
+void CellProbeSeries::add(StepIndex step, std::span<const double> values)
+{
+    double sum = 0;
+    std::size_t count = 0;
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+    for (const auto value : values)
+    {
+        if (! std::isfinite(value))
+            continue;
+        sum += value;
+        ++count;
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    constexpr double NOT_A_NUMBER = std::numeric_limits<double>::quiet_NaN();
+    steps.push_back(step);
+    means.push_back(count > 0 ? sum / count : NOT_A_NUMBER);
+    minimums.push_back(count > 0 ? minimum : NOT_A_NUMBER);
+    maximums.push_back(count > 0 ? maximum : NOT_A_NUMBER);
+}
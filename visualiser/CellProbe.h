@@ -0,0 +1,49 @@
+/** @file CellProbe.h
+ * @brief Time series of a substate of a cell (or of a small window around it) over the steps of a range. */
+
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "utilities/StepLayout.h" // CellRegion
+#include "utilities/types.h"
+
+/** @struct CellProbeRequest
+ * @brief Probed cell, its window and the substate and steps of a probe. */
+struct CellProbeRequest
+{
+    std::string substate;
+    int row{};            ///< of the probed cell, matrix coordinates (row 0 is the first row of the matrix)
+    int column{};
+    int radius{};         ///< the window takes cells at most radius apart from the probed one in both directions (0: only the cell)
+    StepIndex firstStep{};
+    StepIndex lastStep{}; ///< inclusive
+
+    /// @brief Cells of the window, not clipped to the grid
+    CellRegion window() const;
+
+    /// @brief Short text describing the probe, e.g. "h of cell (12, 40) ±1 in steps 0-4000"
+    std::string description() const;
+};
+
+/** @struct CellProbeSeries
+ * @brief Mean, minimum and maximum of the substate in the window of the probe in every probed step. */
+struct CellProbeSeries
+{
+    CellProbeRequest request;
+    std::vector<StepIndex> steps; ///< ascending
+    std::vector<double> means;    ///< NaN in steps without any numeric value in the window (same for minimums and maximums)
+    std::vector<double> minimums;
+    std::vector<double> maximums;
+
+    /** @brief Appends the step with values of the cells of the window in it.
+     *  Values which are not finite (e.g. a substate which is not a number) are ignored. */
+    void add(StepIndex step, std::span<const double> values);
+
+    std::size_t size() const
+    {
+        return steps.size();
+    }
+};
@@ -0,0 +1,201 @@
+/** @file CellReductions.cpp
+ * @brief Implementation of the reductions of substates of cells. */
+
+#include "CellReductions.h"
+
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <utility> // std::move
+
+
+namespace
+{
+constexpr std::array<std::pair<std::string_view, ReductionOperation>, 5> OPERATION_NAMES{ {
+    { "sum", ReductionOperation::Sum },
+    { "min", ReductionOperation::Min },
+    { "max", ReductionOperation::Max },
+    { "mean", ReductionOperation::Mean },
+    { "count", ReductionOperation::Count },
+} };
+
+/// @brief Calls function for every comma separated item of the list, without surrounding spaces (empty items are skipped)
+template<typename Function>
+void forEachListItem(std::string_view list, Function function)
+{
+    while (! list.empty())
+    {
+        const auto comma = list.find(',');
+        auto item = list.substr(0, comma);
+        list = (comma == std::string_view::npos) ? std::string_view{} : list.substr(comma + 1);
+
+        while (! item.empty() && ' ' == item.front())
+            item.remove_prefix(1);
+        while (! item.empty() && ' ' == item.back())
+            item.remove_suffix(1);
+        if (! item.empty())
+            function(item);
+    }
+}
+} // namespace
+
+std::vector<ReductionOperation> reductionOperationsFromList(std::string_view list)
+{
+    std::vector<ReductionOperation> operations;
+    forEachListItem(list,
+                    [&operations](std::string_view name)
+                    {
+                        for (const auto& [knownName, operation] : OPERATION_NAMES)
+                        {
+                            if (knownName == name)
+                            {
+                                operations.push_back(operation);
+                                return;
+                            }
+                        }
+                        throw std::invalid_argument(std::format("Unknown reduction '{}' (expected sum, min, max, mean or count)", name));
+                    });
+    return operations;
+}
+
+std::string_view reductionOperationName(ReductionOperation operation)
+{
+    for (const auto& [name, knownOperation] : OPERATION_NAMES)
+    {
+        if (knownOperation == operation)
+            return name;
+    }
+    return "?";
+}
+
+std::vector<std::string> substateNamesFromList(std::string_view list)
+{
+    std::vector<std::string> names;
+    forEachListItem(list,
+                    [&names](std::string_view name)
+                    {
+                        names.emplace_back(name);
+                    });
+    return names;
+}
+
+
+double ReductionAccumulator::value(ReductionOperation operation) const
+{
+    constexpr double NO_VALUE = std::numeric_limits<double>::quiet_NaN();
+    switch (operation)
+    {
+    case ReductionOperation::Sum:
+        return sum;
+    case ReductionOperation::Min:
+        return count ? min : NO_VALUE;
+    case ReductionOperation::Max:
+        return count ? max : NO_VALUE;
+    case ReductionOperation::Mean:
+        return count ? sum / static_cast<double>(count) : NO_VALUE;
+    case ReductionOperation::Count:
+        return static_cast<double>(count);
+    }
+    return NO_VALUE;
+}
+
+void ReductionAccumulator::addValues(std::span<const double> values)
+{
+    ReductionAccumulator part;
+    for (const double value : values)
+    {
+        const bool finite = std::isfinite(value);
+        part.count += finite;
+        part.sum += finite ? value : 0.0;
+        part.min = (finite && value < part.min) ? value : part.min;
+        part.max = (finite && value > part.max) ? value : part.max;
+    }
+    merge(part);
+}
+
+
+bool StepReductions::hasSubstates(const std::vector<std::string>& names) const
+{
+    if (names.size() != substates.size())
+        return false;
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        if (names[i] != substates[i].substate)
+            return false;
+    }
+    return true;
+}
+
+std::size_t StepReductions::memoryUsage() const
+{
+    std::size_t bytes = sizeof(*this);
+    for (const auto& substate : substates)
+        bytes += sizeof(substate) + (substate.perNode.size() + substate.perRow.size()) * sizeof(ReductionAccumulator);
+    return bytes;
+}
+
+
+StepReductionsBuilder::StepReductionsBuilder(std::vector<std::string> substates, std::size_t nodesCount, int gridRows, const StepReductions* base)
+    : substateNames{ std::move(substates) }
+    , gridRows{ gridRows }
+    , base{ (base && base->hasSubstates(substateNames)) ? base : nullptr }
+    , nodes(nodesCount)
+{
+}
+
+void StepReductionsBuilder::reduceNode(const SubstateColumns& columns, NodeIndex node, const CellRegion& region)
+{
+    const auto substatesCount = substateNames.size();
+    auto& reductions = nodes[node];
+    reductions.firstRow = region.firstRow;
+    reductions.perSubstate.assign(substatesCount, {});
+    reductions.perRow.assign(static_cast<std::size_t>(region.rows) * substatesCount, {});
+
+    for (std::size_t s = 0; s < substatesCount; ++s)
+    {
+        for (int row = 0; row < region.rows; ++row)
+        {
+            auto& rowAccumulator = reductions.perRow[static_cast<std::size_t>(row) * substatesCount + s];
+            rowAccumulator.addValues(columns.row(s, region.firstRow + row).subspan(region.firstColumn, region.columns));
+            reductions.perSubstate[s].merge(rowAccumulator);
+        }
+    }
+    reductions.reduced = true;
+}
+
+StepReductions StepReductionsBuilder::build(bool complete) const
+{
+    StepReductions reductions;
+    reductions.complete = complete;
+    reductions.substates.resize(substateNames.size());
+
+    for (std::size_t s = 0; s < substateNames.size(); ++s)
+    {
+        auto& substate = reductions.substates[s];
+        if (base && base->substates[s].perNode.size() == nodes.size() && base->substates[s].perRow.size() == static_cast<std::size_t>(gridRows))
+        {
+            substate = base->substates[s]; // its nodes are disjoint with the nodes reduced now
+        }
+        else
+        {
+            substate.perNode.assign(nodes.size(), {});
+            substate.perRow.assign(static_cast<std::size_t>(gridRows), {});
+        }
+        substate.substate = substateNames[s];
+
+        for (std::size_t node = 0; node < nodes.size(); ++node)
+        {
+            const auto& nodeReductions = nodes[node];
+            if (! nodeReductions.reduced)
+                continue;
+
+            substate.perNode[node] = nodeReductions.perSubstate[s];
+            substate.global.merge(nodeReductions.perSubstate[s]);
+
+            const auto rowsCount = nodeReductions.perRow.size() / substateNames.size();
+            for (std::size_t row = 0; row < rowsCount; ++row)
+                substate.perRow[nodeReductions.firstRow + row].merge(nodeReductions.perRow[row * substateNames.size() + s]);
+        }
+    }
+    return reductions;
+}
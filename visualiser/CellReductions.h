@@ -0,0 +1,137 @@
+/** @file CellReductions.h
+ * @brief Reductions (sum, minimum, maximum, ...) of substates of cells: per step, per node and per row of the grid. */
+
+#pragma once
+
+#include <cmath> // std::isfinite
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utilities/StepLayout.h" // CellRegion
+#include "utilities/types.h"
+#include "visualiser/SubstateColumns.h"
+
+/// @brief Operation computed by the reduction engine (names as in the `reduction` setting of config files)
+enum class ReductionOperation
+{
+    Sum,
+    Min,
+    Max,
+    Mean,
+    Count ///< number of cells with a numeric value
+};
+
+/** @brief Parses comma separated list of operations, e.g. "sum,min,max" (spaces around names are ignored).
+ *  @throws std::invalid_argument For unknown names */
+std::vector<ReductionOperation> reductionOperationsFromList(std::string_view list);
+
+/// @brief Name of the operation used in config files
+std::string_view reductionOperationName(ReductionOperation operation);
+
+/// @brief Splits comma separated substate names, e.g. "h,z" (empty names are skipped)
+std::vector<std::string> substateNamesFromList(std::string_view list);
+
+/** @struct ReductionAccumulator
+ * @brief Running count, sum, minimum and maximum of values; accumulators of disjoint parts merge into the whole. */
+struct ReductionAccumulator
+{
+    std::uint64_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    /// @brief Adds the value, not finite values (e.g. a substate which is not a number) are ignored
+    void add(double value)
+    {
+        if (! std::isfinite(value))
+            return;
+        ++count;
+        sum += value;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+    }
+
+    /// @brief Adds all values (a loop without calls, which the compiler can vectorise)
+    void addValues(std::span<const double> values);
+
+    void merge(const ReductionAccumulator& other)
+    {
+        count += other.count;
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+    }
+
+    /// @brief Result of the operation, NaN for minimum, maximum and mean of no values
+    double value(ReductionOperation operation) const;
+};
+
+/// @brief Reductions of one substate
+struct SubstateReductions
+{
+    std::string substate;
+    ReductionAccumulator global;
+    std::vector<ReductionAccumulator> perNode; ///< empty accumulator for nodes which were not read
+    std::vector<ReductionAccumulator> perRow;  ///< rows of the whole grid (matrix order)
+};
+
+/** @struct StepReductions
+ * @brief Reductions of all requested substates of one step. */
+struct StepReductions
+{
+    std::vector<SubstateReductions> substates;
+
+    /// False when only nodes around the visible part of the grid were read (see SettingParameter::regionOfInterest)
+    bool complete = false;
+
+    /// @brief Whether reductions of the same substates (in the same order) are computed
+    bool hasSubstates(const std::vector<std::string>& names) const;
+
+    /// @brief Approximate number of bytes occupied (used for the step cache budget)
+    std::size_t memoryUsage() const;
+};
+
+/** @class StepReductionsBuilder
+ * @brief Collects reductions node by node while a step is being read, then merges them into StepReductions.
+ *
+ * Every node has its own accumulators, so reduceNode() can be called for different nodes from many threads
+ * (right after the node's substates are extracted into SubstateColumns, while they are still in the CPU cache)
+ * without any locking.
+ * build() then merges the per-node results on the calling thread. */
+class StepReductionsBuilder
+{
+public:
+    /** @param substates Names of substates to reduce
+     *  @param nodesCount Number of nodes of the stage
+     *  @param gridRows Rows of the whole grid
+     *  @param base Reductions of the same step read for a smaller region: its nodes are kept, only new ones are added */
+    StepReductionsBuilder(std::vector<std::string> substates, std::size_t nodesCount, int gridRows, const StepReductions* base = nullptr);
+
+    /** @brief Reduces values of the node's cells (region clipped to the grid). Thread-safe for different nodes.
+     *  @param columns Values of the cells, with the substates given to the constructor
+     *  @note A node has to be reduced at most once */
+    void reduceNode(const SubstateColumns& columns, NodeIndex node, const CellRegion& region);
+
+    /** @brief Merges the nodes (on the calling thread, after all reduceNode() calls returned).
+     *  @param complete Whether all nodes of the stage were read */
+    StepReductions build(bool complete) const;
+
+private:
+    struct NodeReductions
+    {
+        bool reduced = false;
+        int firstRow = 0;
+        std::vector<ReductionAccumulator> perSubstate;
+        std::vector<ReductionAccumulator> perRow; ///< row by row, substates of one row next to each other
+    };
+
+    std::vector<std::string> substateNames;
+    int gridRows;
+    const StepReductions* base;
+    std::vector<NodeReductions> nodes;
+};
@@ -0,0 +1,110 @@
+/** @file FrameColors.cpp
+ * @brief Implementation of the FrameColors class. */
+
+#include <algorithm> // std::clamp, std::min, std::max
+#include <cmath>     // std::isfinite
+#include <cstddef>
+#include <cstring> // std::memcpy
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include "visualiser/CellColors.h" // toColorByte
+#include "visualiser/FrameColors.h"
+#include "widgets/ColorSettings.h"
+
+
+FrameColors::FrameColors()
+{
+    const auto& settings = ColorSettings::instance();
+    lowColor = settings.scalarLowColor();
+    highColor = settings.scalarHighColor();
+    backgroundColor = settings.backgroundColor();
+    if (! settings.hasAutomaticScalarRange())
+        fixedRange.emplace(static_cast<float>(settings.scalarMinimum()), static_cast<float>(settings.scalarMaximum()));
+}
+
+int FrameColors::width(const StepFrame& frame)
+{
+    const int levelFactor = std::max(frame.levelFactor, 1);
+    return (frame.columns + levelFactor - 1) / levelFactor;
+}
+
+int FrameColors::height(const StepFrame& frame)
+{
+    const int levelFactor = std::max(frame.levelFactor, 1);
+    return (frame.rows + levelFactor - 1) / levelFactor;
+}
+
+void FrameColors::write(const StepFrame& frame, unsigned char* rgb)
+{
+    if (! frame.colors && ! frame.scalars)
+    {
+        throw std::invalid_argument(std::format("Step {} has neither colours nor raw values of cells", frame.step));
+    }
+
+    // texels are in VTK image order (the first row at the bottom), which is the order of vtkImageData
+    const int width = FrameColors::width(frame);
+    const int height = FrameColors::height(frame);
+    const auto texels = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+
+    if (frame.colors)
+    {
+        if (frame.colors->size() != 3 * texels)
+        {
+            throw std::invalid_argument(std::format("Colours of step {} do not match the grid of {}x{} texels", frame.step, width, height));
+        }
+        std::memcpy(rgb, frame.colors->data(), frame.colors->size());
+        return;
+    }
+
+    const auto& scalars = *frame.scalars;
+    if (scalars.size() != texels)
+    {
+        throw std::invalid_argument(std::format("Raw values of step {} do not match the grid of {}x{} texels", frame.step, width, height));
+    }
+
+    if (! fixedRange && ! automaticRange)
+    {
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+        for (const float value : scalars)
+        {
+            if (std::isfinite(value))
+            {
+                minimum = std::min(minimum, value);
+                maximum = std::max(maximum, value);
+            }
+        }
+        if (minimum <= maximum) // otherwise no value is known yet
+            automaticRange.emplace(minimum, maximum);
+    }
+    auto range = fixedRange ? *fixedRange : automaticRange.value_or(std::pair{ 0.f, 1.f });
+    if (range.first == range.second) // e.g. a constant step: all cells get the low colour
+        range.second = range.first + 1;
+
+    for (std::size_t i = 0; i < texels; ++i)
+    {
+        const float value = scalars[i];
+        if (! std::isfinite(value)) // cells not read or not numeric, as the shader shows them
+        {
+            rgb[3 * i + 0] = static_cast<unsigned char>(backgroundColor.red());
+            rgb[3 * i + 1] = static_cast<unsigned char>(backgroundColor.green());
+            rgb[3 * i + 2] = static_cast<unsigned char>(backgroundColor.blue());
+            continue;
+        }
+        const double position = std::clamp((static_cast<double>(value) - range.first) / (range.second - range.first), 0.0, 1.0);
+        rgb[3 * i + 0] = toColorByte(lowColor.redF() + (highColor.redF() - lowColor.redF()) * position);
+        rgb[3 * i + 1] = toColorByte(lowColor.greenF() + (highColor.greenF() - lowColor.greenF()) * position);
+        rgb[3 * i + 2] = toColorByte(lowColor.blueF() + (highColor.blueF() - lowColor.blueF()) * position);
+    }
+}
+
+std::string FrameColors::description() const
+{
+    const auto range = fixedRange ? std::format("{}:{}", fixedRange->first, fixedRange->second) : std::string("automatic");
+    return std::format("ramp {} {} {} {}",
+                       lowColor.name(QColor::HexRgb).toStdString(),
+                       highColor.name(QColor::HexRgb).toStdString(),
+                       backgroundColor.name(QColor::HexRgb).toStdString(),
+                       range);
+}
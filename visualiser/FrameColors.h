@@ -0,0 +1,45 @@
+/** @file FrameColors.h
+ * @brief Declaration of the FrameColors class - colours of decoded frames computed on the CPU, as the grid shows them. */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <QColor>
+
+#include "visualiser/StepFrame.h"
+
+/** @class FrameColors
+ * @brief Converts decoded frames into RGB pictures without rendering (raw grid images, thumbnails of steps).
+ *
+ * Colours of the model are copied. Raw values (the `color_substate` setting) are mapped through the colour ramp
+ * of ColorSettings like on the GPU, values which are not finite get the background colour. The ramp is taken
+ * when the object is created (in the GUI thread), so frames can be converted on any thread afterwards.
+ * With an automatic range, the range of the first converted frame is kept for all following frames. */
+class FrameColors
+{
+public:
+    /// @brief Takes the colour ramp, its range and the background colour from ColorSettings
+    FrameColors();
+
+    /// @brief Texels in a row of the frame (columns of its level of detail)
+    static int width(const StepFrame& frame);
+
+    /// @brief Rows of texels of the frame (rows of its level of detail)
+    static int height(const StepFrame& frame);
+
+    /** @brief Writes colours of the texels: 3 bytes per texel, width() x height() texels in VTK image order (the first row at the bottom).
+     *  @throws std::invalid_argument If the frame has neither colours nor raw values, or their size does not match the grid */
+    void write(const StepFrame& frame, unsigned char* rgb);
+
+    /// @brief Text describing the colour ramp, changes whenever converted raw values would get other colours
+    std::string description() const;
+
+private:
+    QColor lowColor;
+    QColor highColor;
+    QColor backgroundColor;
+    std::optional<std::pair<float, float>> fixedRange;     ///< range of the ramp, std::nullopt when it is automatic
+    std::optional<std::pair<float, float>> automaticRange; ///< taken from the first frame with raw values
+};
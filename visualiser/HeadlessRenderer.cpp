@@ -0,0 +1,423 @@
+/** @file HeadlessRenderer.cpp
+ * @brief Implementation of the HeadlessRenderer class. */
+
+#include <algorithm> // std::clamp, std::ranges::binary_search
+#include <cmath>     // std::lround
+#include <csignal>
+#include <cstdlib>   // std::getenv, setenv
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <pthread.h> // pthread_sigmask
+#include <unistd.h>  // getpid
+
+#include "utilities/OutputContainer.h"
+#include "utilities/RemoteOutput.h"
+#include "visualiser/CellReductions.h"
+#include "visualiser/HeadlessRenderer.h"
+#include "visualiser/ImageSequenceExporter.h"
+#include "visualiser/OffscreenScene.h"
+#include "visualiser/VideoExporter.h"
+#include "visualiserProxy/SceneWidgetVisualizerFactory.h"
+
+
+namespace
+{
+/// Frames per second of headless movies (the same as the default speed of the GUI export)
+constexpr int HEADLESS_MOVIE_FPS = 1;
+
+/// Longer side of rendered images: small grids are enlarged, big ones reduced (the texture keeps all cells)
+constexpr int MIN_IMAGE_SIZE = 512;
+constexpr int MAX_IMAGE_SIZE = 2048;
+
+/// Space above the grid for the step number (the same as in the interactive window)
+constexpr int STEP_TEXT_MARGIN = 10;
+
+/// @brief Writes one CSV line with the operations' results of the accumulator
+void writeReductionsLine(std::ostream& output,
+                         StepIndex step,
+                         const std::string& substate,
+                         std::string_view scope,
+                         std::optional<std::size_t> index,
+                         const ReductionAccumulator& accumulator,
+                         const std::vector<ReductionOperation>& operations)
+{
+    output << step << ',' << substate << ',' << scope << ',';
+    if (index)
+        output << *index;
+    for (const auto operation : operations)
+        output << ',' << accumulator.value(operation);
+    output << '\n';
+}
+} // namespace
+
+
+HeadlessRenderer::HeadlessRenderer(const CommandLineParser& options)
+    : options{ options }
+{
+}
+
+HeadlessRenderer::~HeadlessRenderer() = default;
+
+void HeadlessRenderer::preferDisplaylessRenderWindow()
+{
+    if (! std::getenv("DISPLAY") && ! std::getenv("WAYLAND_DISPLAY"))
+        ::setenv("VTK_DEFAULT_OPENGL_WINDOW", "vtkEGLRenderWindow", /*overwrite=*/0);
+}
+
+int HeadlessRenderer::run()
+{
+    try
+    {
+        if (options.shouldPackOutput())
+        {
+            packOutputContainer();
+            if (! options.getGenerateImagePath() && ! options.getGenerateMoviePath() && ! options.getReductionsPath() && ! options.getServeOutputPort())
+                return 0;
+        }
+
+        if (options.getServeOutputPort())
+        {
+            serveOutput();
+            return 0;
+        }
+
+        loadStage();
+
+        if (options.getGenerateImagePath())
+            renderImages(stepsToRender(/*forMovie=*/false));
+
+        if (options.getGenerateMoviePath())
+            renderMovie(stepsToRender(/*forMovie=*/true));
+
+        if (options.getReductionsPath())
+            saveReductions(stepsToRender(/*forMovie=*/true));
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+void HeadlessRenderer::packOutputContainer()
+{
+    const auto& configFile = options.getConfigFile().value();
+    if (! std::filesystem::exists(configFile))
+    {
+        throw std::invalid_argument(std::format("Configuration file not found: '{}'", configFile));
+    }
+
+    SettingParameter packedSettings{};
+    readSettingParameterFromConfigFile(configFile, packedSettings);
+
+    const auto compression = requestedCompression();
+    const auto containerPath = OutputContainer::fileName(packedSettings.outputFileName);
+    const auto nodesCount = packedSettings.nNodeX * packedSettings.nNodeY;
+    const auto statistics = OutputContainer::pack(packedSettings.outputFileName,
+                                                  nodesCount,
+                                                  containerPath,
+                                                  compression,
+                                                  [](std::size_t packedNodes, std::size_t totalNodes)
+                                                  {
+                                                      std::cout << std::format("\rPacked {}/{} nodes", packedNodes, totalNodes) << std::flush;
+                                                  });
+
+    const double ratio = statistics.storedBytes ? static_cast<double>(statistics.rawBytes) / static_cast<double>(statistics.storedBytes) : 1.0;
+    std::cout << std::format("\nPacked {} chunks ({} bytes) into '{}' ({} bytes of chunks, {:.2f}x smaller)",
+                             statistics.chunks,
+                             statistics.rawBytes,
+                             containerPath,
+                             statistics.storedBytes,
+                             ratio)
+              << std::endl;
+}
+
+void HeadlessRenderer::serveOutput()
+{
+    const auto& configFile = options.getConfigFile().value();
+    if (! std::filesystem::exists(configFile))
+    {
+        throw std::invalid_argument(std::format("Configuration file not found: '{}'", configFile));
+    }
+
+    SettingParameter servedSettings{};
+    readSettingParameterFromConfigFile(configFile, servedSettings);
+
+    // the signals are taken by sigwait() below, so they are blocked before threads of the agent are started (they inherit the mask)
+    sigset_t stopSignals;
+    ::sigemptyset(&stopSignals);
+    ::sigaddset(&stopSignals, SIGINT);
+    ::sigaddset(&stopSignals, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    const auto nodesCount = servedSettings.nNodeX * servedSettings.nNodeY;
+    RemoteOutputAgent agent(servedSettings.outputFileName, nodesCount, requestedCompression(), static_cast<std::uint16_t>(*options.getServeOutputPort()));
+    std::cout << std::format("Serving output '{}' of {} nodes on port {} (viewers use 'mode = remote' and 'remote_agent = <host>:{}'), stop with Ctrl+C",
+                             servedSettings.outputFileName,
+                             nodesCount,
+                             agent.port(),
+                             agent.port())
+              << std::endl;
+
+    std::exception_ptr error;
+    {
+        std::jthread server(
+            [&agent, &error](std::stop_token stopToken)
+            {
+                try
+                {
+                    agent.serve(stopToken);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                    ::kill(::getpid(), SIGTERM); // wakes up sigwait()
+                }
+            });
+
+        int signal = 0;
+        ::sigwait(&stopSignals, &signal);
+        std::cout << "Stopping the output agent" << std::endl;
+    } // the server is stopped and joined
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+ContainerCompression HeadlessRenderer::requestedCompression() const
+{
+    if (const auto& compressionName = options.getPackCompression())
+        return containerCompressionFromName(*compressionName);
+
+    if (! isContainerCompressionAvailable(ContainerCompression::Lz4))
+    {
+        std::cerr << "Warning: LZ4 is not available in this build, the output is not compressed" << std::endl;
+        return ContainerCompression::None;
+    }
+    return ContainerCompression::Lz4;
+}
+
+void HeadlessRenderer::loadStage()
+{
+    const auto& configFile = options.getConfigFile().value();
+    if (! std::filesystem::exists(configFile))
+    {
+        throw std::invalid_argument(std::format("Configuration file not found: '{}'", configFile));
+    }
+
+    const auto& modelName = options.getStartingModel();
+    visualizer = modelName ? SceneWidgetVisualizerFactory::create(*modelName) : SceneWidgetVisualizerFactory::defaultModel();
+
+    readSettingParameterFromConfigFile(configFile, settingParameter);
+    settingParameter.step = 0;
+    settingParameter.changed = false;
+
+    visualizer->initMatrix(settingParameter.numberOfColumnX, settingParameter.numberOfRowsY);
+    visualizer->setStepCacheMemoryBudget(settingParameter.stepCacheMemoryMB * 1024 * 1024, settingParameter.compressedStepCacheMemoryMB * 1024 * 1024);
+    visualizer->setMaxOpenFiles(settingParameter.maxOpenFiles);
+    visualizer->setRemoteAgent(settingParameter.remoteAgent);
+    visualizer->prepareStage(settingParameter.nNodeX, settingParameter.nNodeY);
+
+    std::optional<StepIndex> firstStep; // read into the page cache while the indices are loaded
+    if (const auto& range = options.getStepRange())
+        firstStep = static_cast<StepIndex>(range->first);
+    else if (options.getStep())
+        firstStep = static_cast<StepIndex>(*options.getStep());
+    visualizer->readStepsOffsetsForAllNodesFromFiles(settingParameter.nNodeX,
+                                                     settingParameter.nNodeY,
+                                                     settingParameter.outputFileName,
+                                                     settingParameter.readMode,
+                                                     {},
+                                                     firstStep);
+}
+
+std::vector<StepIndex> HeadlessRenderer::stepsToRender(bool forMovie) const
+{
+    const auto availableSteps = visualizer->availableSteps(); // sorted
+    if (availableSteps.empty())
+    {
+        throw std::runtime_error(std::format("No steps found in index files of '{}'", settingParameter.outputFileName));
+    }
+
+    std::optional<CommandLineParser::StepRange> range = options.getStepRange();
+    if (! range && ! forMovie)
+    {
+        const auto step = options.getStep() ? *options.getStep() : static_cast<int>(availableSteps.front());
+        range = CommandLineParser::StepRange{ step, step };
+    }
+    if (! range)
+        return availableSteps;
+
+    std::vector<StepIndex> steps;
+    for (long long step = range->first; step <= range->last; step += range->stride)
+    {
+        if (std::ranges::binary_search(availableSteps, static_cast<StepIndex>(step)))
+            steps.push_back(static_cast<StepIndex>(step));
+        else
+            std::cerr << "Warning: step " << step << " is not present in the data, skipped" << std::endl;
+    }
+    if (steps.empty())
+    {
+        throw std::runtime_error(std::format("None of steps {}..{} is present in the data", range->first, range->last));
+    }
+    return steps;
+}
+
+std::optional<StepFrame> HeadlessRenderer::decodeStep(const std::vector<StepIndex>& steps, std::size_t index, std::stop_token stopToken)
+{
+    const auto nextSteps = std::vector<StepIndex>(steps.begin() + static_cast<std::ptrdiff_t>(index + 1),
+                                                  steps.begin() + static_cast<std::ptrdiff_t>(std::min(steps.size(), index + 1 + settingParameter.prefetchSteps)));
+    visualizer->prefetchSteps(&settingParameter, nextSteps);
+
+    auto stepParameters = settingParameter;
+    stepParameters.step = steps[index];
+    return visualizer->decodeStepFrame(stepParameters, stopToken);
+}
+
+std::unique_ptr<OffscreenScene> HeadlessRenderer::createScene() const
+{
+    const int gridWidth = std::max(settingParameter.numberOfColumnX, 1);
+    const int gridHeight = std::max(settingParameter.numberOfRowsY, 1) + STEP_TEXT_MARGIN;
+    const int longerSide = std::max(gridWidth, gridHeight);
+    const double scale = static_cast<double>(std::clamp(longerSide, MIN_IMAGE_SIZE, MAX_IMAGE_SIZE)) / longerSide;
+
+    return std::make_unique<OffscreenScene>(std::max(1, static_cast<int>(std::lround(gridWidth * scale))),
+                                            std::max(1, static_cast<int>(std::lround(gridHeight * scale))));
+}
+
+void HeadlessRenderer::renderImages(const std::vector<StepIndex>& steps)
+{
+    const auto& pathPattern = options.getGenerateImagePath().value();
+    const bool rawGrid = options.shouldWriteRawGridImages();
+    auto scene = rawGrid ? nullptr : createScene(); // raw images of the grid are made without rendering
+
+    // this thread decodes and renders, images are compressed and written by the exporter's threads meanwhile
+    ImageSequenceExporter exporter;
+    std::size_t writtenImages = 0;
+    for (std::size_t i = 0; i < steps.size(); ++i)
+    {
+        const auto frame = decodeStep(steps, i, {});
+        if (! frame)
+            continue;
+
+        const auto imagePath = imagePathForStep(pathPattern, frame->step, steps.size() > 1);
+        exporter.write(rawGrid ? exporter.rawGridImage(*frame) : scene->render(*frame), imagePath);
+        ++writtenImages;
+    }
+    exporter.finish();
+
+    if (options.isSilentMode() || 0 == writtenImages)
+        return;
+    if (1 == steps.size())
+        std::cout << "Image saved to: " << imagePathForStep(pathPattern, steps.front(), /*manySteps=*/false) << std::endl;
+    else
+        std::cout << std::format("Saved {} images to: {}", writtenImages, pathPattern) << std::endl;
+}
+
+void HeadlessRenderer::renderMovie(const std::vector<StepIndex>& steps)
+{
+    const auto& moviePath = options.getGenerateMoviePath().value();
+    auto scene = createScene();
+
+    VideoEncoding encoding;
+    if (options.getVideoCodec())
+        encoding.codec = *options.getVideoCodec();
+    encoding.bitrateKbps = options.getVideoBitrate().value_or(0);
+
+    VideoExporter exporter;
+    exporter.setEncoding(encoding);
+    std::size_t nextIndex = 0; // the decoder is called for the steps in order
+    exporter.exportVideo(*scene,
+                         QString::fromStdString(moviePath),
+                         HEADLESS_MOVIE_FPS,
+                         steps,
+                         [this, &steps, &nextIndex](StepIndex step, std::stop_token stopToken)
+                         {
+                             while (nextIndex < steps.size() && steps[nextIndex] != step)
+                                 ++nextIndex;
+                             return decodeStep(steps, nextIndex, stopToken);
+                         },
+                         [this](StepIndex step, StepIndex lastStep)
+                         {
+                             if (! options.isSilentMode())
+                                 std::cout << "Rendered step " << step << " of " << lastStep << std::endl;
+                         },
+                         /*cancelledCallback=*/{});
+
+    if (! options.isSilentMode())
+        std::cout << "Movie saved to: " << moviePath << " (encoder " << exporter.usedEncoder() << ")" << std::endl;
+}
+
+void HeadlessRenderer::saveReductions(const std::vector<StepIndex>& steps)
+{
+    const auto& reductionsPath = options.getReductionsPath().value();
+    const auto operations = reductionOperationsFromList(settingParameter.reduction);
+    if (operations.empty() || substateNamesFromList(settingParameter.substates).empty())
+    {
+        throw std::runtime_error(std::format("{} requires 'reduction' and 'substates' in the VISUALIZATION section of the configuration",
+                                             CommandLineParser::ARG_REDUCTIONS_PATH));
+    }
+
+    std::ofstream output(reductionsPath);
+    if (! output)
+    {
+        throw std::runtime_error(std::format("Can't open '{}' for writing", reductionsPath));
+    }
+    output.precision(17); // doubles are written back exactly
+
+    output << "step,substate,scope,index";
+    for (const auto operation : operations)
+        output << ',' << reductionOperationName(operation);
+    output << '\n';
+
+    for (std::size_t i = 0; i < steps.size(); ++i)
+    {
+        const auto frame = decodeStep(steps, i, {});
+        if (! frame || ! frame->reductions)
+            continue;
+
+        for (const auto& substate : frame->reductions->substates)
+        {
+            writeReductionsLine(output, frame->step, substate.substate, "grid", std::nullopt, substate.global, operations);
+            for (std::size_t node = 0; node < substate.perNode.size(); ++node)
+                writeReductionsLine(output, frame->step, substate.substate, "node", node, substate.perNode[node], operations);
+            for (std::size_t row = 0; row < substate.perRow.size(); ++row)
+                writeReductionsLine(output, frame->step, substate.substate, "row", row, substate.perRow[row], operations);
+        }
+    }
+
+    output.flush();
+    if (! output)
+    {
+        throw std::runtime_error(std::format("Failed to write reductions to: {}", reductionsPath));
+    }
+    if (! options.isSilentMode())
+        std::cout << "Reductions saved to: " << reductionsPath << std::endl;
+}
+
+std::string HeadlessRenderer::imagePathForStep(const std::string& pathPattern, StepIndex step, bool manySteps)
+{
+    constexpr std::string_view STEP_PLACEHOLDER = "{step}";
+    if (const auto position = pathPattern.find(STEP_PLACEHOLDER); position != std::string::npos)
+    {
+        auto path = pathPattern;
+        path.replace(position, STEP_PLACEHOLDER.size(), std::to_string(step));
+        return path;
+    }
+    if (! manySteps)
+        return pathPattern;
+
+    std::filesystem::path path(pathPattern);
+    const auto extension = path.extension().string();
+    path.replace_extension();
+    return path.string() + "_" + std::to_string(step) + extension;
+}
@@ -0,0 +1,85 @@
+/** @file HeadlessRenderer.h
+ * @brief Declaration of the HeadlessRenderer class - batch rendering of steps without any window (--headless). */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "utilities/CommandLineParser.h"
+#include "utilities/OutputContainer.h" // ContainerCompression
+#include "utilities/types.h"
+#include "visualiser/SettingParameter.h"
+#include "visualiser/StepFrame.h"
+
+class ISceneWidgetVisualizer;
+class OffscreenScene;
+
+/** @class HeadlessRenderer
+ * @brief Renders steps of a configuration straight to images or a video, for batch jobs on machines without display.
+ *
+ * Only what rendering needs is created: the model's visualizer (ModelReader with the step cache) and an offscreen scene.
+ * There is no QApplication, no main window and no widget, so the application does not connect to an X server
+ * (when VTK is built with EGL or OSMesa, see doc/Build-VTK.md). Only the rendered steps are decoded,
+ * the following ones in the background while the current one is rendered.
+ *
+ * Images: with more than one step the step number is put into the image path, either in place of "{step}"
+ * or before the file extension (image.png -> image_42.png). The format is chosen by the extension. Images are compressed
+ * and written by a pool of threads while the next steps are rendered (see ImageSequenceExporter); with `--rawGridImages`
+ * they are the colours of the grid, made without rendering.
+ * Video: the steps are the frames of one video, OGG Theora or the codec of `--videoCodec` (see VideoExporter).
+ * Reductions: sum, min, max, ... of substates (see CellReductions.h) of every step are saved to a CSV file,
+ * for the whole grid, every node and every row (all steps by default, like a video).
+ * Packing: the node files are packed into one output container (see OutputContainer) before anything is rendered.
+ * Serving: the node files are sent to viewers reading them with `mode = remote` (see RemoteOutputAgent) until SIGINT or SIGTERM. */
+class HeadlessRenderer
+{
+public:
+    /// @param options Parsed command line with ARG_HEADLESS, the configuration file and an image or movie path
+    explicit HeadlessRenderer(const CommandLineParser& options);
+
+    ~HeadlessRenderer();
+
+    /// @brief Without a display, asks VTK to create EGL render windows instead of X ones (unless chosen by the user already)
+    static void preferDisplaylessRenderWindow();
+
+    /** @brief Renders all requested images and the movie.
+     *  @return Exit code of the application: 0 when everything was rendered, errors are printed to std::cerr */
+    int run();
+
+private:
+    /// @brief Reads the configuration and indices of the node files
+    void loadStage();
+
+    /// @brief Packs the text node files of the configuration into the output container next to them (--packOutput)
+    void packOutputContainer();
+
+    /// @brief Serves the text node files of the configuration on the port of --serveOutput until interrupted
+    void serveOutput();
+
+    /// @brief Compression from --packCompression, LZ4 by default when it is available
+    ContainerCompression requestedCompression() const;
+
+    /// @brief Steps from --stepRange (or --step for images) present in the data, all steps for a movie by default
+    std::vector<StepIndex> stepsToRender(bool forMovie) const;
+
+    void renderImages(const std::vector<StepIndex>& steps);
+    void renderMovie(const std::vector<StepIndex>& steps);
+    void saveReductions(const std::vector<StepIndex>& steps);
+
+    /// @brief Decodes the step and schedules decoding of the ones following it in `steps`
+    std::optional<StepFrame> decodeStep(const std::vector<StepIndex>& steps, std::size_t index, std::stop_token stopToken);
+
+    /// @brief Offscreen scene sized to the grid (kept within limits of a reasonable image)
+    std::unique_ptr<OffscreenScene> createScene() const;
+
+    /// @brief Path of the image of the step, see the class description
+    static std::string imagePathForStep(const std::string& pathPattern, StepIndex step, bool manySteps);
+
+    const CommandLineParser& options;
+    SettingParameter settingParameter{};
+    std::unique_ptr<ISceneWidgetVisualizer> visualizer;
+};
@@ -0,0 +1,109 @@
+/** @file ImageSequenceExporter.cpp
+ * @brief Implementation of the ImageSequenceExporter class. */
+
+#include <algorithm> // std::ranges::transform
+#include <cctype>    // std::tolower
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <vtkBMPWriter.h>
+#include <vtkJPEGWriter.h>
+#include <vtkPNGWriter.h>
+#include <vtkTIFFWriter.h>
+#include "utilities/StageProfiler.h"
+#include "visualiser/ImageSequenceExporter.h"
+
+
+ImageSequenceExporter::ImageSequenceExporter(unsigned threads)
+    : maxQueuedImages{ 2 * static_cast<std::size_t>(threads ? threads : ThreadPool::defaultThreadCount()) }
+    , writers{ threads }
+{
+}
+
+void ImageSequenceExporter::write(vtkSmartPointer<vtkImageData> image, std::string path)
+{
+    auto writer = writerFor(path); // an unsupported format is reported right away, not by a worker
+
+    {
+        std::unique_lock lock(mutex);
+        imageWritten.wait(lock,
+                          [this]
+                          {
+                              return queuedImages < maxQueuedImages || writingError;
+                          });
+        rethrowWritingError();
+        ++queuedImages;
+    }
+
+    writers.submit(
+        [this, writer = std::move(writer), image = std::move(image), path = std::move(path)]
+        {
+            std::exception_ptr error;
+            try
+            {
+                ScopedStageTimer timer(ProfiledStage::WriteImage);
+                writer->SetFileName(path.c_str());
+                writer->SetInputData(image);
+                writer->Write();
+                if (writer->GetErrorCode())
+                {
+                    throw std::runtime_error(std::format("Failed to save image to: {}", path));
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                if (error && ! writingError)
+                    writingError = error;
+                --queuedImages;
+            }
+            imageWritten.notify_all();
+        });
+}
+
+void ImageSequenceExporter::finish()
+{
+    std::unique_lock lock(mutex);
+    imageWritten.wait(lock,
+                      [this]
+                      {
+                          return 0 == queuedImages;
+                      });
+    rethrowWritingError();
+}
+
+void ImageSequenceExporter::rethrowWritingError()
+{
+    if (writingError)
+        std::rethrow_exception(writingError);
+}
+
+vtkSmartPointer<vtkImageData> ImageSequenceExporter::rawGridImage(const StepFrame& frame)
+{
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(FrameColors::width(frame), FrameColors::height(frame), 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    frameColors.write(frame, static_cast<unsigned char*>(image->GetScalarPointer()));
+    return image;
+}
+
+vtkSmartPointer<vtkImageWriter> ImageSequenceExporter::writerFor(const std::string& path)
+{
+    auto extension = std::filesystem::path(path).extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (".png" == extension)
+        return vtkSmartPointer<vtkPNGWriter>::New();
+    if (".jpg" == extension || ".jpeg" == extension)
+        return vtkSmartPointer<vtkJPEGWriter>::New();
+    if (".bmp" == extension)
+        return vtkSmartPointer<vtkBMPWriter>::New();
+    if (".tif" == extension || ".tiff" == extension)
+        return vtkSmartPointer<vtkTIFFWriter>::New();
+
+    throw std::runtime_error(std::format("Unsupported image format of '{}' (use .png, .jpg, .bmp or .tiff)", path));
+}
@@ -0,0 +1,76 @@
+/** @file ImageSequenceExporter.h
+ * @brief Declaration of the ImageSequenceExporter class - images of many steps compressed and written in parallel. */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vtkImageData.h>
+#include <vtkImageWriter.h>
+#include <vtkSmartPointer.h>
+#include "utilities/ThreadPool.h"
+#include "visualiser/FrameColors.h"
+#include "visualiser/StepFrame.h"
+
+/** @class ImageSequenceExporter
+ * @brief Writes a sequence of images (e.g. PNG frames for publication) on a pool of threads, so encoding does not hold up rendering.
+ *
+ * The rendering thread hands every image over to write() and continues with the next step; the exporter becomes
+ * the only owner of the image, so a writer thread compresses it without copying or locking. At most
+ * `2 * threads` images wait for the writers, write() blocks when there are more (memory stays limited
+ * when compression is slower than rendering).
+ *
+ * When only the grid is needed, rawGridImage() makes the image straight from the decoded colours of the step
+ * (one pixel per cell or per texel of the level of detail), with no rendering and no read back from the GPU.
+ * The format of an image is chosen by the extension of its path (see writerFor()). */
+class ImageSequenceExporter
+{
+public:
+    /// @param threads Number of writer threads, 0 means ThreadPool::defaultThreadCount()
+    explicit ImageSequenceExporter(unsigned threads = 0);
+
+    /// @brief Waits for images still being written (errors are dropped, call finish() to get them)
+    ~ImageSequenceExporter() = default;
+
+    ImageSequenceExporter(const ImageSequenceExporter&) = delete;
+    ImageSequenceExporter& operator=(const ImageSequenceExporter&) = delete;
+
+    /** @brief Schedules writing of the image into the file, waits while too many images are queued.
+     *  @throws std::runtime_error If writing of an earlier image failed, or the format of the path is not supported */
+    void write(vtkSmartPointer<vtkImageData> image, std::string path);
+
+    /** @brief Waits until all scheduled images are written.
+     *  @throws std::runtime_error The first error of writing */
+    void finish();
+
+    /** @brief Image of the grid made from the colours of the frame, without rendering.
+     *
+     * Raw values (the `color_substate` setting) are mapped through the colour ramp of ColorSettings like on the GPU
+     * (see FrameColors): with an automatic range, the range of the first frame is kept for the whole sequence.
+     * Lines and the step number are not drawn.
+     * @throws std::invalid_argument If the frame has neither colours nor raw values */
+    vtkSmartPointer<vtkImageData> rawGridImage(const StepFrame& frame);
+
+    /** @brief Image writer chosen by extension of the path: .png, .jpg/.jpeg, .bmp or .tif/.tiff
+     *  @throws std::runtime_error For other extensions */
+    static vtkSmartPointer<vtkImageWriter> writerFor(const std::string& path);
+
+private:
+    /// @brief Throws the first error of writing, if any (the caller holds the mutex)
+    void rethrowWritingError();
+
+    std::size_t maxQueuedImages;
+
+    std::mutex mutex;
+    std::condition_variable imageWritten;
+    std::size_t queuedImages = 0;    ///< guarded by mutex, scheduled and not written yet
+    std::exception_ptr writingError; ///< guarded by mutex, the first one
+
+    FrameColors frameColors; ///< colours of raw grid images, the ramp is taken when the exporter is created
+
+    /// Writer threads (declared last, so they finish before the rest is destroyed)
+    ThreadPool writers;
+};
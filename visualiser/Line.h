@@ -29,4 +29,6 @@ struct Line
         , y2(y2)
     {
     }
+
+    bool operator==(const Line&) const = default;
 };
@@ -0,0 +1,195 @@
+/** @file NodeHitIndex.cpp
+ * @brief Implementation of the NodeHitIndex class. */
+
+#include <algorithm> // std::clamp, std::minmax
+#include <cmath>
+#include <limits>
+
+#include "NodeHitIndex.h"
+
+
+namespace
+{
+/// Buckets per node along every axis: a bucket then holds a few lines and at most four nodes
+constexpr int BUCKETS_PER_NODE = 2;
+
+/// Limits memory of the index for very big grids of nodes
+constexpr int MAX_BUCKETS_PER_AXIS = 1024;
+
+bool isZeroLength(const Line& line)
+{
+    const double dx = line.x2 - line.x1;
+    const double dy = line.y2 - line.y1;
+    return dx * dx + dy * dy < 1e-10;
+}
+} // namespace
+
+
+bool NodeHitIndex::rebuild(const std::vector<Line>& lines, int nNodeX, int nNodeY)
+{
+    if (lines == indexedLines && nNodeX == indexedNodesX && nNodeY == indexedNodesY)
+        return false;
+
+    clear();
+    indexedLines = lines;
+    indexedNodesX = nNodeX;
+    indexedNodesY = nNodeY;
+    if (lines.empty())
+        return true;
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (const auto& line : lines)
+    {
+        minX = std::min({ minX, static_cast<double>(line.x1), static_cast<double>(line.x2) });
+        minY = std::min({ minY, static_cast<double>(line.y1), static_cast<double>(line.y2) });
+        maxX = std::max({ maxX, static_cast<double>(line.x1), static_cast<double>(line.x2) });
+        maxY = std::max({ maxY, static_cast<double>(line.y1), static_cast<double>(line.y2) });
+    }
+
+    // points farther than LINE_PICK_DISTANCE outside of the lines can not hit anything
+    areaLeft = minX - LINE_PICK_DISTANCE;
+    areaTop = minY - LINE_PICK_DISTANCE;
+    bucketsX = std::clamp(BUCKETS_PER_NODE * nNodeX, 1, MAX_BUCKETS_PER_AXIS);
+    bucketsY = std::clamp(BUCKETS_PER_NODE * nNodeY, 1, MAX_BUCKETS_PER_AXIS);
+    bucketWidth = (maxX + LINE_PICK_DISTANCE - areaLeft) / bucketsX;
+    bucketHeight = (maxY + LINE_PICK_DISTANCE - areaTop) / bucketsY;
+    linesInBuckets.assign(static_cast<std::size_t>(bucketsX) * bucketsY, {});
+    nodesInBuckets.assign(static_cast<std::size_t>(bucketsX) * bucketsY, {});
+
+    for (std::uint32_t i = 0; i < lines.size(); ++i)
+    {
+        const auto& line = lines[i];
+        if (isZeroLength(line))
+            continue;
+
+        const auto [left, right] = std::minmax(line.x1, line.x2);
+        const auto [top, bottom] = std::minmax(line.y1, line.y2);
+        forEachBucket(left - LINE_PICK_DISTANCE,
+                      top - LINE_PICK_DISTANCE,
+                      right + LINE_PICK_DISTANCE,
+                      bottom + LINE_PICK_DISTANCE,
+                      [this, i](std::size_t bucket)
+                      {
+                          linesInBuckets[bucket].push_back(i);
+                      });
+    }
+
+    // the first two lines of every node are its edges from its offset along x and along y
+    const auto totalNodes = static_cast<std::size_t>(std::max(0, nNodeX)) * std::max(0, nNodeY);
+    if (lines.size() < 2 * totalNodes)
+        return true;
+
+    for (NodeIndex node = 0; node < totalNodes; ++node)
+    {
+        const auto& edgeX = lines[node * 2];
+        const auto& edgeY = lines[node * 2 + 1];
+        const NodeHit hit{ .node = node,
+                           .nodeX = static_cast<int>(node % nNodeX),
+                           .nodeY = static_cast<int>(node / nNodeX),
+                           .left = edgeX.x1,
+                           .top = edgeX.y1,
+                           .right = edgeX.x2,
+                           .bottom = edgeY.y2 };
+        if (hit.right <= hit.left || hit.bottom <= hit.top)
+            continue; // lines of the node not known (yet)
+
+        const auto nodeIndex = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back(hit);
+        forEachBucket(hit.left,
+                      hit.top,
+                      hit.right,
+                      hit.bottom,
+                      [this, nodeIndex](std::size_t bucket)
+                      {
+                          nodesInBuckets[bucket].push_back(nodeIndex);
+                      });
+    }
+    return true;
+}
+
+void NodeHitIndex::clear()
+{
+    indexedLines.clear();
+    indexedNodesX = indexedNodesY = 0;
+    nodes.clear();
+    linesInBuckets.clear();
+    nodesInBuckets.clear();
+    bucketsX = bucketsY = 0;
+}
+
+std::optional<std::size_t> NodeHitIndex::bucketAt(double x, double y) const
+{
+    if (0 == bucketsX || 0 == bucketsY)
+        return std::nullopt;
+
+    const double bucketX = std::floor((x - areaLeft) / bucketWidth);
+    const double bucketY = std::floor((y - areaTop) / bucketHeight);
+    if (! (bucketX >= 0 && bucketX < bucketsX && bucketY >= 0 && bucketY < bucketsY)) // NaN is outside too
+        return std::nullopt;
+
+    return static_cast<std::size_t>(bucketY) * bucketsX + static_cast<std::size_t>(bucketX);
+}
+
+template<typename AddToBucket>
+void NodeHitIndex::forEachBucket(double left, double top, double right, double bottom, AddToBucket addToBucket) const
+{
+    const auto toBucket = [](double position, double origin, double size, int buckets)
+    {
+        return std::clamp(static_cast<int>(std::floor((position - origin) / size)), 0, buckets - 1);
+    };
+
+    const int firstX = toBucket(left, areaLeft, bucketWidth, bucketsX);
+    const int lastX = toBucket(right, areaLeft, bucketWidth, bucketsX);
+    const int firstY = toBucket(top, areaTop, bucketHeight, bucketsY);
+    const int lastY = toBucket(bottom, areaTop, bucketHeight, bucketsY);
+    for (int bucketY = firstY; bucketY <= lastY; ++bucketY)
+    {
+        for (int bucketX = firstX; bucketX <= lastX; ++bucketX)
+            addToBucket(static_cast<std::size_t>(bucketY) * bucketsX + bucketX);
+    }
+}
+
+std::optional<NodeHitIndex::LineHit> NodeHitIndex::nearestLine(double x, double y) const
+{
+    const auto bucket = bucketAt(x, y);
+    if (! bucket)
+        return std::nullopt;
+
+    constexpr double thresholdSq = LINE_PICK_DISTANCE * LINE_PICK_DISTANCE;
+
+    std::optional<LineHit> nearest;
+    for (const auto i : linesInBuckets[*bucket]) // in ascending order, so the first of equally distant lines wins
+    {
+        const auto& line = indexedLines[i];
+
+        // Calculate squared distance from point to line segment
+        const double lineLengthSq = (line.x2 - line.x1) * (line.x2 - line.x1) + (line.y2 - line.y1) * (line.y2 - line.y1);
+        const double t = std::clamp(((x - line.x1) * (line.x2 - line.x1) + (y - line.y1) * (line.y2 - line.y1)) / lineLengthSq, 0.0, 1.0);
+
+        const double dx = x - (line.x1 + t * (line.x2 - line.x1));
+        const double dy = y - (line.y1 + t * (line.y2 - line.y1));
+        const double distSq = dx * dx + dy * dy;
+
+        if (distSq <= thresholdSq && (! nearest || distSq < nearest->distanceSquared))
+            nearest = LineHit{ .index = i, .line = &line, .distanceSquared = distSq };
+    }
+    return nearest;
+}
+
+std::optional<NodeHitIndex::NodeHit> NodeHitIndex::nodeAt(double x, double y) const
+{
+    const auto bucket = bucketAt(x, y);
+    if (! bucket)
+        return std::nullopt;
+
+    for (const auto i : nodesInBuckets[*bucket])
+    {
+        const auto& node = nodes[i];
+        if (node.left <= x && x < node.right && node.top <= y && y < node.bottom)
+            return node;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,93 @@
+/** @file NodeHitIndex.h
+ * @brief Declaration of the NodeHitIndex class - uniform grid of buckets for finding lines and nodes under the cursor. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "utilities/types.h"
+#include "visualiser/Line.h"
+
+/** @class NodeHitIndex
+ * @brief Finds the load balancing line near a point and the node containing it, without scanning all of them.
+ *
+ * The bounding box of the lines is divided into a uniform grid of buckets (about two per node in both directions).
+ * Every bucket keeps indices of the lines passing within LINE_PICK_DISTANCE of it and of the node rectangles
+ * overlapping it, so a query tests only the few candidates of one bucket.
+ * Node rectangles are taken from the lines themselves (the first two lines of every node are its edges along x and y,
+ * see ModelReader::readStageStateFromFilesForStep()), so nodes of different sizes (load balancing) are found correctly.
+ *
+ * Coordinates are those of the lines: x is the column and y is the row of the grid.
+ * The index is rebuilt only when the lines of the shown step differ from the indexed ones. */
+class NodeHitIndex
+{
+public:
+    /// Maximal distance of a point from a line to be reported by nearestLine()
+    static constexpr double LINE_PICK_DISTANCE = 2;
+
+    /// @brief Line found by nearestLine()
+    struct LineHit
+    {
+        std::size_t index;      ///< Index of the line in the indexed lines
+        const Line* line;       ///< The indexed line
+        double distanceSquared; ///< Squared distance of the point from the line
+    };
+
+    /// @brief Node found by nodeAt(), with its rectangle in the grid
+    struct NodeHit
+    {
+        NodeIndex node; ///< Index of the node (as in the names of node files)
+        int nodeX;      ///< Column of the node in the grid of nodes
+        int nodeY;      ///< Row of the node in the grid of nodes
+        float left;     ///< First column of the node
+        float top;      ///< First row of the node
+        float right;    ///< Column after the last one of the node
+        float bottom;   ///< Row after the last one of the node
+    };
+
+    /** @brief Indexes the lines of the nodes, when they differ from the already indexed ones.
+     *  @param lines Lines in the order of ModelReader (2 per node, then the top and right edges of the last nodes)
+     *  @param nNodeX Number of nodes along x
+     *  @param nNodeY Number of nodes along y
+     *  @return true if the index was rebuilt */
+    bool rebuild(const std::vector<Line>& lines, int nNodeX, int nNodeY);
+
+    /// @brief Forgets all lines and nodes (e.g. when the scene is cleared)
+    void clear();
+
+    /// @brief Nearest line not farther than LINE_PICK_DISTANCE from the point (zero-length lines are skipped)
+    std::optional<LineHit> nearestLine(double x, double y) const;
+
+    /// @brief Node whose rectangle contains the point
+    std::optional<NodeHit> nodeAt(double x, double y) const;
+
+    std::size_t linesCount() const
+    {
+        return indexedLines.size();
+    }
+
+private:
+    /// @brief Index of the bucket containing the point, empty outside of the indexed area
+    std::optional<std::size_t> bucketAt(double x, double y) const;
+
+    /// @brief Calls addToBucket(bucketIndex) for every bucket overlapping the rectangle (clipped to the indexed area)
+    template<typename AddToBucket>
+    void forEachBucket(double left, double top, double right, double bottom, AddToBucket addToBucket) const;
+
+    std::vector<Line> indexedLines;
+    int indexedNodesX = 0;
+    int indexedNodesY = 0;
+    std::vector<NodeHit> nodes;
+
+    double areaLeft = 0;
+    double areaTop = 0;
+    double bucketWidth = 1;
+    double bucketHeight = 1;
+    int bucketsX = 0;
+    int bucketsY = 0;
+    std::vector<std::vector<std::uint32_t>> linesInBuckets; ///< indices of lines near every bucket
+    std::vector<std::vector<std::uint32_t>> nodesInBuckets; ///< indices of nodes overlapping every bucket
+};
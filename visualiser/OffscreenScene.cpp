@@ -0,0 +1,89 @@
+/** @file OffscreenScene.cpp
+ * @brief Implementation of the OffscreenScene class. */
+
+#include <vtkCamera.h>
+#include <vtkRendererCollection.h>
+
+#include "utilities/StageProfiler.h"
+#include "visualiser/OffscreenScene.h"
+#include "visualiser/SettingParameter.h" // font_size
+#include "widgets/ColorSettings.h"
+
+
+OffscreenScene::OffscreenScene(int width, int height)
+    : fitCameraToGrid{ true }
+{
+    setUpWindow(width, height);
+
+    const QColor background = ColorSettings::instance().backgroundColor();
+    renderer->SetBackground(background.redF(), background.greenF(), background.blueF());
+
+    auto* camera = renderer->GetActiveCamera();
+    camera->SetPosition(0, 0, 1);
+    camera->SetFocalPoint(0, 0, 0);
+    camera->SetViewUp(0, 1, 0);
+}
+
+OffscreenScene::OffscreenScene(vtkRenderWindow* sourceWindow)
+{
+    const int* size = sourceWindow->GetSize();
+    setUpWindow(size[0], size[1]);
+
+    if (auto* sourceRenderer = sourceWindow->GetRenderers()->GetFirstRenderer())
+    {
+        renderer->SetBackground(sourceRenderer->GetBackground());
+        renderer->GetActiveCamera()->DeepCopy(sourceRenderer->GetActiveCamera());
+    }
+}
+
+void OffscreenScene::setUpWindow(int width, int height)
+{
+    window->SetOffScreenRendering(1);
+    window->SetSize(width, height);
+    window->AddRenderer(renderer);
+    renderer->AddActor(gridActor);
+
+    capture->SetInput(window);
+    capture->SetScale(1);
+    capture->SetInputBufferTypeToRGB();
+    capture->ReadFrontBufferOff(); // Read from back buffer
+}
+
+vtkSmartPointer<vtkImageData> OffscreenScene::render(const StepFrame& frame)
+{
+    if (frame.scalars)
+        visualizer.refreshWindowsVTK(frame.scalars, frame.rows, frame.columns, gridActor, frame.levelFactor);
+    else
+        visualizer.refreshWindowsVTK(frame.colors, frame.rows, frame.columns, gridActor, frame.levelFactor);
+    visualizer.refreshHeightfield(frame.heights, frame.rows, frame.columns, gridActor);
+    if (! sceneBuilt)
+    {
+        if (! frame.lines.empty())
+            visualizer.buildLoadBalanceLine(frame.lines, frame.rows + 1, renderer, linesActor);
+        visualizer.buildStepText(frame.step, SettingParameter::font_size, stepTextMapper, renderer);
+
+        if (fitCameraToGrid)
+            renderer->ResetCamera();
+        else
+            renderer->ResetCameraClippingRange(); // the copied camera was clipped for the other scene
+        sceneBuilt = true;
+    }
+    else
+    {
+        if (! frame.lines.empty())
+            visualizer.refreshBuildLoadBalanceLine(frame.lines, frame.rows + 1, linesActor);
+        visualizer.buildStepLine(frame.step, stepTextMapper);
+    }
+
+    {
+        ScopedStageTimer timer(ProfiledStage::Render);
+        window->Render();
+    }
+    StageProfiler::instance().finishFrame();
+    capture->Modified();
+    capture->Update();
+
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->DeepCopy(capture->GetOutput());
+    return image;
+}
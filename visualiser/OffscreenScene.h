@@ -0,0 +1,56 @@
+/** @file OffscreenScene.h
+ * @brief Declaration of the OffscreenScene class - grid of the stage rendered into an offscreen window. */
+
+#pragma once
+
+#include <vtkActor.h>
+#include <vtkActor2D.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkTextMapper.h>
+#include <vtkWindowToImageFilter.h>
+
+#include "visualiser/StepFrame.h"
+#include "visualiser/Visualizer.hpp"
+
+/** @class OffscreenScene
+ * @brief Grid, node lines and step number rendered into an offscreen window and captured as images.
+ *
+ * It has its own Visualizer (texture and lines), so an interactive scene is untouched while it renders,
+ * and it needs neither a widget nor a visible window. Which offscreen backend is used (X without mapping
+ * the window, EGL or OSMesa) is decided by the VTK build, see doc/Build-VTK.md.
+ * The scene has to be used from one thread (the one owning its OpenGL context). */
+class OffscreenScene
+{
+public:
+    /** @brief Scene of the given size with the top-down view used by the 2D mode.
+     *  The camera is fitted to the grid when the first frame is rendered; colours are taken from ColorSettings. */
+    OffscreenScene(int width, int height);
+
+    /// @brief Scene copying size, camera and background of the view shown in the render window (its first renderer)
+    explicit OffscreenScene(vtkRenderWindow* sourceWindow);
+
+    OffscreenScene(const OffscreenScene&) = delete;
+    OffscreenScene& operator=(const OffscreenScene&) = delete;
+
+    /// @brief Renders the frame and returns a copy of the rendered image (RGB, it stays valid after next renders)
+    vtkSmartPointer<vtkImageData> render(const StepFrame& frame);
+
+private:
+    /// @brief Creates the offscreen window and image capturing common to both constructors
+    void setUpWindow(int width, int height);
+
+    vtkNew<vtkRenderWindow> window;
+    vtkNew<vtkRenderer> renderer;
+    vtkNew<vtkWindowToImageFilter> capture;
+    Visualizer visualizer;
+    vtkSmartPointer<vtkActor> gridActor = vtkSmartPointer<vtkActor>::New();
+    vtkSmartPointer<vtkActor2D> linesActor = vtkSmartPointer<vtkActor2D>::New();
+    vtkSmartPointer<vtkTextMapper> stepTextMapper = vtkSmartPointer<vtkTextMapper>::New();
+
+    bool fitCameraToGrid = false; ///< the camera is not copied, it is reset to show the whole grid
+    bool sceneBuilt = false;      ///< lines and step text were added by the first frame
+};
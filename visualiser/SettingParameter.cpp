@@ -1,5 +1,41 @@
+#include <algorithm> // std::max
+#include <cmath>      // std::isfinite
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
 #include "SettingParameter.h"
+#include "config/Config.h"
+#include "visualiser/CellColors.h" // colorReductionFromName
+#include "visualiser/SubstateColumns.h" // substateStorageFromName
+
+
+namespace
+{
+constexpr unsigned DEFAULT_PREFETCH_STEPS = 4;
+constexpr std::size_t DEFAULT_STEP_CACHE_MEMORY_MB = 1024;
+constexpr std::size_t DEFAULT_COMPRESSED_STEP_CACHE_MEMORY_MB = 0;
+constexpr std::size_t DEFAULT_MAX_OPEN_FILES = 256;
+constexpr const char* DEFAULT_LOD_REDUCTION = "average";
+constexpr const char* DEFAULT_SUBSTATE_STORAGE = "cells";
+constexpr double DEFAULT_HEIGHT_SCALE = 1;
+
+/** @brief Prepares the output file path for saving visualization data
+ *  @param configFile Path to the configuration file
+ *  @param outputFileNameFromCfg Output filename from configuration
+ *  @return Full path to the output file */
+std::string prepareOutputFileName(const std::string& configFile, const std::string& outputFileNameFromCfg)
+{
+    namespace fs = std::filesystem;
+
+    // Step 1: prepare output directory
+    fs::path configPath(configFile);
+    fs::path outputDir = configPath.parent_path() / "Output";
+    fs::create_directories(outputDir); // ensure that directory exists
+
+    // Step 2: build full output file path
+    return (outputDir / outputFileNameFromCfg).string();
+}
+} // namespace
 
 std::ostream& operator<<(std::ostream& os, const SettingParameter& sp)
 {
@@ -8,6 +44,134 @@ std::ostream& operator<<(std::ostream& os, const SettingParameter& sp)
        << "numberOfRowsY=" << sp.numberOfRowsY << ", "
        << "nNodeX=" << sp.nNodeX << ", "
        << "nNodeY=" << sp.nNodeY << ", "
-       << "outputFileName=" << sp.outputFileName << "}";
+       << "outputFileName=" << sp.outputFileName << ", "
+       << "remoteAgent=" << sp.remoteAgent << ", "
+       << "prefetchSteps=" << sp.prefetchSteps << ", "
+       << "stepCacheMemoryMB=" << sp.stepCacheMemoryMB << ", "
+       << "compressedStepCacheMemoryMB=" << sp.compressedStepCacheMemoryMB << ", "
+       << "maxOpenFiles=" << sp.maxOpenFiles << ", "
+       << "lodReduction=" << sp.lodReduction << ", "
+       << "substateStorage=" << sp.substateStorage << ", "
+       << "colorSubstate=" << sp.colorSubstate << ", "
+       << "heightSubstate=" << sp.heightSubstate << ", "
+       << "heightScale=" << sp.heightScale << "}";
     return os;
 }
+
+void readSettingParameterFromConfigFile(const std::string& filename, SettingParameter& sp)
+{
+    Config config(filename);
+
+    {
+        ConfigCategory* generalContext = config.getConfigCategory("GENERAL");
+        const std::string outputFileNameFromCfg = generalContext->getConfigParameter("output_file_name")->getValue<std::string>();
+        sp.outputFileName = prepareOutputFileName(filename, outputFileNameFromCfg);
+        sp.numberOfColumnX = generalContext->getConfigParameter("number_of_columns")->getValue<int>();
+        sp.numberOfRowsY = generalContext->getConfigParameter("number_of_rows")->getValue<int>();
+        sp.nsteps = generalContext->getConfigParameter("number_steps")->getValue<int>();
+    }
+
+    {
+        ConfigCategory* execContext = config.getConfigCategory("DISTRIBUTED");
+        sp.nNodeX = execContext->getConfigParameter("number_node_x")->getValue<int>();
+        sp.nNodeY = execContext->getConfigParameter("number_node_y")->getValue<int>();
+        /// Notice: there are much more params, which are not used: e.g. border_size_x, border_size_y
+    }
+
+    // Each node has 2 lines (top and left edges)
+    // Plus additional lines for bottom edge (nNodeX lines) and right edge (nNodeY lines)
+    sp.numberOfLines = 2 * (sp.nNodeX * sp.nNodeY) + sp.nNodeX + sp.nNodeY;
+
+    {
+        ConfigCategory* visualizationContext = config.getConfigCategory("VISUALIZATION");
+        if (visualizationContext)
+        {
+            // Read visualization mode (text or binary)
+            auto modeParam = visualizationContext->getConfigParameter("mode");
+            sp.readMode = modeParam ? modeParam->getValue<std::string>() : "text";
+
+            // Read address of the agent serving the output (remote mode)
+            auto remoteAgentParam = visualizationContext->getConfigParameter("remote_agent");
+            sp.remoteAgent = remoteAgentParam ? remoteAgentParam->getValue<std::string>() : "";
+
+            // Read substates
+            auto substatesParam = visualizationContext->getConfigParameter("substates");
+            sp.substates = substatesParam ? substatesParam->getValue<std::string>() : "";
+
+            // Read reduction operations
+            auto reductionParam = visualizationContext->getConfigParameter("reduction");
+            sp.reduction = reductionParam ? reductionParam->getValue<std::string>() : "";
+
+            // Read background decoding (prefetch) settings
+            auto prefetchStepsParam = visualizationContext->getConfigParameter("prefetch_steps");
+            sp.prefetchSteps = prefetchStepsParam ? std::max(0, prefetchStepsParam->getValue<int>()) : DEFAULT_PREFETCH_STEPS;
+
+            auto stepCacheMemoryParam = visualizationContext->getConfigParameter("step_cache_memory_mb");
+            sp.stepCacheMemoryMB = stepCacheMemoryParam ? std::max(0, stepCacheMemoryParam->getValue<int>()) : DEFAULT_STEP_CACHE_MEMORY_MB;
+            auto compressedStepCacheMemoryParam = visualizationContext->getConfigParameter("compressed_step_cache_memory_mb");
+            sp.compressedStepCacheMemoryMB = compressedStepCacheMemoryParam ? std::max(0, compressedStepCacheMemoryParam->getValue<int>()) : DEFAULT_COMPRESSED_STEP_CACHE_MEMORY_MB;
+
+            // Read limit of node files kept open (to stay below the ulimit with big node grids)
+            auto maxOpenFilesParam = visualizationContext->getConfigParameter("max_open_files");
+            sp.maxOpenFiles = maxOpenFilesParam ? std::max(1, maxOpenFilesParam->getValue<int>()) : DEFAULT_MAX_OPEN_FILES;
+
+            // Read reduction used by levels of detail of big grids
+            auto lodReductionParam = visualizationContext->getConfigParameter("lod_reduction");
+            sp.lodReduction = lodReductionParam ? lodReductionParam->getValue<std::string>() : DEFAULT_LOD_REDUCTION;
+            try
+            {
+                colorReductionFromName(sp.lodReduction);
+            }
+            catch (const std::invalid_argument& e)
+            {
+                std::cerr << "Warning: " << e.what() << ", using '" << DEFAULT_LOD_REDUCTION << "'" << std::endl;
+                sp.lodReduction = DEFAULT_LOD_REDUCTION;
+            }
+
+            // Read how decoded steps keep the substates (whole cells or one array per substate)
+            auto substateStorageParam = visualizationContext->getConfigParameter("substate_storage");
+            sp.substateStorage = substateStorageParam ? substateStorageParam->getValue<std::string>() : DEFAULT_SUBSTATE_STORAGE;
+            try
+            {
+                substateStorageFromName(sp.substateStorage);
+            }
+            catch (const std::invalid_argument& e)
+            {
+                std::cerr << "Warning: " << e.what() << ", using '" << DEFAULT_SUBSTATE_STORAGE << "'" << std::endl;
+                sp.substateStorage = DEFAULT_SUBSTATE_STORAGE;
+            }
+
+            // Read substate coloured on the GPU from its raw values (instead of colours of the model)
+            auto colorSubstateParam = visualizationContext->getConfigParameter("color_substate");
+            sp.colorSubstate = colorSubstateParam ? colorSubstateParam->getValue<std::string>() : "";
+
+            // Read substate drawn as elevation of the grid and its scale
+            auto heightSubstateParam = visualizationContext->getConfigParameter("height_substate");
+            sp.heightSubstate = heightSubstateParam ? heightSubstateParam->getValue<std::string>() : "";
+            auto heightScaleParam = visualizationContext->getConfigParameter("height_scale");
+            sp.heightScale = heightScaleParam ? heightScaleParam->getValue<double>() : DEFAULT_HEIGHT_SCALE;
+            if (! std::isfinite(sp.heightScale))
+            {
+                std::cerr << "Warning: height_scale must be a finite number, using " << DEFAULT_HEIGHT_SCALE << std::endl;
+                sp.heightScale = DEFAULT_HEIGHT_SCALE;
+            }
+        }
+        else
+        {
+            // Default values if VISUALIZATION section is not present
+            sp.readMode = "text";
+            sp.remoteAgent = "";
+            sp.substates = "";
+            sp.reduction = "";
+            sp.prefetchSteps = DEFAULT_PREFETCH_STEPS;
+            sp.stepCacheMemoryMB = DEFAULT_STEP_CACHE_MEMORY_MB;
+            sp.compressedStepCacheMemoryMB = DEFAULT_COMPRESSED_STEP_CACHE_MEMORY_MB;
+            sp.maxOpenFiles = DEFAULT_MAX_OPEN_FILES;
+            sp.lodReduction = DEFAULT_LOD_REDUCTION;
+            sp.substateStorage = DEFAULT_SUBSTATE_STORAGE;
+            sp.colorSubstate = "";
+            sp.heightSubstate = "";
+            sp.heightScale = DEFAULT_HEIGHT_SCALE;
+        }
+    }
+}
@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
+#include <optional>
 #include <string>
 
+#include "utilities/StepLayout.h" // CellRegion
 #include "utilities/types.h"
 
 /** @struct SettingParameter
@@ -15,22 +18,41 @@
  * behavior of the simulation. */
 struct SettingParameter
 {
-    StepIndex step;             ///< Current simulation step
-    StepIndex nsteps;           ///< Total number of simulation steps
-    int numberOfColumnX;        ///< Number of columns in the simulation grid
-    int numberOfRowsY;          ///< Number of rows in the simulation grid
-    NodeIndex nNodeX;           ///< Number of nodes in X direction
-    NodeIndex nNodeY;           ///< Number of nodes in Y direction
-    int numberOfLines;          ///< Total number of lines in the visualization
-    std::string outputFileName; ///< Name of the output file
-    std::string readMode;       ///< File read mode: "text" or "binary"
-    std::string substates;      ///< Substates to read (e.g., "h,z")
-    std::string reduction;      ///< Reduction operations (e.g., "sum,min,max")
+    StepIndex step;                ///< Current simulation step
+    StepIndex nsteps;              ///< Total number of simulation steps
+    int numberOfColumnX;           ///< Number of columns in the simulation grid
+    int numberOfRowsY;             ///< Number of rows in the simulation grid
+    NodeIndex nNodeX;              ///< Number of nodes in X direction
+    NodeIndex nNodeY;              ///< Number of nodes in Y direction
+    int numberOfLines;             ///< Total number of lines in the visualization
+    std::string outputFileName;    ///< Name of the output file
+    std::string readMode;          ///< File read mode: "text", "binary", "container" (see OutputContainer) or "remote" (see RemoteOutputClient)
+    std::string remoteAgent;       ///< Address "host:port" of the agent serving the output in the remote mode
+    std::string substates;         ///< Substates to read (e.g., "h,z")
+    std::string reduction;         ///< Reduction operations (e.g., "sum,min,max")
+    unsigned prefetchSteps;        ///< Number of steps decoded in background ahead of the playback
+    std::size_t stepCacheMemoryMB; ///< Memory budget (in MiB) of the cache of decoded steps
+    std::size_t compressedStepCacheMemoryMB; ///< Memory budget (in MiB) of steps evicted from the cache, kept delta-compressed (0: not kept)
+    std::size_t maxOpenFiles;      ///< Maximum number of node files kept open between steps
+    std::string lodReduction;      ///< Reduction of cell blocks in coarser levels of detail: "average" or "max"
+    std::string substateStorage;   ///< How decoded steps keep substates: "cells" (whole cells) or "columns" (one array per substate)
+    std::string colorSubstate;     ///< Substate whose raw values are coloured on the GPU (ColorSettings ramp), empty: colours of the model
+    std::string heightSubstate;    ///< Substate giving elevation of the cells (heightfield mesh), empty: flat grid
+    double heightScale;            ///< Elevation of the grid per unit of the height substate
+    std::optional<CellRegion> regionOfInterest; ///< Only nodes intersecting it are read (visible part of the grid), all when empty
 
     static constexpr int font_size = 18; ///< Font size for text rendering
 
-    bool changed; ///< Flag indicating if settings have been modified and currently visible state should be redrown
+    bool changed;                  ///< Flag indicating if settings have been modified and currently visible state should be redrown
 
     /// @brief Printing SettingParameter to output stream
     friend std::ostream& operator<<(std::ostream& os, const SettingParameter& sp);
 };
+
+/** @brief Reads description of the stage from the configuration file: grid and nodes, output files and VISUALIZATION settings.
+ *
+ * Fields of the current view (step, changed, regionOfInterest) are not touched. The output directory
+ * ("Output" next to the configuration file) is created when missing. Invalid optional values are replaced
+ * by their defaults with a warning.
+ * @throws std::runtime_error If the file cannot be read or a required parameter is missing */
+void readSettingParameterFromConfigFile(const std::string& configFilename, SettingParameter& sp);
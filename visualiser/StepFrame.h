@@ -0,0 +1,39 @@
+/** @file StepFrame.h
+ * @brief Declaration of the StepFrame structure - everything needed to draw one step without the model's cells. */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "utilities/types.h" // StepIndex
+#include "visualiser/Line.h"
+
+struct StepReductions;
+
+/** @struct StepFrame
+ * @brief Decoded step ready for rendering: colours of the cells and lines between nodes.
+ *
+ * It does not depend on the cell type of the model, so it can be produced on a worker thread
+ * by any visualizer and rendered elsewhere (e.g. into an offscreen window by VideoExporter). */
+struct StepFrame
+{
+    StepIndex step{};
+    int rows{};    ///< rows of the whole grid
+    int columns{}; ///< columns of the whole grid
+
+    /// RGB colours of the texture (3 bytes per texel, rows in the order of Visualizer::refreshWindowsVTK())
+    std::shared_ptr<const std::vector<unsigned char>> colors;
+    int levelFactor = 1; ///< colours are of a coarser level of detail when above 1 (grid too big for one texture)
+
+    /// Raw values coloured on the GPU instead of colors (the `color_substate` setting), in the same order and level
+    std::shared_ptr<const std::vector<float>> scalars;
+
+    /// Elevation of the cells at full resolution (the `height_substate` setting), nullptr for a flat grid
+    std::shared_ptr<const std::vector<float>> heights;
+
+    std::vector<Line> lines; ///< lines between nodes
+
+    /// Reductions of substates of the step (see CellReductions.h), nullptr when none are requested
+    std::shared_ptr<const StepReductions> reductions;
+};
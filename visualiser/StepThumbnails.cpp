@@ -0,0 +1,276 @@
+/** @file StepThumbnails.cpp
+ * @brief Implementation of the StepThumbnails class. */
+
+#include <algorithm> // std::max, std::min, std::ranges::lower_bound, std::ranges::equal, std::ranges::find, std::ranges::sort
+#include <cstring>   // std::memcpy
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator> // std::prev, std::end
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include "utilities/MappedFile.h"
+#include "visualiser/StepThumbnails.h"
+
+
+namespace
+{
+/// Layout of the file: ThumbnailsHeader, then for every thumbnail ThumbnailHeader followed by its 3 * width * height bytes
+struct ThumbnailsHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t maxSize;
+    std::uint64_t key;
+    std::uint64_t entriesCount;
+};
+
+struct ThumbnailHeader
+{
+    std::uint32_t step;
+    std::int32_t width;
+    std::int32_t height;
+    std::uint32_t reserved;
+};
+
+constexpr char THUMBNAILS_MAGIC[8] = { 'O', 'O', 'C', 'V', 'T', 'H', 'B', '\0' };
+constexpr std::uint32_t THUMBNAILS_VERSION = 1;
+
+/// Names of files of the output which are caches (they change without the output changing)
+constexpr std::string_view CACHE_EXTENSIONS[] = { ".cache", ".thumbnails", ".tmp" };
+
+/// @brief FNV-1a hash, stable between runs and builds (std::hash is not)
+void hashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+} // namespace
+
+
+std::vector<StepIndex> StepThumbnails::sampledSteps(const std::vector<StepIndex>& availableSteps, std::size_t maxThumbnails)
+{
+    if (availableSteps.size() <= maxThumbnails || 0 == maxThumbnails)
+        return availableSteps;
+
+    const auto stride = (availableSteps.size() + maxThumbnails - 1) / maxThumbnails;
+    std::vector<StepIndex> steps;
+    steps.reserve(maxThumbnails);
+    for (std::size_t i = 0; i < availableSteps.size(); i += stride)
+        steps.push_back(availableSteps[i]);
+    return steps;
+}
+
+StepThumbnail StepThumbnails::thumbnailOf(const StepFrame& frame, FrameColors& colors)
+{
+    const int width = FrameColors::width(frame);
+    const int height = FrameColors::height(frame);
+    std::vector<unsigned char> texels(3 * static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+    colors.write(frame, texels.data());
+
+    // every pixel averages a block of scale x scale texels (smaller at the top and right edges)
+    const int scale = std::max(1, (std::max(width, height) + MAX_SIZE - 1) / MAX_SIZE);
+    const int thumbnailWidth = (width + scale - 1) / scale;
+    const int thumbnailHeight = (height + scale - 1) / scale;
+    StepThumbnail thumbnail{ .width = thumbnailWidth,
+                             .height = thumbnailHeight,
+                             .rgb = std::vector<unsigned char>(3 * static_cast<std::size_t>(thumbnailWidth) * static_cast<std::size_t>(thumbnailHeight)) };
+
+    for (int blockRow = 0; blockRow < thumbnail.height; ++blockRow)
+    {
+        const int firstRow = blockRow * scale;
+        const int lastRow = std::min(firstRow + scale, height);
+        // texels start with the bottom row, thumbnails with the top one
+        unsigned char* pixel = thumbnail.rgb.data() + 3 * static_cast<std::size_t>(thumbnail.height - 1 - blockRow) * thumbnail.width;
+        for (int blockColumn = 0; blockColumn < thumbnail.width; ++blockColumn, pixel += 3)
+        {
+            const int firstColumn = blockColumn * scale;
+            const int lastColumn = std::min(firstColumn + scale, width);
+            unsigned sums[3] = {};
+            for (int row = firstRow; row < lastRow; ++row)
+            {
+                const unsigned char* texel = texels.data() + 3 * (static_cast<std::size_t>(row) * width + firstColumn);
+                for (int column = firstColumn; column < lastColumn; ++column, texel += 3)
+                {
+                    sums[0] += texel[0];
+                    sums[1] += texel[1];
+                    sums[2] += texel[2];
+                }
+            }
+            const auto count = static_cast<unsigned>((lastRow - firstRow) * (lastColumn - firstColumn));
+            for (int channel = 0; channel < 3; ++channel)
+                pixel[channel] = static_cast<unsigned char>((sums[channel] + count / 2) / count);
+        }
+    }
+    return thumbnail;
+}
+
+void StepThumbnails::insert(StepIndex step, StepThumbnail thumbnail)
+{
+    const auto it = std::ranges::lower_bound(sortedEntries, step, {}, &Entry::step);
+    if (it != sortedEntries.end() && it->step == step)
+        it->thumbnail = std::move(thumbnail);
+    else
+        sortedEntries.insert(it, Entry{ .step = step, .thumbnail = std::move(thumbnail) });
+}
+
+const StepThumbnails::Entry* StepThumbnails::nearest(StepIndex step) const
+{
+    if (sortedEntries.empty())
+        return nullptr;
+
+    const auto it = std::ranges::lower_bound(sortedEntries, step, {}, &Entry::step);
+    if (it == sortedEntries.end())
+        return &sortedEntries.back();
+    if (it == sortedEntries.begin() || it->step == step)
+        return &*it;
+
+    const auto previous = std::prev(it);
+    return step - previous->step <= it->step - step ? &*previous : &*it;
+}
+
+std::string StepThumbnails::cacheFileName(const std::string& outputFileName)
+{
+    return outputFileName + ".thumbnails";
+}
+
+std::optional<std::uint64_t> StepThumbnails::cacheKey(const std::string& outputFileName, const std::string& coloringDescription)
+{
+    const std::filesystem::path outputPath(outputFileName);
+    const auto directory = outputPath.has_parent_path() ? outputPath.parent_path() : std::filesystem::path(".");
+    const auto prefix = outputPath.filename().string();
+
+    std::vector<std::tuple<std::string, std::uint64_t, std::int64_t>> outputFiles;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; ! error && it != end; it.increment(error))
+    {
+        const auto name = it->path().filename().string();
+        const auto extension = it->path().extension().string();
+        if (! name.starts_with(prefix) || std::ranges::find(CACHE_EXTENSIONS, extension) != std::end(CACHE_EXTENSIONS))
+            continue;
+
+        std::error_code statusError;
+        if (! it->is_regular_file(statusError))
+            continue;
+        const auto size = it->file_size(statusError);
+        const auto modificationTime = it->last_write_time(statusError);
+        if (statusError)
+            continue;
+        outputFiles.emplace_back(name, static_cast<std::uint64_t>(size), static_cast<std::int64_t>(modificationTime.time_since_epoch().count()));
+    }
+    if (outputFiles.empty())
+        return std::nullopt;
+
+    std::ranges::sort(outputFiles); // the order of the directory is not stable
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hashBytes(hash, coloringDescription.data(), coloringDescription.size());
+    for (const auto& [name, size, modificationTime] : outputFiles)
+    {
+        hashBytes(hash, name.data(), name.size() + 1); // with the terminating zero, so names cannot run into each other
+        hashBytes(hash, &size, sizeof(size));
+        hashBytes(hash, &modificationTime, sizeof(modificationTime));
+    }
+    return hash;
+}
+
+bool StepThumbnails::writeCacheFile(const std::string& fileName, std::uint64_t key) const
+{
+    ThumbnailsHeader header{};
+    std::memcpy(header.magic, THUMBNAILS_MAGIC, sizeof(header.magic));
+    header.version = THUMBNAILS_VERSION;
+    header.maxSize = MAX_SIZE;
+    header.key = key;
+    header.entriesCount = sortedEntries.size();
+
+    // written under temporary name and renamed, so a reader never sees a half-written file
+    const auto temporaryName = fileName + ".tmp";
+    {
+        std::ofstream cacheFile(temporaryName, std::ios::binary | std::ios::trunc);
+        if (! cacheFile)
+            return false;
+
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& [step, thumbnail] : sortedEntries)
+        {
+            const ThumbnailHeader thumbnailHeader{ .step = step, .width = thumbnail.width, .height = thumbnail.height, .reserved = 0 };
+            cacheFile.write(reinterpret_cast<const char*>(&thumbnailHeader), sizeof(thumbnailHeader));
+            cacheFile.write(reinterpret_cast<const char*>(thumbnail.rgb.data()), static_cast<std::streamsize>(thumbnail.rgb.size()));
+        }
+        if (! cacheFile.flush())
+        {
+            cacheFile.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryName, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryName, fileName, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryName, error);
+        return false;
+    }
+    return true;
+}
+
+std::optional<StepThumbnails> StepThumbnails::loadCacheFile(const std::string& fileName, std::uint64_t key)
+{
+    if (! std::filesystem::exists(fileName))
+        return std::nullopt;
+
+    try
+    {
+        const MappedFile cacheFile(fileName);
+
+        ThumbnailsHeader header{};
+        if (cacheFile.size() < sizeof(header))
+            return std::nullopt;
+        std::memcpy(&header, cacheFile.data(), sizeof(header));
+
+        const bool upToDate = std::ranges::equal(header.magic, THUMBNAILS_MAGIC) && THUMBNAILS_VERSION == header.version
+                              && static_cast<std::uint32_t>(MAX_SIZE) == header.maxSize && key == header.key;
+        if (! upToDate)
+            return std::nullopt;
+
+        StepThumbnails thumbnails;
+        thumbnails.sortedEntries.reserve(header.entriesCount);
+        std::size_t offset = sizeof(header);
+        for (std::uint64_t i = 0; i < header.entriesCount; ++i)
+        {
+            ThumbnailHeader thumbnailHeader{};
+            if (cacheFile.size() - offset < sizeof(thumbnailHeader))
+                throw std::runtime_error("the file is truncated");
+            std::memcpy(&thumbnailHeader, cacheFile.data() + offset, sizeof(thumbnailHeader));
+            offset += sizeof(thumbnailHeader);
+
+            if (thumbnailHeader.width <= 0 || thumbnailHeader.height <= 0 || thumbnailHeader.width > MAX_SIZE || thumbnailHeader.height > MAX_SIZE)
+                throw std::runtime_error(std::format("invalid size {}x{} of the thumbnail of step {}", thumbnailHeader.width, thumbnailHeader.height, thumbnailHeader.step));
+            const auto bytes = 3 * static_cast<std::size_t>(thumbnailHeader.width) * static_cast<std::size_t>(thumbnailHeader.height);
+            if (cacheFile.size() - offset < bytes)
+                throw std::runtime_error("the file is truncated");
+
+            const auto* pixels = reinterpret_cast<const unsigned char*>(cacheFile.data() + offset);
+            offset += bytes;
+
+            thumbnails.insert(thumbnailHeader.step,
+                              StepThumbnail{ .width = thumbnailHeader.width,
+                                             .height = thumbnailHeader.height,
+                                             .rgb = std::vector<unsigned char>(pixels, pixels + bytes) });
+        }
+        return thumbnails;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << std::format("Warning: ignoring thumbnails cache '{}': {}", fileName, e.what()) << std::endl;
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,90 @@
+/** @file StepThumbnails.h
+ * @brief Declaration of the StepThumbnails class - small pictures of sampled steps, previews of the step slider. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "utilities/types.h" // StepIndex
+#include "visualiser/FrameColors.h"
+#include "visualiser/StepFrame.h"
+
+/// @brief Small RGB picture of a step
+struct StepThumbnail
+{
+    int width{};
+    int height{};
+    std::vector<unsigned char> rgb; ///< 3 bytes per pixel, the top row first (the order of QImage, unlike StepFrame)
+};
+
+/** @class StepThumbnails
+ * @brief Thumbnails of every k-th step of the output, so events of a long run are found without reading its steps.
+ *
+ * A thumbnail is made from the coarsest level of detail of the decoded step which is still at least MAX_SIZE texels
+ * large, its texels are averaged in blocks. At most MAX_THUMBNAILS steps get a thumbnail (see sampledSteps()),
+ * so a few MB cover a run of any length.
+ *
+ * Thumbnails are stored next to the output in `<output>.thumbnails`, reopening the same output with the same
+ * colouring loads them from there. The file is valid only for the key computed by cacheKey(): a changed output
+ * file (even a step appended) or other colouring makes it outdated. */
+class StepThumbnails
+{
+public:
+    struct Entry
+    {
+        StepIndex step;
+        StepThumbnail thumbnail;
+    };
+
+    static constexpr int MAX_SIZE = 64;                 ///< pixels of the longer side of a thumbnail
+    static constexpr std::size_t MAX_THUMBNAILS = 512; ///< more would not be distinguished on the slider anyway
+
+    /// @brief Steps getting thumbnails: every k-th of the available steps (sorted), k chosen so at most maxThumbnails are taken
+    static std::vector<StepIndex> sampledSteps(const std::vector<StepIndex>& availableSteps, std::size_t maxThumbnails = MAX_THUMBNAILS);
+
+    /** @brief Thumbnail of the frame, its longer side has at most MAX_SIZE pixels (a smaller grid keeps its size).
+     *  @throws std::invalid_argument If the frame has neither colours nor raw values (see FrameColors::write()) */
+    static StepThumbnail thumbnailOf(const StepFrame& frame, FrameColors& colors);
+
+    /// @brief Adds the thumbnail of the step, replaces the older one of the same step
+    void insert(StepIndex step, StepThumbnail thumbnail);
+
+    /// @brief Thumbnail of the step nearest to the given one (the earlier one of two equally near), nullptr when there are none
+    const Entry* nearest(StepIndex step) const;
+
+    const std::vector<Entry>& entries() const
+    {
+        return sortedEntries;
+    }
+
+    std::size_t size() const
+    {
+        return sortedEntries.size();
+    }
+
+    bool empty() const
+    {
+        return sortedEntries.empty();
+    }
+
+    /// @brief Name of the file with thumbnails of the output (`outputFileName` is the base name of node files)
+    static std::string cacheFileName(const std::string& outputFileName);
+
+    /** @brief Key of the file with thumbnails: hash of the description of colouring and of sizes and modification times
+     *         of the output files (`<output>*` except caches).
+     *  @return std::nullopt when there are no output files on this machine (the remote mode), then nothing is cached */
+    static std::optional<std::uint64_t> cacheKey(const std::string& outputFileName, const std::string& coloringDescription);
+
+    /// @brief Writes the thumbnails atomically (temporary file + rename), returns false on failure
+    bool writeCacheFile(const std::string& fileName, std::uint64_t key) const;
+
+    /// @brief Returns thumbnails read from the file, or std::nullopt if it is missing, of another key or damaged
+    static std::optional<StepThumbnails> loadCacheFile(const std::string& fileName, std::uint64_t key);
+
+private:
+    std::vector<Entry> sortedEntries; ///< sorted by step, steps are unique
+};
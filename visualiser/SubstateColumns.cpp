@@ -0,0 +1,45 @@
+/** @file SubstateColumns.cpp
+ * @brief Implementation of the columnar storage of substates. */
+
+#include "SubstateColumns.h"
+
+#include <format>
+#include <stdexcept>
+#include <utility> // std::move
+
+
+SubstateStorage substateStorageFromName(std::string_view name)
+{
+    if (name.empty() || "cells" == name)
+        return SubstateStorage::Cells;
+    if ("columns" == name)
+        return SubstateStorage::Columns;
+    throw std::invalid_argument(std::format("Unknown substate storage '{}' (expected 'cells' or 'columns')", name));
+}
+
+
+SubstateColumns::SubstateColumns(std::vector<std::string> names, int rows, int columns)
+    : names{ std::move(names) }
+    , rows{ rows }
+    , columns{ columns }
+    , values(this->names.size(), std::vector<double>(static_cast<std::size_t>(rows) * columns, std::numeric_limits<double>::quiet_NaN()))
+{
+}
+
+std::optional<std::size_t> SubstateColumns::indexOf(std::string_view name) const
+{
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        if (names[i] == name)
+            return i;
+    }
+    return std::nullopt;
+}
+
+std::size_t SubstateColumns::memoryUsage() const
+{
+    std::size_t bytes = sizeof(*this);
+    for (const auto& column : values)
+        bytes += column.size() * sizeof(double);
+    return bytes;
+}
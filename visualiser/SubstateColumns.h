@@ -0,0 +1,115 @@
+/** @file SubstateColumns.h
+ * @brief Declaration of the SubstateColumns structure - values of chosen substates of cells stored column by column (structure of arrays). */
+
+#pragma once
+
+#include <charconv> // std::from_chars
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utilities/StepLayout.h" // CellRegion
+
+/** @concept CellWithNumericSubstate
+ * @brief Cell type which can return value of its substate as a number (optional hook of a model).
+ *
+ * Such a type provides `double substateValue(const char* substate) const`. Without it the value is parsed
+ * from stringEncoding(substate), which allocates a string for every cell. */
+template<typename Cell>
+concept CellWithNumericSubstate = requires(const Cell& cell, const char* substate) {
+    { cell.substateValue(substate) } -> std::convertible_to<double>;
+};
+
+/** @brief Value of the cell's substate: from the numeric hook or parsed from its string encoding.
+ *  @return NaN when the encoding is not a number */
+template<typename Cell>
+double cellSubstateValue(const Cell& cell, const char* substate)
+{
+    if constexpr (CellWithNumericSubstate<Cell>)
+    {
+        return static_cast<double>(cell.substateValue(substate));
+    }
+    else
+    {
+        const std::string encoding = cell.stringEncoding(substate);
+        const char* begin = encoding.data();
+        const char* const end = encoding.data() + encoding.size();
+        while (begin < end && ' ' == *begin)
+            ++begin;
+
+        double value{};
+        const auto [ptr, ec] = std::from_chars(begin, end, value);
+        return (ec == std::errc{}) ? value : std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+/// @brief How decoded steps keep their data (the `substate_storage` setting)
+enum class SubstateStorage
+{
+    Cells,  ///< the whole cells of the model (array of structures), needed e.g. by models without numeric substates
+    Columns ///< one contiguous array per substate from the `substates` setting, the cells are dropped after colouring
+};
+
+/** @brief Parses storage name used in config files ("cells" or "columns", empty means the default "cells").
+ *  @throws std::invalid_argument For other names */
+SubstateStorage substateStorageFromName(std::string_view name);
+
+/** @struct SubstateColumns
+ * @brief Values of the chosen substates of all cells of a step, one contiguous row-major array per substate.
+ *
+ * The arrays are filled node by node by the reading workers (nodes are disjoint, so no locking is needed)
+ * right after the node's cells are parsed. Only the substates in use are kept, which takes memory proportional
+ * to their number instead of the size of the whole cell, and lets kernels (e.g. reductions) stream plain doubles.
+ * Cells which were not read (outside of the region of interest) or are not numeric hold NaN. */
+struct SubstateColumns
+{
+    std::vector<std::string> names;
+    int rows{};
+    int columns{};
+    std::vector<std::vector<double>> values; ///< values[substate][row * columns + column]
+
+    SubstateColumns() = default;
+
+    SubstateColumns(std::vector<std::string> names, int rows, int columns);
+
+    /// @brief Index of the substate in names
+    std::optional<std::size_t> indexOf(std::string_view name) const;
+
+    /// @brief Values of one row of the substate
+    std::span<const double> row(std::size_t substate, int row) const
+    {
+        return std::span<const double>(values[substate]).subspan(static_cast<std::size_t>(row) * columns, columns);
+    }
+
+    /// @brief Whether the columns hold the same substates of a grid of the same size
+    bool hasLayout(const std::vector<std::string>& otherNames, int otherRows, int otherColumns) const
+    {
+        return names == otherNames && rows == otherRows && columns == otherColumns;
+    }
+
+    /// @brief Approximate number of bytes occupied (used for the step cache budget)
+    std::size_t memoryUsage() const;
+
+    /** @brief Copies values of the substates of cells in the region (clipped to the grid) into the columns.
+     *  Thread-safe for disjoint regions. */
+    template<typename Matrix>
+    void extract(const Matrix& cells, const CellRegion& region)
+    {
+        for (int row = region.firstRow; row < region.firstRow + region.rows; ++row)
+        {
+            const auto cellsOfRow = cells[row].subspan(region.firstColumn, region.columns);
+            const auto rowOffset = static_cast<std::size_t>(row) * columns + region.firstColumn;
+            for (std::size_t s = 0; s < names.size(); ++s)
+            {
+                double* destination = values[s].data() + rowOffset;
+                for (const auto& cell : cellsOfRow)
+                    *destination++ = cellSubstateValue(cell, names[s].c_str());
+            }
+        }
+    }
+};
@@ -0,0 +1,182 @@
+/** @file TemporalAggregation.cpp
+ * @brief Implementation of the temporal aggregation of substates of cells. */
+
+#include "TemporalAggregation.h"
+
+#include <array>
+#include <cmath> // std::isfinite
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+
+namespace
+{
+constexpr std::array<std::pair<std::string_view, TemporalOperation>, 5> OPERATION_NAMES{ {
+    { "max", TemporalOperation::Max },
+    { "min", TemporalOperation::Min },
+    { "mean", TemporalOperation::Mean },
+    { "argmax", TemporalOperation::ArgMax },
+    { "first_exceedance", TemporalOperation::FirstExceedance },
+} };
+
+constexpr std::array<TemporalOperation, 5> OPERATIONS{ TemporalOperation::Max,
+                                                       TemporalOperation::Min,
+                                                       TemporalOperation::Mean,
+                                                       TemporalOperation::ArgMax,
+                                                       TemporalOperation::FirstExceedance };
+
+/// Step of cells without a maximum or never reaching the threshold
+constexpr StepIndex NO_STEP = std::numeric_limits<StepIndex>::max();
+
+constexpr float NOT_A_NUMBER = std::numeric_limits<float>::quiet_NaN();
+} // namespace
+
+TemporalOperation temporalOperationFromName(std::string_view name)
+{
+    for (const auto& [knownName, operation] : OPERATION_NAMES)
+    {
+        if (knownName == name)
+            return operation;
+    }
+    throw std::invalid_argument(std::format("Unknown temporal aggregation '{}' (expected max, min, mean, argmax or first_exceedance)", name));
+}
+
+std::string_view temporalOperationName(TemporalOperation operation)
+{
+    for (const auto& [name, knownOperation] : OPERATION_NAMES)
+    {
+        if (knownOperation == operation)
+            return name;
+    }
+    return "?";
+}
+
+std::span<const TemporalOperation> temporalOperations()
+{
+    return OPERATIONS;
+}
+
+std::string TemporalAggregationRequest::description() const
+{
+    if (TemporalOperation::FirstExceedance == operation)
+        return std::format("first step of {} >= {} in steps {}-{}", substate, threshold, firstStep, lastStep);
+    return std::format("{}({}) of steps {}-{}", temporalOperationName(operation), substate, firstStep, lastStep);
+}
+
+TemporalAccumulator::TemporalAccumulator(TemporalOperation operation, int rows, int columns, double threshold)
+    : operation{ operation }
+    , rows{ rows }
+    , columns{ columns }
+    , threshold{ threshold }
+{
+    if (rows < 0 || columns < 0)
+        throw std::invalid_argument(std::format("Invalid size of the aggregated grid: {} x {}", rows, columns));
+
+    const auto cellsCount = static_cast<std::size_t>(rows) * columns;
+    switch (operation)
+    {
+    case TemporalOperation::Max:
+        values.assign(cellsCount, -std::numeric_limits<double>::infinity());
+        break;
+    case TemporalOperation::Min:
+        values.assign(cellsCount, std::numeric_limits<double>::infinity());
+        break;
+    case TemporalOperation::Mean:
+        values.assign(cellsCount, 0.0);
+        counts.assign(cellsCount, 0);
+        break;
+    case TemporalOperation::ArgMax:
+        values.assign(cellsCount, -std::numeric_limits<double>::infinity());
+        steps.assign(cellsCount, NO_STEP);
+        break;
+    case TemporalOperation::FirstExceedance:
+        steps.assign(cellsCount, NO_STEP);
+        break;
+    }
+}
+
+void TemporalAccumulator::addRow(StepIndex step, int row, int firstColumn, std::span<const double> values)
+{
+    const auto first = static_cast<std::size_t>(row) * columns + firstColumn;
+    switch (operation)
+    {
+    case TemporalOperation::Max:
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (std::isfinite(values[i]) && values[i] > this->values[first + i])
+                this->values[first + i] = values[i];
+        }
+        break;
+    case TemporalOperation::Min:
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (std::isfinite(values[i]) && values[i] < this->values[first + i])
+                this->values[first + i] = values[i];
+        }
+        break;
+    case TemporalOperation::Mean:
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (std::isfinite(values[i]))
+            {
+                this->values[first + i] += values[i];
+                ++counts[first + i];
+            }
+        }
+        break;
+    case TemporalOperation::ArgMax:
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            auto& maximum = this->values[first + i];
+            auto& maximumStep = steps[first + i];
+            if (std::isfinite(values[i]) && (values[i] > maximum || (values[i] == maximum && step < maximumStep)))
+            {
+                maximum = values[i];
+                maximumStep = step;
+            }
+        }
+        break;
+    case TemporalOperation::FirstExceedance:
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (std::isfinite(values[i]) && values[i] >= threshold && step < steps[first + i])
+                steps[first + i] = step;
+        }
+        break;
+    }
+}
+
+std::vector<float> TemporalAccumulator::resultScalars() const
+{
+    std::vector<float> scalars(static_cast<std::size_t>(rows) * columns);
+    const auto cellResult = [this](std::size_t cell)
+    {
+        switch (operation)
+        {
+        case TemporalOperation::Max:
+        case TemporalOperation::Min:
+            return std::isfinite(values[cell]) ? static_cast<float>(values[cell]) : NOT_A_NUMBER;
+        case TemporalOperation::Mean:
+            return counts[cell] > 0 ? static_cast<float>(values[cell] / counts[cell]) : NOT_A_NUMBER;
+        case TemporalOperation::ArgMax:
+        case TemporalOperation::FirstExceedance:
+            return steps[cell] != NO_STEP ? static_cast<float>(steps[cell]) : NOT_A_NUMBER;
+        }
+        return NOT_A_NUMBER;
+    };
+
+    for (int row = 0; row < rows; ++row)
+    {
+        const auto matrixRow = static_cast<std::size_t>(row) * columns;
+        float* imageRow = scalars.data() + static_cast<std::size_t>(rows - 1 - row) * columns;
+        for (int column = 0; column < columns; ++column)
+            imageRow[column] = cellResult(matrixRow + column);
+    }
+    return scalars;
+}
+
+std::size_t TemporalAccumulator::memoryUsage() const
+{
+    return values.capacity() * sizeof(double) + steps.capacity() * sizeof(StepIndex) + counts.capacity() * sizeof(std::uint32_t);
+}
@@ -0,0 +1,83 @@
+/** @file TemporalAggregation.h
+ * @brief Aggregation of a substate of every cell over a range of steps (e.g. maximum flow depth of the whole run). */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utilities/types.h"
+
+/// @brief Operation aggregating values of every cell over steps (names as accepted by temporalOperationFromName())
+enum class TemporalOperation
+{
+    Max,
+    Min,
+    Mean,
+    ArgMax,         ///< step of the maximum (the earliest one of equal maxima)
+    FirstExceedance ///< first step in which the value reached the threshold
+};
+
+/** @brief Parses the operation name: "max", "min", "mean", "argmax" or "first_exceedance".
+ *  @throws std::invalid_argument For other names */
+TemporalOperation temporalOperationFromName(std::string_view name);
+
+/// @brief Name of the operation as accepted by temporalOperationFromName()
+std::string_view temporalOperationName(TemporalOperation operation);
+
+/// @brief All operations, in the order of the enum (e.g. for choosing one in the GUI)
+std::span<const TemporalOperation> temporalOperations();
+
+/** @struct TemporalAggregationRequest
+ * @brief Substate, operation and steps of a temporal aggregation. */
+struct TemporalAggregationRequest
+{
+    std::string substate;
+    TemporalOperation operation = TemporalOperation::Max;
+    StepIndex firstStep{};
+    StepIndex lastStep{}; ///< inclusive
+    double threshold{};   ///< value which has to be reached, only for TemporalOperation::FirstExceedance
+
+    /// @brief Short text shown instead of the step number, e.g. "max(h) of steps 0-4000"
+    std::string description() const;
+};
+
+/** @class TemporalAccumulator
+ * @brief Accumulators of one substate for every cell of the grid, to which steps are added one by one.
+ *
+ * Only the accumulators are kept (one value per cell, plus a count for the mean), never the steps,
+ * so a run of thousands of steps needs the memory of a few grids of numbers.
+ * Every operation is commutative (equal maxima keep the earliest step, the first exceedance is the lowest step),
+ * so the result does not depend on the order in which steps are added and steps can be added by different threads.
+ * Rows of different cells can be added concurrently, the same cells have to be guarded by the caller. */
+class TemporalAccumulator
+{
+public:
+    /// @throws std::invalid_argument For negative dimensions
+    TemporalAccumulator(TemporalOperation operation, int rows, int columns, double threshold = 0);
+
+    /** @brief Adds values of consecutive cells of one row of the grid (matrix order) in the step.
+     *  Values which are not finite (e.g. a substate which is not a number) are ignored. */
+    void addRow(StepIndex step, int row, int firstColumn, std::span<const double> values);
+
+    /** @brief Result of every cell in VTK image order (rows flipped, as writeCellScalarsOfRegion() writes them),
+     *  NaN for cells without any value (or never reaching the threshold) */
+    std::vector<float> resultScalars() const;
+
+    /// @brief Number of bytes occupied by the accumulators
+    std::size_t memoryUsage() const;
+
+private:
+    TemporalOperation operation;
+    int rows;
+    int columns;
+    double threshold;
+
+    std::vector<double> values;       ///< maximum, minimum or sum of every cell, NaN before its first value (not for FirstExceedance)
+    std::vector<StepIndex> steps;     ///< step of the maximum or of the first exceedance (ArgMax, FirstExceedance only)
+    std::vector<std::uint32_t> counts; ///< number of added values (Mean only)
+};
@@ -0,0 +1,423 @@
+/** @file VideoEncoder.cpp
+ * @brief Implementation of the video encoders: vtkOggTheoraWriter and FFmpeg (libavcodec/libavformat, when available). */
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <new> // std::bad_alloc
+#include <stdexcept>
+#include <string_view>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkOggTheoraWriter.h>
+#include "visualiser/VideoEncoder.h"
+
+#ifdef HAVE_FFMPEG
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+#include <libavutil/hwcontext.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+
+namespace
+{
+class OggTheoraVideoEncoder final : public VideoEncoder
+{
+public:
+    OggTheoraVideoEncoder(const std::string& filePath, int fps)
+        : filePath(filePath)
+    {
+        writer->SetFileName(filePath.c_str());
+        writer->SetRate(fps);
+        writer->SetQuality(2); // Quality 0-2, where 2 is highest
+    }
+
+    void writeFrame(vtkImageData* image) override
+    {
+        writer->SetInputData(image);
+        if (! started)
+        {
+            writer->Start();
+            started = true;
+        }
+        writer->Write();
+        if (writer->GetError())
+        {
+            throw std::runtime_error(std::format("Failed to write frame to video file '{}'", filePath));
+        }
+    }
+
+    void finish() override
+    {
+        if (started)
+        {
+            writer->End();
+            started = false;
+        }
+    }
+
+    std::string name() const override
+    {
+        return "theora";
+    }
+
+private:
+    std::string filePath;
+    vtkNew<vtkOggTheoraWriter> writer;
+    bool started = false;
+};
+
+#ifdef HAVE_FFMPEG
+/// @brief Encoders tried for the codec, the fastest first
+std::vector<std::string> ffmpegEncoderCandidates(const std::string& codec)
+{
+    if ("h264" == codec)
+        return { "h264_nvenc", "h264_vaapi", "libx264", "libopenh264" };
+    if ("h265" == codec || "hevc" == codec)
+        return { "hevc_nvenc", "hevc_vaapi", "libx265" };
+    return { codec };
+}
+
+bool isAnyEncoderAvailable(const std::vector<std::string>& candidates)
+{
+    for (const auto& candidate : candidates)
+    {
+        if (avcodec_find_encoder_by_name(candidate.c_str()))
+            return true;
+    }
+    return false;
+}
+
+std::string ffmpegError(int errorCode)
+{
+    char description[AV_ERROR_MAX_STRING_SIZE]{};
+    av_strerror(errorCode, description, sizeof(description));
+    return description;
+}
+
+/** @class FFmpegVideoEncoder
+ * @brief Encodes frames with libavcodec into a container chosen by libavformat from the file extension (e.g. MP4, MKV).
+ *
+ * The codec is opened with the first frame, when the size is known. Frames are converted to YUV 4:2:0
+ * (NV12 uploaded to the GPU for VAAPI) with the rows flipped, as VTK images start from the bottom.
+ * The size is rounded down to even numbers, which 4:2:0 needs. */
+class FFmpegVideoEncoder final : public VideoEncoder
+{
+public:
+    FFmpegVideoEncoder(const std::string& filePath, int fps, const VideoEncoding& encoding)
+        : filePath(filePath)
+        , fps(fps)
+        , encoding(encoding)
+        , candidates(ffmpegEncoderCandidates(encoding.codec))
+    {
+    }
+
+    ~FFmpegVideoEncoder() override
+    {
+        av_frame_free(&frame);
+        av_frame_free(&hardwareFrame);
+        av_packet_free(&packet);
+        sws_freeContext(scaler);
+        avcodec_free_context(&codecContext);
+        av_buffer_unref(&hardwareDevice);
+        if (formatContext)
+        {
+            if (! (formatContext->oformat->flags & AVFMT_NOFILE))
+                avio_closep(&formatContext->pb);
+            avformat_free_context(formatContext);
+        }
+    }
+
+    FFmpegVideoEncoder(const FFmpegVideoEncoder&) = delete;
+    FFmpegVideoEncoder& operator=(const FFmpegVideoEncoder&) = delete;
+
+    void writeFrame(vtkImageData* image) override
+    {
+        int dimensions[3];
+        image->GetDimensions(dimensions);
+        const int components = image->GetNumberOfScalarComponents();
+        if (image->GetScalarType() != VTK_UNSIGNED_CHAR || (components != 3 && components != 4))
+        {
+            throw std::runtime_error(std::format("Frames of video file '{}' must be RGB or RGBA images with 8 bits per channel", filePath));
+        }
+
+        if (! codecContext)
+        {
+            open(dimensions[0], dimensions[1], 4 == components ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24);
+        }
+        else if (dimensions[0] != width || dimensions[1] != height)
+        {
+            throw std::runtime_error(std::format("Frame of {}x{} pixels differs from the size of video file '{}' ({}x{})",
+                                                 dimensions[0], dimensions[1], filePath, width, height));
+        }
+
+        // rows of VTK images go from the bottom: a negative stride flips the frame
+        const int rowBytes = width * components;
+        const auto* pixels = static_cast<const std::uint8_t*>(image->GetScalarPointer());
+        const std::uint8_t* const sourceRows[] = { pixels + static_cast<std::ptrdiff_t>(height - 1) * rowBytes };
+        const int sourceStrides[] = { -rowBytes };
+
+        check(av_frame_make_writable(frame), "Encoding a frame");
+        sws_scale(scaler, sourceRows, sourceStrides, 0, height, frame->data, frame->linesize);
+        frame->pts = nextTimestamp++;
+
+        if (hardwareFrame)
+        {
+            av_frame_unref(hardwareFrame);
+            check(av_hwframe_get_buffer(codecContext->hw_frames_ctx, hardwareFrame, 0), "Allocating a frame on the GPU");
+            check(av_hwframe_transfer_data(hardwareFrame, frame, 0), "Uploading a frame to the GPU");
+            hardwareFrame->pts = frame->pts;
+            encode(hardwareFrame);
+        }
+        else
+        {
+            encode(frame);
+        }
+    }
+
+    void finish() override
+    {
+        if (! headerWritten || finished)
+            return;
+        finished = true;
+
+        encode(nullptr); // flushes frames delayed by the encoder (B-frames, lookahead)
+        check(av_write_trailer(formatContext), "Writing the trailer");
+    }
+
+    std::string name() const override
+    {
+        return encoderName.empty() ? encoding.codec : encoderName;
+    }
+
+private:
+    void open(int frameWidth, int frameHeight, AVPixelFormat sourceFormat)
+    {
+        width = frameWidth;
+        height = frameHeight;
+        const int encodedWidth = width & ~1;
+        const int encodedHeight = height & ~1;
+        if (encodedWidth <= 0 || encodedHeight <= 0)
+        {
+            throw std::runtime_error(std::format("Frame of {}x{} pixels is too small for video file '{}'", width, height, filePath));
+        }
+
+        check(avformat_alloc_output_context2(&formatContext, nullptr, nullptr, filePath.c_str()), "Choosing the container by the extension");
+
+        std::string failures;
+        for (const auto& candidate : candidates)
+        {
+            const AVCodec* codec = avcodec_find_encoder_by_name(candidate.c_str());
+            if (! codec)
+                continue;
+            if (const int result = openCodec(codec, encodedWidth, encodedHeight); result < 0)
+            {
+                failures += std::format("\n  {}: {}", candidate, ffmpegError(result));
+                continue;
+            }
+            encoderName = candidate;
+            break;
+        }
+        if (! codecContext)
+        {
+            throw std::runtime_error(std::format("No encoder of codec '{}' could be opened for video file '{}':{}", encoding.codec, filePath, failures));
+        }
+
+        stream = avformat_new_stream(formatContext, nullptr);
+        if (! stream)
+        {
+            throw std::runtime_error(std::format("Failed to add a video stream to video file '{}'", filePath));
+        }
+        check(avcodec_parameters_from_context(stream->codecpar, codecContext), "Setting parameters of the stream");
+        stream->time_base = codecContext->time_base;
+
+        if (! (formatContext->oformat->flags & AVFMT_NOFILE))
+            check(avio_open(&formatContext->pb, filePath.c_str(), AVIO_FLAG_WRITE), "Opening");
+        check(avformat_write_header(formatContext, nullptr), "Writing the header");
+        headerWritten = true;
+
+        frame = av_frame_alloc();
+        packet = av_packet_alloc();
+        if (! frame || ! packet)
+        {
+            throw std::bad_alloc();
+        }
+        frame->format = hardwareDevice ? AV_PIX_FMT_NV12 : codecContext->pix_fmt;
+        frame->width = encodedWidth;
+        frame->height = encodedHeight;
+        check(av_frame_get_buffer(frame, 0), "Allocating a frame");
+        if (hardwareDevice)
+        {
+            hardwareFrame = av_frame_alloc();
+            if (! hardwareFrame)
+                throw std::bad_alloc();
+        }
+
+        scaler = sws_getContext(width, height, sourceFormat,
+                                encodedWidth, encodedHeight, static_cast<AVPixelFormat>(frame->format),
+                                SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (! scaler)
+        {
+            throw std::runtime_error(std::format("Failed to set up conversion of frames for video file '{}'", filePath));
+        }
+    }
+
+    /// @return Negative error code of FFmpeg when the encoder cannot be used (e.g. no GPU), the state is cleaned up then
+    int openCodec(const AVCodec* codec, int encodedWidth, int encodedHeight)
+    {
+        codecContext = avcodec_alloc_context3(codec);
+        if (! codecContext)
+            return AVERROR(ENOMEM);
+
+        codecContext->width = encodedWidth;
+        codecContext->height = encodedHeight;
+        codecContext->time_base = AVRational{ 1, fps };
+        codecContext->framerate = AVRational{ fps, 1 };
+        codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+        codecContext->thread_count = 0; // as many threads as cores (software encoders)
+        if (encoding.bitrateKbps > 0)
+            codecContext->bit_rate = static_cast<std::int64_t>(encoding.bitrateKbps) * 1000;
+        if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+            codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        int result = 0;
+        if (std::string_view(codec->name).ends_with("_vaapi"))
+            result = setUpVaapi(encodedWidth, encodedHeight);
+        if (result >= 0)
+            result = avcodec_open2(codecContext, codec, nullptr);
+
+        if (result < 0)
+        {
+            avcodec_free_context(&codecContext);
+            av_buffer_unref(&hardwareDevice);
+        }
+        return result;
+    }
+
+    /// @brief Frames of VAAPI encoders live on the GPU: they are uploaded from NV12 frames
+    int setUpVaapi(int encodedWidth, int encodedHeight)
+    {
+        int result = av_hwdevice_ctx_create(&hardwareDevice, AV_HWDEVICE_TYPE_VAAPI, nullptr, nullptr, 0);
+        if (result < 0)
+            return result;
+
+        AVBufferRef* framesReference = av_hwframe_ctx_alloc(hardwareDevice);
+        if (! framesReference)
+            return AVERROR(ENOMEM);
+        auto* framesContext = reinterpret_cast<AVHWFramesContext*>(framesReference->data);
+        framesContext->format = AV_PIX_FMT_VAAPI;
+        framesContext->sw_format = AV_PIX_FMT_NV12;
+        framesContext->width = encodedWidth;
+        framesContext->height = encodedHeight;
+        framesContext->initial_pool_size = 20;
+
+        result = av_hwframe_ctx_init(framesReference);
+        if (result >= 0)
+        {
+            codecContext->hw_frames_ctx = av_buffer_ref(framesReference);
+            codecContext->pix_fmt = AV_PIX_FMT_VAAPI;
+            if (! codecContext->hw_frames_ctx)
+                result = AVERROR(ENOMEM);
+        }
+        av_buffer_unref(&framesReference);
+        return result;
+    }
+
+    /// @brief Sends the frame (nullptr flushes the encoder) and writes all packets which are ready
+    void encode(const AVFrame* frameToEncode)
+    {
+        check(avcodec_send_frame(codecContext, frameToEncode), "Encoding a frame");
+        while (true)
+        {
+            const int result = avcodec_receive_packet(codecContext, packet);
+            if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+                return;
+            check(result, "Encoding a frame");
+
+            av_packet_rescale_ts(packet, codecContext->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            check(av_interleaved_write_frame(formatContext, packet), "Writing a frame");
+        }
+    }
+
+    void check(int result, std::string_view operation) const
+    {
+        if (result < 0)
+        {
+            throw std::runtime_error(std::format("{} of video file '{}' failed: {}", operation, filePath, ffmpegError(result)));
+        }
+    }
+
+    std::string filePath;
+    int fps;
+    VideoEncoding encoding;
+    std::vector<std::string> candidates;
+    std::string encoderName; ///< the candidate which was opened
+
+    AVFormatContext* formatContext = nullptr;
+    AVCodecContext* codecContext = nullptr;
+    AVStream* stream = nullptr;              ///< owned by formatContext
+    AVBufferRef* hardwareDevice = nullptr;   ///< VAAPI device, nullptr for other encoders
+    SwsContext* scaler = nullptr;
+    AVFrame* frame = nullptr;                ///< converted frame in the memory
+    AVFrame* hardwareFrame = nullptr;        ///< frame uploaded to the GPU (VAAPI)
+    AVPacket* packet = nullptr;
+
+    int width = 0;  ///< of the captured frames
+    int height = 0;
+    std::int64_t nextTimestamp = 0;
+    bool headerWritten = false;
+    bool finished = false;
+};
+#endif
+} // namespace
+
+
+std::unique_ptr<VideoEncoder> createVideoEncoder(const std::string& filePath, int fps, const VideoEncoding& encoding)
+{
+    if (fps <= 0)
+    {
+        throw std::invalid_argument(std::format("Frame rate of the video must be positive, got {}", fps));
+    }
+
+    if ("theora" == encoding.codec)
+    {
+        if (encoding.bitrateKbps > 0)
+            std::cerr << "Warning: the theora encoder does not support a bitrate, " << encoding.bitrateKbps << " kbit/s is ignored" << std::endl;
+        return std::make_unique<OggTheoraVideoEncoder>(filePath, fps);
+    }
+
+#ifdef HAVE_FFMPEG
+    if (! isAnyEncoderAvailable(ffmpegEncoderCandidates(encoding.codec)))
+    {
+        throw std::invalid_argument(std::format("Video codec '{}' is not available in FFmpeg of this build", encoding.codec));
+    }
+    return std::make_unique<FFmpegVideoEncoder>(filePath, fps, encoding);
+#else
+    throw std::invalid_argument(std::format("Video codec '{}' requires FFmpeg, this build supports only theora", encoding.codec));
+#endif
+}
+
+std::vector<std::string> availableVideoCodecs()
+{
+    std::vector<std::string> codecs{ "theora" };
+#ifdef HAVE_FFMPEG
+    for (const std::string codec : { "h264", "h265" })
+    {
+        if (isAnyEncoderAvailable(ffmpegEncoderCandidates(codec)))
+            codecs.push_back(codec);
+    }
+#endif
+    return codecs;
+}
+
+std::string videoFileExtension(const std::string& codec)
+{
+    return "theora" == codec ? ".ogv" : ".mp4";
+}
@@ -0,0 +1,55 @@
+/** @file VideoEncoder.h
+ * @brief Declaration of the VideoEncoder interface and its backends (OGG Theora of VTK, FFmpeg). */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class vtkImageData;
+
+/// @brief Codec and bitrate of an exported video (see createVideoEncoder())
+struct VideoEncoding
+{
+    /// "theora", "h264", "h265" (the fastest available encoder of the codec), or a name of an FFmpeg encoder (e.g. "libx264", "hevc_nvenc")
+    std::string codec = "theora";
+
+    /// Target bitrate in kbit/s, 0 uses the default of the encoder (quality-based for software H.264/H.265)
+    unsigned bitrateKbps = 0;
+};
+
+/** @class VideoEncoder
+ * @brief Writes captured frames into a video file, the backend of VideoExporter.
+ *
+ * Frames are given one by one from one thread (the encoding stage of the export); the size of the video
+ * is the size of the first frame. The encoder may use more threads internally. */
+class VideoEncoder
+{
+public:
+    virtual ~VideoEncoder() = default;
+
+    /** @brief Encodes the frame: RGB or RGBA image with rows from the bottom, as captured by vtkWindowToImageFilter.
+     *  @throws std::runtime_error If the frame cannot be encoded or written */
+    virtual void writeFrame(vtkImageData* image) = 0;
+
+    /** @brief Flushes frames still buffered by the encoder and closes the file (nothing happens without any frame).
+     *  @throws std::runtime_error If the file cannot be finished */
+    virtual void finish() = 0;
+
+    /// @brief Name of the encoder actually used (e.g. "theora", "h264_nvenc", "libx265"), for messages
+    virtual std::string name() const = 0;
+};
+
+/** @brief Creates the encoder of the codec writing into the file (the container is given by its extension for FFmpeg).
+ *
+ * For "h264" and "h265" hardware encoders are tried first (NVENC, then VAAPI), when they are not usable
+ * on this machine the software encoder (libx264/libx265, multi-threaded) is used.
+ * @throws std::invalid_argument If the codec is unknown or not available in this build (FFmpeg codecs need FFmpeg) */
+std::unique_ptr<VideoEncoder> createVideoEncoder(const std::string& filePath, int fps, const VideoEncoding& encoding);
+
+/// @brief Codecs accepted by createVideoEncoder() in this build ("theora" always, "h264" and "h265" with FFmpeg)
+std::vector<std::string> availableVideoCodecs();
+
+/// @brief File extension (with the dot) of the usual container of the codec: ".ogv" for theora, ".mp4" otherwise
+std::string videoFileExtension(const std::string& codec);
@@ -1,23 +1,45 @@
+#include <cstddef>
+#include <exception>
+#include <numeric> // std::iota
 #include <stdexcept>
-#include <vtkOggTheoraWriter.h>
-#include <vtkWindowToImageFilter.h>
-#include <vtkRenderWindow.h>
-#include <vtkNew.h>
+#include <thread>
+#include <utility> // std::move
+#include <vector>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include "utilities/BoundedQueue.h"
 #include "utilities/types.h"
+#include "visualiser/OffscreenScene.h"
+#include "visualiser/VideoEncoder.h"
 #include "visualiser/VideoExporter.h"
 
 
+namespace
+{
+/// Steps decoded ahead of rendering (each one holds colours of the whole grid)
+constexpr std::size_t DECODED_FRAMES_QUEUE_CAPACITY = 8;
+
+/// Rendered frames waiting for the encoder (each one holds the image of the whole window)
+constexpr std::size_t CAPTURED_FRAMES_QUEUE_CAPACITY = 8;
+} // namespace
+
+
 VideoExporter::VideoExporter(QObject* parent)
     : QObject(parent)
 {
 }
 
+void VideoExporter::setEncoding(const VideoEncoding& encoding)
+{
+    this->encoding = encoding;
+}
+
 void VideoExporter::exportVideo(
     vtkRenderWindow* renderWindow,
     const QString& outputFilePath,
     int fps,
     StepIndex totalSteps,
-    std::function<void(StepIndex)> updateStepCallback,
+    DecodeStepCallback decodeStepCallback,
     std::function<void(StepIndex, StepIndex)> progressCallback,
     std::function<bool()> cancelledCallback)
 {
@@ -31,65 +53,142 @@ void VideoExporter::exportVideo(
         throw std::runtime_error("Total steps must be greater than 0");
     }
 
-    // Setup VTK video writer
-    vtkNew<vtkOggTheoraWriter> writer;
-    writer->SetFileName(outputFilePath.toStdString().c_str());
-    writer->SetRate(fps);
-    writer->SetQuality(2); // Quality 0-2, where 2 is highest
+    std::vector<StepIndex> steps(totalSteps);
+    std::iota(steps.begin(), steps.end(), StepIndex{ 1 });
+
+    OffscreenScene scene(renderWindow);
+    exportVideo(scene, outputFilePath, fps, steps, std::move(decodeStepCallback), std::move(progressCallback), std::move(cancelledCallback));
+}
+
+void VideoExporter::exportVideo(
+    OffscreenScene& scene,
+    const QString& outputFilePath,
+    int fps,
+    const std::vector<StepIndex>& steps,
+    DecodeStepCallback decodeStepCallback,
+    std::function<void(StepIndex, StepIndex)> progressCallback,
+    std::function<bool()> cancelledCallback)
+{
+    if (steps.empty())
+    {
+        throw std::runtime_error("No steps to export");
+    }
+
+    if (! decodeStepCallback)
+    {
+        throw std::runtime_error("Step decoding callback is not set");
+    }
+
+    const StepIndex lastStep = steps.back();
 
-    // Setup window to image filter
-    vtkNew<vtkWindowToImageFilter> windowToImageFilter;
-    windowToImageFilter->SetInput(renderWindow);
-    windowToImageFilter->SetScale(1); // Image quality scale
-    windowToImageFilter->SetInputBufferTypeToRGB();
-    windowToImageFilter->ReadFrontBufferOff(); // Read from back buffer
+    // before the stages start, so an unknown codec is reported without any thread waiting
+    const std::string videoFilePath = outputFilePath.toStdString();
+    const auto videoEncoder = createVideoEncoder(videoFilePath, fps, encoding);
 
-    // Connect filter to writer
-    writer->SetInputConnection(windowToImageFilter->GetOutputPort());
+    BoundedQueue<StepFrame> decodedFrames(DECODED_FRAMES_QUEUE_CAPACITY);
+    BoundedQueue<vtkSmartPointer<vtkImageData>> capturedFrames(CAPTURED_FRAMES_QUEUE_CAPACITY);
+    std::exception_ptr decodingError;
+    std::exception_ptr encodingError;
 
-    // Start writing
-    writer->Start();
+    // Decoding stage: steps are prepared in order, the queue limits how far ahead
+    std::jthread decoder(
+        [&](std::stop_token stopToken)
+        {
+            try
+            {
+                for (const auto step : steps)
+                {
+                    if (stopToken.stop_requested())
+                        break;
+                    auto frame = decodeStepCallback(step, stopToken);
+                    if (frame && ! decodedFrames.push(std::move(*frame)))
+                        break; // the export was stopped
+                }
+            }
+            catch (...)
+            {
+                decodingError = std::current_exception();
+            }
+            decodedFrames.close();
+        });
+
+    // Encoding stage: the encoder is started by the first frame, its size is known then
+    std::jthread encoder(
+        [&]
+        {
+            try
+            {
+                while (auto image = capturedFrames.pop())
+                {
+                    videoEncoder->writeFrame(*image);
+                }
+                videoEncoder->finish();
+            }
+            catch (...)
+            {
+                encodingError = std::current_exception();
+                capturedFrames.cancel(); // the rendering stage must not wait for the encoder anymore
+                try
+                {
+                    videoEncoder->finish(); // keeps the frames written so far playable
+                }
+                catch (const std::exception&)
+                {
+                }
+            }
+        });
+
+    const auto finishPipeline = [&]
+    {
+        decodedFrames.close();
+        capturedFrames.close();
+        if (decoder.joinable())
+            decoder.join();
+        if (encoder.joinable())
+            encoder.join();
+    };
 
     try
     {
-        // Iterate through all steps and capture frames
-        for (StepIndex step = 1; step <= totalSteps; ++step)
+        // Rendering stage (this thread owns the OpenGL context)
+        while (auto frame = decodedFrames.pop())
         {
             // Check if user cancelled
             if (cancelledCallback && cancelledCallback())
             {
-                writer->End();
                 throw std::runtime_error("Video export cancelled by user");
             }
 
             // Report progress
             if (progressCallback)
             {
-                progressCallback(step, totalSteps);
-            }
-            emit progressChanged(step, totalSteps);
-
-            // Update visualization for this step
-            if (updateStepCallback)
-            {
-                updateStepCallback(step);
+                progressCallback(frame->step, lastStep);
             }
+            emit progressChanged(frame->step, lastStep);
 
-            // Force render
-            renderWindow->Render();
-
-            // Capture frame
-            windowToImageFilter->Modified();
-            writer->Write();
+            if (! capturedFrames.push(scene.render(*frame)))
+                break; // the encoder failed, its error is reported below
         }
 
-        // Finalize video
-        writer->End();
+        finishPipeline();
+        usedEncoderName = videoEncoder->name();
+        if (decodingError)
+            std::rethrow_exception(decodingError);
+        if (encodingError)
+            std::rethrow_exception(encodingError);
+
         emit exportCompleted();
     }
     catch (const std::exception& e)
     {
-        writer->End();
+        if (decoder.joinable() || encoder.joinable())
+        {
+            // stopped early: frames not encoded yet are dropped, the file is finished with frames written so far
+            decoder.request_stop();
+            decodedFrames.cancel();
+            capturedFrames.cancel();
+            finishPipeline();
+        }
         emit exportFailed(QString::fromStdString(e.what()));
         throw;
     }
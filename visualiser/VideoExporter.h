@@ -6,44 +6,86 @@
 #include <QObject>
 #include <QString>
 #include <functional>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
 #include "utilities/types.h"
+#include "visualiser/StepFrame.h"
+#include "visualiser/VideoEncoder.h" // VideoEncoding
 
+class OffscreenScene;
 class vtkRenderWindow;
 
 /** @class VideoExporter
- * @brief Handles exporting of VTK render window content to video format (OGG).
+ * @brief Handles exporting of VTK render window content to video (OGG Theora, or H.264/H.265 through FFmpeg, see setEncoding()).
  * 
- * This class provides functionality to capture frames from a VTK render window
- * and save them as a video file. It's designed to work asynchronously and provides
- * progress feedback through signals and callbacks. */
+ * The export is a pipeline of three stages running at the same time:
+ * - a decoding thread prepares the steps (through the callback, which may prefetch further ones),
+ * - the calling thread renders them into an offscreen copy of the exported view,
+ * - an encoding thread writes the captured frames into the video file (see VideoEncoder).
+ * Stages are connected by bounded queues, so memory stays limited when one stage is slower.
+ * The interactive render window is only used as the template of the view (size, camera, background),
+ * it is neither changed nor rendered during the export. */
 class VideoExporter : public QObject
 {
     Q_OBJECT
 
 public:
+    /** @brief Decodes the step for rendering, called from the decoding thread.
+     *  @return Empty if the step does not exist (it is skipped) or stop was requested */
+    using DecodeStepCallback = std::function<std::optional<StepFrame>(StepIndex step, std::stop_token stopToken)>;
+
     /** @brief Constructs a VideoExporter with the given parent
      *  @param parent Parent QObject (optional) */
     explicit VideoExporter(QObject* parent = nullptr);
 
-    /** @brief Exports the current VTK render window to a video file.
+    /// @brief Sets codec and bitrate of the following exports (OGG Theora by default)
+    void setEncoding(const VideoEncoding& encoding);
+
+    /// @brief Name of the encoder used by the last export (e.g. "h264_nvenc" for codec "h264"), empty before any
+    const std::string& usedEncoder() const
+    {
+        return usedEncoderName;
+    }
+
+    /** @brief Exports steps as seen in the render window to a video file.
      * 
-     * This method captures frames from the provided render window and encodes them
-     * into a video file. It supports progress tracking and cancellation.
+     * Frames are rendered offscreen with the camera, size and background of the render window
+     * and encoded on a separate thread. It supports progress tracking and cancellation.
      * 
-     * @param renderWindow The VTK render window to capture frames from
-     * @param outputFilePath Path where the video file will be saved (should end with .ogv)
+     * @param renderWindow The VTK render window whose view is exported (its first renderer's camera is copied)
+     * @param outputFilePath Path where the video file will be saved (.ogv for theora, the container of FFmpeg codecs is given by the extension)
      * @param fps Frames per second for the output video
-     * @param totalSteps Total number of frames to capture
-     * @param updateStepCallback Called before capturing each frame (frame number as parameter)
+     * @param totalSteps Steps 1 to totalSteps are exported
+     * @param decodeStepCallback Prepares the step for rendering, called from the decoding thread in the order of steps
      * @param progressCallback Called to report export progress (current, total)
      * @param cancelledCallback Called to check if export was cancelled
-     * @throws std::runtime_error if export fails or is cancelled */
+     * @throws std::runtime_error if export fails or is cancelled
+     * @throws std::invalid_argument if the codec is not available (see createVideoEncoder()) */
     void exportVideo(
         vtkRenderWindow* renderWindow,
         const QString& outputFilePath,
         int fps,
         StepIndex totalSteps,
-        std::function<void (StepIndex)> updateStepCallback,
+        DecodeStepCallback decodeStepCallback,
+        std::function<void (StepIndex, StepIndex)> progressCallback,
+        std::function<bool()> cancelledCallback
+    );
+
+    /** @brief Exports the steps rendered by the scene to a video file (used also without any window, in headless mode).
+     *
+     * @param scene Offscreen scene rendering the frames (it is used from the calling thread only)
+     * @param steps Steps to export in the order of frames, steps missing in the data are skipped
+     * @param progressCallback Called to report export progress (current step, last step)
+     * @throws std::runtime_error if export fails or is cancelled
+     * @see exportVideo() above for the remaining parameters */
+    void exportVideo(
+        OffscreenScene& scene,
+        const QString& outputFilePath,
+        int fps,
+        const std::vector<StepIndex>& steps,
+        DecodeStepCallback decodeStepCallback,
         std::function<void (StepIndex, StepIndex)> progressCallback,
         std::function<bool()> cancelledCallback
     );
@@ -59,4 +101,8 @@ signals:
 
     /// @brief Emitted when export fails with description of the error that occurred
     void exportFailed(const QString& errorMessage);
+
+private:
+    VideoEncoding encoding;
+    std::string usedEncoderName;
 };
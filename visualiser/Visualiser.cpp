@@ -1,3 +1,15 @@
+#include <algorithm> // std::min, std::max
+#include <array>
+#include <cmath>     // std::isfinite, std::isnan
+#include <format>
+#include <limits>
+
+#include <vtkPlaneSource.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkShaderProperty.h>
+#include <vtkUniforms.h>
+
 #include "Line.h"
 #include "visualiser/Visualizer.hpp"
 #include "widgets/ColorSettings.h"
@@ -9,16 +21,368 @@ vtkColor3d toVtkColor(QColor color)
 {
     return vtkColor3d{ color.redF(), color.greenF(), color.blueF() };
 }
+
+/// Name of the sampler of the colour ramp in the fragment shader (a named texture of the actor's property)
+constexpr char SCALAR_RAMP_SAMPLER[] = "scalarColorRamp";
+
+/** Replaces the texturing of the grid: the red channel of the float texture is the raw value of the cell,
+ *  it is mapped through the colour ramp by the range given in uniforms (declared by vtkShaderProperty).
+ *  The position is moved to centres of the first and last texel, so both end colours are reached exactly. */
+constexpr char SCALAR_COLOR_MAP_SHADER[] = R"(
+  float cellValue = texture(actortexture, tcoordVCVSOutput).r;
+  if (isnan(cellValue))
+  {
+    gl_FragData[0] = vec4(nanColor, 1.0);
+  }
+  else
+  {
+    float rampPosition = clamp((cellValue - scalarMinimum) / (scalarMaximum - scalarMinimum), 0.0, 1.0);
+    const float rampSize = 256.0;
+    gl_FragData[0] = vec4(texture(scalarColorRamp, vec2((0.5 + rampPosition * (rampSize - 1.0)) / rampSize, 0.5)).rgb, 1.0);
+  }
+)";
+static_assert(Visualizer::SCALAR_RAMP_SIZE == 256, "rampSize in SCALAR_COLOR_MAP_SHADER has to be updated");
+
+/// @brief Null-terminated "Step N" formatted on the stack, so showing a step does not allocate a string
+std::array<char, 32> stepLabel(StepIndex step)
+{
+    std::array<char, 32> label{};
+    std::format_to_n(label.data(), label.size() - 1, "Step {}", step);
+    return label;
+}
 } // namespace
 
 
+void Visualizer::setUpGridActor(int nRows, int nCols, vtkActor* gridActor, int levelFactor)
+{
+    releaseSharedColors(); // resizing must not reallocate the shared buffer
+    releaseSharedScalars();
+    removeScalarColorMap(gridActor);
+    shownLevelFactor = levelFactor;
+    showsScalars = false;
+
+    // one texel per levelFactor x levelFactor block of cells, the quad covers whole blocks (the last may exceed the grid)
+    const int textureRows = (nRows + levelFactor - 1) / levelFactor;
+    const int textureColumns = (nCols + levelFactor - 1) / levelFactor;
+
+    gridColors->SetName("colors");
+    gridColors->SetNumberOfComponents(3);
+    gridColors->SetNumberOfTuples(static_cast<vtkIdType>(textureRows) * textureColumns);
+    gridImage->GetPointData()->SetScalars(gridColors);
+
+    setUpGridQuad(nRows, nCols, gridActor, levelFactor);
+}
+
+void Visualizer::setUpScalarGridActor(int nRows, int nCols, vtkActor* gridActor, int levelFactor)
+{
+    releaseSharedColors();
+    releaseSharedScalars();
+    shownLevelFactor = levelFactor;
+    showsScalars = true;
+
+    const int textureRows = (nRows + levelFactor - 1) / levelFactor;
+    const int textureColumns = (nCols + levelFactor - 1) / levelFactor;
+
+    gridScalars->SetName("values");
+    gridScalars->SetNumberOfComponents(1);
+    gridScalars->SetNumberOfTuples(static_cast<vtkIdType>(textureRows) * textureColumns);
+    gridImage->GetPointData()->SetScalars(gridScalars);
+
+    setUpGridQuad(nRows, nCols, gridActor, levelFactor);
+
+    rampImage->SetDimensions(SCALAR_RAMP_SIZE, 1, 1);
+    rampImage->GetPointData()->SetScalars(rampColors);
+    rampTexture->SetInputData(rampImage);
+    rampTexture->InterpolateOn(); // colours between the texels of the ramp are blended
+    rampTexture->SetWrap(vtkTexture::ClampToEdge);
+    rampTexture->SetColorModeToDirectScalars();
+    gridActor->GetProperty()->SetTexture(SCALAR_RAMP_SAMPLER, rampTexture);
+
+    // the value of the cell (the red channel of the float texture) is coloured instead of the texture colour
+    auto* shaderProperty = gridActor->GetShaderProperty();
+    shaderProperty->ClearFragmentShaderReplacement("//VTK::TCoord::Impl", true);
+    shaderProperty->AddFragmentShaderReplacement("//VTK::TCoord::Impl", true, SCALAR_COLOR_MAP_SHADER, false);
+
+    applyScalarColorMap(gridActor);
+}
+
+void Visualizer::removeScalarColorMap(vtkActor* gridActor)
+{
+    if (gridActor->GetProperty()->GetTexture(SCALAR_RAMP_SAMPLER))
+        gridActor->GetProperty()->RemoveTexture(SCALAR_RAMP_SAMPLER);
+    gridActor->GetShaderProperty()->ClearFragmentShaderReplacement("//VTK::TCoord::Impl", true);
+}
+
+void Visualizer::setUpGridQuad(int nRows, int nCols, vtkActor* gridActor, int levelFactor)
+{
+    const int textureRows = (nRows + levelFactor - 1) / levelFactor;
+    const int textureColumns = (nCols + levelFactor - 1) / levelFactor;
+
+    gridImage->SetDimensions(textureColumns, textureRows, 1);
+    gridImage->SetOrigin(0, 0, 0);
+    gridImage->SetSpacing(1, 1, 1);
+
+    gridTexture->SetInputData(gridImage);
+    gridTexture->InterpolateOff();              // every cell is a sharp square, as in the data
+    gridTexture->SetColorModeToDirectScalars(); // bytes are colours (floats are raw values), no lookup table
+
+    vtkNew<vtkPlaneSource> gridQuad;
+    gridQuad->SetOrigin(0, 0, 1);
+    gridQuad->SetPoint1(textureColumns * levelFactor, 0, 1);
+    gridQuad->SetPoint2(0, textureRows * levelFactor, 1);
+    quadExtent = { textureColumns * levelFactor, textureRows * levelFactor };
+
+    vtkNew<vtkPolyDataMapper> gridMapper;
+    gridMapper->SetInputConnection(gridQuad->GetOutputPort());
+    gridMapper->ScalarVisibilityOff();
+
+    gridActor->SetMapper(gridMapper);
+    gridActor->SetTexture(gridTexture);
+}
+
+void Visualizer::refreshWindowsVTK(std::shared_ptr<const std::vector<unsigned char>> colors,
+                                   int nRows,
+                                   int nCols,
+                                   vtkSmartPointer<vtkActor> gridActor,
+                                   int levelFactor)
+{
+    ScopedStageTimer timer(ProfiledStage::RefreshGrid);
+    const auto textureCells = static_cast<vtkIdType>((nRows + levelFactor - 1) / levelFactor) * ((nCols + levelFactor - 1) / levelFactor);
+    if (gridActor->GetTexture() != gridTexture.GetPointer() || showsScalars || gridColors->GetNumberOfTuples() != textureCells
+        || levelFactor != shownLevelFactor)
+        setUpGridActor(nRows, nCols, gridActor, levelFactor);
+    else if (colors == sharedGridColors) // no node changed since the shown step: nothing to upload
+        return;
+
+    // save=1: VTK does not free the buffer, it is owned by the decoded step (VTK only reads it)
+    gridColors->SetArray(const_cast<unsigned char*>(colors->data()), static_cast<vtkIdType>(colors->size()), /*save=*/1);
+    sharedGridColors = std::move(colors); // the previously shown buffer is released only now
+    gridColors->Modified();
+}
+
+void Visualizer::refreshWindowsVTK(std::shared_ptr<const std::vector<float>> scalars,
+                                   int nRows,
+                                   int nCols,
+                                   vtkSmartPointer<vtkActor> gridActor,
+                                   int levelFactor)
+{
+    ScopedStageTimer timer(ProfiledStage::RefreshGrid);
+    const bool otherActor = gridActor->GetTexture() != gridTexture.GetPointer();
+    if (otherActor)
+        automaticScalarRange.reset(); // e.g. a new configuration
+
+    const auto textureCells = static_cast<vtkIdType>((nRows + levelFactor - 1) / levelFactor) * ((nCols + levelFactor - 1) / levelFactor);
+    if (otherActor || ! showsScalars || gridScalars->GetNumberOfTuples() != textureCells || levelFactor != shownLevelFactor)
+        setUpScalarGridActor(nRows, nCols, gridActor, levelFactor);
+    else if (scalars == sharedGridScalars) // no node changed since the shown step: nothing to upload
+        return;
+
+    if (! automaticScalarRange) // one pass per configuration, the range is kept when switching to the automatic one later
+    {
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+        for (const float value : *scalars)
+        {
+            if (std::isfinite(value))
+            {
+                minimum = std::min(minimum, value);
+                maximum = std::max(maximum, value);
+            }
+        }
+        if (minimum <= maximum) // otherwise no value is known yet
+        {
+            automaticScalarRange.emplace(minimum, maximum);
+            applyScalarColorMap(gridActor);
+        }
+    }
+
+    // save=1: VTK does not free the buffer, it is owned by the decoded step (VTK only reads it)
+    gridScalars->SetArray(const_cast<float*>(scalars->data()), static_cast<vtkIdType>(scalars->size()), /*save=*/1);
+    sharedGridScalars = std::move(scalars);
+    gridScalars->Modified();
+}
+
+void Visualizer::applyScalarColorMap(vtkActor* gridActor)
+{
+    if (! showsScalars || ! gridActor)
+        return;
+
+    const auto& settings = ColorSettings::instance();
+    const auto low = toVtkColor(settings.scalarLowColor());
+    const auto high = toVtkColor(settings.scalarHighColor());
+
+    rampColors->SetNumberOfComponents(3);
+    rampColors->SetNumberOfTuples(SCALAR_RAMP_SIZE);
+    auto* rgb = rampColors->WritePointer(0, 3 * SCALAR_RAMP_SIZE);
+    for (int i = 0; i < SCALAR_RAMP_SIZE; ++i)
+    {
+        const double position = static_cast<double>(i) / (SCALAR_RAMP_SIZE - 1);
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            rgb[3 * i + channel] = toColorByte(low[channel] + (high[channel] - low[channel]) * position);
+        }
+    }
+    rampColors->Modified();
+
+    auto range = settings.hasAutomaticScalarRange() ? automaticScalarRange.value_or(std::pair{ 0.f, 1.f })
+                                                    : std::pair{ static_cast<float>(settings.scalarMinimum()), static_cast<float>(settings.scalarMaximum()) };
+    if (range.first == range.second) // e.g. a constant step: all cells get the low colour
+        range.second = range.first + 1;
+
+    const auto background = toVtkColor(settings.backgroundColor());
+    const float nanColor[3] = { static_cast<float>(background.GetRed()), static_cast<float>(background.GetGreen()), static_cast<float>(background.GetBlue()) };
+
+    auto* uniforms = gridActor->GetShaderProperty()->GetFragmentCustomUniforms();
+    uniforms->SetUniformf("scalarMinimum", range.first);
+    uniforms->SetUniformf("scalarMaximum", range.second);
+    uniforms->SetUniform3f("nanColor", nanColor);
+    gridActor->Modified();
+}
+
+void Visualizer::refreshHeightfield(std::shared_ptr<const std::vector<float>> heights, int nRows, int nCols, vtkActor* gridActor)
+{
+    auto* mapper = vtkPolyDataMapper::SafeDownCast(gridActor->GetMapper());
+    if (! mapper)
+        return;
+    ScopedStageTimer timer(ProfiledStage::RefreshHeights);
+
+    if (! heights || heights->size() != static_cast<std::size_t>(nRows) * nCols)
+    {
+        if (mapper->GetInput() == heightfieldMesh.GetPointer()) // e.g. a configuration without the height substate
+            setUpGridQuad(nRows, nCols, gridActor, shownLevelFactor);
+        shownHeights.reset();
+        return;
+    }
+
+    const bool newMesh = heightfieldRows != nRows || heightfieldColumns != nCols;
+    if (newMesh)
+    {
+        const int meshFactor = (std::max(nRows, nCols) + HEIGHTFIELD_MAX_MESH_SIZE - 1) / HEIGHTFIELD_MAX_MESH_SIZE;
+        setUpHeightfieldMesh(nRows, nCols, std::max(1, meshFactor));
+    }
+    if (newMesh || heightfieldTextureExtent != quadExtent) // the texture got another level of detail
+        writeHeightfieldTextureCoordinates();
+
+    // the quad is recreated whenever the texture is set up, the mesh takes its place with the same texture and shader
+    if (mapper->GetInput() != heightfieldMesh.GetPointer())
+        mapper->SetInputData(heightfieldMesh);
+    else if (! newMesh && heights == shownHeights) // no node changed since the shown step
+        return;
+
+    auto* coordinates = vtkFloatArray::SafeDownCast(heightfieldPoints->GetData());
+    float* xyz = coordinates->GetPointer(0);
+    for (std::size_t i = 0; i < heightfieldSamples.size(); ++i)
+    {
+        const float height = (*heights)[heightfieldSamples[i]];
+        xyz[3 * i + 2] = 1 + (std::isnan(height) ? 0.f : height); // the flat grid is at z = 1
+    }
+    shownHeights = std::move(heights);
+    coordinates->Modified();
+    heightfieldPoints->Modified();
+}
+
+void Visualizer::setUpHeightfieldMesh(int nRows, int nCols, int meshFactor)
+{
+    heightfieldRows = nRows;
+    heightfieldColumns = nCols;
+    shownHeights.reset();
+
+    const int meshRows = (nRows + meshFactor - 1) / meshFactor;
+    const int meshColumns = (nCols + meshFactor - 1) / meshFactor;
+    const auto pointsCount = static_cast<vtkIdType>(meshRows) * meshColumns;
+
+    heightfieldSamples.resize(pointsCount);
+    heightfieldPoints->SetDataTypeToFloat();
+    heightfieldPoints->SetNumberOfPoints(pointsCount);
+    float* xyz = vtkFloatArray::SafeDownCast(heightfieldPoints->GetData())->WritePointer(0, 3 * pointsCount);
+    for (int meshRow = 0; meshRow < meshRows; ++meshRow)
+    {
+        // rows in VTK image order, as in the texture: the first one is at y = 0
+        const int row = std::min(meshRow * meshFactor + meshFactor / 2, nRows - 1);
+        for (int meshColumn = 0; meshColumn < meshColumns; ++meshColumn)
+        {
+            const int column = std::min(meshColumn * meshFactor + meshFactor / 2, nCols - 1);
+            const auto point = static_cast<std::size_t>(meshRow) * meshColumns + meshColumn;
+            heightfieldSamples[point] = static_cast<std::size_t>(row) * nCols + column;
+            xyz[3 * point] = column + 0.5f;
+            xyz[3 * point + 1] = row + 0.5f;
+            xyz[3 * point + 2] = 1;
+        }
+    }
+
+    // one strip per pair of neighbouring rows of the mesh, alternating the upper and the lower vertex (counter-clockwise seen from above)
+    const vtkIdType strips = std::max(0, meshRows - 1);
+    vtkNew<vtkIdTypeArray> offsets;
+    vtkNew<vtkIdTypeArray> connectivity;
+    offsets->SetNumberOfValues(strips + 1);
+    connectivity->SetNumberOfValues(strips * 2 * meshColumns);
+    for (vtkIdType strip = 0; strip <= strips; ++strip)
+        offsets->SetValue(strip, strip * 2 * meshColumns);
+    vtkIdType* ids = connectivity->GetPointer(0);
+    for (vtkIdType strip = 0; strip < strips; ++strip)
+    {
+        for (vtkIdType meshColumn = 0; meshColumn < meshColumns; ++meshColumn)
+        {
+            *ids++ = (strip + 1) * meshColumns + meshColumn;
+            *ids++ = strip * meshColumns + meshColumn;
+        }
+    }
+
+    vtkNew<vtkCellArray> cellStrips;
+    cellStrips->SetData(offsets, connectivity);
+
+    heightfieldTextureCoordinates->SetName("textureCoordinates");
+    heightfieldTextureCoordinates->SetNumberOfComponents(2);
+    heightfieldTextureCoordinates->SetNumberOfTuples(pointsCount);
+
+    heightfieldMesh->SetPoints(heightfieldPoints);
+    heightfieldMesh->SetStrips(cellStrips);
+    heightfieldMesh->GetPointData()->SetTCoords(heightfieldTextureCoordinates);
+}
+
+void Visualizer::writeHeightfieldTextureCoordinates()
+{
+    heightfieldTextureExtent = quadExtent;
+    const double width = quadExtent.first > 0 ? quadExtent.first : heightfieldColumns;
+    const double height = quadExtent.second > 0 ? quadExtent.second : heightfieldRows;
+
+    const auto pointsCount = heightfieldPoints->GetNumberOfPoints();
+    const float* xyz = vtkFloatArray::SafeDownCast(heightfieldPoints->GetData())->GetPointer(0);
+    float* uv = heightfieldTextureCoordinates->WritePointer(0, 2 * pointsCount);
+    for (vtkIdType point = 0; point < pointsCount; ++point)
+    {
+        uv[2 * point] = static_cast<float>(xyz[3 * point] / width);
+        uv[2 * point + 1] = static_cast<float>(xyz[3 * point + 1] / height);
+    }
+    heightfieldTextureCoordinates->Modified();
+}
+
+void Visualizer::releaseSharedScalars()
+{
+    if (! sharedGridScalars)
+        return;
+
+    gridScalars->Initialize(); // forgets the shared buffer, the next resize allocates own memory
+    sharedGridScalars.reset();
+}
+
+void Visualizer::releaseSharedColors()
+{
+    if (! sharedGridColors)
+        return;
+
+    gridColors->Initialize(); // forgets the shared buffer, the next resize allocates own memory
+    sharedGridColors.reset();
+}
+
 void Visualizer::buildLoadBalanceLine(const std::vector<Line>& lines,
                                       int nRows,
                                       vtkSmartPointer<vtkRenderer> renderer,
                                       vtkSmartPointer<vtkActor2D> actorBuildLine)
 {
     // 1. Build line geometry data
-    auto grid = createLinePolyData(lines, nRows);
+    setUpLinePolyData(lines.size());
+    writeLinePoints(lines, nRows);
 
     // 2. Setup coordinate system
     vtkNew<vtkCoordinate> normCoords;
@@ -26,7 +390,7 @@ void Visualizer::buildLoadBalanceLine(const std::vector<Line>& lines,
 
     // 3. Create 2D mapper
     vtkNew<vtkPolyDataMapper2D> mapper;
-    mapper->SetInputData(grid);
+    mapper->SetInputData(linePolyData);
     mapper->SetTransformCoordinate(normCoords);
     mapper->Update();
 
@@ -42,55 +406,70 @@ void Visualizer::buildLoadBalanceLine(const std::vector<Line>& lines,
     renderer->AddActor2D(actorBuildLine);
 }
 
-vtkSmartPointer<vtkPolyData> Visualizer::createLinePolyData(const std::vector<Line>& lines, int nRows)
+void Visualizer::setUpLinePolyData(std::size_t linesCount)
 {
-    vtkNew<vtkPoints> pts;
+    const auto pointsCount = static_cast<vtkIdType>(2 * linesCount);
+
+    linePoints->SetDataTypeToFloat();
+    linePoints->SetNumberOfPoints(pointsCount);
+
+    // every line is a cell of its own two points: 2i and 2i + 1
+    vtkNew<vtkIdTypeArray> offsets;
+    vtkNew<vtkIdTypeArray> connectivity;
+    offsets->SetNumberOfValues(static_cast<vtkIdType>(linesCount) + 1);
+    connectivity->SetNumberOfValues(pointsCount);
+    for (vtkIdType i = 0; i <= static_cast<vtkIdType>(linesCount); ++i)
+        offsets->SetValue(i, 2 * i);
+    for (vtkIdType i = 0; i < pointsCount; ++i)
+        connectivity->SetValue(i, i);
+
     vtkNew<vtkCellArray> cellLines;
+    cellLines->SetData(offsets, connectivity);
+
+    linePolyData->SetPoints(linePoints);
+    linePolyData->SetLines(cellLines);
+}
 
-    for (size_t i = 0; i < lines.size(); ++i)
+void Visualizer::writeLinePoints(const std::vector<Line>& lines, int nRows)
+{
+    auto* coordinates = vtkFloatArray::SafeDownCast(linePoints->GetData());
+    float* xyz = coordinates->WritePointer(0, static_cast<vtkIdType>(6 * lines.size()));
+    for (const auto& line : lines)
     {
-        pts->InsertNextPoint(lines[i].x1, nRows - 1 - lines[i].y1, 0.0);
-        pts->InsertNextPoint(lines[i].x2, nRows - 1 - lines[i].y2, 0.0);
-        cellLines->InsertNextCell(2);
-        cellLines->InsertCellPoint(i * 2);
-        cellLines->InsertCellPoint(i * 2 + 1);
+        *xyz++ = line.x1;
+        *xyz++ = nRows - 1 - line.y1;
+        *xyz++ = 0;
+        *xyz++ = line.x2;
+        *xyz++ = nRows - 1 - line.y2;
+        *xyz++ = 0;
     }
-
-    vtkNew<vtkPolyData> polyData;
-    polyData->SetPoints(pts);
-    polyData->SetLines(cellLines);
-    return polyData;
+    coordinates->Modified();
+    linePoints->Modified();
 }
 
 void Visualizer::refreshBuildLoadBalanceLine(const std::vector<Line>& lines, int nRows, vtkActor2D* lineActor)
 {
     if (! lineActor)
         return;
+    ScopedStageTimer timer(ProfiledStage::RefreshLines);
 
-    // 1. Rebuild geometry
-    auto grid = createLinePolyData(lines, nRows);
-
-    // 2. Get existing mapper (assumes it’s a vtkPolyDataMapper2D)
+    // Get existing mapper (assumes it’s a vtkPolyDataMapper2D)
     auto* mapper = vtkPolyDataMapper2D::SafeDownCast(lineActor->GetMapper());
     if (! mapper)
         return;
 
-    vtkNew<vtkCoordinate> normCoords;
-    normCoords->SetCoordinateSystemToWorld();
-
-    // 3. Update mapper input
-    mapper->SetInputData(grid);
-    mapper->SetTransformCoordinate(normCoords);
-    mapper->Update();
-
-    lineActor->SetMapper(mapper);
-    lineActor->GetMapper()->Update();
+    // the topology is the same for the whole stage, only coordinates of the points are written
+    if (mapper->GetInput() != linePolyData.GetPointer() || linePoints->GetNumberOfPoints() != static_cast<vtkIdType>(2 * lines.size()))
+    {
+        setUpLinePolyData(lines.size());
+        mapper->SetInputData(linePolyData);
+    }
+    writeLinePoints(lines, nRows);
 }
 
 vtkTextProperty* Visualizer::buildStepLine(StepIndex step, vtkSmartPointer<vtkTextMapper> singleLineTextB)
 {
-    std::string stepText = "Step " + std::to_string(step);
-    singleLineTextB->SetInput(stepText.c_str());
+    singleLineTextB->SetInput(stepLabel(step).data());
 
     vtkTextProperty* singleLineTextProp = singleLineTextB->GetTextProperty();
     singleLineTextProp->SetVerticalJustificationToBottom();
@@ -106,7 +485,7 @@ vtkNew<vtkActor2D> Visualizer::buildStepText(StepIndex step,
                                              vtkSmartPointer<vtkTextMapper> stepLineTextMapper,
                                              vtkSmartPointer<vtkRenderer> renderer)
 {
-    stepLineTextMapper->SetInput(("Step " + std::to_string(step)).c_str());
+    stepLineTextMapper->SetInput(stepLabel(step).data());
 
     auto textProp = stepLineTextMapper->GetTextProperty();
     textProp->SetFontSize(font_size);
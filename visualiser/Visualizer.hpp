@@ -3,12 +3,18 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory> // std::shared_ptr
+#include <optional>
+#include <utility> // std::pair
+#include <vector>
+
 #include <vtkActor2D.h>
 #include <vtkCellArray.h>
 #include <vtkCoordinate.h>
-#include <vtkDataSetMapper.h>
-#include <vtkDoubleArray.h>
-#include <vtkLookupTable.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
 #include <vtkNamedColors.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
@@ -17,11 +23,14 @@
 #include <vtkPolyDataMapper2D.h>
 #include <vtkProperty2D.h>
 #include <vtkRenderer.h>
-#include <vtkStructuredGrid.h>
 #include <vtkTextMapper.h>
 #include <vtkTextProperty.h>
+#include <vtkTexture.h>
+#include <vtkUnsignedCharArray.h>
 
-#include "utilities/types.h"    // StepIndex
+#include "utilities/StageProfiler.h"
+#include "utilities/types.h"        // StepIndex
+#include "visualiser/CellColors.h" // writeCellColors
 
 class Line;
 
@@ -38,114 +47,192 @@ public:
     void drawWithVTK(const Matrix& p, int nRows, int nCols, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor> gridActor);
     template<class Matrix>
     void refreshWindowsVTK(const Matrix& p, int nRows, int nCols, vtkSmartPointer<vtkActor> gridActor);
+
+    /** @brief Shows colours computed in advance (with writeCellColors()) without copying them.
+     *
+     * The colour array of the grid texture is switched to the given buffer, which is kept alive
+     * until other colours are shown, so decoding of the next step into its own buffer does not
+     * touch the displayed one. Showing the buffer which is already shown does not upload the texture again.
+     * @param colors Colours in VTK image order, not modified while shown: nRows * nCols * 3 bytes,
+     *               or a level of detail (see buildColorPyramid()) with one texel per levelFactor x levelFactor cells
+     * @param nRows, nCols Size of the whole grid (in cells) */
+    void refreshWindowsVTK(std::shared_ptr<const std::vector<unsigned char>> colors,
+                           int nRows,
+                           int nCols,
+                           vtkSmartPointer<vtkActor> gridActor,
+                           int levelFactor = 1);
+
+    /** @brief Shows raw values of cells (one float per texel, see writeCellScalarsOfRegion()) coloured on the GPU.
+     *
+     * The values are uploaded as a single channel float texture and a fragment shader maps them through
+     * the colour ramp of ColorSettings (see applyScalarColorMap()), so a step uploads one float per cell and
+     * changing the palette or the range does not touch the values. The buffer is shared as with colours.
+     * NaN values (cells not read or not numeric) are shown in the background colour.
+     * @param scalars Values in VTK image order: nRows * nCols floats, or a level of detail with one texel per levelFactor x levelFactor cells */
+    void refreshWindowsVTK(std::shared_ptr<const std::vector<float>> scalars,
+                           int nRows,
+                           int nCols,
+                           vtkSmartPointer<vtkActor> gridActor,
+                           int levelFactor = 1);
+
+    /** @brief Updates the colour ramp and the range of values from ColorSettings, when the grid shows raw values.
+     *
+     * Only SCALAR_RAMP_SIZE texels of the ramp and a few uniforms of the shader are changed. When the range
+     * of ColorSettings is automatic, the range of values of the first shown step (after setting up the actor) is used. */
+    void applyScalarColorMap(vtkActor* gridActor);
+
+    /// @brief Makes the next refreshWindowsVTK() of raw values compute the automatic range again (e.g. for values of a different kind)
+    void resetAutomaticScalarRange()
+    {
+        automaticScalarRange.reset();
+    }
+
+    /// Number of texels of the colour ramp of scalar colouring (linearly interpolated by the GPU)
+    static constexpr int SCALAR_RAMP_SIZE = 256;
+
+    /** @brief Shows the grid as a terrain: the textured quad is replaced by a regular mesh whose vertices are raised by the heights.
+     *
+     * The mesh has one vertex per cell, or per meshFactor x meshFactor block of cells for grids bigger than
+     * HEIGHTFIELD_MAX_MESH_SIZE (decimated level of detail, the vertex takes the height of the block's centre cell).
+     * Its points and triangle strips are allocated once per grid size; a step only rewrites Z of the points in place,
+     * and nothing when the buffer is the shown one. Colours (or raw values) are still the texture of the grid,
+     * so they keep their own resolution. A vertex of unknown (NaN) height stays on the flat grid.
+     * @param heights Elevation of cells in VTK image order (nRows * nCols floats), nullptr shows the flat quad again */
+    void refreshHeightfield(std::shared_ptr<const std::vector<float>> heights, int nRows, int nCols, vtkActor* gridActor);
+
+    /// Maximal number of vertices of the heightfield mesh along each axis
+    static constexpr int HEIGHTFIELD_MAX_MESH_SIZE = 1024;
+
     void buildLoadBalanceLine(const std::vector<Line>& lines, int nRows, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor2D> actorBuildLine);
     void refreshBuildLoadBalanceLine(const std::vector<Line> &lines, int nRows, vtkActor2D* lineActor);
     vtkTextProperty* buildStepLine(StepIndex step, vtkSmartPointer<vtkTextMapper> singleLineTextB);
     vtkNew<vtkActor2D> buildStepText(StepIndex step, int font_size, vtkSmartPointer<vtkTextMapper> stepLineTextMapper, vtkSmartPointer<vtkRenderer> renderer);
 
 private:
+    /// @brief Writes RGB colours of all cells into the colour array (in VTK image order, so rows are flipped)
     template<class Matrix>
-    void buidColor(vtkLookupTable* lut, int nCols, int nRows, const Matrix& p);
+    void buidColor(vtkUnsignedCharArray* colors, int nCols, int nRows, const Matrix& p);
 
-    /** @brief Creates a vtkPolyData representing a set of 2D lines.
-      * @param lines Vector of Line objects (each defines a line segment)
-      * @param nRows Number of grid rows (used to invert Y coordinates)
-      * @return vtkSmartPointer<vtkPolyData> with points and lines set */
-    vtkSmartPointer<vtkPolyData> createLinePolyData(const std::vector<Line>& lines, int nRows);
-};
+    /** @brief Allocates points and cells of linesCount 2D lines in linePolyData (the topology of the stage's lines).
+      * Coordinates are written by writeLinePoints(). */
+    void setUpLinePolyData(std::size_t linesCount);
 
-////////////////////////////////////////////////////////////////////
+    /** @brief Writes coordinates of the lines straight into the float array of linePoints and marks it modified.
+      * @param lines Vector of Line objects (each defines a line segment), as many as given to setUpLinePolyData()
+      * @param nRows Number of grid rows (used to invert Y coordinates) */
+    void writeLinePoints(const std::vector<Line>& lines, int nRows);
 
-template <class Matrix>
-void Visualizer::drawWithVTK(const Matrix &p, int nRows, int nCols, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor> gridActor)
-{
-    const auto numberOfPoints = nRows * nCols;
-    vtkNew<vtkDoubleArray> pointValues;
-    pointValues->SetNumberOfTuples(numberOfPoints);
-    for (int i = 0; i < numberOfPoints; ++i)
-    {
-        pointValues->SetValue(i, i);
-    }
+    /** @brief Allocates colour array for nRows x nCols cells and makes the actor show it as a textured quad.
+     *  Cell (col, row) is the unit square starting at (col, row), so the quad covers [0, nCols] x [0, nRows].
+     *  @param levelFactor Cells per texel in each direction (level of detail), the quad is rounded up to whole blocks */
+    void setUpGridActor(int nRows, int nCols, vtkActor* gridActor, int levelFactor = 1);
 
-    vtkNew<vtkLookupTable> lut;
-    lut->SetNumberOfTableValues(numberOfPoints);
+    /** @brief Allocates array of raw values and makes the actor show it through the colour ramp (see refreshWindowsVTK()).
+     *  The quad is the same as of setUpGridActor(), the texture keeps one float per texel. */
+    void setUpScalarGridActor(int nRows, int nCols, vtkActor* gridActor, int levelFactor);
 
-    vtkNew<vtkPoints> points;
-    for (int row = 0; row < nRows; row++)
-    {
-        for (int col = 0; col < nCols; col++)
-        {
-            points->InsertNextPoint(col, row, 1);
-        }
-    }
+    /// @brief Removes the shader and the ramp texture of scalar colouring from the actor
+    void removeScalarColorMap(vtkActor* gridActor);
+
+    /// @brief Creates the quad of nRows x nCols cells (rounded up to whole blocks of levelFactor cells) textured with gridImage
+    void setUpGridQuad(int nRows, int nCols, vtkActor* gridActor, int levelFactor);
+
+    /** @brief Allocates the heightfield mesh of a grid: XY of the points (centres of the sampled cells, Z on the flat grid),
+     *  a triangle strip per row of the mesh and cell indices sampled by every vertex. */
+    void setUpHeightfieldMesh(int nRows, int nCols, int meshFactor);
+
+    /// @brief Writes texture coordinates of the heightfield mesh, so the texture lies on it as on the quad of setUpGridQuad()
+    void writeHeightfieldTextureCoordinates();
+
+    /// @brief Makes the colour array use its own memory again, when it shows a shared (read-only) buffer
+    void releaseSharedColors();
+
+    /// @brief Makes the array of raw values use its own memory again, when it shows a shared (read-only) buffer
+    void releaseSharedScalars();
+
+    /** @brief RGB colour (3 bytes) of every cell, used directly (without lookup table) as texels of the grid texture.
+     *  The array is allocated in drawWithVTK() and only rewritten on refresh. */
+    vtkNew<vtkUnsignedCharArray> gridColors;
+
+    /// Buffer used as memory of gridColors by the second refreshWindowsVTK(), nullptr when gridColors owns its memory
+    std::shared_ptr<const std::vector<unsigned char>> sharedGridColors;
 
-    vtkNew<vtkStructuredGrid> structuredGrid;
-    structuredGrid->SetDimensions(nCols, nRows, 1);
-    structuredGrid->SetPoints(points);
-    structuredGrid->GetPointData()->SetScalars(pointValues);
+    /// Cells per texel of the shown colours (1 is full resolution)
+    int shownLevelFactor = 1;
 
-    buidColor(lut, nCols, nRows, p);
+    /// Regular grid of cells: only dimensions, origin and spacing, no explicit coordinates
+    vtkNew<vtkImageData> gridImage;
 
-    vtkNew<vtkDataSetMapper> gridMapper;
-    gridMapper->UpdateDataObject();
-    gridMapper->SetInputData(structuredGrid);
-    gridMapper->SetLookupTable(lut);
-    gridMapper->SetScalarRange(0, numberOfPoints - 1);
+    /// Texture showing gridImage on a single quad (one texel per cell)
+    vtkNew<vtkTexture> gridTexture;
+
+    /// Size of the quad of setUpGridQuad() (whole blocks of the texture), the texture coordinates of the heightfield follow it
+    std::pair<double, double> quadExtent{};
+
+    /// Heightfield mesh: float points, triangle strips and texture coordinates, allocated by setUpHeightfieldMesh()
+    vtkNew<vtkPoints> heightfieldPoints;
+    vtkNew<vtkFloatArray> heightfieldTextureCoordinates;
+    vtkNew<vtkPolyData> heightfieldMesh;
+
+    /// Index of the cell (in VTK image order) giving the height of every vertex of the mesh
+    std::vector<std::size_t> heightfieldSamples;
+
+    /// Grid of the mesh, quad extent of its texture coordinates and the shown heights (not uploaded again)
+    int heightfieldRows = 0;
+    int heightfieldColumns = 0;
+    std::pair<double, double> heightfieldTextureExtent{};
+    std::shared_ptr<const std::vector<float>> shownHeights;
+
+    /// Load balancing lines: two float points per line, allocated once per stage and rewritten on refresh
+    vtkNew<vtkPoints> linePoints;
+    vtkNew<vtkPolyData> linePolyData;
+
+    /// Raw value of every cell (scalar colouring), used instead of gridColors as the scalars of gridImage
+    vtkNew<vtkFloatArray> gridScalars;
+
+    /// Buffer used as memory of gridScalars, nullptr when gridScalars owns its memory
+    std::shared_ptr<const std::vector<float>> sharedGridScalars;
+
+    /// Whether gridImage shows raw values (gridScalars) instead of colours (gridColors)
+    bool showsScalars = false;
+
+    /// Range of values of the first shown step, used when the range of ColorSettings is automatic
+    std::optional<std::pair<float, float>> automaticScalarRange;
+
+    /// Colour ramp of scalar colouring: SCALAR_RAMP_SIZE x 1 RGB texels from ColorSettings
+    vtkNew<vtkUnsignedCharArray> rampColors;
+    vtkNew<vtkImageData> rampImage;
+    vtkNew<vtkTexture> rampTexture;
+};
+
+////////////////////////////////////////////////////////////////////
+
+template <class Matrix>
+void Visualizer::drawWithVTK(const Matrix &p, int nRows, int nCols, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor> gridActor)
+{
+    setUpGridActor(nRows, nCols, gridActor);
+    buidColor(gridColors, nCols, nRows, p);
 
-    gridActor->SetMapper(gridMapper);
     renderer->AddActor(gridActor);
 }
 
 template<class Matrix>
 void Visualizer::refreshWindowsVTK(const Matrix &p, int nRows, int nCols, vtkSmartPointer<vtkActor> gridActor)
 {
-    if (vtkLookupTable* lut = dynamic_cast<vtkLookupTable*>(gridActor->GetMapper()->GetLookupTable()))
-    {
-        buidColor(lut, nCols, nRows, p);
-        gridActor->GetMapper()->SetLookupTable(lut);
-        gridActor->GetMapper()->Update();
-    }
-    else
-        throw std::runtime_error("Invalid dynamic cast!");
-}
+    ScopedStageTimer timer(ProfiledStage::RefreshGrid);
+    releaseSharedColors(); // colours are written below, the shared buffer must stay untouched
 
-/** @brief Converts a color channel value to a normalized range [0, 1].
- *
- * This function is designed to be forward-compatible with upcoming changes in OOpenCal.
- * Currently, OOpenCal provides color values in the 0–255 integer range. VTK, however,
- * expects normalized double precision values in the 0–1 range.
- *
- * If the input value is greater than 1, it is assumed to be in the 0–255 range
- * and will be scaled down to [0, 1]. If the value is already in the [0, 1] range
- * (future OOpenCal format), it will be returned unchanged.
- *
- * @param channel The input color component (either in 0–255 or already in 0–1).
- * @return Normalized color value in the range [0, 1]. */
-inline double toUnitColor(double channel)
-{
-    // Backward compatibility: if value is > 1, assume 0–255 format and scale.
-    if (channel > 1.0)
-        return channel / 255.0;
+    // e.g. after switching model the actor still shows texture of the previous visualizer
+    if (gridActor->GetTexture() != gridTexture.GetPointer() || gridColors->GetNumberOfTuples() != static_cast<vtkIdType>(nRows) * nCols
+        || shownLevelFactor != 1 || showsScalars)
+        setUpGridActor(nRows, nCols, gridActor);
 
-    // Already normalized (future format) — return as-is.
-    return channel;
+    buidColor(gridColors, nCols, nRows, p);
+    gridColors->Modified(); // only the texture is uploaded again, the quad stays untouched
 }
 
 template<class Matrix>
-void Visualizer::buidColor(vtkLookupTable* lut, int nCols, int nRows, const Matrix &p)
+void Visualizer::buidColor(vtkUnsignedCharArray* colors, int nCols, int nRows, const Matrix &p)
 {
-    for (int r = 0; r < nRows; ++r)
-    {
-        for (int c = 0; c < nCols; ++c)
-        {
-            const auto color = p[r][c].outputValue(nullptr);
-            lut->SetTableValue(
-                (nRows - 1 - r) * nCols + c,
-                toUnitColor(color.getRed()),
-                toUnitColor(color.getGreen()),
-                toUnitColor(color.getBlue()),
-                1.0 // alpha channel – keep as 1.0 for full opacity (optional scaling)
-            );
-        }
-    }
+    writeCellColors(p, nRows, nCols, colors->WritePointer(0, static_cast<vtkIdType>(nRows) * nCols * 3));
 }
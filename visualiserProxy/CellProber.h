@@ -0,0 +1,82 @@
+/** @file CellProber.h
+ * @brief Declaration of the CellProber class template - time series of a substate of a cell over a range of steps. */
+
+#pragma once
+
+#include <algorithm> // std::min
+#include <format>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <vector>
+
+#include "utilities/ModelReader.hpp"
+#include "visualiser/CellProbe.h"
+#include "visualiser/SettingParameter.h"
+#include "visualiser/SubstateColumns.h" // cellSubstateValue
+
+/** @class CellProber
+ * @brief Reads the substate of the probed window in every step of the range (see ModelReader::readCellsOfSteps()).
+ *
+ * Only the rows of the window are read from the nodes owning it, so a probe of thousands of steps reads
+ * a few kilobytes per step instead of whole steps, and steps are neither decoded for the view nor cached.
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+class CellProber
+{
+public:
+    /// Steps read at once, so the cells of a long range are not all held in memory
+    static constexpr std::size_t STEPS_PER_BATCH = 1024;
+
+    /** @brief Probes steps of the request which are written by all nodes.
+     *  @param sp Parameters of the stage, the step and the region of interest inside are ignored
+     *  @param stopToken When stop is requested, reading ends early and std::nullopt is returned
+     *  @throws std::invalid_argument If no step of the range is written by all nodes, or the window is outside of the grid
+     *  @throws std::runtime_error If a step cannot be read */
+    static std::optional<CellProbeSeries> probe(ModelReader<Cell>& modelReader,
+                                                const SettingParameter& sp,
+                                                const CellProbeRequest& request,
+                                                std::stop_token stopToken = {})
+    {
+        if (request.row < 0 || request.row >= sp.numberOfRowsY || request.column < 0 || request.column >= sp.numberOfColumnX)
+            throw std::invalid_argument(std::format("Cell ({}, {}) is outside of the grid of {} x {} cells", request.row, request.column, sp.numberOfRowsY, sp.numberOfColumnX));
+
+        std::vector<StepIndex> steps;
+        for (const auto step : modelReader.stepsInAllNodes())
+        {
+            if (request.firstStep <= step && step <= request.lastStep)
+                steps.push_back(step);
+        }
+        if (steps.empty())
+            throw std::invalid_argument(std::format("No step in range {}-{} is written by all nodes", request.firstStep, request.lastStep));
+
+        CellProbeSeries series{ .request = request };
+        series.steps.reserve(steps.size());
+        series.means.reserve(steps.size());
+        series.minimums.reserve(steps.size());
+        series.maximums.reserve(steps.size());
+
+        std::vector<double> values;
+        for (std::size_t first = 0; first < steps.size(); first += STEPS_PER_BATCH)
+        {
+            const auto batch = std::span<const StepIndex>(steps).subspan(first, std::min(STEPS_PER_BATCH, steps.size() - first));
+            const auto cellsOfSteps = modelReader.readCellsOfSteps(sp, request.window(), batch, stopToken);
+            if (! cellsOfSteps)
+                return std::nullopt;
+
+            for (std::size_t index = 0; index < batch.size(); ++index)
+            {
+                const auto& cells = (*cellsOfSteps)[index];
+                values.clear();
+                for (std::size_t row = 0; row < cells.rows(); ++row)
+                {
+                    for (const auto& cell : cells[row])
+                        values.push_back(cellSubstateValue(cell, request.substate.c_str()));
+                }
+                series.add(batch[index], values);
+            }
+        }
+        return series;
+    }
+};
@@ -0,0 +1,90 @@
+/** @file DecodedStep.h
+ * @brief Declaration of the DecodedStep structure - complete state of one step, ready to be displayed. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utilities/Matrix2D.h"
+#include "utilities/StepLayout.h"
+#include "utilities/types.h"
+#include "visualiser/CellColors.h" // ColorLevel
+#include "visualiserProxy/StepColoring.h"
+#include "visualiser/CellReductions.h"
+#include "visualiser/SubstateColumns.h"
+#include "visualiser/Line.h"
+
+/** @struct DecodedStep
+ * @brief Cells, their colours and load balancing lines of one step, read and parsed from the node files.
+ *
+ * Decoded steps are immutable after decoding and shared between the step cache,
+ * the background prefetcher and the visualizer (which displays one of them).
+ * Every step has its own buffers, so the next step is decoded and coloured by a worker thread
+ * while the displayed one is rendered; switching steps only swaps the shared pointers.
+ * A view colouring the step differently than it was decoded gets a step of its own colours, which refers
+ * to the decoded one as its source (the cells are not copied, see StepColorizer::recolor()).
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+struct DecodedStep
+{
+    StepIndex step{};        ///< Step which the data belongs to
+    int rows{};              ///< Rows of the whole grid
+    int columns{};           ///< Columns of the whole grid
+    Matrix2D<Cell> cells;    ///< Cells of the whole stage, empty when dropped after decoding (columnar substate storage)
+    std::vector<Line> lines; ///< Borders of the nodes (load balancing lines)
+
+    /** RGB of every cell in VTK image order (see writeCellColors()), nullptr if not computed (e.g. the initial empty step).
+     *  Steps whose nodes did not change share the buffer with the step they were compared to. */
+    std::shared_ptr<const std::vector<unsigned char>> colors;
+
+    /** Raw values of the colour substate (the `color_substate` setting) in the same order, coloured on the GPU;
+     *  set instead of colors, so a step uploads one float per cell. Shared with the compared step like colors. */
+    std::shared_ptr<const std::vector<float>> scalars;
+
+    /** Elevation of every cell in the same order (the `height_substate` setting multiplied by `height_scale`),
+     *  NaN where unknown, nullptr for a flat grid. Shared with the compared step like colors. */
+    std::shared_ptr<const std::vector<float>> heights;
+
+    /// Levels of detail of the colours or of the raw values (factor 2, 4, ...), empty for grids small enough to be always shown in full
+    std::vector<ColorLevel> coarserColors;
+
+    /// How the texels and heights were computed (a previous step is reused only when coloured the same way)
+    StepColoring coloring;
+
+    /// Step owning the cells when this one only colours them for another view, nullptr when the cells are own
+    std::shared_ptr<const DecodedStep> source;
+
+    /// Placement and hashes of raw data of the nodes (used to find nodes which did not change)
+    StepContents contents;
+
+    /// Reductions of the substates from the `substates` setting, nullptr when none are requested
+    std::shared_ptr<const StepReductions> reductions;
+
+    /// Description of a synthetic step showing a temporal aggregation (TemporalAggregationRequest::description()), empty for read steps
+    std::string aggregation;
+
+    /// Values of the substates from the `substates` setting, only with the columnar storage (`substate_storage=columns`)
+    std::shared_ptr<const SubstateColumns> substateColumns;
+
+    /// @brief Cells of the step: own ones or those of the source step
+    const Matrix2D<Cell>& decodedCells() const
+    {
+        return source ? source->cells : cells;
+    }
+
+    /// @brief Approximate number of bytes occupied by the step (used for the cache budget), without its source step
+    std::size_t memoryUsage() const
+    {
+        std::size_t colorsSize = (colors ? colors->size() : 0) + (scalars ? scalars->size() * sizeof(float) : 0)
+                               + (heights ? heights->size() * sizeof(float) : 0);
+        for (const auto& level : coarserColors)
+            colorsSize += (level.colors ? level.colors->size() : 0) + (level.scalars ? level.scalars->size() * sizeof(float) : 0);
+        return sizeof(*this) + cells.size() * sizeof(Cell) + lines.size() * sizeof(Line) + colorsSize
+             + contents.nodeHashes.size() * sizeof(std::uint64_t) + (reductions ? reductions->memoryUsage() : 0)
+             + (substateColumns ? substateColumns->memoryUsage() : 0);
+    }
+};
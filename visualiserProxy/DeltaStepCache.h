@@ -0,0 +1,428 @@
+/** @file DeltaStepCache.h
+ * @brief Declaration of the DeltaStepCache class template - memory-bounded cache of steps stored as differences from keyframes. */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator> // std::prev
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility> // std::move
+#include <vector>
+
+#include "DecodedStep.h"
+#include "utilities/SparseDelta.h"
+#include "utilities/StepCache.h" // StepCacheStatistics
+#include "utilities/types.h"
+
+/** @class DeltaStepCache
+ * @brief Thread-safe LRU cache of decoded steps, most of them kept only as their differences from a similar step.
+ *
+ * Some of the cached steps are keyframes, kept as they are. Any other step is stored as SparseDelta of each of its
+ * buffers (cells, colours, raw values, heights, levels of detail, substate columns) from the keyframe nearest to it
+ * (by step index), which takes a fraction of the step when few cells change between steps. A step whose delta would
+ * take more than 1/KEYFRAME_DELTA_RATIO of its size becomes a keyframe itself, so keyframes follow the pace
+ * at which the simulation changes. A step is reconstructed from its keyframe by two sequential copies per buffer,
+ * buffers equal to the keyframe's ones are shared with it.
+ *
+ * Used behind StepCache by StepPrefetcher: steps evicted from the full cache are kept here,
+ * so the same memory budget holds many more steps for scrubbing back and forth.
+ * A keyframe is refreshed together with its deltas, and evicting it evicts them too (they could not be reconstructed).
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+class DeltaStepCache
+{
+public:
+    using StepPtr = std::shared_ptr<const DecodedStep<Cell>>;
+
+    /// A step becomes a keyframe when its delta from the nearest keyframe takes more than this part of its size
+    static constexpr std::size_t KEYFRAME_DELTA_RATIO = 4;
+
+    explicit DeltaStepCache(std::size_t memoryBudgetBytes)
+        : memoryBudgetBytes{ memoryBudgetBytes }
+    {
+    }
+
+    /** @brief Adds the step, as a delta from the nearest keyframe or as a new keyframe.
+     *  Nothing is done when the step is already cached (erase() an outdated one first). The step is encoded outside of the lock. */
+    void insert(const StepPtr& step)
+    {
+        if (! step)
+            return;
+
+        StepPtr keyframe;
+        {
+            std::lock_guard lock(mutex);
+            if (entriesByStep.contains(step->step) || 0 == memoryBudgetBytes)
+                return;
+            keyframe = nearestKeyframeUnlocked(*step);
+        }
+
+        const auto stepSize = step->memoryUsage();
+        std::shared_ptr<const EncodedStep> encoded;
+        if (keyframe)
+        {
+            encoded = std::make_shared<const EncodedStep>(encode(*step, keyframe));
+            if (encoded->memoryUsage() * KEYFRAME_DELTA_RATIO > stepSize)
+                encoded.reset();
+        }
+
+        std::lock_guard lock(mutex);
+        if (entriesByStep.contains(step->step))
+            return; // inserted by another thread meanwhile
+
+        const auto keyframeEntry = keyframe ? entriesByStep.find(keyframe->step) : entriesByStep.end();
+        if (encoded && keyframeEntry != entriesByStep.end() && keyframeEntry->second->keyframe == keyframe)
+        {
+            keyframeEntry->second->dependentSteps.push_back(step->step);
+            const auto encodedSize = encoded->memoryUsage();
+            pushFrontUnlocked(Entry{ step->step, keyframe, std::move(encoded), encodedSize, {} });
+            entries.splice(entries.begin(), entries, keyframeEntry->second); // the keyframe always outlives its deltas in the LRU order
+        }
+        else
+        {
+            if (stepSize > memoryBudgetBytes)
+                return;
+            pushFrontUnlocked(Entry{ step->step, step, nullptr, stepSize, {} });
+            keyframes[step->step] = entries.begin();
+        }
+        evictAboveBudgetUnlocked();
+    }
+
+    /** @brief Returns the step (reconstructed when it is a delta) and marks it and its keyframe as the most recently used ones.
+     *  @return The step or nullptr if it is not cached, a found step is counted as a hit */
+    StepPtr find(StepIndex step)
+    {
+        StepPtr keyframe;
+        std::shared_ptr<const EncodedStep> encoded;
+        {
+            std::lock_guard lock(mutex);
+            const auto it = entriesByStep.find(step);
+            if (it == entriesByStep.end())
+                return nullptr;
+
+            ++hitsCount;
+            keyframe = it->second->keyframe;
+            encoded = it->second->encoded;
+            entries.splice(entries.begin(), entries, it->second);
+            if (encoded)
+                entries.splice(entries.begin(), entries, entriesByStep.at(keyframe->step));
+        }
+        return encoded ? decode(*encoded, *keyframe) : keyframe;
+    }
+
+    /// @brief Like find(), without changing the LRU order and without counting the lookup
+    StepPtr peek(StepIndex step) const
+    {
+        StepPtr keyframe;
+        std::shared_ptr<const EncodedStep> encoded;
+        {
+            std::lock_guard lock(mutex);
+            const auto it = entriesByStep.find(step);
+            if (it == entriesByStep.end())
+                return nullptr;
+            keyframe = it->second->keyframe;
+            encoded = it->second->encoded;
+        }
+        return encoded ? decode(*encoded, *keyframe) : keyframe;
+    }
+
+    bool contains(StepIndex step) const
+    {
+        std::lock_guard lock(mutex);
+        return entriesByStep.contains(step);
+    }
+
+    /// @brief Whether the step is cached with all nodes intersecting the region read (without reconstructing it)
+    bool covers(StepIndex step, const std::optional<CellRegion>& region) const
+    {
+        std::lock_guard lock(mutex);
+        const auto it = entriesByStep.find(step);
+        if (it == entriesByStep.end())
+            return false;
+        const auto& entry = *it->second;
+        return (entry.encoded ? entry.encoded->metadata.contents : entry.keyframe->contents).covers(region);
+    }
+
+    /// @brief Removes the step (with its deltas when it is a keyframe)
+    void erase(StepIndex step)
+    {
+        std::lock_guard lock(mutex);
+        eraseUnlocked(step);
+    }
+
+    /// @brief Removes all cached steps (counters are kept)
+    void clear()
+    {
+        std::lock_guard lock(mutex);
+        entries.clear();
+        entriesByStep.clear();
+        keyframes.clear();
+        usedBytes = 0;
+    }
+
+    void setMemoryBudget(std::size_t newMemoryBudgetBytes)
+    {
+        std::lock_guard lock(mutex);
+        memoryBudgetBytes = newMemoryBudgetBytes;
+        evictAboveBudgetUnlocked();
+    }
+
+    std::size_t memoryBudget() const
+    {
+        std::lock_guard lock(mutex);
+        return memoryBudgetBytes;
+    }
+
+    /// @brief State of the cache, misses are not counted (the full cache in front of it counts them)
+    StepCacheStatistics statistics() const
+    {
+        std::lock_guard lock(mutex);
+        return StepCacheStatistics{
+            .hits = hitsCount,
+            .cachedSteps = entries.size(),
+            .memoryUsage = usedBytes,
+            .memoryBudget = memoryBudgetBytes
+        };
+    }
+
+private:
+    /// @brief One level of detail of a step
+    struct LevelDelta
+    {
+        int factor;
+        int rows;
+        int columns;
+        std::optional<SparseDelta<unsigned char>> colors;
+        std::optional<SparseDelta<float>> scalars;
+    };
+
+    /** @struct EncodedStep
+     * @brief A step stored as deltas of its buffers from a keyframe (a missing buffer is std::nullopt). */
+    struct EncodedStep
+    {
+        DecodedStep<Cell> metadata; ///< everything but the buffers below (lines, contents, reductions, ...)
+        std::size_t cellRows{};
+        std::size_t cellColumns{};
+        SparseDelta<Cell> cells;
+        std::optional<SparseDelta<unsigned char>> colors;
+        std::optional<SparseDelta<float>> scalars;
+        std::optional<SparseDelta<float>> heights;
+        std::vector<LevelDelta> coarserColors;
+        std::optional<SubstateColumns> substateLayout; ///< names and size of the substate columns, without the values
+        std::vector<SparseDelta<double>> substateValues;
+
+        std::size_t memoryUsage() const
+        {
+            std::size_t bytes = metadata.memoryUsage() + cells.memoryUsage() + (colors ? colors->memoryUsage() : 0)
+                              + (scalars ? scalars->memoryUsage() : 0) + (heights ? heights->memoryUsage() : 0);
+            for (const auto& level : coarserColors)
+                bytes += (level.colors ? level.colors->memoryUsage() : 0) + (level.scalars ? level.scalars->memoryUsage() : 0);
+            if (substateLayout)
+                bytes += substateLayout->memoryUsage();
+            for (const auto& values : substateValues)
+                bytes += values.memoryUsage();
+            return bytes;
+        }
+    };
+
+    struct Entry
+    {
+        StepIndex step;
+        StepPtr keyframe;                           ///< the step itself for a keyframe
+        std::shared_ptr<const EncodedStep> encoded; ///< nullptr for a keyframe
+        std::size_t sizeInBytes;
+        std::vector<StepIndex> dependentSteps;      ///< steps encoded from this keyframe
+    };
+
+    template<typename T>
+    static std::optional<SparseDelta<T>> encodeBuffer(const std::shared_ptr<const std::vector<T>>& buffer, const std::shared_ptr<const std::vector<T>>& reference)
+    {
+        if (! buffer)
+            return std::nullopt;
+        return SparseDelta<T>::encode(reference ? std::span<const T>(*reference) : std::span<const T>{}, *buffer);
+    }
+
+    template<typename T>
+    static std::shared_ptr<const std::vector<T>> decodeBuffer(const std::optional<SparseDelta<T>>& delta, const std::shared_ptr<const std::vector<T>>& reference)
+    {
+        if (! delta)
+            return nullptr;
+        if (reference && delta->isUnchanged(reference->size()))
+            return reference; // shared, as between decoded steps with unchanged nodes
+
+        auto buffer = std::make_shared<std::vector<T>>(delta->size());
+        delta->apply(reference ? std::span<const T>(*reference) : std::span<const T>{}, *buffer);
+        return buffer;
+    }
+
+    static EncodedStep encode(const DecodedStep<Cell>& step, const StepPtr& keyframe)
+    {
+        EncodedStep encoded;
+        encoded.metadata.step = step.step;
+        encoded.metadata.rows = step.rows;
+        encoded.metadata.columns = step.columns;
+        encoded.metadata.lines = step.lines;
+        encoded.metadata.coloring = step.coloring;
+        encoded.metadata.source = step.source;
+        encoded.metadata.contents = step.contents;
+        encoded.metadata.reductions = step.reductions;
+        encoded.metadata.aggregation = step.aggregation;
+
+        encoded.cellRows = step.cells.rows();
+        encoded.cellColumns = step.cells.columns();
+        encoded.cells = SparseDelta<Cell>::encode(keyframe->cells.flat(), step.cells.flat());
+        encoded.colors = encodeBuffer(step.colors, keyframe->colors);
+        encoded.scalars = encodeBuffer(step.scalars, keyframe->scalars);
+        encoded.heights = encodeBuffer(step.heights, keyframe->heights);
+
+        for (std::size_t level = 0; level < step.coarserColors.size(); ++level)
+        {
+            const auto* referenceLevel = (level < keyframe->coarserColors.size()) ? &keyframe->coarserColors[level] : nullptr;
+            const auto& stepLevel = step.coarserColors[level];
+            encoded.coarserColors.push_back({ stepLevel.factor,
+                                              stepLevel.rows,
+                                              stepLevel.columns,
+                                              encodeBuffer(stepLevel.colors, referenceLevel ? referenceLevel->colors : nullptr),
+                                              encodeBuffer(stepLevel.scalars, referenceLevel ? referenceLevel->scalars : nullptr) });
+        }
+
+        if (const auto& columns = step.substateColumns)
+        {
+            const auto& referenceColumns = keyframe->substateColumns;
+            const bool sameLayout = referenceColumns && referenceColumns->hasLayout(columns->names, columns->rows, columns->columns);
+            encoded.substateLayout.emplace();
+            encoded.substateLayout->names = columns->names;
+            encoded.substateLayout->rows = columns->rows;
+            encoded.substateLayout->columns = columns->columns;
+            for (std::size_t substate = 0; substate < columns->values.size(); ++substate)
+            {
+                encoded.substateValues.push_back(SparseDelta<double>::encode(sameLayout ? std::span<const double>(referenceColumns->values[substate]) : std::span<const double>{},
+                                                                              columns->values[substate]));
+            }
+        }
+        return encoded;
+    }
+
+    static StepPtr decode(const EncodedStep& encoded, const DecodedStep<Cell>& keyframe)
+    {
+        auto step = std::make_shared<DecodedStep<Cell>>(encoded.metadata);
+
+        if (encoded.cells.size() > 0)
+        {
+            step->cells.resize(encoded.cellRows, encoded.cellColumns);
+            encoded.cells.apply(keyframe.cells.flat(), step->cells.flat());
+        }
+        step->colors = decodeBuffer(encoded.colors, keyframe.colors);
+        step->scalars = decodeBuffer(encoded.scalars, keyframe.scalars);
+        step->heights = decodeBuffer(encoded.heights, keyframe.heights);
+
+        for (std::size_t level = 0; level < encoded.coarserColors.size(); ++level)
+        {
+            const auto* referenceLevel = (level < keyframe.coarserColors.size()) ? &keyframe.coarserColors[level] : nullptr;
+            const auto& encodedLevel = encoded.coarserColors[level];
+            step->coarserColors.push_back({ .factor = encodedLevel.factor,
+                                            .rows = encodedLevel.rows,
+                                            .columns = encodedLevel.columns,
+                                            .colors = decodeBuffer(encodedLevel.colors, referenceLevel ? referenceLevel->colors : nullptr),
+                                            .scalars = decodeBuffer(encodedLevel.scalars, referenceLevel ? referenceLevel->scalars : nullptr) });
+        }
+
+        if (encoded.substateLayout)
+        {
+            const auto& referenceColumns = keyframe.substateColumns;
+            const bool sameLayout = referenceColumns && referenceColumns->hasLayout(encoded.substateLayout->names, encoded.substateLayout->rows, encoded.substateLayout->columns);
+            auto columns = std::make_shared<SubstateColumns>(*encoded.substateLayout);
+            for (std::size_t substate = 0; substate < encoded.substateValues.size(); ++substate)
+            {
+                auto& values = columns->values.emplace_back(encoded.substateValues[substate].size());
+                encoded.substateValues[substate].apply(sameLayout ? std::span<const double>(referenceColumns->values[substate]) : std::span<const double>{}, values);
+            }
+            step->substateColumns = std::move(columns);
+        }
+        return step;
+    }
+
+    /// @brief Keyframe with the same grid size nearest to the step (by step index), nullptr if there is none
+    StepPtr nearestKeyframeUnlocked(const DecodedStep<Cell>& step) const
+    {
+        const auto compatible = [&step](const auto& keyframe)
+        {
+            return keyframe->second->keyframe->rows == step.rows && keyframe->second->keyframe->columns == step.columns;
+        };
+
+        const auto after = keyframes.lower_bound(step.step);
+        StepPtr nearest;
+        StepIndex nearestDistance{};
+        if (after != keyframes.end() && compatible(after))
+        {
+            nearest = after->second->keyframe;
+            nearestDistance = after->first - step.step;
+        }
+        if (after != keyframes.begin())
+        {
+            const auto before = std::prev(after);
+            if (compatible(before) && (! nearest || step.step - before->first < nearestDistance))
+                nearest = before->second->keyframe;
+        }
+        return nearest;
+    }
+
+    void pushFrontUnlocked(Entry entry)
+    {
+        usedBytes += entry.sizeInBytes;
+        const auto step = entry.step;
+        entries.push_front(std::move(entry));
+        entriesByStep[step] = entries.begin();
+    }
+
+    void eraseUnlocked(StepIndex step)
+    {
+        const auto it = entriesByStep.find(step);
+        if (it == entriesByStep.end())
+            return;
+
+        const auto entry = it->second;
+        usedBytes -= entry->sizeInBytes;
+        entriesByStep.erase(it);
+        if (entry->encoded)
+        {
+            if (const auto keyframe = entriesByStep.find(entry->keyframe->step); keyframe != entriesByStep.end())
+                std::erase(keyframe->second->dependentSteps, step);
+        }
+        else
+        {
+            keyframes.erase(step);
+            for (const auto dependent : entry->dependentSteps)
+            {
+                if (const auto dependentEntry = entriesByStep.find(dependent); dependentEntry != entriesByStep.end())
+                {
+                    usedBytes -= dependentEntry->second->sizeInBytes;
+                    entries.erase(dependentEntry->second);
+                    entriesByStep.erase(dependentEntry);
+                }
+            }
+        }
+        entries.erase(entry);
+    }
+
+    void evictAboveBudgetUnlocked()
+    {
+        while (usedBytes > memoryBudgetBytes && ! entries.empty())
+        {
+            eraseUnlocked(entries.back().step);
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; ///< most recently used first
+    std::unordered_map<StepIndex, typename std::list<Entry>::iterator> entriesByStep;
+    std::map<StepIndex, typename std::list<Entry>::iterator> keyframes; ///< keyframe entries ordered by step, see nearestKeyframeUnlocked()
+    std::size_t usedBytes = 0;
+    std::size_t memoryBudgetBytes;
+    std::size_t hitsCount = 0;
+};
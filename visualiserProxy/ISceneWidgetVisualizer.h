@@ -17,14 +17,53 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
 #include <vtkRenderer.h>
 
+#include "utilities/NodeStepOffsets.h" // IndexLoadingProgressCallback, IndexAppendResult
+#include "utilities/StepCache.h"       // StepCacheStatistics
 #include "utilities/types.h"
+#include "visualiser/StepFrame.h"
 
 // Forward declarations
 class SettingParameter;
 class Line;
 class Visualizer;
+struct StepReductions;
+struct TemporalAggregationRequest;
+struct CellProbeRequest;
+struct CellProbeSeries;
+
+/** @brief Called from the loading thread when an asynchronous step load finishes.
+ *  The error is set when the step could not be read. Not called for loads superseded by a newer request. */
+using StepLoadedCallback = std::function<void(StepIndex step, std::exception_ptr error)>;
+
+/// @brief Reports steps aggregated so far by an asynchronous aggregation, called from the aggregating threads
+using AggregationProgressCallback = std::function<void(std::size_t aggregatedSteps, std::size_t totalSteps)>;
+
+/** @brief Called from the aggregating thread when an asynchronous aggregation finishes.
+ *  The error is set when it failed. Not called for aggregations which were stopped. */
+using AggregationFinishedCallback = std::function<void(std::exception_ptr error)>;
+
+/** @brief Called from the probing thread when an asynchronous cell probe finishes.
+ *  Either the series or the error is set. Not called for probes which were stopped. */
+using CellProbeFinishedCallback = std::function<void(std::shared_ptr<const CellProbeSeries> series, std::exception_ptr error)>;
+
+/// @brief Called from the thumbnail thread with every frame decoded by requestThumbnailFrames()
+using ThumbnailFrameCallback = std::function<void(StepFrame frame)>;
+
+/** @brief Called from the thumbnail thread when all frames of requestThumbnailFrames() were given.
+ *  The error is set when a step could not be read. Not called for passes which were stopped. */
+using ThumbnailsFinishedCallback = std::function<void(std::exception_ptr error)>;
 
 /** @interface ISceneWidgetVisualizer
  * @brief Abstract interface defining the contract for all scene widget visualizers.
@@ -54,18 +93,148 @@ public:
      * This should be called before reloading data to avoid duplicate entries. */
     virtual void clearStage() = 0;
 
-    /// @brief Read steps offsets for all nodes from files.
-    virtual void readStepsOffsetsForAllNodesFromFiles(int nNodeX, int nNodeY, const std::string& filename) = 0;
+    /** @brief Read steps offsets for all nodes from files (nodes are loaded in parallel).
+     *  @param readMode The `mode` setting, in the container mode the offsets are read from the output container
+     *  @param progress Optional callback after every loaded node, called from worker threads
+     *  @param firstStep Step shown first, its data is read into the page cache while the indices are loaded */
+    virtual void readStepsOffsetsForAllNodesFromFiles(int nNodeX,
+                                                      int nNodeY,
+                                                      const std::string& filename,
+                                                      const std::string& readMode,
+                                                      const IndexLoadingProgressCallback& progress = {},
+                                                      std::optional<StepIndex> firstStep = std::nullopt) = 0;
+
+    /** @brief Read only lines appended to the index files since the last read (following a running simulation).
+     *  Background reading of all views of the stage (also the linked ones) is stopped first, they have to request their steps again.
+     *  @return Number of appended lines and whether the indices had to be parsed again */
+    virtual IndexAppendResult appendStepsOffsetsForAllNodesFromFiles(const std::string& filename) = 0;
 
-    /// @brief Read stage state from files for a specific step.
+    /** @brief Read stage state from files for a specific step.
+     *
+     * A step already decoded by prefetchSteps() is taken from the step cache without reading files. */
     virtual void readStageStateFromFilesForStep(SettingParameter* sp, Line* lines) = 0;
 
+    /** @brief Start reading the step on a background thread, a running older request is stopped.
+     *
+     * Only the newest request reports its result (with onLoaded), then the GUI thread shows it with showLoadedStep().
+     * @param sp Parameters of the stage with the requested step (copied) */
+    virtual void requestStepLoad(const SettingParameter* sp, StepLoadedCallback onLoaded) = 0;
+
+    /** @brief Make the step loaded by requestStepLoad() the displayed one and copy its node lines.
+     *  @return false if the loaded step is not the given one (a newer one was requested meanwhile) */
+    virtual bool showLoadedStep(StepIndex step, Line* lines) = 0;
+
+    /// @brief Stop the running asynchronous step load (its callback is not called), does not wait for it.
+    virtual void cancelStepLoad() = 0;
+
+    /** @brief Start aggregating a substate over a range of steps on a background thread (see TemporalAggregator).
+     *
+     * A running older aggregation is stopped. The steps are read by a streaming pass holding only the accumulators,
+     * the step cache is neither used nor filled. When finished, the GUI thread shows the result with showAggregatedStep().
+     * @param sp Parameters of the stage (copied, the step inside is ignored) */
+    virtual void requestStepAggregation(const SettingParameter* sp,
+                                        const TemporalAggregationRequest& request,
+                                        AggregationProgressCallback progress,
+                                        AggregationFinishedCallback onFinished) = 0;
+
+    /** @brief Make the finished aggregation the displayed step (a synthetic step: aggregated values coloured on the GPU,
+     *         node lines of the last aggregated step) and copy its node lines.
+     *  @return false if no aggregation has finished since the last request */
+    virtual bool showAggregatedStep(Line* lines) = 0;
+
+    /// @brief Stop the running aggregation (its callback is not called), does not wait for it.
+    virtual void cancelStepAggregation() = 0;
+
+    /** @brief Start reading a substate of a cell (or of a window around it) over a range of steps on a background thread (see CellProber).
+     *
+     * A running older probe is stopped. Only the rows of the window are read from the nodes owning it,
+     * the step cache is neither used nor filled.
+     * @param sp Parameters of the stage (copied, the step and the region of interest inside are ignored) */
+    virtual void requestCellProbe(const SettingParameter* sp, const CellProbeRequest& request, CellProbeFinishedCallback onFinished) = 0;
+
+    /// @brief Stop the running cell probe (its callback is not called), does not wait for it.
+    virtual void cancelCellProbe() = 0;
+
+    /** @brief Decode the step for rendering elsewhere (e.g. video export), the displayed step is not changed.
+     *
+     * Safe to call from any thread, the step cache and running prefetches are used.
+     * @param sp Parameters of the stage with the requested step
+     * @return Empty if the step is not present in index files or stop was requested
+     * @throws std::runtime_error If the step cannot be read */
+    virtual std::optional<StepFrame> decodeStepFrame(const SettingParameter& sp, std::stop_token stopToken = {}) = 0;
+
+    /** @brief Start decoding the steps for thumbnails on a background thread of the lowest priority, a running older pass is stopped.
+     *
+     * The pass yields to the views: it waits while they load, prefetch or aggregate steps. A step cached for the views
+     * is taken from the cache, other steps are decoded without filling the cache. Frames are given at the coarsest
+     * level of detail which still has at least maxSize texels on the longer side (see SceneWidgetVisualizerTemplate::levelOfDetail()).
+     * @param sp Parameters of the stage (copied, the step and the region of interest inside are ignored)
+     * @param steps Steps to decode, in this order */
+    virtual void requestThumbnailFrames(const SettingParameter* sp,
+                                        std::vector<StepIndex> steps,
+                                        int maxSize,
+                                        ThumbnailFrameCallback onFrame,
+                                        ThumbnailsFinishedCallback onFinished) = 0;
+
+    /// @brief Stop the running pass of requestThumbnailFrames() (its finishing callback is not called), does not wait for it.
+    virtual void cancelThumbnailFrames() = 0;
+
+    /** @brief Start decoding the steps in background, so switching to them later does not wait for I/O.
+     *
+     * Steps already cached or not present in index files are skipped.
+     * @param sp Parameters of the stage (the step inside is ignored)
+     * @param steps Steps to decode, in the order of expected use */
+    virtual void prefetchSteps(const SettingParameter* sp, const std::vector<StepIndex>& steps) = 0;
+
+    /** @brief Like prefetchSteps(), but steps scheduled earlier, not in the list and not started yet, are not decoded.
+     *  Used by the playback when it skips steps which would not be decoded in time. */
+    virtual void reschedulePrefetch(const SettingParameter* sp, const std::vector<StepIndex>& steps) = 0;
+
+    /** @brief Whether the step is decoded for sp.regionOfInterest, so showing it does not read files.
+     *  @param sp Parameters of the stage (the step inside is ignored) */
+    virtual bool isStepDecoded(StepIndex step, const SettingParameter& sp) const = 0;
+
+    /// @brief Recent average time of decoding one step in background (zero when no step was decoded yet)
+    virtual std::chrono::nanoseconds averageStepDecodeTime() const = 0;
+
+    /** @brief Reductions of substates (the `reduction` and `substates` settings) of the displayed step.
+     *  @return nullptr when no reductions are requested or no step is displayed yet */
+    virtual std::shared_ptr<const StepReductions> displayedStepReductions() const = 0;
+
+    /** @brief Value of the cell of the displayed step as text (shown e.g. in the tooltip).
+     *
+     * It is the cell's stringEncoding(), or values of the substates when the cells were dropped after decoding
+     * (columnar substate storage).
+     * @param row Row of the cell in the whole grid (0 is the first row of the output files)
+     * @param column Column of the cell in the whole grid
+     * @return Empty outside of the grid or when the value is not known */
+    virtual std::string displayedCellText(int row, int column) const = 0;
+
+    /** @brief Set maximum number of bytes occupied by decoded steps kept in the step cache.
+     *  @param compressedMemoryBudgetBytes Bytes of the steps evicted from it, kept delta-compressed (0: they are dropped) */
+    virtual void setStepCacheMemoryBudget(std::size_t memoryBudgetBytes, std::size_t compressedMemoryBudgetBytes) = 0;
+
+    /// @brief Returns hits, misses and memory usage of the step cache.
+    virtual StepCacheStatistics stepCacheStatistics() const = 0;
+
+    /// @brief Set maximum number of node files kept open between steps.
+    virtual void setMaxOpenFiles(std::size_t maxOpenFiles) = 0;
+
+    /// @brief Set address ("host:port") of the agent sending the output in the remote mode.
+    virtual void setRemoteAgent(const std::string& address) = 0;
+
     /// @brief Draw the visualization using VTK.
     virtual void drawWithVTK(int nRows, int nCols, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor> gridActor) = 0;
 
     /// @brief Refresh the VTK windows.
     virtual void refreshWindowsVTK(int nRows, int nCols, vtkSmartPointer<vtkActor> gridActor) = 0;
 
+    /** @brief Set how many cells of the grid fall on one screen pixel (from the camera zoom).
+     *
+     * Big grids are then shown at a coarser level of detail (see buildColorPyramid()).
+     * @return true if the shown level changed, so refreshWindowsVTK() has to be called */
+    virtual bool setCellsPerScreenPixel(double cellsPerPixel) = 0;
+
     /// @brief Get the visualizer instance.
     virtual Visualizer& getVisualizer() = 0;
 
@@ -76,4 +245,15 @@ public:
 
     /// @brief Returns available steps from index file.
     virtual std::vector<StepIndex> availableSteps() const = 0;
+
+    /// @brief Returns steps already written by every node (differences between nodes are expected, no warnings).
+    virtual std::vector<StepIndex> stepsInAllNodes() const = 0;
+
+    /** @brief Creates another view of the same stage (linked view): it shares the reader and the decoded steps.
+     *
+     * Steps are decoded once for all views (the store is reference counted), a view whose colouring settings
+     * (colour substate, height substate) differ computes only its own colours. The stage itself is changed
+     * only through this visualizer (initMatrix(), prepareStage(), clearStage(), reading of indices) and
+     * linked views have to be destroyed before it is changed. */
+    virtual std::unique_ptr<ISceneWidgetVisualizer> createLinkedView() = 0;
 };
@@ -17,6 +17,16 @@
 
 #pragma once
 
+#include <algorithm> // std::ranges::copy, std::max
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <stop_token>
+#include <thread> // std::this_thread::sleep_for
+#include <vector>
+
 #include "ISceneWidgetVisualizer.h"
 #include "SceneWidgetVisualizerProxy.h"
 
@@ -48,6 +58,18 @@ public:
     {
     }
 
+    /// @brief Creates a linked view: it shows the stage of the store (read and decoded by its owner)
+    SceneWidgetVisualizerAdapter(const std::string& modelName, std::shared_ptr<DecodedStepStore<Cell>> store)
+        : m_impl(std::move(store))
+        , m_modelName(modelName)
+    {
+    }
+
+    std::unique_ptr<ISceneWidgetVisualizer> createLinkedView() override
+    {
+        return std::make_unique<SceneWidgetVisualizerAdapter<Cell>>(m_modelName, m_impl.store);
+    }
+
     void initMatrix(int dimX, int dimY) override
     {
         m_impl.initMatrix(dimX, dimY);
@@ -55,32 +77,386 @@ public:
 
     void prepareStage(int nNodeX, int nNodeY) override
     {
+        m_impl.invalidateDecodedSteps(); // background reads must not run while the stage changes
         m_impl.modelReader.prepareStage(nNodeX, nNodeY);
     }
 
     void clearStage() override
     {
+        m_impl.invalidateDecodedSteps();
         m_impl.modelReader.clearStage();
     }
 
-    void readStepsOffsetsForAllNodesFromFiles(int nNodeX, int nNodeY, const std::string& filename) override
+    void readStepsOffsetsForAllNodesFromFiles(int nNodeX,
+                                              int nNodeY,
+                                              const std::string& filename,
+                                              const std::string& readMode,
+                                              const IndexLoadingProgressCallback& progress,
+                                              std::optional<StepIndex> firstStep) override
     {
-        m_impl.modelReader.readStepsOffsetsForAllNodesFromFiles(nNodeX, nNodeY, filename);
+        m_impl.invalidateDecodedSteps();
+        m_impl.modelReader.readStepsOffsetsForAllNodesFromFiles(nNodeX, nNodeY, filename, readMode, progress, firstStep);
+    }
+
+    IndexAppendResult appendStepsOffsetsForAllNodesFromFiles(const std::string& filename) override
+    {
+        m_impl.stopBackgroundReadingOfAllViews(); // linked views read the same index; known steps do not change, so decoded ones stay cached
+        const auto result = m_impl.modelReader.appendStepsOffsetsForAllNodesFromFiles(filename);
+        if (result.reloaded)
+            m_impl.stepPrefetcher.invalidate();
+        return result;
     }
 
     void readStageStateFromFilesForStep(SettingParameter* sp, Line* lines) override
     {
-        m_impl.modelReader.readStageStateFromFilesForStep(m_impl.p, sp, lines);
+        m_impl.displayedStep = m_impl.acquire(*sp);
+        std::ranges::copy(m_impl.displayedStep->lines, lines);
+    }
+
+    void requestStepLoad(const SettingParameter* sp, StepLoadedCallback onLoaded) override
+    {
+        m_impl.stepLoader.submit(
+            [this, stepParameters = *sp, onLoaded = std::move(onLoaded)](std::stop_token stopToken)
+            {
+                std::exception_ptr error;
+                try
+                {
+                    auto decoded = m_impl.acquire(stepParameters, stopToken);
+                    if (! decoded) // superseded by a newer request
+                        return;
+
+                    std::lock_guard lock(m_impl.loadedStepMutex);
+                    m_impl.loadedStep = std::move(decoded);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                if (! stopToken.stop_requested())
+                    onLoaded(stepParameters.step, error);
+            });
+    }
+
+    bool showLoadedStep(StepIndex step, Line* lines) override
+    {
+        std::lock_guard lock(m_impl.loadedStepMutex);
+        if (! m_impl.loadedStep || m_impl.loadedStep->step != step)
+            return false;
+
+        m_impl.displayedStep = std::move(m_impl.loadedStep);
+        m_impl.loadedStep.reset();
+        std::ranges::copy(m_impl.displayedStep->lines, lines);
+        return true;
+    }
+
+    void cancelStepLoad() override
+    {
+        m_impl.stepLoader.cancel();
+    }
+
+    void requestStepAggregation(const SettingParameter* sp,
+                                const TemporalAggregationRequest& request,
+                                AggregationProgressCallback progress,
+                                AggregationFinishedCallback onFinished) override
+    {
+        m_impl.stepAggregator.submit(
+            [this, stageParameters = *sp, request, progress = std::move(progress), onFinished = std::move(onFinished)](std::stop_token stopToken)
+            {
+                std::exception_ptr error;
+                try
+                {
+                    auto aggregation = TemporalAggregator<Cell>::aggregate(m_impl.modelReader, stageParameters, request, progress, stopToken);
+                    if (! aggregation) // stopped
+                        return;
+
+                    auto aggregatedStep = SceneWidgetVisualizerTemplate<Cell>::aggregatedStepOf(std::move(*aggregation), stageParameters, request);
+                    std::lock_guard lock(m_impl.aggregatedStepMutex);
+                    m_impl.aggregatedStep = std::move(aggregatedStep);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                if (! stopToken.stop_requested())
+                    onFinished(error);
+            });
+    }
+
+    bool showAggregatedStep(Line* lines) override
+    {
+        std::lock_guard lock(m_impl.aggregatedStepMutex);
+        if (! m_impl.aggregatedStep)
+            return false;
+
+        m_impl.displayedStep = std::move(m_impl.aggregatedStep);
+        m_impl.aggregatedStep.reset();
+        std::ranges::copy(m_impl.displayedStep->lines, lines);
+        return true;
+    }
+
+    void cancelStepAggregation() override
+    {
+        m_impl.stepAggregator.cancel();
+        std::lock_guard lock(m_impl.aggregatedStepMutex);
+        m_impl.aggregatedStep.reset();
+    }
+
+    void requestCellProbe(const SettingParameter* sp, const CellProbeRequest& request, CellProbeFinishedCallback onFinished) override
+    {
+        m_impl.cellProber.submit(
+            [this, stageParameters = *sp, request, onFinished = std::move(onFinished)](std::stop_token stopToken)
+            {
+                std::shared_ptr<const CellProbeSeries> series;
+                std::exception_ptr error;
+                try
+                {
+                    auto probed = CellProber<Cell>::probe(m_impl.modelReader, stageParameters, request, stopToken);
+                    if (! probed) // stopped
+                        return;
+                    series = std::make_shared<const CellProbeSeries>(std::move(*probed));
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                if (! stopToken.stop_requested())
+                    onFinished(std::move(series), error);
+            });
+    }
+
+    void cancelCellProbe() override
+    {
+        m_impl.cellProber.cancel();
+    }
+
+    std::optional<StepFrame> decodeStepFrame(const SettingParameter& sp, std::stop_token stopToken) override
+    {
+        if (! m_impl.modelReader.hasStep(sp.step))
+            return std::nullopt;
+
+        const auto decoded = m_impl.acquire(sp, stopToken);
+        if (! decoded)
+            return std::nullopt;
+
+        StepFrame frame{ .step = sp.step,
+                         .rows = decoded->rows,
+                         .columns = decoded->columns,
+                         .colors = decoded->colors,
+                         .scalars = decoded->scalars,
+                         .heights = decoded->heights,
+                         .lines = decoded->lines,
+                         .reductions = decoded->reductions };
+        // full resolution, unless the grid does not fit into one texture
+        if (const auto* level = SceneWidgetVisualizerTemplate<Cell>::levelOfDetail(*decoded, /*cellsPerPixel=*/1.0))
+        {
+            frame.colors = level->colors;
+            frame.scalars = level->scalars;
+            frame.levelFactor = level->factor;
+        }
+        return frame;
+    }
+
+    void requestThumbnailFrames(const SettingParameter* sp,
+                                std::vector<StepIndex> steps,
+                                int maxSize,
+                                ThumbnailFrameCallback onFrame,
+                                ThumbnailsFinishedCallback onFinished) override
+    {
+        auto stageParameters = *sp;
+        stageParameters.regionOfInterest.reset(); // thumbnails show the whole grid
+
+        m_impl.thumbnailer.submit(
+            [this, stageParameters, steps = std::move(steps), maxSize, onFrame = std::move(onFrame), onFinished = std::move(onFinished)](std::stop_token stopToken) mutable
+            {
+                // steps which are not cached are decoded only for their colours: no reductions and no heights
+                auto uncachedParameters = stageParameters;
+                uncachedParameters.reduction.clear();
+                uncachedParameters.heightSubstate.clear();
+
+                const double cellsPerPixel = static_cast<double>(std::max(stageParameters.numberOfRowsY, stageParameters.numberOfColumnX)) / std::max(maxSize, 1);
+                std::exception_ptr error;
+                try
+                {
+                    for (const auto step : steps)
+                    {
+                        while (m_impl.isReadingForViews() && ! stopToken.stop_requested())
+                            std::this_thread::sleep_for(THUMBNAIL_PASS_YIELD_INTERVAL);
+                        if (stopToken.stop_requested())
+                            return;
+                        if (! m_impl.modelReader.hasStep(step))
+                            continue;
+
+                        stageParameters.step = step;
+                        uncachedParameters.step = step;
+                        const auto decoded = m_impl.stepPrefetcher.isDecoded(step, stageParameters) ? m_impl.acquire(stageParameters, stopToken)
+                                                                                                     : m_impl.stepPrefetcher.decodeUncached(uncachedParameters, stopToken);
+                        if (! decoded) // stopped
+                            return;
+
+                        StepFrame frame{ .step = step, .rows = decoded->rows, .columns = decoded->columns, .colors = decoded->colors, .scalars = decoded->scalars };
+                        if (const auto* level = SceneWidgetVisualizerTemplate<Cell>::levelOfDetail(*decoded, cellsPerPixel))
+                        {
+                            frame.colors = level->colors;
+                            frame.scalars = level->scalars;
+                            frame.levelFactor = level->factor;
+                        }
+                        onFrame(std::move(frame));
+                    }
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                if (! stopToken.stop_requested())
+                    onFinished(error);
+            });
+    }
+
+    void cancelThumbnailFrames() override
+    {
+        m_impl.thumbnailer.cancel();
+    }
+
+    void prefetchSteps(const SettingParameter* sp, const std::vector<StepIndex>& steps) override
+    {
+        m_impl.stepPrefetcher.prefetch(*sp, steps);
+    }
+
+    void reschedulePrefetch(const SettingParameter* sp, const std::vector<StepIndex>& steps) override
+    {
+        m_impl.stepPrefetcher.reschedule(*sp, steps);
+    }
+
+    bool isStepDecoded(StepIndex step, const SettingParameter& sp) const override
+    {
+        return m_impl.stepPrefetcher.isDecoded(step, sp);
+    }
+
+    std::chrono::nanoseconds averageStepDecodeTime() const override
+    {
+        return m_impl.stepPrefetcher.averageDecodeTime();
+    }
+
+    std::shared_ptr<const StepReductions> displayedStepReductions() const override
+    {
+        return m_impl.displayedStep->reductions;
+    }
+
+    std::string displayedCellText(int row, int column) const override
+    {
+        const auto& step = *m_impl.displayedStep;
+        if (row < 0 || row >= step.rows || column < 0 || column >= step.columns)
+            return {};
+
+        if (! step.aggregation.empty() && step.scalars)
+        {
+            const float value = (*step.scalars)[static_cast<std::size_t>(step.rows - 1 - row) * step.columns + column];
+            return std::isnan(value) ? std::format("{}: no value", step.aggregation) : std::format("{}: {}", step.aggregation, value);
+        }
+
+        if (const auto& cells = step.decodedCells(); ! cells.empty())
+            return cells[row][column].stringEncoding(nullptr);
+
+        std::string text;
+        if (const auto& columns = step.substateColumns)
+        {
+            for (std::size_t s = 0; s < columns->names.size(); ++s)
+            {
+                const double value = columns->row(s, row)[column];
+                if (! std::isnan(value)) // NaN: the cell was not read or the substate is not numeric
+                    text += std::format("{}{}={}", text.empty() ? "" : ", ", columns->names[s], value);
+            }
+        }
+        return text;
+    }
+
+    void setStepCacheMemoryBudget(std::size_t memoryBudgetBytes, std::size_t compressedMemoryBudgetBytes) override
+    {
+        m_impl.stepPrefetcher.setMemoryBudget(memoryBudgetBytes, compressedMemoryBudgetBytes);
+        m_impl.coloredSteps.setMemoryBudget(memoryBudgetBytes);
+    }
+
+    StepCacheStatistics stepCacheStatistics() const override
+    {
+        return m_impl.stepPrefetcher.statistics();
+    }
+
+    void setMaxOpenFiles(std::size_t maxOpenFiles) override
+    {
+        m_impl.modelReader.setMaxOpenFiles(maxOpenFiles);
+    }
+
+    void setRemoteAgent(const std::string& address) override
+    {
+        m_impl.modelReader.setRemoteAgent(address);
     }
 
     void drawWithVTK(int nRows, int nCols, vtkSmartPointer<vtkRenderer> renderer, vtkSmartPointer<vtkActor> gridActor) override
     {
-        m_impl.visualiser.drawWithVTK(m_impl.p, nRows, nCols, renderer, gridActor);
+        if (m_impl.cells().empty() || m_impl.displayedStep->scalars)
+        {
+            // cells dropped after decoding (columnar substate storage) or coloured on the GPU, the decoded texels are shown
+            renderer->AddActor(gridActor);
+            refreshWindowsVTK(nRows, nCols, gridActor);
+        }
+        else
+        {
+            m_impl.visualiser.drawWithVTK(m_impl.cells(), nRows, nCols, renderer, gridActor);
+            m_impl.visualiser.refreshHeightfield(m_impl.displayedStep->heights, nRows, nCols, gridActor);
+        }
     }
 
     void refreshWindowsVTK(int nRows, int nCols, vtkSmartPointer<vtkActor> gridActor) override
     {
-        m_impl.visualiser.refreshWindowsVTK(m_impl.p, nRows, nCols, gridActor);
+        if (m_impl.displayedStep->aggregation != m_impl.shownAggregation)
+        {
+            // e.g. steps of the maximum: the automatic colour range of the substate does not fit
+            m_impl.visualiser.resetAutomaticScalarRange();
+            m_impl.shownAggregation = m_impl.displayedStep->aggregation;
+        }
+
+        const auto& scalars = m_impl.displayedStep->scalars;
+        const auto& colors = m_impl.displayedStep->colors;
+        if (scalars && scalars->size() == static_cast<std::size_t>(nRows) * nCols)
+        {
+            // raw values of the colour substate, coloured by the shader
+            if (const auto* level = m_impl.levelOfDetail())
+                m_impl.visualiser.refreshWindowsVTK(level->scalars, nRows, nCols, gridActor, level->factor);
+            else
+                m_impl.visualiser.refreshWindowsVTK(scalars, nRows, nCols, gridActor);
+        }
+        else if (colors && colors->size() == static_cast<std::size_t>(nRows) * nCols * 3)
+        {
+            // colours decoded in background: the texture is switched to them, unchanged ones are not uploaded again
+            if (const auto* level = m_impl.levelOfDetail())
+                m_impl.visualiser.refreshWindowsVTK(level->colors, nRows, nCols, gridActor, level->factor);
+            else
+                m_impl.visualiser.refreshWindowsVTK(colors, nRows, nCols, gridActor);
+        }
+        else
+        {
+            m_impl.visualiser.refreshWindowsVTK(m_impl.cells(), nRows, nCols, gridActor);
+        }
+
+        // after the texture, which may have recreated the flat quad
+        m_impl.visualiser.refreshHeightfield(m_impl.displayedStep->heights, nRows, nCols, gridActor);
+    }
+
+    bool setCellsPerScreenPixel(double cellsPerPixel) override
+    {
+        const auto shownFactor = [this]
+        {
+            const auto* level = m_impl.levelOfDetail();
+            return level ? level->factor : 1;
+        };
+
+        const auto factorBefore = shownFactor();
+        m_impl.cellsPerScreenPixel = cellsPerPixel;
+        return shownFactor() != factorBefore;
     }
 
     Visualizer& getVisualizer() override
@@ -98,7 +474,15 @@ public:
         return m_impl.modelReader.availableSteps();
     }
 
+    std::vector<StepIndex> stepsInAllNodes() const override
+    {
+        return m_impl.modelReader.stepsInAllNodes();
+    }
+
 private:
+    /// How often a waiting thumbnail pass checks whether the views finished reading
+    static constexpr auto THUMBNAIL_PASS_YIELD_INTERVAL = std::chrono::milliseconds(50);
+
     SceneWidgetVisualizerTemplate<Cell> m_impl;
     const std::string m_modelName;
 };
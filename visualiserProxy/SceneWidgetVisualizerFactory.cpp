@@ -1,5 +1,6 @@
 #include "SceneWidgetVisualizerFactory.h"
 
+#include <algorithm> // std::ranges::sort
 #include <stdexcept> // std::invalid_argument
 
 #include <OOpenCAL/models/Ball/BallCell.h>
@@ -15,6 +16,12 @@ std::map<std::string, SceneWidgetVisualizerFactory::ModelCreator>& SceneWidgetVi
     return registry;
 }
 
+std::map<std::string, SceneWidgetVisualizerFactory::ModelLoader>& SceneWidgetVisualizerFactory::getDeferredRegistry()
+{
+    static std::map<std::string, ModelLoader> registry;
+    return registry;
+}
+
 void SceneWidgetVisualizerFactory::initializeBuiltInModels()
 {
     if (isInitializedWithBuildInModels)
@@ -48,7 +55,22 @@ std::unique_ptr<ISceneWidgetVisualizer> SceneWidgetVisualizerFactory::create(con
 
     if (it == registry.end())
     {
-        throw std::invalid_argument("Unknown model name: " + modelName);
+        auto& deferredRegistry = getDeferredRegistry();
+        auto deferred = deferredRegistry.find(modelName);
+        if (deferred == deferredRegistry.end())
+        {
+            throw std::invalid_argument("Unknown model name: " + modelName);
+        }
+
+        const auto loader = std::move(deferred->second);
+        deferredRegistry.erase(deferred); // loaded only once, even if it fails
+        loader();
+
+        it = registry.find(modelName);
+        if (it == registry.end())
+        {
+            throw std::runtime_error("Model '" + modelName + "' was not registered by its plugin");
+        }
     }
 
     return it->second();
@@ -81,6 +103,19 @@ bool SceneWidgetVisualizerFactory::registerModel(const std::string& modelName, M
     }
 
     registry[modelName] = std::move(creator);
+    getDeferredRegistry().erase(modelName); // e.g. plugin loaded explicitly before its model was used
+    return true;
+}
+
+bool SceneWidgetVisualizerFactory::registerDeferredModel(const std::string& modelName, ModelLoader loader)
+{
+    auto& deferredRegistry = getDeferredRegistry();
+    if (getRegistry().contains(modelName) || deferredRegistry.contains(modelName))
+    {
+        return false;
+    }
+
+    deferredRegistry[modelName] = std::move(loader);
     return true;
 }
 
@@ -96,6 +131,11 @@ std::vector<std::string> SceneWidgetVisualizerFactory::getAvailableModels()
     {
         models.push_back(name);
     }
+    for (const auto& [name, loader] : getDeferredRegistry())
+    {
+        models.push_back(name);
+    }
+    std::ranges::sort(models);
 
     return models;
 }
@@ -106,5 +146,5 @@ bool SceneWidgetVisualizerFactory::isModelRegistered(const std::string& modelNam
     initializeBuiltInModels();
 
     auto& registry = getRegistry();
-    return registry.find(modelName) != registry.end();
+    return registry.find(modelName) != registry.end() || getDeferredRegistry().contains(modelName);
 }
@@ -47,11 +47,15 @@ public:
     /// Type for model creation functions
     using ModelCreator = std::function<std::unique_ptr<ISceneWidgetVisualizer>()>;
 
+    /// Type for functions making a deferred model available (e.g. loading its plugin, which calls registerModel())
+    using ModelLoader = std::function<void()>;
+
     /** @brief Create a visualizer from a string name.
      * 
      * @param modelName The name of the model (e.g., "Ball", "SciddicaT")
      * @return std::unique_ptr<ISceneWidgetVisualizer> Pointer to the created visualizer
-     * @throws std::invalid_argument if the model name is not recognized */
+     * @throws std::invalid_argument if the model name is not recognized
+     * @throws std::runtime_error if the loader of a deferred model did not register it */
     static std::unique_ptr<ISceneWidgetVisualizer> create(const std::string& modelName);
 
     /// @brief Create a visualizer for default model
@@ -67,6 +71,13 @@ public:
      * @return true if registration succeeded, false if model already exists */
     static bool registerModel(const std::string& modelName, ModelCreator creator);
 
+    /** @brief Register a model whose creator is not available yet (e.g. plugin known from the plugin manifest, not loaded).
+     *
+     * The model is listed by getAvailableModels() and isModelRegistered(). When it is created for the first time
+     * the loader is called once, it has to register the model with registerModel().
+     * @return true if registration succeeded, false if model already exists */
+    static bool registerDeferredModel(const std::string& modelName, ModelLoader loader);
+
     /// @brief Get all available model names
     static std::vector<std::string> getAvailableModels();
 
@@ -80,6 +91,9 @@ private:
     /// Registry of model creation functions
     static std::map<std::string, ModelCreator>& getRegistry();
 
+    /// Registry of loaders of deferred models (removed from it when loaded)
+    static std::map<std::string, ModelLoader>& getDeferredRegistry();
+
     /// Initialize built-in models (called automatically)
     static void initializeBuiltInModels();
 
@@ -16,9 +16,41 @@
 
 #pragma once
 
+#include <algorithm> // std::max
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CellProber.h"
+#include "DecodedStep.h"
+#include "StepColorizer.h"
+#include "StepPrefetcher.h"
+#include "TemporalAggregator.h"
+#include "utilities/LatestTaskRunner.h"
 #include "utilities/ModelReader.hpp"
 #include "visualiser/Visualizer.hpp"
 
+template<typename Cell>
+struct SceneWidgetVisualizerTemplate;
+
+/** @struct DecodedStepStore
+ * @brief Reader of one stage and the cache of its decoded steps, shared (reference counted) by all views of the stage.
+ *
+ * Every step is read and decoded once, whichever view requests it first. A view colouring the cells
+ * in another way computes only its own texels (see SceneWidgetVisualizerTemplate::acquire()).
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+struct DecodedStepStore
+{
+    ModelReader<Cell> modelReader;
+    StepPrefetcher<Cell> stepPrefetcher{ modelReader };
+
+    /// Views reading the stage (the owner and its linked views), registered by SceneWidgetVisualizerTemplate
+    std::vector<SceneWidgetVisualizerTemplate<Cell>*> views;
+    std::mutex viewsMutex;
+};
+
 /** @class SceneWidgetVisualizerTemplate
  * @tparam Cell The cell type used in the model (must inherit from Element in OOpenCal)
  * 
@@ -39,14 +71,118 @@
 template<typename Cell>
 struct SceneWidgetVisualizerTemplate
 {
-    Visualizer visualiser;            ///< The visualizer instance for rendering the model
-    ModelReader<Cell> modelReader;    ///< The reader for loading and managing model data
-    std::vector<std::vector<Cell>> p; ///< 2D vector storing the cell data
+    /// Reader and decoded steps of the stage, shared with the linked views (see DecodedStepStore)
+    std::shared_ptr<DecodedStepStore<Cell>> store = std::make_shared<DecodedStepStore<Cell>>();
+
+    Visualizer visualiser;                              ///< The visualizer instance for rendering the model
+    ModelReader<Cell>& modelReader = store->modelReader; ///< The reader for loading and managing model data
+
+    /// Step currently displayed (shared with the step cache), never nullptr after initMatrix()
+    std::shared_ptr<const DecodedStep<Cell>> displayedStep;
+
+    /// Background decoding of upcoming steps and the LRU cache of decoded steps (of the store)
+    StepPrefetcher<Cell>& stepPrefetcher = store->stepPrefetcher;
+
+    /// Steps of the store coloured by this view, when they were decoded with another colouring (by another view)
+    StepCache<DecodedStep<Cell>> coloredSteps{ StepPrefetcher<Cell>::DEFAULT_MEMORY_BUDGET_BYTES };
+
+    /// The most recently coloured step of coloredSteps, its unchanged nodes are reused
+    std::shared_ptr<const DecodedStep<Cell>> lastColored;
+    std::mutex lastColoredMutex;
+
+    /// Cells of the grid per screen pixel (from the camera zoom), decides the shown level of detail
+    double cellsPerScreenPixel = 1.0;
+
+    /// Result of the last finished asynchronous step load, waiting to be displayed by the GUI thread
+    std::shared_ptr<const DecodedStep<Cell>> loadedStep;
+    std::mutex loadedStepMutex;
+
+    /// Result of the last finished temporal aggregation, waiting to be displayed by the GUI thread
+    std::shared_ptr<const DecodedStep<Cell>> aggregatedStep;
+    std::mutex aggregatedStepMutex;
+
+    /// Aggregation shown by the grid texture (DecodedStep::aggregation), its values have a colour range of their own
+    std::string shownAggregation;
+
+    /// Asynchronous step loads, a newer request stops the older one.
+    /// Declared last, so it is joined before the prefetcher and the reader are destroyed
+    LatestTaskRunner stepLoader;
+
+    /// Asynchronous temporal aggregations, a newer request stops the older one (joined before the reader is destroyed)
+    LatestTaskRunner stepAggregator;
 
-    /** @brief Initializes the internal matrix with the specified dimensions.
+    /// Asynchronous cell probes, a newer request stops the older one (joined before the reader is destroyed)
+    LatestTaskRunner cellProber;
+
+    /// Passes decoding thumbnails of steps, on a thread of the lowest priority (joined before the reader is destroyed)
+    LatestTaskRunner thumbnailer{ LatestTaskRunner::Priority::Background };
+
+    SceneWidgetVisualizerTemplate()
+    {
+        registerInStore();
+    }
+
+    /// @brief Creates a view of the stage of another visualizer: the reader and decoded steps are shared
+    explicit SceneWidgetVisualizerTemplate(std::shared_ptr<DecodedStepStore<Cell>> sharedStore)
+        : store{ std::move(sharedStore) }
+        , displayedStep{ std::make_shared<DecodedStep<Cell>>() } // nothing is shown until the first step is acquired
+    {
+        registerInStore();
+    }
+
+    ~SceneWidgetVisualizerTemplate()
+    {
+        std::lock_guard lock(store->viewsMutex);
+        std::erase(store->views, this);
+    }
+
+    SceneWidgetVisualizerTemplate(const SceneWidgetVisualizerTemplate&) = delete;
+    SceneWidgetVisualizerTemplate& operator=(const SceneWidgetVisualizerTemplate&) = delete;
+
+    /** @brief Returns step sp.step coloured as sp says (StepColoring): decoded by the store, or coloured again by this view.
      *
-     * This method resizes the internal 2D vector to match the given dimensions,
-     * creating a grid of default-constructed Cell objects.
+     * A step decoded for another view with other colouring keeps its cells in the store, this view computes only
+     * its texels and heights (cached in coloredSteps). When the cells were already dropped (columnar storage),
+     * the step is decoded again for this view.
+     * @return nullptr if decoding was stopped
+     * @throws std::runtime_error If the step cannot be read */
+    std::shared_ptr<const DecodedStep<Cell>> acquire(const SettingParameter& sp, std::stop_token stopToken = {})
+    {
+        auto decoded = stepPrefetcher.acquire(sp, stopToken);
+        const auto coloring = StepColoring::of(sp);
+        if (! decoded || decoded->coloring == coloring)
+            return decoded;
+
+        // coloured from the decoded cells, or decoded again from the same data
+        const auto colorsDecoded = [&decoded](const DecodedStep<Cell>& colored)
+        {
+            if (colored.source)
+                return colored.source == decoded;
+            return colored.contents.nodesRead == decoded->contents.nodesRead && colored.contents.nodeHashes == decoded->contents.nodeHashes;
+        };
+        if (auto colored = coloredSteps.find(sp.step); colored && colorsDecoded(*colored))
+            return colored;
+
+        std::shared_ptr<const DecodedStep<Cell>> previous;
+        {
+            std::lock_guard lock(lastColoredMutex);
+            previous = lastColored;
+        }
+
+        auto colored = decoded->cells.empty() ? stepPrefetcher.decodeUncached(sp, stopToken) : StepColorizer<Cell>::recolor(decoded, previous, coloring);
+        if (! colored)
+            return nullptr;
+        coloredSteps.insert(sp.step, colored, colored->memoryUsage());
+
+        std::lock_guard lock(lastColoredMutex);
+        lastColored = colored;
+        return colored;
+    }
+
+    /** @brief Initializes the displayed grid with the specified dimensions.
+     *
+     * This method creates a contiguous grid of default-constructed Cell objects
+     * matching the given dimensions. Steps decoded for previous dimensions are dropped.
      *
      * @param dimX The width of the grid (number of columns)
      * @param dimY The height of the grid (number of rows)
@@ -54,10 +190,113 @@ struct SceneWidgetVisualizerTemplate
      * @note The dimensions must be positive integers. The method will create a grid with dimY rows and dimX columns. */
     void initMatrix(int dimX, int dimY)
     {
-        p.resize(dimY);
-        for (int i = 0; i < dimY; i++)
+        invalidateDecodedSteps();
+
+        auto emptyStep = std::make_shared<DecodedStep<Cell>>();
+        emptyStep->rows = dimY;
+        emptyStep->columns = dimX;
+        emptyStep->cells.resize(dimY, dimX);
+        displayedStep = std::move(emptyStep);
+    }
+
+    /// @brief Stops asynchronous loads and prefetches and drops decoded steps (they must not read while the stage changes)
+    void invalidateDecodedSteps()
+    {
+        stopBackgroundReading();
+        stepPrefetcher.invalidate();
+        coloredSteps.clear();
+
+        std::lock_guard lock(lastColoredMutex);
+        lastColored.reset();
+    }
+
+    /// @brief Whether steps are being read for this view (loaded, aggregated, probed) or for any view (prefetched), background passes wait meanwhile
+    bool isReadingForViews() const
+    {
+        return stepLoader.isBusy() || stepAggregator.isBusy() || cellProber.isBusy() || stepPrefetcher.isPrefetching();
+    }
+
+    /// @brief Stops asynchronous loads and prefetches, waits for them, already decoded steps stay in the cache
+    void stopBackgroundReading()
+    {
+        stepLoader.cancelAndWait();
+        stepAggregator.cancelAndWait();
+        cellProber.cancelAndWait();
+        thumbnailer.cancelAndWait();
+        {
+            std::lock_guard lock(loadedStepMutex);
+            loadedStep.reset();
+        }
         {
-            p[i].resize(dimX);
+            std::lock_guard lock(aggregatedStepMutex);
+            aggregatedStep.reset();
         }
+        stepPrefetcher.cancelPending();
+    }
+
+    /// @brief Stops background reading of every view of the store (see stopBackgroundReading()), e.g. before the shared index changes
+    void stopBackgroundReadingOfAllViews()
+    {
+        std::lock_guard lock(store->viewsMutex);
+        for (auto* view : store->views)
+            view->stopBackgroundReading();
+    }
+
+    /** @brief Level of detail of the displayed step fitting cellsPerScreenPixel, nullptr for full resolution.
+     *
+     * The coarsest level whose block is not bigger than a screen pixel is chosen, but at least one fitting
+     * into LEVEL_OF_DETAIL_MAX_TEXTURE_SIZE. Steps without levels (small grids) are always in full resolution. */
+    const ColorLevel* levelOfDetail() const
+    {
+        return levelOfDetail(*displayedStep, cellsPerScreenPixel);
+    }
+
+    /// @brief Level of detail of the decoded step for the given zoom (see levelOfDetail() of the displayed step)
+    static const ColorLevel* levelOfDetail(const DecodedStep<Cell>& step, double cellsPerPixel)
+    {
+        const auto gridSize = static_cast<int>(std::max(step.rows, step.columns));
+
+        const ColorLevel* chosen = nullptr;
+        for (const auto& level : step.coarserColors) // from the finest
+        {
+            const int finerFactor = level.factor / 2;
+            const bool finerTooBig = (gridSize + finerFactor - 1) / finerFactor > LEVEL_OF_DETAIL_MAX_TEXTURE_SIZE;
+            if (level.factor > cellsPerPixel && ! finerTooBig)
+                break;
+            chosen = &level;
+        }
+        return chosen;
+    }
+
+    /** @brief Synthetic step showing aggregated values: they are the raw values of the step (coloured on the GPU),
+     *         it has the node lines of the last aggregated step and no cells. */
+    static std::shared_ptr<const DecodedStep<Cell>> aggregatedStepOf(typename TemporalAggregator<Cell>::Aggregation aggregation,
+                                                                     const SettingParameter& sp,
+                                                                     const TemporalAggregationRequest& request)
+    {
+        auto step = std::make_shared<DecodedStep<Cell>>();
+        step->step = aggregation.lastStep;
+        step->rows = sp.numberOfRowsY;
+        step->columns = sp.numberOfColumnX;
+        step->lines = std::move(aggregation.lines);
+
+        auto scalars = std::make_shared<const std::vector<float>>(aggregation.values.resultScalars());
+        step->coarserColors = buildScalarPyramid(*scalars, step->rows, step->columns, colorReductionFromName(sp.lodReduction));
+        step->scalars = std::move(scalars);
+        step->aggregation = request.description();
+        return step;
+    }
+
+    /// @brief Cells of the displayed step, empty when they were dropped after decoding (columnar substate storage)
+    const Matrix2D<Cell>& cells() const
+    {
+        return displayedStep->decodedCells();
+    }
+
+private:
+    void registerInStore()
+    {
+        std::lock_guard lock(store->viewsMutex);
+        store->views.push_back(this);
     }
 };
@@ -0,0 +1,31 @@
+/** @file StepColoring.h
+ * @brief Declaration of the StepColoring structure - settings deciding how cells of a decoded step are coloured. */
+
+#pragma once
+
+#include <string>
+
+#include "visualiser/SettingParameter.h"
+
+/** @struct StepColoring
+ * @brief Part of the VISUALIZATION settings which gives colours (texels) and heights of a decoded step.
+ *
+ * Views showing the same stage share the decoded cells, but every view may colour them differently.
+ * Texels of a step are reused for the next step only when both were coloured the same way. */
+struct StepColoring
+{
+    std::string colorSubstate;  ///< Substate coloured on the GPU (`color_substate`), empty: colours of the model
+    std::string heightSubstate; ///< Substate giving elevation of the cells (`height_substate`), empty: flat grid
+    double heightScale = 1;     ///< Elevation per unit of the height substate (`height_scale`)
+    std::string lodReduction;   ///< Reduction of cell blocks in levels of detail (`lod_reduction`)
+
+    static StepColoring of(const SettingParameter& sp)
+    {
+        return StepColoring{ .colorSubstate = sp.colorSubstate,
+                             .heightSubstate = sp.heightSubstate,
+                             .heightScale = sp.heightScale,
+                             .lodReduction = sp.lodReduction };
+    }
+
+    bool operator==(const StepColoring&) const = default;
+};
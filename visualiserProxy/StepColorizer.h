@@ -0,0 +1,175 @@
+/** @file StepColorizer.h
+ * @brief Declaration of the StepColorizer class template - colours, levels of detail and heights of decoded steps. */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DecodedStep.h"
+#include "StepColoring.h"
+#include "visualiser/CellColors.h"
+
+/** @class StepColorizer
+ * @brief Computes texels (colours or raw values), their levels of detail and heights of a decoded step for one StepColoring.
+ *
+ * It is used by StepPrefetcher right after decoding, and by views colouring shared decoded cells in their own way
+ * (see recolor()). Texels of nodes which did not change since the previous step coloured the same way are reused.
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+class StepColorizer
+{
+public:
+    using StepPtr = std::shared_ptr<const DecodedStep<Cell>>;
+
+    /** @brief Computes texels, levels of detail and heights of the decoded step (its cells have to be present) and sets its colouring.
+     *  @param previous Step to reuse unchanged nodes from, ignored when it was coloured in another way */
+    static void colorStep(DecodedStep<Cell>& decoded, const StepPtr& previous, const StepColoring& coloring)
+    {
+        decoded.coloring = coloring;
+        const auto comparable = (previous && previous->coloring == coloring) ? previous : nullptr;
+
+        if (coloring.colorSubstate.empty())
+        {
+            decoded.colors = colorize(decoded, comparable);
+            if (comparable && decoded.colors == comparable->colors)
+                decoded.coarserColors = comparable->coarserColors;
+            else
+                decoded.coarserColors = buildColorPyramid(*decoded.colors, decoded.rows, decoded.columns, colorReductionFromName(coloring.lodReduction));
+        }
+        else
+        {
+            // only raw values are kept, the colour ramp is applied by the GPU (see Visualizer::refreshWindowsVTK())
+            decoded.scalars = extractColorScalars(decoded, comparable, coloring.colorSubstate.c_str());
+            if (comparable && decoded.scalars == comparable->scalars)
+                decoded.coarserColors = comparable->coarserColors;
+            else
+                decoded.coarserColors = buildScalarPyramid(*decoded.scalars, decoded.rows, decoded.columns, colorReductionFromName(coloring.lodReduction));
+        }
+
+        if (! coloring.heightSubstate.empty())
+            decoded.heights = extractHeights(decoded, comparable, coloring.heightSubstate.c_str(), static_cast<float>(coloring.heightScale));
+    }
+
+    /** @brief Step showing the decoded cells of the source step with another colouring, without copying them.
+     *
+     * Lines, node contents, reductions and substate columns are taken over, only the texels and heights are computed.
+     * @param source Step still having its cells (see DecodedStep::decodedCells())
+     * @param previous The previous step of the view, its unchanged nodes are reused as by colorStep() */
+    static StepPtr recolor(const StepPtr& source, const StepPtr& previous, const StepColoring& coloring)
+    {
+        auto colored = std::make_shared<DecodedStep<Cell>>();
+        colored->step = source->step;
+        colored->rows = source->rows;
+        colored->columns = source->columns;
+        colored->lines = source->lines;
+        colored->contents = source->contents;
+        colored->reductions = source->reductions;
+        colored->substateColumns = source->substateColumns;
+        colored->source = source->source ? source->source : source;
+        colorStep(*colored, previous, coloring);
+        return colored;
+    }
+
+private:
+    /** @brief Computes colours of the step, reusing colours of nodes which did not change since the previous decoded step.
+     *
+     * Nodes are compared by placement, read flag and hash of their raw data (nodes outside the region of interest
+     * stay as they were). When no node changed, the buffer of
+     * the previous step is shared (the visualizer then does not upload the texture again). */
+    static std::shared_ptr<const std::vector<unsigned char>> colorize(const DecodedStep<Cell>& decoded, const std::shared_ptr<const DecodedStep<Cell>>& previous)
+    {
+        return writeChangedNodes(decoded,
+                                 previous,
+                                 previous ? previous->colors : nullptr,
+                                 decoded.decodedCells().size() * 3,
+                                 [&decoded](const CellRegion& region, unsigned char* rgb)
+                                 {
+                                     writeCellColorsOfRegion(decoded.decodedCells(), decoded.rows, decoded.columns, region.firstRow, region.firstColumn, region.rows, region.columns, rgb);
+                                 });
+    }
+
+    /// @brief Raw values of the colour substate of the step (one float per cell), reusing values of unchanged nodes as colorize() does
+    static std::shared_ptr<const std::vector<float>> extractColorScalars(const DecodedStep<Cell>& decoded,
+                                                                  const std::shared_ptr<const DecodedStep<Cell>>& previous,
+                                                                  const char* substate)
+    {
+        return writeChangedNodes(decoded,
+                                 previous,
+                                 previous ? previous->scalars : nullptr,
+                                 decoded.decodedCells().size(),
+                                 [&decoded, substate](const CellRegion& region, float* scalars)
+                                 {
+                                     writeCellScalarsOfRegion(decoded.decodedCells(), substate, decoded.rows, decoded.columns, region.firstRow, region.firstColumn, region.rows, region.columns, scalars);
+                                 });
+    }
+
+    /// @brief Elevation of every cell: value of the height substate multiplied by scale, reusing values of unchanged nodes
+    static std::shared_ptr<const std::vector<float>> extractHeights(const DecodedStep<Cell>& decoded,
+                                                             const std::shared_ptr<const DecodedStep<Cell>>& previous,
+                                                             const char* substate,
+                                                             float scale)
+    {
+        return writeChangedNodes(decoded,
+                                 previous,
+                                 previous ? previous->heights : nullptr,
+                                 decoded.decodedCells().size(),
+                                 [&decoded, substate, scale](const CellRegion& region, float* heights)
+                                 {
+                                     writeCellScalarsOfRegion(decoded.decodedCells(), substate, decoded.rows, decoded.columns, region.firstRow, region.firstColumn, region.rows, region.columns, heights);
+                                     for (int row = 0; row < region.rows; ++row)
+                                     {
+                                         // the same rows of the whole buffer as written above (VTK image order)
+                                         float* rowHeights = heights + static_cast<std::size_t>(decoded.rows - 1 - region.firstRow - row) * decoded.columns + region.firstColumn;
+                                         for (int column = 0; column < region.columns; ++column)
+                                             rowHeights[column] *= scale;
+                                     }
+                                 });
+    }
+
+    /** @brief Texels (colours or raw values) of the step: those of the previous step with changed nodes written again.
+     *  @param previousTexels Texels of the previous step of the same kind, nullptr when it has none
+     *  @param writeRegion Writes texels of a region of cells into the whole buffer */
+    template<typename T, typename WriteRegion>
+    static std::shared_ptr<const std::vector<T>> writeChangedNodes(const DecodedStep<Cell>& decoded,
+                                                                   const std::shared_ptr<const DecodedStep<Cell>>& previous,
+                                                                   const std::shared_ptr<const std::vector<T>>& previousTexels,
+                                                                   std::size_t texelsSize,
+                                                                   WriteRegion writeRegion)
+    {
+        const auto nRows = decoded.rows;
+        const auto nCols = decoded.columns;
+
+        const bool comparable = previousTexels && previousTexels->size() == texelsSize
+                             && previous->contents.layout && decoded.contents.layout
+                             && *previous->contents.layout == *decoded.contents.layout
+                             && previous->contents.nodesRead.size() == decoded.contents.nodesRead.size();
+        if (! comparable)
+        {
+            auto texels = std::make_shared<std::vector<T>>(texelsSize);
+            writeRegion(CellRegion{ .firstRow = 0, .firstColumn = 0, .rows = nRows, .columns = nCols }, texels->data());
+            return texels;
+        }
+
+        const auto& layout = *decoded.contents.layout;
+        std::shared_ptr<std::vector<T>> texels; // created on the first changed node
+        for (std::size_t node = 0; node < decoded.contents.nodesRead.size(); ++node)
+        {
+            if (decoded.contents.sameNodeData(previous->contents, node))
+                continue;
+
+            if (! texels)
+                texels = std::make_shared<std::vector<T>>(*previousTexels);
+
+            // the same clipping to the grid as done by the reader
+            const auto region = CellRegion::ofNode(layout.offsetsXY[node], layout.sceneSizes[node], nRows, nCols);
+            if (region.rows > 0 && region.columns > 0)
+                writeRegion(region, texels->data());
+        }
+
+        if (! texels) // nothing changed
+            return previousTexels;
+        return texels;
+    }
+};
@@ -0,0 +1,498 @@
+/** @file StepPrefetcher.h
+ * @brief Declaration of the StepPrefetcher class template - background decoding of upcoming steps.
+ *
+ * During playback the next steps are known in advance (direction and stride of the playback),
+ * so they can be read, parsed and coloured on a worker thread while the current one is displayed.
+ * Decoded steps are kept in a memory-bounded LRU cache (StepCache), from which the GUI thread
+ * takes them without touching the files. Steps evicted from it are kept delta-compressed (DeltaStepCache). */
+
+#pragma once
+
+#include <algorithm> // std::ranges::find
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DecodedStep.h"
+#include "DeltaStepCache.h"
+#include "StepColorizer.h"
+#include "utilities/ModelReader.hpp"
+#include "utilities/StageProfiler.h"
+#include "utilities/StepCache.h"
+#include "utilities/ThreadPool.h"
+#include "visualiser/CellColors.h"
+#include "visualiser/CellReductions.h"
+#include "visualiser/SubstateColumns.h"
+#include "visualiser/SettingParameter.h"
+
+/** @class StepPrefetcher
+ * @brief Decodes steps on a background thread into a StepCache and hands them out on request.
+ *
+ * One step is decoded at a time (in the order of requests), the decoding itself is parallelised
+ * over nodes by ModelReader. A step requested while it is being prefetched is not read twice,
+ * the caller waits for the running decoding instead.
+ *
+ * The steps are kept in two tiers with their own memory budgets: the most recently used ones in full, older ones
+ * as deltas from keyframes, reconstructed by a couple of copies when they are needed again. Steps evicted from the full
+ * tier are encoded on a worker thread of their own, never on the thread acquiring a step.
+ *
+ * @note Before the reader's stage is modified (cleared, prepared or re-indexed) invalidate() has to be called,
+ *       it waits for the running decoding, drops the queued ones and empties the cache.
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+class StepPrefetcher
+{
+public:
+    using StepPtr = std::shared_ptr<const DecodedStep<Cell>>;
+
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET_BYTES = std::size_t{ 1024 } * 1024 * 1024;
+
+    /// Evicted steps waiting for their encoding at most, more are dropped (they are kept alive above the budget until encoded)
+    static constexpr std::size_t MAX_PENDING_COMPRESSIONS = 8;
+
+    /** @param memoryBudgetBytes Budget of the steps kept in full
+     *  @param compressedMemoryBudgetBytes Budget of the delta-compressed steps evicted from them (0: evicted steps are dropped) */
+    explicit StepPrefetcher(ModelReader<Cell>& modelReader, std::size_t memoryBudgetBytes = DEFAULT_MEMORY_BUDGET_BYTES, std::size_t compressedMemoryBudgetBytes = 0)
+        : modelReader{ modelReader }
+        , cache{ memoryBudgetBytes }
+        , compressedCache{ compressedMemoryBudgetBytes }
+    {
+    }
+
+    ~StepPrefetcher()
+    {
+        invalidate();
+    }
+
+    StepPrefetcher(const StepPrefetcher&) = delete;
+    StepPrefetcher& operator=(const StepPrefetcher&) = delete;
+
+    /** @brief Returns decoded step sp.step: from the cache, from a running prefetch or decoded right now.
+     *
+     * A step decoded for a smaller region of interest (sp.regionOfInterest) is completed: only the missing nodes are read.
+     * @param stopToken Stops decoding done by this call, then nullptr is returned (and nothing is cached)
+     * @throws std::runtime_error If the step cannot be read */
+    StepPtr acquire(const SettingParameter& sp, std::stop_token stopToken = {})
+    {
+        auto partial = findCached(sp.step);
+        if (partial && partial->contents.covers(sp.regionOfInterest))
+            return partial;
+
+        if (! partial)
+        {
+            std::shared_future<StepPtr> running;
+            {
+                std::lock_guard lock(inFlightMutex);
+                if (const auto it = inFlight.find(sp.step); it != inFlight.end())
+                    running = it->second;
+            }
+            if (running.valid())
+            {
+                partial = running.get(); // nullptr when the prefetch failed
+                if (partial && partial->contents.covers(sp.regionOfInterest))
+                    return partial;
+            }
+        }
+
+        auto decoded = decode(sp, stopToken, partial);
+        if (decoded) // a stopped decoding has only part of the nodes read
+            cacheDecoded(decoded);
+        return decoded;
+    }
+
+    /** @brief Reads and decodes the step again without caching it, with the colouring of sp.
+     *
+     * Used by a view colouring a cached step differently, when the cells of the cached step were already dropped
+     * (columnar substate storage), so they cannot be coloured again.
+     * @return nullptr if decoding was stopped */
+    StepPtr decodeUncached(const SettingParameter& sp, std::stop_token stopToken = {})
+    {
+        return decode(sp, stopToken);
+    }
+
+    /** @brief Schedules background decoding of the steps (in the given order).
+     *  Steps already cached or scheduled are skipped, as well as steps not present in node index files.
+     *  In the remote mode the scheduled steps are also requested from the agent right away (ModelReader::fetchStepsAhead()).
+     *  @param sp Parameters of the stage, the step inside is ignored */
+    void prefetch(const SettingParameter& sp, const std::vector<StepIndex>& steps)
+    {
+        const auto currentGeneration = generation.load();
+
+        std::lock_guard lock(inFlightMutex);
+        for (const auto step : steps)
+        {
+            if (inFlight.contains(step))
+            {
+                droppedSteps.erase(step); // requested again before it was started
+                continue;
+            }
+            if (! modelReader.hasStep(step))
+                continue;
+            auto cached = cache.peek(step);
+            if (! cached)
+                cached = evictedBeforeCompression(step);
+            if ((cached && cached->contents.covers(sp.regionOfInterest)) || compressedCache.covers(step, sp.regionOfInterest))
+                continue;
+            if (! cached)
+                cached = compressedCache.peek(step); // decoded for a smaller region
+
+            // in the remote mode the request is sent now, the decoding then only waits for the rest of the reply
+            modelReader.fetchStepsAhead(sp, std::span(&step, 1));
+
+            auto promise = std::make_shared<std::promise<StepPtr>>();
+            inFlight.emplace(step, promise->get_future().share());
+
+            SettingParameter stepParameters = sp;
+            stepParameters.step = step;
+            workers.submit(
+                [this, promise, stepParameters, currentGeneration, cached = std::move(cached)]
+                {
+                    StepPtr decoded;
+                    bool dropped = false;
+                    if (currentGeneration == generation.load()) // skip steps of an invalidated stage
+                    {
+                        std::lock_guard lock(inFlightMutex);
+                        dropped = droppedSteps.erase(stepParameters.step) > 0;
+                    }
+                    if (currentGeneration == generation.load() && ! dropped)
+                    {
+                        try
+                        {
+                            decoded = decode(stepParameters, {}, cached);
+                            cacheDecoded(decoded);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            std::cerr << "Warning: prefetching step " << stepParameters.step << " failed: " << e.what() << std::endl;
+                        }
+                    }
+
+                    {
+                        std::lock_guard lock(inFlightMutex);
+                        if (currentGeneration == generation.load())
+                        {
+                            inFlight.erase(stepParameters.step);
+                            droppedSteps.erase(stepParameters.step); // dropped while it was being decoded
+                        }
+                    }
+                    promise->set_value(std::move(decoded));
+                });
+        }
+    }
+
+    /** @brief Like prefetch(), but scheduled steps which are not in the list and were not started yet are dropped.
+     *  Used by the playback skipping steps: steps it has moved past would only delay the ones it needs now. */
+    void reschedule(const SettingParameter& sp, const std::vector<StepIndex>& steps)
+    {
+        {
+            std::lock_guard lock(inFlightMutex);
+            for (const auto& [step, future] : inFlight)
+            {
+                if (std::ranges::find(steps, step) == steps.end())
+                    droppedSteps.insert(step);
+            }
+        }
+        prefetch(sp, steps);
+    }
+
+    /// @brief Whether the step is in the cache with all nodes intersecting sp.regionOfInterest, so acquire() does not read files
+    bool isDecoded(StepIndex step, const SettingParameter& sp) const
+    {
+        auto cached = cache.peek(step);
+        if (! cached)
+            cached = evictedBeforeCompression(step);
+        return (cached && cached->contents.covers(sp.regionOfInterest)) || compressedCache.covers(step, sp.regionOfInterest);
+    }
+
+    /// @brief Whether prefetches are scheduled or running
+    bool isPrefetching() const
+    {
+        std::lock_guard lock(inFlightMutex);
+        return ! inFlight.empty();
+    }
+
+    /// @brief Average time of decoding one step recently (zero before the first step is decoded)
+    std::chrono::nanoseconds averageDecodeTime() const
+    {
+        return std::chrono::nanoseconds(averageDecodeNanoseconds.load(std::memory_order_relaxed));
+    }
+
+    /// @brief Drops scheduled prefetches, waits for the running one and for the encoding of evicted steps, and empties the cache.
+    void invalidate()
+    {
+        cancelPending(); // the new generation makes the queued compressions skip their steps
+        {
+            std::unique_lock lock(compressionsMutex);
+            compressionsFinished.wait(lock, [this] { return 0 == pendingCompressions; });
+        }
+        cache.clear();
+        compressedCache.clear();
+
+        std::lock_guard lock(lastDecodedMutex);
+        lastDecoded.reset();
+    }
+
+    /// @brief Drops scheduled prefetches and waits for the running one, already decoded steps stay in the cache.
+    void cancelPending()
+    {
+        std::unordered_map<StepIndex, std::shared_future<StepPtr>> toWaitFor;
+        {
+            std::lock_guard lock(inFlightMutex);
+            ++generation;
+            toWaitFor.swap(inFlight);
+            droppedSteps.clear();
+        }
+
+        for (auto& [step, future] : toWaitFor)
+        {
+            future.wait();
+        }
+    }
+
+    /// @brief Sets the budgets of both tiers, see StepPrefetcher()
+    void setMemoryBudget(std::size_t memoryBudgetBytes, std::size_t compressedMemoryBudgetBytes)
+    {
+        compressedCache.setMemoryBudget(compressedMemoryBudgetBytes);
+        compressEvicted(cache.setMemoryBudget(memoryBudgetBytes));
+    }
+
+    /// @brief State of both tiers: cachedSteps counts the steps kept in full, compressedSteps the delta-compressed ones
+    StepCacheStatistics statistics() const
+    {
+        auto statistics = cache.statistics();
+        const auto compressed = compressedCache.statistics();
+        const auto hitsBeforeCompression = evictedHits.load(std::memory_order_relaxed);
+        statistics.hits += compressed.hits + hitsBeforeCompression;
+        statistics.misses -= compressed.hits + hitsBeforeCompression; // missed in full first
+        statistics.compressedSteps = compressed.cachedSteps;
+        statistics.memoryUsage += compressed.memoryUsage;
+        statistics.memoryBudget += compressed.memoryBudget;
+        return statistics;
+    }
+
+private:
+    /// @brief Cached step, from the full tier or reconstructed from the compressed one (then it is kept in full again)
+    StepPtr findCached(StepIndex step)
+    {
+        if (auto cached = cache.find(step))
+            return cached;
+
+        if (auto evicted = evictedBeforeCompression(step)) // its compression is skipped once it is in full again
+        {
+            evictedHits.fetch_add(1, std::memory_order_relaxed);
+            compressEvicted(cache.insert(step, evicted, evicted->memoryUsage()));
+            return evicted;
+        }
+
+        auto reconstructed = compressedCache.find(step);
+        if (reconstructed)
+        {
+            // steps evicted by it are usually compressed already (it stays compressed too), so nothing is encoded again
+            compressEvicted(cache.insert(step, reconstructed, reconstructed->memoryUsage()));
+        }
+        return reconstructed;
+    }
+
+    /// @brief Keeps the newly decoded step in full, the steps evicted for it are compressed
+    void cacheDecoded(const StepPtr& decoded)
+    {
+        compressedCache.erase(decoded->step); // decoded for a smaller region before
+        compressEvicted(cache.insert(decoded->step, decoded, decoded->memoryUsage()));
+    }
+
+    /// @brief Step evicted from the full tier which is waiting for its compression, nullptr if there is none
+    StepPtr evictedBeforeCompression(StepIndex step) const
+    {
+        std::lock_guard lock(compressionsMutex);
+        const auto it = evictedSteps.find(step);
+        return it != evictedSteps.end() ? it->second : nullptr;
+    }
+
+    /// @brief Hands the steps evicted from the full tier to compressionWorker, which adds them to the compressed one
+    void compressEvicted(std::vector<typename StepCache<DecodedStep<Cell>>::Evicted> evictedFromFull)
+    {
+        if (evictedFromFull.empty() || 0 == compressedCache.memoryBudget()) // without the compressed tier evicted steps are dropped at once
+            return;
+
+        const auto currentGeneration = generation.load();
+        for (auto& [step, evicted] : evictedFromFull)
+        {
+            {
+                std::lock_guard lock(compressionsMutex);
+                if (pendingCompressions >= MAX_PENDING_COMPRESSIONS)
+                    return; // encoding falls behind the evictions: the rest is read again when needed
+                ++pendingCompressions;
+                evictedSteps[step] = evicted;
+            }
+            compressionWorker.submit(
+                [this, currentGeneration, evicted = std::move(evicted)]
+                {
+                    // skipped when the stage was invalidated, or when the step is back in full (e.g. decoded again for a bigger region)
+                    if (currentGeneration == generation.load() && ! cache.contains(evicted->step))
+                        compressedCache.insert(evicted);
+
+                    std::lock_guard lock(compressionsMutex);
+                    if (const auto it = evictedSteps.find(evicted->step); it != evictedSteps.end() && it->second == evicted)
+                        evictedSteps.erase(it); // not when it was evicted again meanwhile
+                    --pendingCompressions;
+                    compressionsFinished.notify_all();
+                });
+        }
+    }
+
+    /** @brief Reads the step (nodes intersecting sp.regionOfInterest) and computes its colours.
+     *
+     * With the columnar storage (the `substate_storage` setting) the cells of a completely read step are dropped
+     * at the end, the step keeps only colours, lines and values of the substates.
+     * @param partial The same step decoded for another region: its nodes are copied, only the missing ones are read
+     * @return nullptr if decoding was stopped */
+    StepPtr decode(const SettingParameter& sp, std::stop_token stopToken = {}, const StepPtr& partial = nullptr)
+    {
+        ScopedStageTimer timer(ProfiledStage::DecodeStep);
+        const auto decodingStart = std::chrono::steady_clock::now();
+        auto decoded = std::make_shared<DecodedStep<Cell>>();
+        decoded->step = sp.step;
+        decoded->rows = sp.numberOfRowsY;
+        decoded->columns = sp.numberOfColumnX;
+        if (partial)
+        {
+            decoded->cells = partial->cells;
+            decoded->lines = partial->lines;
+            decoded->contents = partial->contents;
+        }
+        else
+        {
+            decoded->cells.resize(sp.numberOfRowsY, sp.numberOfColumnX);
+            decoded->lines.resize(sp.numberOfLines);
+        }
+
+        // substates needed by reductions or kept in columns are extracted by the reading workers,
+        // node by node right after parsing, so the cells are not traversed again
+        const auto storage = substateStorageFromName(sp.substateStorage);
+        const bool reductionsRequested = ! sp.reduction.empty();
+        const auto substates = (reductionsRequested || SubstateStorage::Columns == storage) ? substateNamesFromList(sp.substates) : std::vector<std::string>{};
+
+        SubstateColumns columns;
+        std::optional<StepReductionsBuilder> reductions;
+        NodeReadCallback processNode;
+        bool partialHasColumns = false;
+        if (! substates.empty())
+        {
+            partialHasColumns = partial && partial->substateColumns && partial->substateColumns->hasLayout(substates, decoded->rows, decoded->columns);
+            columns = partialHasColumns ? *partial->substateColumns : SubstateColumns(substates, decoded->rows, decoded->columns);
+            if (reductionsRequested)
+                reductions.emplace(substates, sp.nNodeX * sp.nNodeY, decoded->rows, partial ? partial->reductions.get() : nullptr);
+
+            processNode = [&columns, &reductions, &cells = decoded->cells](NodeIndex node, const CellRegion& region)
+            {
+                columns.extract(cells, region);
+                if (reductions)
+                    reductions->reduceNode(columns, node, region);
+            };
+        }
+
+        SettingParameter stepParameters = sp; // the reader takes non-const parameters
+        if (! modelReader.readStageStateFromFilesForStep(decoded->cells, &stepParameters, decoded->lines.data(), stopToken, &decoded->contents, processNode))
+            return nullptr;
+
+        if (! substates.empty())
+        {
+            // nodes copied from a partial step decoded with other settings
+            const bool reducePartial = reductions && partial && ! (partial->reductions && partial->reductions->hasSubstates(substates));
+            const bool extractPartial = partial && ! partialHasColumns && (SubstateStorage::Columns == storage || reducePartial);
+            if (extractPartial || reducePartial)
+                processNodesOfPartialStep(*decoded, *partial, columns, extractPartial, reducePartial ? &*reductions : nullptr);
+
+            if (reductions)
+                decoded->reductions = std::make_shared<const StepReductions>(reductions->build(decoded->contents.covers(std::nullopt)));
+            if (SubstateStorage::Columns == storage)
+                decoded->substateColumns = std::make_shared<const SubstateColumns>(std::move(columns));
+        }
+
+        // colours are computed here too, so the GUI thread only swaps the displayed buffer
+        std::shared_ptr<const DecodedStep<Cell>> previous = partial;
+        if (! previous)
+        {
+            std::lock_guard lock(lastDecodedMutex);
+            previous = lastDecoded;
+        }
+        StepColorizer<Cell>::colorStep(*decoded, previous, StepColoring::of(sp));
+
+        // a complete step is never read again, so its cells are not needed any more (only the requested substates are kept)
+        if (SubstateStorage::Columns == storage && decoded->contents.covers(std::nullopt))
+            decoded->cells = Matrix2D<Cell>{};
+
+        // smoothed, so one slow step (e.g. first access of a file) does not change the pace of the playback at once
+        const auto decodingTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodingStart).count();
+        const auto previousAverage = averageDecodeNanoseconds.load(std::memory_order_relaxed);
+        averageDecodeNanoseconds.store(previousAverage ? (3 * previousAverage + decodingTime) / 4 : decodingTime, std::memory_order_relaxed);
+
+        std::lock_guard lock(lastDecodedMutex);
+        lastDecoded = decoded;
+        return decoded;
+    }
+
+    /// @brief Extracts substates and/or reduces nodes copied from a partial step (when it was decoded with other settings)
+    static void processNodesOfPartialStep(const DecodedStep<Cell>& decoded,
+                                          const DecodedStep<Cell>& partial,
+                                          SubstateColumns& columns,
+                                          bool extractColumns,
+                                          StepReductionsBuilder* reductions)
+    {
+        if (! partial.contents.layout || partial.contents.layout != decoded.contents.layout)
+            return;
+
+        const auto& layout = *partial.contents.layout;
+        for (std::size_t node = 0; node < partial.contents.nodesRead.size(); ++node)
+        {
+            if (! partial.contents.nodesRead[node])
+                continue;
+
+            const auto region = CellRegion::ofNode(layout.offsetsXY[node], layout.sceneSizes[node], decoded.rows, decoded.columns);
+            if (extractColumns)
+                columns.extract(decoded.cells, region);
+            if (reductions)
+                reductions->reduceNode(columns, static_cast<NodeIndex>(node), region);
+        }
+    }
+
+    ModelReader<Cell>& modelReader;
+    StepCache<DecodedStep<Cell>> cache;     ///< the most recently used steps, in full
+    DeltaStepCache<Cell> compressedCache; ///< steps evicted from the cache
+
+    mutable std::mutex inFlightMutex;
+    std::unordered_map<StepIndex, std::shared_future<StepPtr>> inFlight; ///< scheduled or running prefetches
+    std::unordered_set<StepIndex> droppedSteps;                           ///< scheduled prefetches to skip, see reschedule()
+    std::atomic<unsigned> generation{};                                   ///< increased by invalidate()
+
+    std::atomic<std::int64_t> averageDecodeNanoseconds{}; ///< see averageDecodeTime()
+
+    /// The most recently decoded step, its unchanged nodes' colours are reused by the next decoded step
+    std::shared_ptr<const DecodedStep<Cell>> lastDecoded;
+    std::mutex lastDecodedMutex;
+
+    mutable std::mutex compressionsMutex;
+    std::condition_variable compressionsFinished;
+    std::size_t pendingCompressions = 0;                  ///< evicted steps submitted to compressionWorker and not encoded yet
+    std::unordered_map<StepIndex, StepPtr> evictedSteps; ///< the steps waiting for compression, still handed out by findCached()
+    std::atomic<std::size_t> evictedHits{};               ///< lookups which found a step in evictedSteps
+
+    /// Encodes the evicted steps into compressedCache, it outlives the workers submitting to it
+    ThreadPool compressionWorker{ 1 };
+
+    /// Declared last, so it is destroyed (and drained) first, while the rest of members is still alive
+    ThreadPool workers{ 1 };
+};
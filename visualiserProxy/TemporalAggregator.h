@@ -0,0 +1,155 @@
+/** @file TemporalAggregator.h
+ * @brief Declaration of the TemporalAggregator class template - streaming pass aggregating a substate over a range of steps. */
+
+#pragma once
+
+#include <algorithm> // std::min
+#include <atomic>
+#include <exception>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "utilities/Matrix2D.h"
+#include "utilities/ModelReader.hpp"
+#include "utilities/StageProfiler.h"
+#include "visualiser/Line.h"
+#include "visualiser/SettingParameter.h"
+#include "visualiser/SubstateColumns.h" // cellSubstateValue
+#include "visualiser/TemporalAggregation.h"
+
+/** @class TemporalAggregator
+ * @brief Aggregates a substate of every cell over the steps of a range (see TemporalAccumulator), reading each step once.
+ *
+ * The pass streams through the step index: PIPELINED_STEPS steps are read at the same time, each one node by node
+ * by the reader's pool, so workers read nodes of the next step while the last nodes of the previous one are finished.
+ * Values of a node are added to the accumulators right after the node is parsed (while its cells are in the CPU cache)
+ * under a lock of the node, which only readers of the same node in another step wait for.
+ * Besides the accumulators only the cells of the steps being read are held in memory, steps are not cached.
+ * @tparam Cell The cell type used in the model */
+template<typename Cell>
+class TemporalAggregator
+{
+public:
+    /// @brief Reports steps added so far, called from the reading threads
+    using ProgressCallback = std::function<void(std::size_t aggregatedSteps, std::size_t totalSteps)>;
+
+    /// Steps read at the same time, each one needs its own grid of cells
+    static constexpr std::size_t PIPELINED_STEPS = 2;
+
+    /// @brief Accumulated values with the lines of the last aggregated step (the result is shown as that step)
+    struct Aggregation
+    {
+        TemporalAccumulator values;
+        StepIndex lastStep{};
+        std::vector<Line> lines; ///< Borders of the nodes in the last step
+    };
+
+    /** @brief Aggregates steps of the request which are written by all nodes.
+     *  @param sp Parameters of the stage, the step and the region of interest inside are ignored (whole steps are read)
+     *  @param stopToken When stop is requested, reading ends early and std::nullopt is returned
+     *  @throws std::invalid_argument If no step of the range is written by all nodes
+     *  @throws std::runtime_error If a step cannot be read */
+    static std::optional<Aggregation> aggregate(ModelReader<Cell>& modelReader,
+                                                const SettingParameter& sp,
+                                                const TemporalAggregationRequest& request,
+                                                const ProgressCallback& progress = {},
+                                                std::stop_token stopToken = {})
+    {
+        std::vector<StepIndex> steps;
+        for (const auto step : modelReader.stepsInAllNodes())
+        {
+            if (request.firstStep <= step && step <= request.lastStep)
+                steps.push_back(step);
+        }
+        if (steps.empty())
+            throw std::invalid_argument(std::format("No step in range {}-{} is written by all nodes", request.firstStep, request.lastStep));
+
+        Aggregation aggregation{ .values = TemporalAccumulator(request.operation, sp.numberOfRowsY, sp.numberOfColumnX, request.threshold),
+                                 .lastStep = steps.back() };
+        std::vector<std::mutex> nodeMutexes(static_cast<std::size_t>(sp.nNodeX) * sp.nNodeY);
+        std::atomic<std::size_t> nextStep{};
+        std::atomic<std::size_t> aggregatedSteps{};
+
+        // an error of one reader stops also the other ones
+        std::stop_source stopReading;
+        std::stop_callback stopWithCaller(stopToken,
+                                          [&stopReading]
+                                          {
+                                              stopReading.request_stop();
+                                          });
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        const auto readSteps = [&]
+        {
+            try
+            {
+                Matrix2D<Cell> cells(sp.numberOfRowsY, sp.numberOfColumnX);
+                std::vector<Line> lines(sp.numberOfLines);
+                SettingParameter stepParameters = sp; // the reader takes non-const parameters
+                stepParameters.regionOfInterest.reset();
+
+                for (auto index = nextStep++; index < steps.size() && ! stopReading.stop_requested(); index = nextStep++)
+                {
+                    const auto step = steps[index];
+                    stepParameters.step = step;
+
+                    const auto addNode = [&](NodeIndex node, const CellRegion& region)
+                    {
+                        ScopedStageTimer timer(ProfiledStage::AggregateNode);
+                        static thread_local std::vector<double> values;
+                        values.resize(static_cast<std::size_t>(region.rows) * region.columns);
+                        for (int row = 0; row < region.rows; ++row)
+                        {
+                            const auto rowCells = cells[region.firstRow + row].subspan(region.firstColumn, region.columns);
+                            double* rowValues = values.data() + static_cast<std::size_t>(row) * region.columns;
+                            for (int column = 0; column < region.columns; ++column)
+                                rowValues[column] = cellSubstateValue(rowCells[column], request.substate.c_str());
+                        }
+
+                        std::lock_guard lock(nodeMutexes[node]);
+                        for (int row = 0; row < region.rows; ++row)
+                        {
+                            const std::span<const double> rowValues(values.data() + static_cast<std::size_t>(row) * region.columns, region.columns);
+                            aggregation.values.addRow(step, region.firstRow + row, region.firstColumn, rowValues);
+                        }
+                    };
+
+                    if (! modelReader.readStageStateFromFilesForStep(cells, &stepParameters, lines.data(), stopReading.get_token(), nullptr, addNode))
+                        return;
+                    if (step == aggregation.lastStep) // read by one reader only
+                        aggregation.lines = lines;
+
+                    if (progress)
+                        progress(++aggregatedSteps, steps.size());
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard lock(errorMutex);
+                if (! error)
+                    error = std::current_exception();
+                stopReading.request_stop();
+            }
+        };
+
+        {
+            std::vector<std::jthread> readers;
+            for (std::size_t reader = 1; reader < std::min(PIPELINED_STEPS, steps.size()); ++reader)
+                readers.emplace_back(readSteps);
+            readSteps(); // the calling thread is one of the readers
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+        if (stopToken.stop_requested())
+            return std::nullopt;
+        return aggregation;
+    }
+};
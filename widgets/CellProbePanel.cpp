@@ -0,0 +1,245 @@
+#include "CellProbePanel.h"
+
+#include <algorithm> // std::ranges::lower_bound, std::clamp
+#include <cmath>     // std::isfinite
+#include <limits>
+#include <utility> // std::move
+
+#include <QComboBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QSignalBlocker>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+
+namespace
+{
+/// Largest window radius offered, a window of 2 * radius + 1 cells on each side is read in every step
+constexpr int MAX_PROBE_RADIUS = 16;
+} // namespace
+
+CellProbePlot::CellProbePlot(QWidget* parent)
+    : QWidget(parent)
+{
+    setBackgroundRole(QPalette::Base);
+    setAutoFillBackground(true);
+}
+
+QSize CellProbePlot::minimumSizeHint() const
+{
+    return { 4 * MARGIN + 120, 2 * MARGIN + 80 };
+}
+
+void CellProbePlot::setSeries(std::shared_ptr<const CellProbeSeries> series)
+{
+    this->series = std::move(series);
+    minimumValue = std::numeric_limits<double>::infinity();
+    maximumValue = -std::numeric_limits<double>::infinity();
+    if (this->series)
+    {
+        for (std::size_t i = 0; i < this->series->size(); ++i)
+        {
+            if (std::isfinite(this->series->minimums[i]))
+                minimumValue = std::min(minimumValue, this->series->minimums[i]);
+            if (std::isfinite(this->series->maximums[i]))
+                maximumValue = std::max(maximumValue, this->series->maximums[i]);
+        }
+    }
+    if (minimumValue > maximumValue) // no numeric value
+        minimumValue = maximumValue = 0;
+    if (minimumValue == maximumValue) // a constant is drawn in the middle
+    {
+        minimumValue -= 1;
+        maximumValue += 1;
+    }
+    update();
+}
+
+void CellProbePlot::setCurrentStep(StepIndex step)
+{
+    currentStep = step;
+    update();
+}
+
+QRect CellProbePlot::plotArea() const
+{
+    return rect().adjusted(2 * MARGIN, MARGIN / 2, -MARGIN / 2, -MARGIN);
+}
+
+void CellProbePlot::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    const auto area = plotArea();
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(area);
+    if (! series || series->size() == 0 || area.width() <= 0 || area.height() <= 0)
+        return;
+
+    const double firstStep = series->steps.front();
+    const double stepsRange = std::max<double>(1, series->steps.back() - series->steps.front());
+    const auto xOf = [&](double step)
+    {
+        return area.left() + (step - firstStep) / stepsRange * area.width();
+    };
+    const auto yOf = [&](double value)
+    {
+        return area.bottom() - (value - minimumValue) / (maximumValue - minimumValue) * area.height();
+    };
+    // polyline of the values, broken by steps without a value
+    const auto pathOf = [&](const std::vector<double>& values)
+    {
+        QPainterPath path;
+        bool drawing = false;
+        for (std::size_t i = 0; i < series->size(); ++i)
+        {
+            if (! std::isfinite(values[i]))
+            {
+                drawing = false;
+                continue;
+            }
+            const QPointF point(xOf(series->steps[i]), yOf(values[i]));
+            if (drawing)
+                path.lineTo(point);
+            else
+                path.moveTo(point);
+            drawing = true;
+        }
+        return path;
+    };
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    const auto highlight = palette().color(QPalette::Highlight);
+    if (series->request.radius > 0)
+    {
+        auto bandColor = highlight;
+        bandColor.setAlpha(110);
+        painter.setPen(QPen(bandColor, 1));
+        painter.drawPath(pathOf(series->minimums));
+        painter.drawPath(pathOf(series->maximums));
+    }
+    painter.setPen(QPen(highlight, 2));
+    painter.drawPath(pathOf(series->means));
+
+    if (series->steps.front() <= currentStep && currentStep <= series->steps.back())
+    {
+        const double x = xOf(currentStep);
+        painter.setPen(QPen(palette().color(QPalette::Text), 1, Qt::DashLine));
+        painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+    }
+
+    painter.setPen(palette().color(QPalette::Text));
+    const auto textHeight = painter.fontMetrics().height();
+    painter.drawText(QRect(0, area.top(), area.left() - 4, textHeight), Qt::AlignRight, QString::number(maximumValue, 'g', 6));
+    painter.drawText(QRect(0, area.bottom() - textHeight, area.left() - 4, textHeight), Qt::AlignRight, QString::number(minimumValue, 'g', 6));
+    painter.drawText(QRect(area.left(), area.bottom() + 2, area.width(), textHeight), Qt::AlignLeft, QString::number(series->steps.front()));
+    painter.drawText(QRect(area.left(), area.bottom() + 2, area.width(), textHeight), Qt::AlignRight, QString::number(series->steps.back()));
+}
+
+void CellProbePlot::mousePressEvent(QMouseEvent* event)
+{
+    const auto area = plotArea();
+    if (! series || series->size() == 0 || area.width() <= 0 || event->button() != Qt::LeftButton)
+        return;
+
+    const double fraction = std::clamp((event->position().x() - area.left()) / area.width(), 0.0, 1.0);
+    const double clickedStep = series->steps.front() + fraction * (series->steps.back() - series->steps.front());
+
+    // the nearest probed step (steps may be missing in the index)
+    auto nearest = std::ranges::lower_bound(series->steps, clickedStep, {}, [](StepIndex step) { return static_cast<double>(step); });
+    if (nearest == series->steps.end() || (nearest != series->steps.begin() && clickedStep - *(nearest - 1) < *nearest - clickedStep))
+        --nearest;
+    emit stepSelected(*nearest);
+}
+
+CellProbePanel::CellProbePanel(QWidget* parent)
+    : QWidget(parent)
+    , substateComboBox(new QComboBox(this))
+    , radiusSpinBox(new QSpinBox(this))
+    , plot(new CellProbePlot(this))
+    , statusLabel(new QLabel(this))
+{
+    setupUI();
+}
+
+void CellProbePanel::setupUI()
+{
+    auto* mainLayout = new QVBoxLayout(this);
+
+    auto* formLayout = new QFormLayout;
+    formLayout->addRow(tr("Substate:"), substateComboBox);
+    radiusSpinBox->setRange(0, MAX_PROBE_RADIUS);
+    radiusSpinBox->setToolTip(tr("Cells around the probed one included in the plotted mean, minimum and maximum"));
+    formLayout->addRow(tr("Window radius:"), radiusSpinBox);
+    mainLayout->addLayout(formLayout);
+
+    connect(substateComboBox, &QComboBox::currentIndexChanged, this, &CellProbePanel::requestProbe);
+    connect(radiusSpinBox, &QSpinBox::valueChanged, this, &CellProbePanel::requestProbe);
+    connect(plot, &CellProbePlot::stepSelected, this, &CellProbePanel::stepSelected);
+    mainLayout->addWidget(plot, 1);
+
+    statusLabel->setWordWrap(true);
+    statusLabel->setText(tr("Double-click a cell to plot its substate over all steps"));
+    mainLayout->addWidget(statusLabel);
+
+    setLayout(mainLayout);
+}
+
+void CellProbePanel::setSubstates(const QStringList& substates)
+{
+    const QSignalBlocker blocker(substateComboBox); // the caller probes afterwards
+    const auto chosenSubstate = substateComboBox->currentText();
+    substateComboBox->clear();
+    substateComboBox->addItems(substates);
+    if (const auto index = substateComboBox->findText(chosenSubstate); index >= 0)
+        substateComboBox->setCurrentIndex(index);
+
+    if (substates.isEmpty())
+        statusLabel->setText(tr("No substates to probe (see 'substates' in the VISUALIZATION section of the configuration)"));
+}
+
+void CellProbePanel::clear()
+{
+    lastRequest.reset();
+    plot->setSeries(nullptr);
+    statusLabel->setText(tr("Double-click a cell to plot its substate over all steps"));
+}
+
+void CellProbePanel::probeCell(int row, int column, StepIndex lastStep)
+{
+    lastRequest = CellProbeRequest{ .row = row, .column = column, .firstStep = 0, .lastStep = lastStep };
+    requestProbe();
+}
+
+void CellProbePanel::requestProbe()
+{
+    if (! lastRequest || substateComboBox->currentText().isEmpty())
+        return;
+
+    lastRequest->substate = substateComboBox->currentText().toStdString();
+    lastRequest->radius = radiusSpinBox->value();
+    statusLabel->setText(tr("Reading %1...").arg(QString::fromStdString(lastRequest->description())));
+    emit probeRequested(*lastRequest);
+}
+
+void CellProbePanel::showSeries(std::shared_ptr<const CellProbeSeries> series)
+{
+    statusLabel->setText(tr("%1 (%2 steps)").arg(QString::fromStdString(series->request.description())).arg(series->size()));
+    plot->setSeries(std::move(series));
+}
+
+void CellProbePanel::showError(const QString& message)
+{
+    plot->setSeries(nullptr);
+    statusLabel->setText(tr("Probe failed: %1").arg(message));
+}
+
+void CellProbePanel::setCurrentStep(StepIndex step)
+{
+    plot->setCurrentStep(step);
+}
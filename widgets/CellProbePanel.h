@@ -0,0 +1,109 @@
+/** @file CellProbePanel.h
+ * @brief Declaration of the CellProbePanel class - plot of a substate of a probed cell over the steps of the run. */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+
+#include <QStringList>
+#include <QWidget>
+
+#include "utilities/types.h"
+#include "visualiser/CellProbe.h"
+
+class QComboBox;
+class QLabel;
+class QSpinBox;
+
+/** @class CellProbePlot
+ * @brief Line plot of a CellProbeSeries: the mean over the window, its minimum and maximum as a band, and the displayed step.
+ *
+ * Drawn with QPainter, steps without numeric values leave gaps in the lines. A click selects the nearest probed step. */
+class CellProbePlot : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit CellProbePlot(QWidget* parent = nullptr);
+
+    /// @brief Plots the series, nullptr clears the plot
+    void setSeries(std::shared_ptr<const CellProbeSeries> series);
+
+    /// @brief Moves the marker of the displayed step
+    void setCurrentStep(StepIndex step);
+
+    QSize minimumSizeHint() const override;
+
+signals:
+    /// @brief Signal emitted when a step was clicked in the plot
+    void stepSelected(StepIndex step);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+
+private:
+    /// Margin around the plotted area, in pixels (the axis labels are drawn inside it)
+    static constexpr int MARGIN = 36;
+
+    /// @brief Area of the widget in which values are plotted
+    QRect plotArea() const;
+
+    std::shared_ptr<const CellProbeSeries> series;
+    StepIndex currentStep{};
+    double minimumValue{}; ///< range of the vertical axis, of all minimums and maximums of the series
+    double maximumValue{};
+};
+
+/** @class CellProbePanel
+ * @brief Shows a substate of a cell (double-clicked in the scene) or of a window around it over all steps of the run.
+ *
+ * The panel only asks for probes with probeRequested() and presents their results (see SceneWidget::requestCellProbe()).
+ * Choosing another substate or window probes the same cell again. */
+class CellProbePanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit CellProbePanel(QWidget* parent = nullptr);
+
+    /** @brief Sets the substates which can be probed, the chosen one is kept when it is still among them.
+     *  @param substates Names of numeric substates of the model (`substates` of the configuration) */
+    void setSubstates(const QStringList& substates);
+
+    /// @brief Drops the probed cell and its series (e.g. when the stage changes)
+    void clear();
+
+    /// @brief Probes the cell over steps 0 - lastStep with the chosen substate and window (emits probeRequested())
+    void probeCell(int row, int column, StepIndex lastStep);
+
+    /// @brief Plots the result of the last probe
+    void showSeries(std::shared_ptr<const CellProbeSeries> series);
+
+    /// @brief Reports a failed probe
+    void showError(const QString& message);
+
+    /// @brief Moves the marker of the displayed step
+    void setCurrentStep(StepIndex step);
+
+signals:
+    /// @brief Signal emitted when the panel needs a probe to be read
+    void probeRequested(CellProbeRequest request);
+
+    /// @brief Signal emitted when a step was clicked in the plot
+    void stepSelected(StepIndex step);
+
+private:
+    void setupUI();
+
+    /// @brief Probes the last probed cell again (another substate or window was chosen)
+    void requestProbe();
+
+    QComboBox* substateComboBox; ///< Probed substate
+    QSpinBox* radiusSpinBox;     ///< Cells around the probed one included in the window
+    CellProbePlot* plot;
+    QLabel* statusLabel; ///< Probed cell, progress or error
+
+    std::optional<CellProbeRequest> lastRequest; ///< Cell and steps of the last probe
+};
@@ -15,6 +15,8 @@ ColorSettings::ColorSettings(QObject* parent)
     , textColor_(DEFAULT_TEXT)
     , gridColor_(DEFAULT_GRID)
     , highlightColor_(DEFAULT_HIGHLIGHT)
+    , scalarLowColor_(DEFAULT_SCALAR_LOW)
+    , scalarHighColor_(DEFAULT_SCALAR_HIGH)
 {
     loadSettings();
 }
@@ -55,6 +57,34 @@ void ColorSettings::setHighlightColor(const QColor& color)
     }
 }
 
+void ColorSettings::setScalarLowColor(const QColor& color)
+{
+    if (scalarLowColor_ != color)
+    {
+        scalarLowColor_ = color;
+        emit colorsChanged();
+    }
+}
+
+void ColorSettings::setScalarHighColor(const QColor& color)
+{
+    if (scalarHighColor_ != color)
+    {
+        scalarHighColor_ = color;
+        emit colorsChanged();
+    }
+}
+
+void ColorSettings::setScalarRange(double minimum, double maximum)
+{
+    if (scalarMinimum_ != minimum || scalarMaximum_ != maximum)
+    {
+        scalarMinimum_ = minimum;
+        scalarMaximum_ = maximum;
+        emit colorsChanged();
+    }
+}
+
 void ColorSettings::saveSettings()
 {
     QSettings settings;
@@ -63,6 +93,10 @@ void ColorSettings::saveSettings()
     settings.setValue("text", textColor_);
     settings.setValue("grid", gridColor_);
     settings.setValue("highlight", highlightColor_);
+    settings.setValue("scalarLow", scalarLowColor_);
+    settings.setValue("scalarHigh", scalarHighColor_);
+    settings.setValue("scalarMinimum", scalarMinimum_);
+    settings.setValue("scalarMaximum", scalarMaximum_);
     settings.endGroup();
 }
 
@@ -75,6 +109,10 @@ void ColorSettings::loadSettings()
     textColor_ = settings.value("text", DEFAULT_TEXT).value<QColor>();
     gridColor_ = settings.value("grid", DEFAULT_GRID).value<QColor>();
     highlightColor_ = settings.value("highlight", DEFAULT_HIGHLIGHT).value<QColor>();
+    scalarLowColor_ = settings.value("scalarLow", DEFAULT_SCALAR_LOW).value<QColor>();
+    scalarHighColor_ = settings.value("scalarHigh", DEFAULT_SCALAR_HIGH).value<QColor>();
+    scalarMinimum_ = settings.value("scalarMinimum", 0.0).toDouble();
+    scalarMaximum_ = settings.value("scalarMaximum", 0.0).toDouble();
 
     settings.endGroup();
 
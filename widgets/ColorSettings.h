@@ -53,12 +53,39 @@ public:
     {
         return highlightColor_;
     }
+    /// @brief Colour of the lowest value of the colour substate (scalar colouring on the GPU, `color_substate` setting)
+    QColor scalarLowColor() const
+    {
+        return scalarLowColor_;
+    }
+    /// @brief Colour of the highest value of the colour substate
+    QColor scalarHighColor() const
+    {
+        return scalarHighColor_;
+    }
+    /// @brief Value shown with scalarLowColor(), when equal to scalarMaximum() the range of the first shown step is used
+    double scalarMinimum() const
+    {
+        return scalarMinimum_;
+    }
+    /// @brief Value shown with scalarHighColor()
+    double scalarMaximum() const
+    {
+        return scalarMaximum_;
+    }
+    bool hasAutomaticScalarRange() const
+    {
+        return scalarMinimum_ == scalarMaximum_;
+    }
 
     // Setters
     void setBackgroundColor(const QColor& color);
     void setTextColor(const QColor& color);
     void setGridColor(const QColor& color);
     void setHighlightColor(const QColor& color);
+    void setScalarLowColor(const QColor& color);
+    void setScalarHighColor(const QColor& color);
+    void setScalarRange(double minimum, double maximum);
 
     // Save/load settings
     void saveSettings();
@@ -69,6 +96,8 @@ public:
     static inline const QColor DEFAULT_TEXT{ Qt::black };
     static inline const QColor DEFAULT_GRID{ Qt::red };
     static inline const QColor DEFAULT_HIGHLIGHT{ Qt::yellow };
+    static inline const QColor DEFAULT_SCALAR_LOW{ Qt::blue };
+    static inline const QColor DEFAULT_SCALAR_HIGH{ Qt::red };
 
 signals:
     void colorsChanged();
@@ -85,4 +114,8 @@ private:
     QColor textColor_;
     QColor gridColor_;
     QColor highlightColor_;
+    QColor scalarLowColor_;
+    QColor scalarHighColor_;
+    double scalarMinimum_ = 0; ///< equal minimum and maximum: automatic range
+    double scalarMaximum_ = 0;
 };
@@ -26,6 +26,8 @@ ColorSettingsDialog::ColorSettingsDialog(QWidget* parent)
     connect(ui->btnTextColor, &QPushButton::clicked, this, &ColorSettingsDialog::onTextColorClicked);
     connect(ui->btnGridColor, &QPushButton::clicked, this, &ColorSettingsDialog::onGridColorClicked);
     connect(ui->btnHighlightColor, &QPushButton::clicked, this, &ColorSettingsDialog::onHighlightColorClicked);
+    connect(ui->btnScalarLowColor, &QPushButton::clicked, this, &ColorSettingsDialog::onScalarLowColorClicked);
+    connect(ui->btnScalarHighColor, &QPushButton::clicked, this, &ColorSettingsDialog::onScalarHighColorClicked);
 
     // Load current settings
     loadSettings();
@@ -69,6 +71,22 @@ void ColorSettingsDialog::onHighlightColorClicked()
     }
 }
 
+void ColorSettingsDialog::onScalarLowColorClicked()
+{
+    if (selectColor(m_scalarLowColor, tr("Select Color of Low Values")))
+    {
+        updateColorPreviews();
+    }
+}
+
+void ColorSettingsDialog::onScalarHighColorClicked()
+{
+    if (selectColor(m_scalarHighColor, tr("Select Color of High Values")))
+    {
+        updateColorPreviews();
+    }
+}
+
 void ColorSettingsDialog::onResetColors()
 {
     auto reply = QMessageBox::question(this, 
@@ -82,6 +100,10 @@ void ColorSettingsDialog::onResetColors()
         m_textColor = ColorSettings::DEFAULT_TEXT;
         m_gridColor = ColorSettings::DEFAULT_GRID;
         m_highlightColor = ColorSettings::DEFAULT_HIGHLIGHT;
+        m_scalarLowColor = ColorSettings::DEFAULT_SCALAR_LOW;
+        m_scalarHighColor = ColorSettings::DEFAULT_SCALAR_HIGH;
+        ui->spinScalarMinimum->setValue(0);
+        ui->spinScalarMaximum->setValue(0);
         updateColorPreviews();
     }
 }
@@ -94,6 +116,9 @@ void ColorSettingsDialog::onAccepted()
     settings.setTextColor(m_textColor);
     settings.setGridColor(m_gridColor);
     settings.setHighlightColor(m_highlightColor);
+    settings.setScalarLowColor(m_scalarLowColor);
+    settings.setScalarHighColor(m_scalarHighColor);
+    settings.setScalarRange(ui->spinScalarMinimum->value(), ui->spinScalarMaximum->value());
     settings.saveSettings();
 
     accept();
@@ -112,6 +137,8 @@ void ColorSettingsDialog::updateColorPreviews()
     updateColorButton(ui->btnTextColor, m_textColor);
     updateColorButton(ui->btnGridColor, m_gridColor);
     updateColorButton(ui->btnHighlightColor, m_highlightColor);
+    updateColorButton(ui->btnScalarLowColor, m_scalarLowColor);
+    updateColorButton(ui->btnScalarHighColor, m_scalarHighColor);
 
     // Update preview text
     QString style = QString("color: %1; background-color: %2;")
@@ -147,6 +174,10 @@ void ColorSettingsDialog::loadSettings()
     m_textColor = settings.textColor();
     m_gridColor = settings.gridColor();
     m_highlightColor = settings.highlightColor();
+    m_scalarLowColor = settings.scalarLowColor();
+    m_scalarHighColor = settings.scalarHighColor();
+    ui->spinScalarMinimum->setValue(settings.scalarMinimum());
+    ui->spinScalarMaximum->setValue(settings.scalarMaximum());
 }
 
 void ColorSettingsDialog::saveSettings()
@@ -156,5 +187,8 @@ void ColorSettingsDialog::saveSettings()
     settings.setTextColor(m_textColor);
     settings.setGridColor(m_gridColor);
     settings.setHighlightColor(m_highlightColor);
+    settings.setScalarLowColor(m_scalarLowColor);
+    settings.setScalarHighColor(m_scalarHighColor);
+    settings.setScalarRange(ui->spinScalarMinimum->value(), ui->spinScalarMaximum->value());
     settings.saveSettings();
 }
@@ -45,6 +45,8 @@ private slots:
     void onTextColorClicked();
     void onGridColorClicked();
     void onHighlightColorClicked();
+    void onScalarLowColorClicked();
+    void onScalarHighColorClicked();
     void onResetColors();
     void onAccepted();
     void onRejected();
@@ -63,4 +65,6 @@ private:
     QColor m_textColor;
     QColor m_gridColor;
     QColor m_highlightColor;
+    QColor m_scalarLowColor;
+    QColor m_scalarHighColor;
 };
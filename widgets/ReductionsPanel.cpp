@@ -0,0 +1,146 @@
+#include "ReductionsPanel.h"
+
+#include <algorithm> // std::min
+#include <cmath>     // std::isnan
+#include <stdexcept>
+#include <utility> // std::move
+
+#include <QComboBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+
+ReductionsPanel::ReductionsPanel(QWidget* parent)
+    : QWidget(parent)
+    , scopeComboBox(new QComboBox(this))
+    , tableWidget(new QTableWidget(this))
+    , statusLabel(new QLabel(this))
+{
+    setupUI();
+    refreshTable();
+}
+
+void ReductionsPanel::setupUI()
+{
+    auto* mainLayout = new QVBoxLayout(this);
+
+    scopeComboBox->addItem(tr("Whole grid"), static_cast<int>(Scope::Global));
+    scopeComboBox->addItem(tr("Per node"), static_cast<int>(Scope::PerNode));
+    scopeComboBox->addItem(tr("Per row"), static_cast<int>(Scope::PerRow));
+    connect(scopeComboBox, &QComboBox::currentIndexChanged, this, &ReductionsPanel::refreshTable);
+    mainLayout->addWidget(scopeComboBox);
+
+    tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
+    tableWidget->setAlternatingRowColors(true);
+    tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    mainLayout->addWidget(tableWidget);
+
+    statusLabel->setWordWrap(true);
+    mainLayout->addWidget(statusLabel);
+
+    setLayout(mainLayout);
+}
+
+void ReductionsPanel::showReductions(StepIndex step, std::shared_ptr<const StepReductions> reductions, const std::string& operations)
+{
+    this->step = step;
+    this->reductions = std::move(reductions);
+    try
+    {
+        this->operations = reductionOperationsFromList(operations);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        this->operations.clear();
+        statusLabel->setText(QString::fromUtf8(e.what()));
+        tableWidget->clear();
+        tableWidget->setRowCount(0);
+        tableWidget->setColumnCount(0);
+        return;
+    }
+    refreshTable();
+}
+
+void ReductionsPanel::refreshTable()
+{
+    tableWidget->clear();
+    tableWidget->setRowCount(0);
+    tableWidget->setColumnCount(0);
+
+    if (! reductions || reductions->substates.empty() || operations.empty())
+    {
+        statusLabel->setText(tr("No reductions requested (see 'reduction' and 'substates' in the VISUALIZATION section of the configuration)"));
+        return;
+    }
+
+    const auto scope = static_cast<Scope>(scopeComboBox->currentData().toInt());
+    if (Scope::Global == scope)
+        fillGlobalTable();
+    else
+        fillDetailTable(scope);
+
+    statusLabel->setText(reductions->complete ? tr("Step %1").arg(step)
+                                              : tr("Step %1, only nodes around the visible part of the grid were read").arg(step));
+}
+
+void ReductionsPanel::fillGlobalTable()
+{
+    QStringList headers;
+    for (const auto operation : operations)
+        headers << QString::fromUtf8(reductionOperationName(operation));
+
+    tableWidget->setColumnCount(static_cast<int>(operations.size()));
+    tableWidget->setHorizontalHeaderLabels(headers);
+    tableWidget->setRowCount(static_cast<int>(reductions->substates.size()));
+
+    QStringList substateNames;
+    for (int row = 0; row < static_cast<int>(reductions->substates.size()); ++row)
+    {
+        const auto& substate = reductions->substates[row];
+        substateNames << QString::fromStdString(substate.substate);
+        for (int column = 0; column < static_cast<int>(operations.size()); ++column)
+            tableWidget->setItem(row, column, new QTableWidgetItem(formatValue(substate.global.value(operations[column]))));
+    }
+    tableWidget->setVerticalHeaderLabels(substateNames);
+}
+
+void ReductionsPanel::fillDetailTable(Scope scope)
+{
+    const auto& firstSubstate = reductions->substates.front();
+    const auto itemsCount = (Scope::PerNode == scope) ? firstSubstate.perNode.size() : firstSubstate.perRow.size();
+    const int rowsCount = static_cast<int>(std::min<std::size_t>(itemsCount, MAX_TABLE_ROWS));
+
+    QStringList headers;
+    for (const auto& substate : reductions->substates)
+    {
+        for (const auto operation : operations)
+            headers << QString("%1 %2").arg(QString::fromStdString(substate.substate), QString::fromUtf8(reductionOperationName(operation)));
+    }
+
+    tableWidget->setColumnCount(static_cast<int>(headers.size()));
+    tableWidget->setHorizontalHeaderLabels(headers);
+    tableWidget->setRowCount(rowsCount);
+
+    QStringList rowNames;
+    for (int row = 0; row < rowsCount; ++row)
+    {
+        rowNames << ((Scope::PerNode == scope) ? tr("node %1").arg(row) : tr("row %1").arg(row));
+
+        int column = 0;
+        for (const auto& substate : reductions->substates)
+        {
+            const auto& accumulator = (Scope::PerNode == scope) ? substate.perNode[row] : substate.perRow[row];
+            for (const auto operation : operations)
+                tableWidget->setItem(row, column++, new QTableWidgetItem(formatValue(accumulator.value(operation))));
+        }
+    }
+    tableWidget->setVerticalHeaderLabels(rowNames);
+}
+
+QString ReductionsPanel::formatValue(double value)
+{
+    return std::isnan(value) ? QStringLiteral("-") : QString::number(value, 'g', 10);
+}
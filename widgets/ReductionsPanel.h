@@ -0,0 +1,64 @@
+/** @file ReductionsPanel.h
+ * @brief Declaration of the ReductionsPanel class - table with reductions (sum, min, max, ...) of substates of the displayed step. */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QWidget>
+
+#include "utilities/types.h"
+#include "visualiser/CellReductions.h"
+
+class QComboBox;
+class QLabel;
+class QTableWidget;
+
+/** @class ReductionsPanel
+ * @brief Shows reductions of the requested substates (the `reduction` and `substates` settings) of one step.
+ *
+ * The values are computed while the step is decoded (see StepReductionsBuilder), the panel only presents them:
+ * for the whole grid (one row per substate), per node or per row of the grid (one column per substate and operation). */
+class ReductionsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ReductionsPanel(QWidget* parent = nullptr);
+
+    /** @brief Shows reductions of the step.
+     *  @param reductions Reductions of the step, nullptr when none were requested
+     *  @param operations Operations to show, as in the `reduction` setting (e.g. "sum,min,max") */
+    void showReductions(StepIndex step, std::shared_ptr<const StepReductions> reductions, const std::string& operations);
+
+private:
+    /// Values in the per node and per row tables are limited, so huge grids do not freeze the GUI
+    static constexpr int MAX_TABLE_ROWS = 10000;
+
+    enum class Scope
+    {
+        Global,
+        PerNode,
+        PerRow
+    };
+
+    void setupUI();
+
+    /// @brief Fills the table for the scope selected in the combo box
+    void refreshTable();
+
+    void fillGlobalTable();
+    void fillDetailTable(Scope scope);
+
+    static QString formatValue(double value);
+
+    QComboBox* scopeComboBox; ///< Whole grid, per node or per row
+    QTableWidget* tableWidget;
+    QLabel* statusLabel; ///< Step and whether all nodes were read
+
+    StepIndex step{};
+    std::shared_ptr<const StepReductions> reductions;
+    std::vector<ReductionOperation> operations;
+};
@@ -1,10 +1,19 @@
 /** @file SceneWidget.cpp
  * @brief Implementation of the SceneWidget class for 3D visualization. */
 
+#include <algorithm> // std::max
 #include <iostream> // std::cout
 #include <cmath> // std::isfinite
+#include <exception> // std::rethrow_exception
 #include <filesystem>
+#include <format>
+#include <future>
+#include <limits>
+#include <utility> // std::exchange
 #include <QApplication>
+#include <QEventLoop>
+#include <QProgressDialog>
+#include <QScopeGuard>
 #include <vtkCallbackCommand.h>
 #include <vtkInteractorStyleImage.h>
 #include <vtkInteractorStyleTrackballCamera.h>
@@ -26,31 +35,25 @@
 #include <vtkRenderWindow.h>
 #include <vtkPropPicker.h>
 #include "SceneWidget.h"
-#include "config/Config.h"
+#include "utilities/ModelReader.hpp" // ReaderHelpers::giveMeFileNameIndex
+#include "utilities/StageProfiler.h"
+#include "utilities/StartupTimeline.h"
 #include "visualiser/Line.h"
 #include "visualiser/Visualizer.hpp"
 #include "visualiser/SettingParameter.h"
+#include "visualiser/TemporalAggregation.h"
 #include "widgets/ColorSettings.h"
 
 
 namespace
 {
-/** @brief Prepares the output file path for saving visualization data
- *  @param configFile Path to the configuration file
- *  @param outputFileNameFromCfg Output filename from configuration
- *  @return Full path to the output file */
-std::string prepareOutputFileName(const std::string& configFile, const std::string& outputFileNameFromCfg)
-{
-    namespace fs = std::filesystem;
-
-    // Step 1: prepare output directory
-    fs::path configPath(configFile);
-    fs::path outputDir = configPath.parent_path() / "Output";
-    fs::create_directories(outputDir); // ensure that directory exists
+/// Part of the visible size added on every side of the region of interest, so small pans do not need reading
+constexpr double REGION_OF_INTEREST_MARGIN = 0.25;
 
-    // Step 2: build full output file path
-    return (outputDir / outputFileNameFromCfg).string();
-}
+/// Live follow: changes of index files coming shortly after each other are processed together
+constexpr int LIVE_FOLLOW_UPDATE_DELAY_MS = 250;
+/// Live follow: sizes of index files are checked also periodically (NFS and Lustre do not notify about remote writes)
+constexpr int LIVE_FOLLOW_POLL_INTERVAL_MS = 2000;
 
 vtkColor3d toVtkColor(QColor color)
 {
@@ -72,6 +75,7 @@ SceneWidget::SceneWidget(QWidget* parent)
     , actorBuildLine{ vtkSmartPointer<vtkActor2D>::New() }
 {
     enableToolTipWhenMouseAboveWidget();
+    connectRenderTimingCallbacks();
 
     connect(&ColorSettings::instance(), &ColorSettings::colorsChanged, this, &SceneWidget::onColorsReloadRequested);
 }
@@ -114,12 +118,20 @@ void SceneWidget::applyCameraAngles()
 
 void SceneWidget::loadAndUpdateVisualizationForCurrentStep()
 {
+    ScopedStageTimer timer(ProfiledStage::LoadStep);
+
     // Resize lines vector to match expected number of lines
     lines.resize(settingParameter->numberOfLines);
 
     // Read stage state from files for the current step
     sceneWidgetVisualizerProxy->readStageStateFromFilesForStep(settingParameter.get(), &lines[0]);
+    shownAggregationDescription.clear();
 
+    refreshVisualizationOfDisplayedStep();
+}
+
+void SceneWidget::refreshVisualizationOfDisplayedStep()
+{
     // Refresh VTK visualization elements
     sceneWidgetVisualizerProxy->refreshWindowsVTK(settingParameter->numberOfRowsY, settingParameter->numberOfColumnX, gridActor);
 
@@ -131,8 +143,22 @@ void SceneWidget::loadAndUpdateVisualizationForCurrentStep()
                                                                                 actorBuildLine);
     }
 
+    updateHitIndex();
+
     // Update step number display
     sceneWidgetVisualizerProxy->getVisualizer().buildStepLine(settingParameter->step, singleLineTextStep);
+    if (! shownAggregationDescription.isEmpty()) // a synthetic step, not the current one
+    {
+        singleLineTextStep->SetInput(shownAggregationDescription.toUtf8().constData());
+        return;
+    }
+
+    emit displayedStepChanged(settingParameter->step);
+}
+
+void SceneWidget::updateHitIndex()
+{
+    hitIndex.rebuild(lines, settingParameter->nNodeX, settingParameter->nNodeY);
 }
 
 void SceneWidget::prepareStageWithCurrentNodeConfiguration()
@@ -148,26 +174,60 @@ void SceneWidget::addVisualizer(const std::string& filename, StepIndex stepNumbe
         throw std::invalid_argument(std::string("File '") + filename + "' does not exist!");
     }
 
-    setupSettingParameters(filename, stepNumber);
-    setupVtkScene();
+    {
+        ScopedStartupPhase phase(StartupPhase::Configuration);
+        setupSettingParameters(filename, stepNumber);
+        prepareStageWithCurrentNodeConfiguration();
+        setupVtkScene();
+    }
     renderVtkScene();
 }
 
+void SceneWidget::showLinkedView(SceneWidget& owner, const std::string& colorSubstate)
+{
+    if (owner.isLinkedView())
+        throw std::invalid_argument("A linked view can be created only for the view which loaded the configuration");
+
+    sceneWidgetVisualizerProxy = owner.sceneWidgetVisualizerProxy->createLinkedView();
+    currentModelName = owner.currentModelName;
+    linkedView = true;
+
+    *settingParameter = *owner.settingParameter;
+    settingParameter->colorSubstate = colorSubstate;
+    settingParameter->changed = false;
+    settingParameter->regionOfInterest.reset();
+    refreshBackgroundColorFromSettings();
+
+    setupVtkScene(); // the stage is prepared and its indices are loaded by the owner
+    drawSceneForCurrentStep();
+
+    if (ViewMode::Mode3D == owner.currentViewMode)
+        setViewMode3D();
+    copyCameraFrom(*owner.renderer->GetActiveCamera());
+    linkCameraWith(owner);
+    triggerRenderUpdate();
+}
+
 void SceneWidget::setupSettingParameters(const std::string& configFilename, StepIndex stepNumber)
 {
     readSettingsFromConfigFile(configFilename);
-
-    // Each node has 2 lines (top and left edges)
-    // Plus additional lines for bottom edge (nNodeX lines) and right edge (nNodeY lines)
-    settingParameter->numberOfLines = 2 * (settingParameter->nNodeX * settingParameter->nNodeY) + settingParameter->nNodeX + settingParameter->nNodeY;
     settingParameter->step = stepNumber;
     settingParameter->changed = false;
+    settingParameter->regionOfInterest.reset(); // the first step is read whole, the view is not known yet
 
     sceneWidgetVisualizerProxy->initMatrix(settingParameter->numberOfColumnX, settingParameter->numberOfRowsY);
+    applyStepCacheSettings();
 
     refreshBackgroundColorFromSettings();
 }
 
+void SceneWidget::applyStepCacheSettings()
+{
+    sceneWidgetVisualizerProxy->setStepCacheMemoryBudget(settingParameter->stepCacheMemoryMB * 1024 * 1024, settingParameter->compressedStepCacheMemoryMB * 1024 * 1024);
+    sceneWidgetVisualizerProxy->setMaxOpenFiles(settingParameter->maxOpenFiles);
+    sceneWidgetVisualizerProxy->setRemoteAgent(settingParameter->remoteAgent);
+}
+
 void SceneWidget::refreshGridColorFromSettings()
 {
     const auto color = ColorSettings::instance().gridColor();
@@ -180,55 +240,12 @@ void SceneWidget::refreshGridColorFromSettings()
 
 void SceneWidget::readSettingsFromConfigFile(const std::string& filename)
 {
-    Config config(filename);
-
-    {
-        ConfigCategory* generalContext = config.getConfigCategory("GENERAL");
-        const std::string outputFileNameFromCfg = generalContext->getConfigParameter("output_file_name")->getValue<std::string>();
-        settingParameter->outputFileName = prepareOutputFileName(filename, outputFileNameFromCfg);
-        settingParameter->numberOfColumnX = generalContext->getConfigParameter("number_of_columns")->getValue<int>();
-        settingParameter->numberOfRowsY = generalContext->getConfigParameter("number_of_rows")->getValue<int>();
-        settingParameter->nsteps = generalContext->getConfigParameter("number_steps")->getValue<int>();
-        emit totalNumberOfStepsReadFromConfigFile(settingParameter->nsteps);
-    }
-
-    {
-        ConfigCategory* execContext = config.getConfigCategory("DISTRIBUTED");
-        settingParameter->nNodeX = execContext->getConfigParameter("number_node_x")->getValue<int>();
-        settingParameter->nNodeY = execContext->getConfigParameter("number_node_y")->getValue<int>();
-        /// Notice: there are much more params, which are not used: e.g. border_size_x, border_size_y
-    }
-
-    {
-        ConfigCategory* visualizationContext = config.getConfigCategory("VISUALIZATION");
-        if (visualizationContext)
-        {
-            // Read visualization mode (text or binary)
-            auto modeParam = visualizationContext->getConfigParameter("mode");
-            settingParameter->readMode = modeParam ? modeParam->getValue<std::string>() : "text";
-
-            // Read substates
-            auto substatesParam = visualizationContext->getConfigParameter("substates");
-            settingParameter->substates = substatesParam ? substatesParam->getValue<std::string>() : "";
-
-            // Read reduction operations
-            auto reductionParam = visualizationContext->getConfigParameter("reduction");
-            settingParameter->reduction = reductionParam ? reductionParam->getValue<std::string>() : "";
-        }
-        else
-        {
-            // Default values if VISUALIZATION section is not present
-            settingParameter->readMode = "text";
-            settingParameter->substates = "";
-            settingParameter->reduction = "";
-        }
-    }
+    readSettingParameterFromConfigFile(filename, *settingParameter);
+    emit totalNumberOfStepsReadFromConfigFile(settingParameter->nsteps);
 }
 
 void SceneWidget::setupVtkScene()
 {
-    sceneWidgetVisualizerProxy->prepareStage(settingParameter->nNodeX, settingParameter->nNodeY);
-
     renderWindow()->AddRenderer(renderer);
     interactor()->SetRenderWindow(renderWindow());
 
@@ -241,19 +258,19 @@ void SceneWidget::setupVtkScene()
 
     renderWindow()->SetWindowName(QApplication::applicationName().toLocal8Bit().data());
 
-    // Setup orientation axes widget
-    setupAxesWidget();
-
-    // Setup 2D ruler axes (bounds will be updated when data is loaded)
-    setup2DRulerAxes();
+    // Orientation axes and 2D rulers are not needed for the first frame: they are created when first shown
 
     connectKeyboardCallback();
     connectMouseCallback();
     connectCameraCallback();
+    connectRenderStartCallback();
 }
 
 void SceneWidget::setupAxesWidget()
 {
+    axesActor = vtkSmartPointer<vtkAxesActor>::New();
+    axesWidget = vtkSmartPointer<vtkOrientationMarkerWidget>::New();
+
     // Configure axes actor
     axesActor->SetShaftTypeToCylinder();
     axesActor->SetXAxisLabelText("X");
@@ -280,6 +297,9 @@ void SceneWidget::setupAxesWidget()
 
 void SceneWidget::setup2DRulerAxes()
 {
+    rulerAxisX = vtkSmartPointer<vtkAxisActor2D>::New();
+    rulerAxisY = vtkSmartPointer<vtkAxisActor2D>::New();
+
     // Configure X axis (horizontal, bottom)
     // Use World coordinates so the axis matches the actual data coordinates
     rulerAxisX->GetPositionCoordinate()->SetCoordinateSystemToWorld();
@@ -312,6 +332,33 @@ void SceneWidget::setup2DRulerAxes()
     rulerAxisY->SetVisibility(false);
 }
 
+void SceneWidget::set2DRulerAxesVisible(bool visible)
+{
+    if (! visible)
+    {
+        if (rulerAxisX)
+        {
+            rulerAxisX->SetVisibility(false);
+            rulerAxisY->SetVisibility(false);
+        }
+        return;
+    }
+
+    if (! rulerAxisX)
+    {
+        setup2DRulerAxes();
+    }
+    else if (! renderer->HasViewProp(rulerAxisX)) // removed with all props when the scene was cleared
+    {
+        renderer->AddActor2D(rulerAxisX);
+        renderer->AddActor2D(rulerAxisY);
+    }
+
+    update2DRulerAxesBounds();
+    rulerAxisX->SetVisibility(true);
+    rulerAxisY->SetVisibility(true);
+}
+
 void SceneWidget::update2DRulerAxesBounds()
 {
     if (! renderer || ! renderWindow())
@@ -353,6 +400,304 @@ void SceneWidget::connectKeyboardCallback()
     interactor()->AddObserver(vtkCommand::KeyPressEvent, keypressCallback);
 }
 
+void SceneWidget::connectRenderStartCallback()
+{
+    vtkNew<vtkCallbackCommand> renderStartCallback;
+    renderStartCallback->SetCallback(SceneWidget::renderStartCallbackFunction);
+    renderStartCallback->SetClientData(this);
+    renderer->AddObserver(vtkCommand::StartEvent, renderStartCallback);
+}
+
+void SceneWidget::renderStartCallbackFunction(vtkObject* /*caller*/, long unsigned int /*eventId*/, void* clientData, void* /*callData*/)
+{
+    auto* sceneWidget = static_cast<SceneWidget*>(clientData);
+    sceneWidget->updateLevelOfDetail();
+    sceneWidget->updateRegionOfInterest();
+    sceneWidget->updateTimingOverlay();
+}
+
+void SceneWidget::connectRenderTimingCallbacks()
+{
+    vtkNew<vtkCallbackCommand> renderTimingCallback;
+    renderTimingCallback->SetCallback(SceneWidget::renderWindowTimingCallbackFunction);
+    renderTimingCallback->SetClientData(this);
+    renderWindow()->AddObserver(vtkCommand::StartEvent, renderTimingCallback);
+    renderWindow()->AddObserver(vtkCommand::EndEvent, renderTimingCallback);
+}
+
+void SceneWidget::renderWindowTimingCallbackFunction(vtkObject* /*caller*/, long unsigned int eventId, void* clientData, void* /*callData*/)
+{
+    if (! StageProfiler::isEnabled())
+        return;
+
+    auto* sceneWidget = static_cast<SceneWidget*>(clientData);
+    if (vtkCommand::StartEvent == eventId)
+    {
+        sceneWidget->renderStartAllocations = AllocationCounter::threadAllocations();
+        sceneWidget->renderStartTime = StageProfiler::Clock::now();
+    }
+    else if (sceneWidget->renderStartTime != StageProfiler::Clock::time_point{})
+    {
+        auto& profiler = StageProfiler::instance();
+        profiler.record(ProfiledStage::Render,
+                        sceneWidget->renderStartTime,
+                        StageProfiler::Clock::now(),
+                        AllocationCounter::threadAllocations() - sceneWidget->renderStartAllocations);
+        profiler.finishFrame();
+        sceneWidget->renderStartTime = {};
+    }
+}
+
+void SceneWidget::linkCameraWith(SceneWidget& other)
+{
+    if (&other == this)
+        return;
+
+    const auto link = [](SceneWidget& from, SceneWidget& to)
+    {
+        if (from.cameraLinkedViews.empty())
+        {
+            vtkNew<vtkCallbackCommand> renderEndCallback;
+            renderEndCallback->SetCallback(SceneWidget::renderEndCallbackFunction);
+            renderEndCallback->SetClientData(&from);
+            from.renderWindow()->AddObserver(vtkCommand::EndEvent, renderEndCallback);
+        }
+        from.cameraLinkedViews.emplace_back(&to);
+    };
+    link(*this, other);
+    link(other, *this);
+}
+
+void SceneWidget::renderEndCallbackFunction(vtkObject* /*caller*/, long unsigned int /*eventId*/, void* clientData, void* /*callData*/)
+{
+    // linked views are rendered after this render, not from inside of it
+    auto* sceneWidget = static_cast<SceneWidget*>(clientData);
+    if (std::exchange(sceneWidget->cameraSyncPending, true))
+        return;
+    QMetaObject::invokeMethod(sceneWidget, &SceneWidget::syncLinkedCameras, Qt::QueuedConnection);
+}
+
+void SceneWidget::syncLinkedCameras()
+{
+    cameraSyncPending = false;
+    std::erase_if(cameraLinkedViews,
+                  [](const QPointer<SceneWidget>& view)
+                  {
+                      return view.isNull();
+                  });
+
+    auto* camera = renderer->GetActiveCamera();
+    if (! camera)
+        return;
+
+    for (const auto& view : cameraLinkedViews)
+    {
+        // a view rendered with an unchanged camera does not sync back, so the views do not render each other forever
+        if (view->copyCameraFrom(*camera))
+            view->renderWindow()->Render();
+    }
+}
+
+bool SceneWidget::copyCameraFrom(vtkCamera& source)
+{
+    auto* camera = renderer->GetActiveCamera();
+    if (! camera)
+        return false;
+
+    const auto equal = [](const double* lhs, const double* rhs)
+    {
+        return std::equal(lhs, lhs + 3, rhs);
+    };
+    if (equal(camera->GetPosition(), source.GetPosition()) && equal(camera->GetFocalPoint(), source.GetFocalPoint())
+        && equal(camera->GetViewUp(), source.GetViewUp()) && camera->GetParallelProjection() == source.GetParallelProjection()
+        && camera->GetParallelScale() == source.GetParallelScale() && camera->GetViewAngle() == source.GetViewAngle())
+    {
+        return false;
+    }
+
+    camera->SetPosition(source.GetPosition());
+    camera->SetFocalPoint(source.GetFocalPoint());
+    camera->SetViewUp(source.GetViewUp());
+    camera->SetParallelProjection(source.GetParallelProjection());
+    camera->SetParallelScale(source.GetParallelScale());
+    camera->SetViewAngle(source.GetViewAngle());
+    renderer->ResetCameraClippingRange(); // the clipping range of the source depends on its scene
+    return true;
+}
+
+void SceneWidget::setTimingOverlayVisible(bool visible)
+{
+    auto& profiler = StageProfiler::instance();
+    if (visible)
+    {
+        profiler.setEnabled(true);
+        if (! timingOverlayActor)
+        {
+            auto textProp = timingOverlayText->GetTextProperty();
+            textProp->SetFontSize(12);
+            textProp->SetFontFamilyToCourier(); // columns of times are aligned
+            textProp->SetVerticalJustificationToTop();
+            textProp->SetColor(toVtkColor(ColorSettings::instance().textColor()).GetData());
+
+            timingOverlayActor = vtkSmartPointer<vtkActor2D>::New();
+            timingOverlayActor->SetMapper(timingOverlayText);
+            timingOverlayActor->GetPositionCoordinate()->SetCoordinateSystemToNormalizedDisplay();
+            timingOverlayActor->GetPositionCoordinate()->SetValue(0.05, 0.84); // below the step number
+            renderer->AddActor2D(timingOverlayActor);
+        }
+        timingOverlayText->SetInput("Measuring...");
+    }
+    else if (! profiler.isTraceRecording())
+    {
+        profiler.setEnabled(false);
+    }
+
+    if (timingOverlayActor)
+    {
+        timingOverlayActor->SetVisibility(visible);
+        triggerRenderUpdate();
+    }
+}
+
+void SceneWidget::updateTimingOverlay()
+{
+    if (! timingOverlayActor || ! timingOverlayActor->GetVisibility() || ! StageProfiler::isEnabled())
+        return;
+
+    const auto lastFrame = StageProfiler::instance().lastFrame();
+    if (! lastFrame.stages.empty())
+        timingOverlayText->SetInput(lastFrame.toText().c_str());
+}
+
+double SceneWidget::cellsPerScreenPixel()
+{
+    auto* camera = renderer->GetActiveCamera();
+    if (! camera || ! renderWindow() || renderWindow()->GetSize()[0] <= 0)
+        return 1.0;
+
+    double focalPoint[3];
+    camera->GetFocalPoint(focalPoint);
+
+    vtkNew<vtkCoordinate> coordinate;
+    coordinate->SetCoordinateSystemToWorld();
+    const auto toDisplay = [&](double dx, double dy)
+    {
+        coordinate->SetValue(focalPoint[0] + dx, focalPoint[1] + dy, focalPoint[2]);
+        const double* display = coordinate->GetComputedDoubleDisplayValue(renderer);
+        return std::array<double, 2>{ display[0], display[1] };
+    };
+
+    // one cell in both directions, the longer projection counts (in 3D the grid may be tilted)
+    const auto origin = toDisplay(0, 0);
+    const auto alongX = toDisplay(1, 0);
+    const auto alongY = toDisplay(0, 1);
+    const double pixelsPerCell = std::max(std::hypot(alongX[0] - origin[0], alongX[1] - origin[1]),
+                                          std::hypot(alongY[0] - origin[0], alongY[1] - origin[1]));
+    if (! std::isfinite(pixelsPerCell) || pixelsPerCell <= 0)
+        return 1.0;
+    return 1.0 / pixelsPerCell;
+}
+
+void SceneWidget::updateLevelOfDetail()
+{
+    if (! sceneWidgetVisualizerProxy || ! gridActor)
+        return;
+
+    if (sceneWidgetVisualizerProxy->setCellsPerScreenPixel(cellsPerScreenPixel()))
+    {
+        // called at the start of the render, so the new texture is used by this render already
+        sceneWidgetVisualizerProxy->refreshWindowsVTK(settingParameter->numberOfRowsY, settingParameter->numberOfColumnX, gridActor);
+    }
+}
+
+std::optional<CellRegion> SceneWidget::visibleCellRegion()
+{
+    const int nRows = settingParameter->numberOfRowsY;
+    const int nCols = settingParameter->numberOfColumnX;
+    if (currentViewMode != ViewMode::Mode2D || ! renderWindow() || nRows <= 0 || nCols <= 0)
+        return std::nullopt;
+
+    const int* windowSize = renderWindow()->GetSize();
+    if (windowSize[0] <= 0 || windowSize[1] <= 0)
+        return std::nullopt;
+
+    // the viewing ray through the display point crosses the grid's plane (z = 1, see Visualizer::setUpGridActor())
+    constexpr double GRID_PLANE_Z = 1.0;
+    const auto toGridPlane = [&](double displayX, double displayY)
+    {
+        std::array<double, 3> ends[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            renderer->SetDisplayPoint(displayX, displayY, i);
+            renderer->DisplayToWorld();
+            const double* world = renderer->GetWorldPoint();
+            const double w = (world[3] != 0) ? world[3] : 1.0;
+            ends[i] = { world[0] / w, world[1] / w, world[2] / w };
+        }
+        const double dz = ends[1][2] - ends[0][2];
+        const double t = (dz != 0) ? (GRID_PLANE_Z - ends[0][2]) / dz : 0.0;
+        return std::array<double, 2>{ ends[0][0] + t * (ends[1][0] - ends[0][0]), ends[0][1] + t * (ends[1][1] - ends[0][1]) };
+    };
+
+    double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+    double minY = minX, maxY = maxX;
+    for (const auto [displayX, displayY] : { std::pair{ 0, 0 }, std::pair{ windowSize[0], 0 }, std::pair{ 0, windowSize[1] }, std::pair{ windowSize[0], windowSize[1] } })
+    {
+        const auto [x, y] = toGridPlane(displayX, displayY);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+    if (! std::isfinite(minX) || ! std::isfinite(maxX) || ! std::isfinite(minY) || ! std::isfinite(maxY))
+        return std::nullopt;
+
+    const double marginX = (maxX - minX) * REGION_OF_INTEREST_MARGIN;
+    const double marginY = (maxY - minY) * REGION_OF_INTEREST_MARGIN;
+
+    // column c is drawn at x in [c, c + 1], matrix row r at y in [nRows - 1 - r, nRows - r]
+    const auto clampedCell = [](double value, int count)
+    {
+        return static_cast<int>(std::clamp(value, 0.0, static_cast<double>(count)));
+    };
+    const int firstColumn = clampedCell(std::floor(minX - marginX), nCols);
+    const int endColumn = clampedCell(std::ceil(maxX + marginX), nCols);
+    const int firstRow = clampedCell(std::floor(nRows - (maxY + marginY)), nRows);
+    const int endRow = clampedCell(std::ceil(nRows - (minY - marginY)), nRows);
+
+    if (0 == firstColumn && nCols == endColumn && 0 == firstRow && nRows == endRow)
+        return std::nullopt;
+    return CellRegion{ firstRow, firstColumn, endRow - firstRow, endColumn - firstColumn };
+}
+
+void SceneWidget::updateRegionOfInterest()
+{
+    if (! sceneWidgetVisualizerProxy || ! gridActor || loadingStepIndices)
+        return;
+    if (! shownAggregationDescription.isEmpty()) // aggregated values are always the whole grid
+        return;
+
+    auto& regionOfInterest = settingParameter->regionOfInterest;
+    const auto visible = visibleCellRegion();
+    const auto area = [](const CellRegion& region)
+    {
+        return static_cast<long long>(region.rows) * region.columns;
+    };
+
+    const bool visibleWasRead = ! regionOfInterest || (visible && regionOfInterest->contains(*visible));
+    if (visibleWasRead)
+    {
+        // zoomed in: next steps read less, the displayed step already has the visible cells
+        if (visible && (! regionOfInterest || 4 * area(*visible) < area(*regionOfInterest)))
+            regionOfInterest = visible;
+        return;
+    }
+
+    regionOfInterest = visible;
+    requestedStep.reset(); // the same step is loaded again, now with the newly visible nodes
+    requestStepAsync(settingParameter->step);
+}
+
 void SceneWidget::connectCameraCallback()
 {
     if (! interactor())
@@ -395,24 +740,8 @@ void SceneWidget::keypressCallbackFunction(vtkObject* caller, long unsigned int
 
     if (sp->changed)
     {
-        try
-        {
-            // Load and update visualization using helper method
-            sw->loadAndUpdateVisualizationForCurrentStep();
-
-            // Trigger render update
-            sw->triggerRenderUpdate();
-        }
-        catch (const std::runtime_error& re)
-        {
-            std::cerr << "Runtime error di getElementMatrix: " << re.what() << std::endl;
-        }
-        catch (const std::exception& ex)
-        {
-            std::cerr << "Error occurred: " << ex.what() << std::endl;
-        }
-
-        sp->changed = false;
+        // read in background, holding the key (auto-repeat) shows only the steps which can be read in time
+        sw->requestStepAsync(sp->step);
     }
 }
 
@@ -422,6 +751,29 @@ void SceneWidget::connectMouseCallback()
     mouseMoveCallback->SetCallback(&SceneWidget::mouseCallbackFunction);
     mouseMoveCallback->SetClientData(this);
     interactor()->AddObserver(vtkCommand::MouseMoveEvent, mouseMoveCallback);
+
+    vtkNew<vtkCallbackCommand> doubleClickCallback;
+    doubleClickCallback->SetCallback(&SceneWidget::doubleClickCallbackFunction);
+    doubleClickCallback->SetClientData(this);
+    interactor()->AddObserver(vtkCommand::LeftButtonPressEvent, doubleClickCallback);
+}
+
+void SceneWidget::doubleClickCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData)
+{
+    Q_UNUSED(eventId);
+    Q_UNUSED(callData);
+
+    auto interactor = static_cast<vtkRenderWindowInteractor*>(caller);
+    auto* self = static_cast<SceneWidget*>(clientData);
+    if (! self || ! self->settingParameter || interactor->GetRepeatCount() == 0) // not a double-click
+        return;
+
+    const auto [x, y] = self->worldToGridPosition(self->m_lastWorldPos);
+    const int column = static_cast<int>(std::floor(x));
+    const int row = static_cast<int>(std::floor(y));
+    if (row < 0 || row >= self->settingParameter->numberOfRowsY || column < 0 || column >= self->settingParameter->numberOfColumnX)
+        return;
+    emit self->cellProbeRequested(row, column);
 }
 
 void SceneWidget::cameraCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData)
@@ -527,12 +879,19 @@ void SceneWidget::mouseCallbackFunction(vtkObject* caller, long unsigned int eve
 
 void SceneWidget::renderVtkScene()
 {
-    sceneWidgetVisualizerProxy->readStepsOffsetsForAllNodesFromFiles(settingParameter->nNodeX,
-                                                                     settingParameter->nNodeY,
-                                                                     settingParameter->outputFileName);
+    emit availableStepsReadFromConfigFile(loadStepIndicesInBackground());
+    watchIndexFiles(); // in live follow mode: index files of the new configuration
 
-    emit availableStepsReadFromConfigFile(sceneWidgetVisualizerProxy->availableSteps());
+    {
+        ScopedStartupPhase phase(StartupPhase::FirstStep);
+        drawSceneForCurrentStep();
+    }
+    StartupTimeline::instance().finish(); // the first frame is shown (no-op for configurations opened later)
+    requestStepThumbnails();
+}
 
+void SceneWidget::drawSceneForCurrentStep()
+{
     lines.resize(settingParameter->numberOfLines);
     sceneWidgetVisualizerProxy->readStageStateFromFilesForStep(settingParameter.get(), &lines[0]);
 
@@ -542,6 +901,7 @@ void SceneWidget::renderVtkScene()
                                                                      settingParameter->numberOfRowsY + 1,
                                                                      renderer,
                                                                      actorBuildLine);
+    updateHitIndex();
 
     sceneWidgetVisualizerProxy->getVisualizer().buildStepText(settingParameter->step,
                                                               settingParameter->font_size,
@@ -551,15 +911,15 @@ void SceneWidget::renderVtkScene()
     // Update 2D ruler axes bounds now that data is loaded
     if (currentViewMode == ViewMode::Mode2D)
     {
-        update2DRulerAxesBounds();
-        rulerAxisX->SetVisibility(true);
-        rulerAxisY->SetVisibility(true);
+        set2DRulerAxesVisible(true);
     }
 
     // Render
     renderWindow()->Render();
     interactor()->Initialize();
     interactor()->Enable();
+
+    emit displayedStepChanged(settingParameter->step);
 }
 
 std::array<double, 3> SceneWidget::screenToWorldCoordinates(const QPoint& pos) const
@@ -587,105 +947,53 @@ std::array<double, 3> SceneWidget::screenToWorldCoordinates(const QPoint& pos) c
     return worldPos;
 }
 
-QString SceneWidget::getNodeAtWorldPosition(const std::array<double, 3>& worldPos) const
+std::array<double, 2> SceneWidget::worldToGridPosition(const std::array<double, 3>& worldPos) const
 {
-    if (! settingParameter || ! sceneWidgetVisualizerProxy || ! renderer)
-    {
-        return {};
-    }
+    // rows are drawn bottom-up: the line at row y is at world height numberOfRowsY - y (see Visualizer::writeLinePoints())
+    return { worldPos[0], settingParameter->numberOfRowsY - worldPos[1] };
+}
 
-    // Get the bounds of the entire scene
-    double* bounds = renderer->ComputeVisiblePropBounds();
-    if (! bounds)
+QString SceneWidget::getNodeAtWorldPosition(const std::array<double, 3>& worldPos) const
+{
+    if (! settingParameter || ! sceneWidgetVisualizerProxy)
     {
         return {};
     }
 
-    // Check if the position is within the scene bounds
-    if (worldPos[0] < bounds[0] || worldPos[0] > bounds[1] ||
-        worldPos[1] < bounds[2] || worldPos[1] > bounds[3])
+    const auto [x, y] = worldToGridPosition(worldPos);
+    const auto node = hitIndex.nodeAt(x, y);
+    if (! node)
     {
-        return {}; // Outside scene bounds
+        return {}; // Outside node grid
     }
 
-    // Calculate the width and height of each node's area in world coordinates
-    const double sceneWidth = bounds[1] - bounds[0];
-    const double sceneHeight = bounds[3] - bounds[2];
-
-    const double nodeWidth = sceneWidth / settingParameter->nNodeX;
-    const double nodeHeight = sceneHeight / settingParameter->nNodeY;
-
-    // Calculate which node the position is in (0-based indices)
-    const int nodeX = (worldPos[0] - bounds[0]) / nodeWidth;
-    const int nodeY = (worldPos[1] - bounds[2]) / nodeHeight;
-
-    // Check if the calculated node is within bounds
-    if (nodeX >= 0 && nodeX < settingParameter->nNodeX &&
-        nodeY >= 0 && nodeY < settingParameter->nNodeY)
+    QString nodeInfo = QString("Node %1 [%2, %3]: columns %4-%5, rows %6-%7")
+                           .arg(node->node)
+                           .arg(node->nodeX)
+                           .arg(node->nodeY)
+                           .arg(node->left)
+                           .arg(node->right - 1)
+                           .arg(node->top)
+                           .arg(node->bottom - 1);
+
+    const int column = static_cast<int>(std::floor(x));
+    const int row = static_cast<int>(std::floor(y));
+    if (const auto cellText = sceneWidgetVisualizerProxy->displayedCellText(row, column); ! cellText.empty())
     {
-        return QString("Node [%1, %2]").arg(nodeX).arg(nodeY);
+        nodeInfo += QString("\nCell [column %1, row %2]: %3").arg(column).arg(row).arg(QString::fromStdString(cellText));
     }
-
-    return {}; // Outside node grid
+    return nodeInfo;
 }
 
-const Line* SceneWidget::findNearestLine(const std::array<double, 3>& worldPos, size_t& lineIndex, double& distanceSquared) const
+std::optional<NodeHitIndex::LineHit> SceneWidget::findNearestLine(const std::array<double, 3>& worldPos) const
 {
     if (! settingParameter || ! sceneWidgetVisualizerProxy)
     {
-        return nullptr;
+        return std::nullopt;
     }
 
-    // const auto& lines = sceneWidgetVisualizerProxy->getVisualizer().getLines();
-    if (lines.empty())
-    {
-        return nullptr;
-    }
-
-    constexpr double threshold = 2; // Threshold for line selection (in world coordinates)
-    constexpr double thresholdSq = threshold * threshold;
-
-    const Line* nearestLine = nullptr;
-    double minDistanceSq = std::numeric_limits<double>::max();
-    size_t foundIndex = 0;
-
-    for (size_t i = 0; i < lines.size(); ++i)
-    {
-        const auto& line = lines[i];
-
-        // Calculate squared distance from point to line segment
-        const double lineLengthSq = (line.x2 - line.x1) * (line.x2 - line.x1) +
-                                   (line.y2 - line.y1) * (line.y2 - line.y1);
-
-        if (lineLengthSq < 1e-10) // Skip zero-length lines
-            continue;
-
-        const double t = std::max(0.0, std::min(1.0,
-            ((worldPos[0] - line.x1) * (line.x2 - line.x1) +
-             (worldPos[1] - line.y1) * (line.y2 - line.y1)) / lineLengthSq));
-
-        const double projX = line.x1 + t * (line.x2 - line.x1);
-        const double projY = line.y1 + t * (line.y2 - line.y1);
-
-        const double dx = worldPos[0] - projX;
-        const double dy = worldPos[1] - projY;
-        const double distSq = dx * dx + dy * dy;
-
-        if (distSq < minDistanceSq && distSq <= thresholdSq)
-        {
-            minDistanceSq = distSq;
-            nearestLine = &line;
-            foundIndex = i;
-        }
-    }
-
-    if (nearestLine)
-    {
-        lineIndex = foundIndex;
-        distanceSquared = minDistanceSq;
-    }
-
-    return nearestLine;
+    const auto [x, y] = worldToGridPosition(worldPos);
+    return hitIndex.nearestLine(x, y);
 }
 
 void SceneWidget::updateToolTip(const QPoint& lastMousePos)
@@ -697,22 +1005,20 @@ void SceneWidget::updateToolTip(const QPoint& lastMousePos)
     // m_lastWorldPos is set by the VTK callback (picker or DisplayToWorld fallback)
 
     // Check if we're over a line
-    size_t lineIndex = 0;
-    double distanceSq = 0.0;
-    const Line* nearestLine = findNearestLine(m_lastWorldPos, lineIndex, distanceSq);
+    const auto nearestLine = findNearestLine(m_lastWorldPos);
 
     // Prepare tooltip text
     QString tooltipText;
 
     if (nearestLine)
     {
-        tooltipText += QString("Line %1/%2:").arg(lineIndex).arg(lines.size());
+        tooltipText += QString("Line %1/%2:").arg(nearestLine->index).arg(hitIndex.linesCount());
         tooltipText += QString("\n  From: (x1=%1, y1=%2)")
-                           .arg(nearestLine->x1, 0, 'f', 2)
-                           .arg(nearestLine->y1, 0, 'f', 2);
+                           .arg(nearestLine->line->x1, 0, 'f', 2)
+                           .arg(nearestLine->line->y1, 0, 'f', 2);
         tooltipText += QString("\n  To:   (x2=%1, y2=%2)")
-                           .arg(nearestLine->x2, 0, 'f', 2)
-                           .arg(nearestLine->y2, 0, 'f', 2);
+                           .arg(nearestLine->line->x2, 0, 'f', 2)
+                           .arg(nearestLine->line->y2, 0, 'f', 2);
     }
     else if (QString nodeInfo = getNodeAtWorldPosition(m_lastWorldPos); ! nodeInfo.isEmpty())
     {
@@ -733,16 +1039,339 @@ void SceneWidget::updateToolTip(const QPoint& lastMousePos)
 
 void SceneWidget::selectedStepParameter(StepIndex stepNumber)
 {
+    cancelAsyncStepLoad(); // the step read now must not be replaced by an older asynchronous one
     settingParameter->step = stepNumber;
     settingParameter->changed = true;
     upgradeModelInCentralPanel();
 }
 
+void SceneWidget::requestStepAsync(StepIndex stepNumber)
+{
+    settingParameter->step = stepNumber;
+    settingParameter->changed = true;
+
+    if (loadingStepIndices) // postponed step is shown when the indices are loaded
+        return;
+    if (requestedStep == stepNumber) // e.g. keyboard step change followed by the slider update
+        return;
+
+    requestedStep = stepNumber;
+    sceneWidgetVisualizerProxy->requestStepLoad(settingParameter.get(),
+                                                [this](StepIndex loadedStep, std::exception_ptr error)
+                                                {
+                                                    // called from the loading thread: VTK is updated in the GUI thread
+                                                    QMetaObject::invokeMethod(
+                                                        this,
+                                                        [this, loadedStep, error]
+                                                        {
+                                                            onAsyncStepLoaded(loadedStep, error);
+                                                        },
+                                                        Qt::QueuedConnection);
+                                                });
+}
+
+void SceneWidget::cancelAsyncStepLoad()
+{
+    requestedStep.reset();
+    if (sceneWidgetVisualizerProxy)
+        sceneWidgetVisualizerProxy->cancelStepLoad();
+}
+
+void SceneWidget::onAsyncStepLoaded(StepIndex loadedStep, std::exception_ptr error)
+{
+    if (requestedStep != loadedStep) // superseded meanwhile, a newer result will come
+        return;
+    requestedStep.reset();
+
+    if (loadedStep != settingParameter->step)
+        return;
+
+    if (error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error occurred: " << e.what() << std::endl;
+            emit stepLoadFailed(loadedStep, QString::fromUtf8(e.what()));
+        }
+        return;
+    }
+
+    lines.resize(settingParameter->numberOfLines);
+    if (! sceneWidgetVisualizerProxy->showLoadedStep(loadedStep, lines.data()))
+        return;
+
+    shownAggregationDescription.clear();
+    refreshVisualizationOfDisplayedStep();
+    triggerRenderUpdate();
+    settingParameter->changed = false;
+}
+
+void SceneWidget::requestStepAggregation(const TemporalAggregationRequest& request)
+{
+    if (loadingStepIndices)
+        throw std::runtime_error("Steps cannot be aggregated while step indices are being loaded");
+
+    const auto aggregation = ++requestedAggregation;
+    const auto description = QString::fromStdString(request.description());
+    sceneWidgetVisualizerProxy->requestStepAggregation(
+        settingParameter.get(),
+        request,
+        [this, aggregation](std::size_t aggregatedSteps, std::size_t totalSteps)
+        {
+            // called from the aggregating threads: signals are emitted in the GUI thread
+            QMetaObject::invokeMethod(
+                this,
+                [this, aggregation, aggregatedSteps, totalSteps]
+                {
+                    if (aggregation == requestedAggregation)
+                        emit stepAggregationProgress(static_cast<int>(aggregatedSteps), static_cast<int>(totalSteps));
+                },
+                Qt::QueuedConnection);
+        },
+        [this, aggregation, description](std::exception_ptr error)
+        {
+            QMetaObject::invokeMethod(
+                this,
+                [this, aggregation, description, error]
+                {
+                    onStepAggregationFinished(aggregation, description, error);
+                },
+                Qt::QueuedConnection);
+        });
+}
+
+void SceneWidget::cancelStepAggregation()
+{
+    ++requestedAggregation;
+    if (sceneWidgetVisualizerProxy)
+        sceneWidgetVisualizerProxy->cancelStepAggregation();
+}
+
+void SceneWidget::onStepAggregationFinished(unsigned aggregation, const QString& description, std::exception_ptr error)
+{
+    if (aggregation != requestedAggregation) // stopped or superseded meanwhile
+        return;
+
+    if (error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error occurred: " << e.what() << std::endl;
+            emit stepAggregationFailed(QString::fromUtf8(e.what()));
+        }
+        return;
+    }
+
+    cancelAsyncStepLoad(); // an older step must not replace the aggregated values
+    lines.resize(settingParameter->numberOfLines);
+    if (! sceneWidgetVisualizerProxy->showAggregatedStep(lines.data()))
+        return;
+
+    shownAggregationDescription = description;
+    refreshVisualizationOfDisplayedStep();
+    triggerRenderUpdate();
+    emit stepAggregationFinished(description);
+}
+
+void SceneWidget::requestCellProbe(const CellProbeRequest& request)
+{
+    if (loadingStepIndices)
+        throw std::runtime_error("Cells cannot be probed while step indices are being loaded");
+
+    const auto probe = ++requestedCellProbe;
+    sceneWidgetVisualizerProxy->requestCellProbe(
+        settingParameter.get(),
+        request,
+        [this, probe](std::shared_ptr<const CellProbeSeries> series, std::exception_ptr error)
+        {
+            // called from the probing thread: signals are emitted in the GUI thread
+            QMetaObject::invokeMethod(
+                this,
+                [this, probe, series = std::move(series), error]
+                {
+                    onCellProbeFinished(probe, series, error);
+                },
+                Qt::QueuedConnection);
+        });
+}
+
+void SceneWidget::cancelCellProbe()
+{
+    ++requestedCellProbe;
+    if (sceneWidgetVisualizerProxy)
+        sceneWidgetVisualizerProxy->cancelCellProbe();
+}
+
+void SceneWidget::onCellProbeFinished(unsigned probe, std::shared_ptr<const CellProbeSeries> series, std::exception_ptr error)
+{
+    if (probe != requestedCellProbe) // stopped or superseded meanwhile
+        return;
+
+    if (error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error occurred: " << e.what() << std::endl;
+            emit cellProbeFailed(QString::fromUtf8(e.what()));
+        }
+        return;
+    }
+    emit cellProbeFinished(std::move(series));
+}
+
+void SceneWidget::prefetchPlaybackSteps(std::vector<StepIndex> steps)
+{
+    if (0 == settingParameter->prefetchSteps || loadingStepIndices)
+        return;
+
+    if (steps.size() > settingParameter->prefetchSteps)
+        steps.resize(settingParameter->prefetchSteps);
+    sceneWidgetVisualizerProxy->reschedulePrefetch(settingParameter.get(), steps);
+}
+
+bool SceneWidget::isStepDecoded(StepIndex step) const
+{
+    return sceneWidgetVisualizerProxy->isStepDecoded(step, *settingParameter);
+}
+
+std::chrono::nanoseconds SceneWidget::averageStepDecodeTime() const
+{
+    return sceneWidgetVisualizerProxy->averageStepDecodeTime();
+}
+
+VideoExporter::DecodeStepCallback SceneWidget::stepFrameDecoder() const
+{
+    auto stageParameters = *settingParameter;
+    stageParameters.regionOfInterest.reset(); // frames show the whole grid
+
+    return [visualizer = sceneWidgetVisualizerProxy.get(), stageParameters](StepIndex step, std::stop_token stopToken) mutable
+    {
+        std::vector<StepIndex> stepsToPrefetch;
+        for (StepIndex ahead = 1; ahead <= stageParameters.prefetchSteps && step + ahead <= stageParameters.nsteps; ++ahead)
+            stepsToPrefetch.push_back(step + ahead);
+        visualizer->prefetchSteps(&stageParameters, stepsToPrefetch);
+
+        stageParameters.step = step;
+        return visualizer->decodeStepFrame(stageParameters, stopToken);
+    };
+}
+
+void SceneWidget::setStepThumbnailsEnabled(bool enabled)
+{
+    if (enabled == stepThumbnailsEnabled)
+        return;
+
+    stepThumbnailsEnabled = enabled;
+    if (enabled)
+        requestStepThumbnails();
+    else
+        clearStepThumbnails();
+}
+
+void SceneWidget::clearStepThumbnails()
+{
+    ++requestedThumbnails;
+    if (sceneWidgetVisualizerProxy)
+        sceneWidgetVisualizerProxy->cancelThumbnailFrames();
+
+    thumbnails = {};
+    emit stepThumbnailsChanged(0, 0);
+}
+
+void SceneWidget::requestStepThumbnails()
+{
+    clearStepThumbnails();
+    if (! stepThumbnailsEnabled || linkedView || loadingStepIndices || settingParameter->outputFileName.empty())
+        return;
+
+    const auto steps = StepThumbnails::sampledSteps(sceneWidgetVisualizerProxy->availableSteps());
+    if (steps.empty())
+        return;
+
+    FrameColors frameColors; // the colour ramp is taken now, in the GUI thread
+    const auto cacheFileName = StepThumbnails::cacheFileName(settingParameter->outputFileName);
+    const auto coloringDescription = std::format("{} {}x{} color_substate={} lod_reduction={} {}",
+                                                 currentModelName,
+                                                 settingParameter->numberOfColumnX,
+                                                 settingParameter->numberOfRowsY,
+                                                 settingParameter->colorSubstate,
+                                                 settingParameter->lodReduction,
+                                                 frameColors.description());
+    const auto cacheKey = StepThumbnails::cacheKey(settingParameter->outputFileName, coloringDescription);
+    if (cacheKey)
+    {
+        if (auto cachedThumbnails = StepThumbnails::loadCacheFile(cacheFileName, *cacheKey))
+        {
+            thumbnails = std::move(*cachedThumbnails);
+            emit stepThumbnailsChanged(static_cast<int>(thumbnails.size()), static_cast<int>(thumbnails.size()));
+            return;
+        }
+    }
+
+    const auto pass = requestedThumbnails;
+    const auto totalThumbnails = static_cast<int>(steps.size());
+    auto builtThumbnails = std::make_shared<StepThumbnails>(); // owned by the pass, written into the file when it ends
+    sceneWidgetVisualizerProxy->requestThumbnailFrames(
+        settingParameter.get(),
+        steps,
+        StepThumbnails::MAX_SIZE,
+        [this, pass, totalThumbnails, builtThumbnails, frameColors](StepFrame frame) mutable
+        {
+            // called from the thumbnail thread: the thumbnail is made there, the GUI thread only stores it
+            auto thumbnail = StepThumbnails::thumbnailOf(frame, frameColors);
+            builtThumbnails->insert(frame.step, thumbnail);
+            QMetaObject::invokeMethod(
+                this,
+                [this, pass, totalThumbnails, step = frame.step, thumbnail = std::move(thumbnail)]
+                {
+                    if (pass != requestedThumbnails) // cleared or requested again meanwhile
+                        return;
+                    thumbnails.insert(step, thumbnail);
+                    emit stepThumbnailsChanged(static_cast<int>(thumbnails.size()), totalThumbnails);
+                },
+                Qt::QueuedConnection);
+        },
+        [builtThumbnails, cacheFileName, cacheKey](std::exception_ptr error)
+        {
+            if (error)
+            {
+                try
+                {
+                    std::rethrow_exception(error);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Warning: thumbnails of steps were not built: " << e.what() << std::endl;
+                }
+                return;
+            }
+            if (cacheKey && ! builtThumbnails->writeCacheFile(cacheFileName, *cacheKey))
+            {
+                std::cerr << std::format("Warning: can't write thumbnails cache '{}', the thumbnails will be built again next time", cacheFileName)
+                          << std::endl;
+            }
+        });
+}
+
 void SceneWidget::upgradeModelInCentralPanel()
 {
-    if (! settingParameter->changed)
+    if (! settingParameter->changed || loadingStepIndices) // postponed step is shown when the indices are loaded
         return;
 
+    requestedStep.reset(); // the current step is read right now
+
     try
     {
         loadAndUpdateVisualizationForCurrentStep();
@@ -784,12 +1413,15 @@ void SceneWidget::switchModel(const std::string& modelName)
         }
     }
 
-    // Create new visualizer with the selected model
+    // Create new visualizer with the selected model (destroying the old one waits for its background reading)
+    requestedStep.reset();
+    clearStepThumbnails(); // colours of the other model
     sceneWidgetVisualizerProxy = SceneWidgetVisualizerFactory::create(modelName);
     currentModelName = modelName;
 
     // Reinitialize the matrix with current dimensions
     sceneWidgetVisualizerProxy->initMatrix(settingParameter->numberOfColumnX, settingParameter->numberOfRowsY);
+    applyStepCacheSettings();
 
     std::cout << "Switched to model: " << sceneWidgetVisualizerProxy->getModelName() << std::endl;
 }
@@ -804,16 +1436,14 @@ void SceneWidget::reloadData()
         // Reinitialize stage with current node configuration using helper
         prepareStageWithCurrentNodeConfiguration();
 
-        // Load step offsets from files
-        sceneWidgetVisualizerProxy->readStepsOffsetsForAllNodesFromFiles(
-            settingParameter->nNodeX,
-            settingParameter->nNodeY,
-            settingParameter->outputFileName
-        );
+        // Load step offsets from files (the steps are only validated, the list of steps is not changed by reloading)
+        loadStepIndicesInBackground();
+        watchIndexFiles();
 
         // Force a full refresh
         settingParameter->changed = true;
         upgradeModelInCentralPanel();
+        requestStepThumbnails();
     }
     catch (const std::exception& e)
     {
@@ -822,17 +1452,192 @@ void SceneWidget::reloadData()
     }
 }
 
+void SceneWidget::setLiveFollowEnabled(bool enabled)
+{
+    if (enabled == isLiveFollowEnabled())
+        return;
+
+    if (! enabled)
+    {
+        delete indexFilesWatcher; // deletes also its timers
+        indexFilesWatcher = nullptr;
+        return;
+    }
+
+    indexFilesWatcher = new QFileSystemWatcher(this);
+
+    auto* updateDelayTimer = new QTimer(indexFilesWatcher);
+    updateDelayTimer->setSingleShot(true);
+    updateDelayTimer->setInterval(LIVE_FOLLOW_UPDATE_DELAY_MS);
+    connect(indexFilesWatcher, &QFileSystemWatcher::fileChanged, updateDelayTimer, qOverload<>(&QTimer::start));
+    connect(updateDelayTimer, &QTimer::timeout, this, &SceneWidget::appendNewStepsFromIndexFiles);
+
+    auto* pollTimer = new QTimer(indexFilesWatcher);
+    pollTimer->setInterval(LIVE_FOLLOW_POLL_INTERVAL_MS);
+    connect(pollTimer, &QTimer::timeout, this, &SceneWidget::appendNewStepsFromIndexFiles);
+    pollTimer->start();
+
+    watchIndexFiles();
+    appendNewStepsFromIndexFiles(); // steps written since the indices were loaded
+}
+
+void SceneWidget::watchIndexFiles()
+{
+    if (! indexFilesWatcher)
+        return;
+
+    QStringList indexFiles;
+    const auto totalNodes = settingParameter->nNodeX * settingParameter->nNodeY;
+    const bool hasIndexFiles = ! settingParameter->outputFileName.empty() && settingParameter->readMode != "container";
+    for (NodeIndex node = 0; node < totalNodes && hasIndexFiles; ++node)
+    {
+        indexFiles << QString::fromStdString(ReaderHelpers::giveMeFileNameIndex(settingParameter->outputFileName, node));
+    }
+
+    const auto watchedFiles = indexFilesWatcher->files();
+    QStringList filesToRemove;
+    for (const auto& watchedFile : watchedFiles)
+    {
+        if (! indexFiles.contains(watchedFile))
+            filesToRemove << watchedFile;
+    }
+    if (! filesToRemove.isEmpty())
+        indexFilesWatcher->removePaths(filesToRemove);
+
+    // a file replaced by rename is not watched any more, so missing files are added every time
+    indexFiles.removeIf(
+        [&watchedFiles](const QString& indexFile)
+        {
+            return watchedFiles.contains(indexFile);
+        });
+    if (! indexFiles.isEmpty())
+        indexFilesWatcher->addPaths(indexFiles);
+}
+
+void SceneWidget::appendNewStepsFromIndexFiles()
+{
+    if (loadingStepIndices) // the whole indices are being read, nothing to append to
+        return;
+
+    try
+    {
+        const auto appended = sceneWidgetVisualizerProxy->appendStepsOffsetsForAllNodesFromFiles(settingParameter->outputFileName);
+        watchIndexFiles();
+
+        resumeAfterStepIndexAppended(appended.reloaded);
+        emit stepIndexAppended(appended.reloaded); // the linked views were stopped too
+
+        if (0 == appended.appendedEntries && ! appended.reloaded)
+            return;
+
+        emit newStepsAvailable(sceneWidgetVisualizerProxy->stepsInAllNodes());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Warning: following index files failed: " << e.what() << std::endl;
+        emit stepIndexAppended(false); // the linked views may have been stopped before the failure
+    }
+}
+
+void SceneWidget::onStepIndexOfOwnerAppended(bool reloaded)
+{
+    try
+    {
+        resumeAfterStepIndexAppended(reloaded);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Warning: the linked view can't show the step again: " << e.what() << std::endl;
+    }
+}
+
+void SceneWidget::resumeAfterStepIndexAppended(bool reloaded)
+{
+    if (requestedStep) // the asynchronous load was stopped by appending, it is requested again
+    {
+        const auto stepToLoad = *requestedStep;
+        requestedStep.reset();
+        if (! reloaded) // when reloaded the current step is read below
+            requestStepAsync(stepToLoad);
+    }
+
+    if (reloaded) // the simulation was started again, the shown step may have new data
+    {
+        settingParameter->changed = true;
+        upgradeModelInCentralPanel();
+    }
+}
+
+std::vector<StepIndex> SceneWidget::loadStepIndicesInBackground()
+{
+    if (loadingStepIndices)
+        throw std::runtime_error("Step indices are already being loaded");
+
+    ScopedStartupPhase phase(StartupPhase::StepIndices);
+    loadingStepIndices = true;
+    const auto resetLoadingFlag = qScopeGuard(
+        [this]
+        {
+            loadingStepIndices = false;
+        });
+
+    const auto totalNodes = static_cast<int>(settingParameter->nNodeX * settingParameter->nNodeY);
+    QProgressDialog progressDialog(tr("Loading step indices of %1 nodes...").arg(totalNodes), QString(), 0, totalNodes, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(500); // indices loaded from cache do not flash the dialog
+    progressDialog.setValue(0);
+
+    QEventLoop waitingLoop;
+    auto loading = std::async(std::launch::async,
+                              [this, &progressDialog, &waitingLoop]
+                              {
+                                  const auto stopWaiting = qScopeGuard(
+                                      [&waitingLoop]
+                                      {
+                                          QMetaObject::invokeMethod(&waitingLoop, &QEventLoop::quit, Qt::QueuedConnection);
+                                      });
+
+                                  const auto reportProgress = [&progressDialog](std::size_t loadedNodes, std::size_t /*totalNodes*/)
+                                  {
+                                      // called from reader's workers: the dialog is updated in the GUI thread
+                                      QMetaObject::invokeMethod(
+                                          &progressDialog,
+                                          [&progressDialog, loadedNodes]
+                                          {
+                                              progressDialog.setValue(std::max(progressDialog.value(), static_cast<int>(loadedNodes)));
+                                          },
+                                          Qt::QueuedConnection);
+                                  };
+
+                                  sceneWidgetVisualizerProxy->readStepsOffsetsForAllNodesFromFiles(settingParameter->nNodeX,
+                                                                                                   settingParameter->nNodeY,
+                                                                                                   settingParameter->outputFileName,
+                                                                                                   settingParameter->readMode,
+                                                                                                   reportProgress,
+                                                                                                   settingParameter->step);
+                                  return sceneWidgetVisualizerProxy->availableSteps();
+                              });
+
+    waitingLoop.exec(); // GUI events are processed until the loading ends
+
+    return loading.get(); // rethrows exception of the loading
+}
+
 void SceneWidget::clearScene()
 {
     // Clear the renderer
     renderer->RemoveAllViewProps();
+    if (timingOverlayActor) // the overlay stays shown for the next configuration
+        renderer->AddActor2D(timingOverlayActor);
 
     // Clear stage data
+    clearStepThumbnails();
     sceneWidgetVisualizerProxy->clearStage();
 
     // Reset VTK actors
     gridActor = vtkSmartPointer<vtkActor>::New();
     actorBuildLine = vtkSmartPointer<vtkActor2D>::New();
+    hitIndex.clear();
 }
 
 void SceneWidget::loadNewConfiguration(const std::string& configFileName, int stepNumber)
@@ -863,6 +1668,10 @@ void SceneWidget::onColorsReloadRequested()
     refreshBackgroundColorFromSettings();
     refreshStepNumberTextColorFromSettings();
     refreshGridColorFromSettings();
+    if (sceneWidgetVisualizerProxy) // colours of raw values are changed on the GPU only
+        sceneWidgetVisualizerProxy->getVisualizer().applyScalarColorMap(gridActor);
+    if (! settingParameter->colorSubstate.empty()) // thumbnails of raw values have colours of the old ramp
+        requestStepThumbnails();
 }
 void SceneWidget::refreshBackgroundColorFromSettings()
 {
@@ -878,6 +1687,7 @@ void SceneWidget::refreshStepNumberTextColorFromSettings()
     auto realTextProp = singleLineTextStep->GetTextProperty();
     realTextProp->SetColor(toVtkColor(color).GetData());
     realTextProp->Modified();
+    timingOverlayText->GetTextProperty()->SetColor(toVtkColor(color).GetData());
 
     triggerRenderUpdate();
 }
@@ -920,15 +1730,12 @@ void SceneWidget::setViewMode2D()
     renderer->ComputeVisiblePropBounds(bounds);
     if (bounds[0] < bounds[1] && bounds[2] < bounds[3] && std::isfinite(bounds[0]) && std::isfinite(bounds[1]))
     {
-        update2DRulerAxesBounds();
-        rulerAxisX->SetVisibility(true);
-        rulerAxisY->SetVisibility(true);
+        set2DRulerAxesVisible(true);
     }
     else
     {
         // No data yet, keep ruler axes hidden
-        rulerAxisX->SetVisibility(false);
-        rulerAxisY->SetVisibility(false);
+        set2DRulerAxesVisible(false);
     }
 }
 
@@ -947,14 +1754,16 @@ void SceneWidget::setViewMode3D()
     setAxesWidgetVisible(true);
 
     // Hide 2D ruler axes in 3D mode
-    rulerAxisX->SetVisibility(false);
-    rulerAxisY->SetVisibility(false);
+    set2DRulerAxesVisible(false);
 
     std::cout << "Switched to 3D view mode" << std::endl;
 }
 
 void SceneWidget::setAxesWidgetVisible(bool visible)
 {
+    if (visible && ! axesWidget)
+        setupAxesWidget();
+
     if (axesWidget)
     {
         axesWidget->SetEnabled(visible);
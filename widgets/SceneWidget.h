@@ -4,13 +4,23 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+
+#include <QFileSystemWatcher>
 #include <QMouseEvent>
+#include <QPointer>
 #include <QTimer>
 #include <QToolTip>
 
 #include <QVTKOpenGLNativeWidget.h>
+#include <vtkActor2D.h>
 #include <vtkAxesActor.h>
 #include <vtkAxisActor2D.h>
+#include <vtkCamera.h>
 #include <vtkDataSet.h>
 #include <vtkNamedColors.h>
 #include <vtkOrientationMarkerWidget.h>
@@ -18,7 +28,12 @@
 #include <vtkSmartPointer.h>
 #include <vtkTextMapper.h>
 
+#include "utilities/StepLayout.h" // CellRegion
 #include "utilities/types.h"
+#include "visualiser/CellProbe.h"
+#include "visualiser/NodeHitIndex.h"
+#include "visualiser/StepThumbnails.h"
+#include "visualiser/VideoExporter.h" // VideoExporter::DecodeStepCallback
 #include "visualiserProxy/ISceneWidgetVisualizer.h"
 #include "visualiserProxy/SceneWidgetVisualizerFactory.h"
 
@@ -54,9 +69,120 @@ public:
      *  @param stepNumber The simulation step to display **/
     void addVisualizer(const std::string& filename, StepIndex stepNumber);
 
-    /// @brief Updates the visualization widget to show the specified step number
+    /** @brief Turns the widget into a linked view of the owner: the same stage coloured by another substate.
+     *
+     * The view shares reading and decoded steps of the owner (see ISceneWidgetVisualizer::createLinkedView()),
+     * so every step is decoded once and this view computes only its own colours. Settings and view mode are
+     * copied from the owner, the cameras of both views are linked (see linkCameraWith()).
+     * The view never changes the stage: it has to be destroyed before the owner loads another configuration,
+     * switches the model or reloads data.
+     * @param owner The widget which loaded the configuration (not a linked view)
+     * @param colorSubstate Substate coloured on the GPU in this view, empty: colours of the model
+     * @throws std::invalid_argument If the owner is a linked view itself */
+    void showLinkedView(SceneWidget& owner, const std::string& colorSubstate);
+
+    /// @brief True for views created by showLinkedView()
+    bool isLinkedView() const
+    {
+        return linkedView;
+    }
+
+    /** @brief Links cameras of both views: moving the camera in one of them moves it also in the other one.
+     *
+     * The cameras are not shared, the other views are updated after each render (if the camera changed). */
+    void linkCameraWith(SceneWidget& other);
+
+    /// @brief Updates the visualization widget to show the specified step number (reads it in the calling thread)
     void selectedStepParameter(StepIndex stepNumber);
 
+    /** @brief Starts reading the step in background, the widget is updated when it is read.
+     *
+     * Used for interactive step changes (slider, keyboard): a newer request stops the running one,
+     * so only the last requested step is shown and the GUI does not wait for the files.
+     * When reading fails stepLoadFailed() is emitted. */
+    void requestStepAsync(StepIndex stepNumber);
+
+    /** @brief Starts aggregating a substate over a range of steps in background (see TemporalAggregator).
+     *
+     * The GUI stays usable meanwhile, stepAggregationProgress() reports aggregated steps. The result is shown
+     * as a synthetic step instead of the displayed one (until another step is shown) and stepAggregationFinished()
+     * is emitted; when aggregation fails stepAggregationFailed() is emitted. A newer request stops the running one.
+     * @throws std::runtime_error If step indices are being loaded */
+    void requestStepAggregation(const TemporalAggregationRequest& request);
+
+    /// @brief Stops the running aggregation, its result will not be shown
+    void cancelStepAggregation();
+
+    /** @brief Starts reading a substate of a cell (or of a window around it) over a range of steps in background (see CellProber).
+     *
+     * Only the rows of the window are read in every step, the displayed step is not changed. When finished
+     * cellProbeFinished() is emitted, when probing fails cellProbeFailed(). A newer request stops the running one.
+     * @throws std::runtime_error If step indices are being loaded */
+    void requestCellProbe(const CellProbeRequest& request);
+
+    /// @brief Stops the running cell probe, its result will not be reported
+    void cancelCellProbe();
+
+    /// @brief Description of the shown aggregation (see TemporalAggregationRequest::description()), empty when a step is shown
+    const QString& shownAggregation() const
+    {
+        return shownAggregationDescription;
+    }
+
+    /** @brief Decodes the steps chosen by the playback (see PlaybackScheduler) in background, at most `prefetch_steps` of them.
+     *  Scheduled steps which are not in the list any more are dropped, unless their decoding has started. */
+    void prefetchPlaybackSteps(std::vector<StepIndex> steps);
+
+    /// @brief Whether the step is decoded for the visible part of the grid, so showing it does not read files
+    bool isStepDecoded(StepIndex step) const;
+
+    /// @brief Recent average time of decoding one step in background (zero when not known yet)
+    std::chrono::nanoseconds averageStepDecodeTime() const;
+
+    /** @brief Returns function decoding steps of the current stage for video export (see VideoExporter).
+     *
+     * The function can be called from any thread, it does not change the displayed step.
+     * It also prefetches `prefetch_steps` following steps, so reading overlaps with rendering.
+     * Steps are always decoded whole, regardless of the visible part of the grid. */
+    VideoExporter::DecodeStepCallback stepFrameDecoder() const;
+
+    /** @brief Enables or disables thumbnails of steps (previews of the step slider), enabled by default.
+     *
+     * When enabled, thumbnails of sampled steps (see StepThumbnails) are loaded from the file next to the output,
+     * or built by a background pass of the lowest priority after the step indices are loaded.
+     * stepThumbnailsChanged() is emitted as they come. Disabling stops the pass and drops the thumbnails. */
+    void setStepThumbnailsEnabled(bool enabled);
+
+    /// @brief Thumbnails of steps built or loaded so far
+    const StepThumbnails& stepThumbnails() const
+    {
+        return thumbnails;
+    }
+
+    /** @brief Enables or disables following output of a simulation which is still running.
+     *
+     * Index files of all nodes are watched (QFileSystemWatcher, plus periodic polling for network
+     * file systems which do not report changes). Only the lines appended since the last read are
+     * parsed, then newStepsAvailable() is emitted. */
+    void setLiveFollowEnabled(bool enabled);
+
+    bool isLiveFollowEnabled() const
+    {
+        return indexFilesWatcher != nullptr;
+    }
+
+    /// @brief Returns hits, misses and memory usage of the cache of decoded steps
+    StepCacheStatistics stepCacheStatistics() const
+    {
+        return sceneWidgetVisualizerProxy->stepCacheStatistics();
+    }
+
+    /// @brief Returns reductions of substates of the displayed step, nullptr when none are requested in the config file
+    std::shared_ptr<const StepReductions> displayedStepReductions() const
+    {
+        return sceneWidgetVisualizerProxy->displayedStepReductions();
+    }
+
     /** @brief Switch to a different model by name.
      * 
      * This method allows changing the visualization model at runtime.
@@ -110,6 +236,10 @@ public:
     /// @brief Show or hide the orientation axes widget. If true, shows the axes widget; if false, hides it
     void setAxesWidgetVisible(bool visible);
 
+    /** @brief Shows or hides times of stages of the last frame and the frame rate (see StageProfiler) below the step number.
+     *  Showing enables the profiler, hiding disables it unless a trace is being recorded. */
+    void setTimingOverlayVisible(bool visible);
+
     /// @brief Get the current ViewMode (2D or 3D)
     ViewMode getViewMode() const
     {
@@ -168,6 +298,10 @@ public:
      * @param callData     Additional event-specific data (unused in this implementation). */
     static void mouseCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
 
+    /** @brief Callback function for VTK left button presses: a double-click on a cell emits cellProbeRequested().
+     *  The cell is taken from the world position of the last mouse move (see mouseCallbackFunction()). */
+    static void doubleClickCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
+
     /** @brief Callback function for VTK camera modified events.
      *
      * This function is triggered whenever the camera is modified (e.g., rotated via mouse).
@@ -179,6 +313,19 @@ public:
      * @param callData     Additional event-specific data (unused). */
     static void cameraCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
 
+    /** @brief Callback function for VTK renderer start events (before every render of the scene).
+     *
+     * It chooses level of detail of big grids from the current zoom (see updateLevelOfDetail()),
+     * so zooming, resizing and switching views need no special handling. */
+    static void renderStartCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
+
+    /** @brief Callback function for start and end of rendering of the window: measures the render stage and finishes frames of StageProfiler
+     *  @param eventId vtkCommand::StartEvent or vtkCommand::EndEvent */
+    static void renderWindowTimingCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
+
+    /// @brief Callback of the end of render of views with linked cameras, it postpones syncLinkedCameras() after the render
+    static void renderEndCallbackFunction(vtkObject* caller, long unsigned int eventId, void* clientData, void* callData);
+
 signals:
     /** @brief Signal emitted when step number is changed using keyboard keys (sent from method keypressCallbackFunction)
      *  @param stepNumber The new step number */
@@ -199,6 +346,56 @@ signals:
      * @param elevation Current camera elevation in degrees */
     void cameraOrientationChanged(double azimuth, double elevation);
 
+    /** @brief Signal emitted in live follow mode when the simulation wrote new steps.
+     *  @param availableSteps All steps already written by every node (sorted) */
+    void newStepsAvailable(std::vector<StepIndex> availableSteps);
+
+    /** @brief Signal emitted in live follow mode after lines appended to the index files were read (also when none were).
+     *
+     * Background reading of the linked views was stopped meanwhile (they share the index), see onStepIndexOfOwnerAppended().
+     * @param reloaded The indices were read again from the beginning (the simulation was started again) */
+    void stepIndexAppended(bool reloaded);
+
+    /** @brief Signal emitted when the step requested by requestStepAsync() could not be read.
+     *  @param stepNumber The requested step
+     *  @param message Description of the error */
+    void stepLoadFailed(StepIndex stepNumber, QString message);
+
+    /** @brief Signal emitted when the scene was updated to show another decoded step (or more of its nodes).
+     *  @param stepNumber The displayed step */
+    void displayedStepChanged(StepIndex stepNumber);
+
+    /** @brief Signal emitted while requestStepAggregation() runs, after each aggregated step.
+     *  @param aggregatedSteps Steps added so far
+     *  @param totalSteps Steps of the range written by all nodes */
+    void stepAggregationProgress(int aggregatedSteps, int totalSteps);
+
+    /** @brief Signal emitted when the aggregation requested by requestStepAggregation() is shown.
+     *  @param description Description of the aggregation shown instead of the step number */
+    void stepAggregationFinished(QString description);
+
+    /** @brief Signal emitted when the aggregation requested by requestStepAggregation() failed.
+     *  @param message Description of the error */
+    void stepAggregationFailed(QString message);
+
+    /** @brief Signal emitted when a cell of the grid was double-clicked (to be probed over time).
+     *  @param row Row of the cell, matrix coordinates
+     *  @param column Column of the cell */
+    void cellProbeRequested(int row, int column);
+
+    /** @brief Signal emitted when the probe requested by requestCellProbe() finished.
+     *  @param series Values of the probed substate in the steps of the range */
+    void cellProbeFinished(std::shared_ptr<const CellProbeSeries> series);
+
+    /** @brief Signal emitted when the probe requested by requestCellProbe() failed.
+     *  @param message Description of the error */
+    void cellProbeFailed(QString message);
+
+    /** @brief Signal emitted when thumbnails of steps were added or dropped (see setStepThumbnailsEnabled()).
+     *  @param builtThumbnails Thumbnails available now
+     *  @param totalThumbnails Thumbnails of all sampled steps, when the pass is finished */
+    void stepThumbnailsChanged(int builtThumbnails, int totalThumbnails);
+
 public slots:
     /** @brief Slot called when color settings need to be reloaded (at least one of them was changed)
      *
@@ -207,6 +404,10 @@ public slots:
      * current color settings from the ColorSettings singleton. */
     void onColorsReloadRequested();
 
+    /** @brief Called in a linked view when its owner read appended lines of the shared index (see stepIndexAppended()).
+     *  The stopped asynchronous step load is requested again, after a reload the current step is read again. */
+    void onStepIndexOfOwnerAppended(bool reloaded);
+
 protected:
     /// @brief Renders the VTK scene. It needs to be called when reading from config file
     void renderVtkScene();
@@ -226,17 +427,15 @@ protected:
      *  @return The corresponding world coordinates in VTK space */
     std::array<double, 3> screenToWorldCoordinates(const QPoint& pos) const;
 
-    /** @brief Determines which node the mouse is currently over using VTK coordinates
+    /** @brief Determines which node and cell the mouse is currently over using VTK coordinates
      *  @param worldPos The current position in VTK world coordinates
-     *  @return A string indicating which node the mouse is over, or empty string if not over any node */
+     *  @return The node (with its rectangle) and the value of the cell, or empty string if not over any node */
     QString getNodeAtWorldPosition(const std::array<double, 3>& worldPos) const;
 
-    /** @brief Finds the nearest line to the given world position
+    /** @brief Finds the nearest line to the given world position (see NodeHitIndex::LINE_PICK_DISTANCE)
      *  @param worldPos The position to check
-     *  @param[out] lineIndex Index of the found line in the lines vector
-     *  @param[out] distanceSquared Squared distance to the nearest point on the line
-     *  @return Pointer to the nearest line, or nullptr if no lines exist */
-    const Line* findNearestLine(const std::array<double, 3>& worldPos, size_t& lineIndex, double& distanceSquared) const;
+     *  @return The found line, empty if no line is near */
+    std::optional<NodeHitIndex::LineHit> findNearestLine(const std::array<double, 3>& worldPos) const;
 
     /// @brief Reads settings from a configuration file
     /// @param filename Path to the configuration file
@@ -245,18 +444,44 @@ protected:
     /// @brief Sets up the VTK scene, it is called when reading config file
     void setupVtkScene();
 
-    /// @brief Sets up the orientation axes widget
+    /// @brief Passes step cache, open files and remote agent settings read from config file to the current visualizer
+    void applyStepCacheSettings();
+
+    /// @brief Creates the orientation axes widget (when it is shown for the first time)
     void setupAxesWidget();
 
-    /// @brief Sets up the 2D ruler axes
+    /// @brief Creates the 2D ruler axes and adds them hidden to the renderer (when they are shown for the first time)
     void setup2DRulerAxes();
 
+    /// @brief Shows the 2D ruler axes fitted to the current data (creating them if needed) or hides them
+    void set2DRulerAxesVisible(bool visible);
+
     /// @brief Connects the VTK camera modified callback to track camera changes
     void connectCameraCallback();
 
     /// @brief Updates the 2D ruler axes bounds based on current data
     void update2DRulerAxesBounds();
 
+    /// @brief Connects the renderer start callback choosing the level of detail
+    void connectRenderStartCallback();
+
+    /** @brief Returns how many grid cells fall on one screen pixel around the camera's focal point.
+     *  @return Value below 1 when zoomed in (a cell takes several pixels) */
+    double cellsPerScreenPixel();
+
+    /// @brief Switches the grid to the level of detail fitting the current zoom (texture is updated only when the level changes)
+    void updateLevelOfDetail();
+
+    /** @brief Returns cells of the grid visible in the viewport (2D view only).
+     *  @return Empty when the whole grid is visible or the view is 3D (the camera may look at any part then) */
+    std::optional<CellRegion> visibleCellRegion();
+
+    /** @brief Narrows reading of steps to the nodes around the visible part of the grid.
+     *
+     * When the view moves outside of the region read so far, the current step is loaded again
+     * (asynchronously, only the newly visible nodes are read). */
+    void updateRegionOfInterest();
+
     /** @param configFilename Path to the configuration file and move view to provided step
      *  @param stepNumber Initial step number to display */
     void setupSettingParameters(const std::string& configFilename, StepIndex stepNumber);
@@ -274,6 +499,12 @@ protected:
      * singleton and applies it to any step number text elements in the scene. */
     void refreshStepNumberTextColorFromSettings();
 
+    /// @brief Connects renderWindowTimingCallbackFunction() to the render window
+    void connectRenderTimingCallbacks();
+
+    /// @brief Shows stages of the last finished frame in the timing overlay (when visible)
+    void updateTimingOverlay();
+
     /** @brief Updates the grid color from application settings.
      *
      * This method retrieves the current grid color from the ColorSettings
@@ -301,6 +532,7 @@ protected:
      * The callback captures live mouse movement, converts the VTK event position
      * into Qt widget coordinates, updates the last known world position using
      * a picker or DisplayToWorld transformation, and triggers tooltip updates.
+     * A left button observer (doubleClickCallbackFunction()) reports double-clicked cells.
      *
      * @note Similar to the keyboard callback, SetClientData(this) is used to allow
      *       the static callback function to interact with the SceneWidget instance. */
@@ -326,6 +558,35 @@ protected:
      * number changes or when data needs to be refreshed. */
     void loadAndUpdateVisualizationForCurrentStep();
 
+    /// @brief Refreshes VTK elements (grid, lines, text) from the already read displayed step
+    void refreshVisualizationOfDisplayedStep();
+
+    /// @brief Indexes the lines of the displayed step for the tooltip (nothing is done when they did not change)
+    void updateHitIndex();
+
+    /** @brief Converts VTK world coordinates of the scene to coordinates of the lines and cells
+     *  @return Column (x) and row (y) of the grid, the row 0 is the first row of the output files */
+    std::array<double, 2> worldToGridPosition(const std::array<double, 3>& worldPos) const;
+
+    /// @brief Drops the running asynchronous step load, its result will not be shown
+    void cancelAsyncStepLoad();
+
+    /// @brief Shows the step read by requestStepAsync(), called in the GUI thread (ignores superseded steps)
+    void onAsyncStepLoaded(StepIndex loadedStep, std::exception_ptr error);
+
+    /// @brief Shows the result of requestStepAggregation(), called in the GUI thread (ignores stopped aggregations)
+    void onStepAggregationFinished(unsigned aggregation, const QString& description, std::exception_ptr error);
+
+    /// @brief Reports the result of requestCellProbe(), called in the GUI thread (ignores stopped probes)
+    void onCellProbeFinished(unsigned probe, std::shared_ptr<const CellProbeSeries> series, std::exception_ptr error);
+
+    /** @brief Drops thumbnails of steps and loads them from the file next to the output, or starts building them in background.
+     *  Does nothing when thumbnails are disabled, for linked views and while step indices are being loaded. */
+    void requestStepThumbnails();
+
+    /// @brief Stops building thumbnails of steps and drops them
+    void clearStepThumbnails();
+
     /** @brief Prepare the stage for visualization with current node configuration.
      * 
      * This helper initializes the visualizer stage using the current nNodeX and nNodeY
@@ -333,6 +594,34 @@ protected:
      * reloading data. */
     void prepareStageWithCurrentNodeConfiguration();
 
+    /** @brief Loads step indices of all nodes and checks their consistency in a background thread.
+     *
+     * The window keeps repainting while waiting; a window-modal progress dialog (shown only
+     * for longer loads) reports loaded nodes and blocks user input. Step changes requested
+     * in the meantime (e.g. by the playback timer) are postponed until the load is finished.
+     * @return Steps available in all nodes
+     * @throws std::runtime_error If the indices are already being loaded, or rethrows errors of the loading */
+    std::vector<StepIndex> loadStepIndicesInBackground();
+
+    /// @brief Reads the current step and draws all VTK elements of the scene (the stage has to be prepared)
+    void drawSceneForCurrentStep();
+
+    /// @brief Copies the camera to the views linked by linkCameraWith(), the views whose camera changed are rendered
+    void syncLinkedCameras();
+
+    /** @brief Sets the camera of this view to the same position, orientation and projection as the source.
+     *  @return False when the camera already was the same (nothing changed) */
+    bool copyCameraFrom(vtkCamera& source);
+
+    /// @brief Reads lines appended to the index files (live follow mode) and announces new steps
+    void appendNewStepsFromIndexFiles();
+
+    /// @brief Requests again the step load stopped by reading appended lines of the index, after a reload shows the current step again
+    void resumeAfterStepIndexAppended(bool reloaded);
+
+    /// @brief Makes the watcher watch exactly the index files of the current configuration (also files replaced meanwhile)
+    void watchIndexFiles();
+
 private:
     /** @brief Proxy for the scene widget visualizer
      *  This proxy provides access to the visualizer implementation
@@ -345,6 +634,42 @@ private:
     /// @brief Currently active model name
     std::string currentModelName;
 
+    /// @brief True for a linked view (see showLinkedView()), it shows the stage of another view
+    bool linkedView = false;
+
+    /// @brief Views whose camera follows the camera of this view (see linkCameraWith()), closed views are nullptr
+    std::vector<QPointer<SceneWidget>> cameraLinkedViews;
+
+    /// @brief True when syncLinkedCameras() is already queued
+    bool cameraSyncPending = false;
+
+    /// @brief True while loadStepIndicesInBackground() runs, the stage must not be read then
+    bool loadingStepIndices = false;
+
+    /// @brief Step being read by requestStepAsync(), empty when no asynchronous load is pending
+    std::optional<StepIndex> requestedStep;
+
+    /// @brief Number of the last requestStepAggregation() (or of its cancellation), results of older ones are ignored
+    unsigned requestedAggregation = 0;
+
+    /// @brief Number of the last requestCellProbe() (or of its cancellation), results of older ones are ignored
+    unsigned requestedCellProbe = 0;
+
+    /// @brief Description of the aggregated values shown instead of a step, empty when a read step is shown
+    QString shownAggregationDescription;
+
+    /// @brief Whether thumbnails of steps are built (see setStepThumbnailsEnabled())
+    bool stepThumbnailsEnabled = true;
+
+    /// @brief Number of the last requestStepThumbnails() (or of clearing them), thumbnails of older passes are ignored
+    unsigned requestedThumbnails = 0;
+
+    /// @brief Thumbnails of steps built or loaded so far
+    StepThumbnails thumbnails;
+
+    /// @brief Watcher of index files in live follow mode, nullptr when the mode is off (owned by this widget as Qt parent)
+    QFileSystemWatcher* indexFilesWatcher = nullptr;
+
     /// @brief Current view mode (2D or 3D)
     ViewMode currentViewMode = ViewMode::Mode2D;
 
@@ -372,19 +697,31 @@ private:
     /// @brief Text mapper for step display: This text mapper is responsible for rendering the step number in the scene.
     vtkNew<vtkTextMapper> singleLineTextStep;
 
-    /// @brief Axes actor for showing coordinate system orientation
-    vtkNew<vtkAxesActor> axesActor;
+    /// @brief Text mapper and actor of the timing overlay (see setTimingOverlayVisible()), added to the renderer when first shown
+    vtkNew<vtkTextMapper> timingOverlayText;
+    vtkSmartPointer<vtkActor2D> timingOverlayActor;
+
+    /// @brief Start of the render being measured (see renderWindowTimingCallbackFunction())
+    std::chrono::steady_clock::time_point renderStartTime;
+    std::uint64_t renderStartAllocations = 0; ///< allocations of the GUI thread at renderStartTime (see AllocationCounter)
 
-    /// @brief Orientation marker widget for displaying axes in corner
-    vtkNew<vtkOrientationMarkerWidget> axesWidget;
+    /// @brief Axes actor for showing coordinate system orientation (created with axesWidget)
+    vtkSmartPointer<vtkAxesActor> axesActor;
 
-    /// @brief 2D ruler axes for showing scale in 2D mode (X and Y axes)
-    vtkNew<vtkAxisActor2D> rulerAxisX;
-    vtkNew<vtkAxisActor2D> rulerAxisY;
+    /** @brief Orientation marker widget for displaying axes in corner
+     *  @note: Created by setupAxesWidget() when the 3D mode is entered for the first time, nullptr until then */
+    vtkSmartPointer<vtkOrientationMarkerWidget> axesWidget;
+
+    /// @brief 2D ruler axes for showing scale in 2D mode (X and Y axes), created when first shown (nullptr until then)
+    vtkSmartPointer<vtkAxisActor2D> rulerAxisX;
+    vtkSmartPointer<vtkAxisActor2D> rulerAxisY;
 
     /** @brief Collection of line segments used for visualization.
      *
      * This vector stores all the line segments that are currently being rendered
      * in the scene. Each segment is from different node. */
     std::vector<Line> lines;
+
+    /// @brief Lines and nodes under the cursor for the tooltip, rebuilt only when the lines change (see updateHitIndex())
+    NodeHitIndex hitIndex;
 };
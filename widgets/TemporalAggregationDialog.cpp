@@ -0,0 +1,71 @@
+#include "TemporalAggregationDialog.h"
+
+#include <algorithm> // std::min
+#include <limits>
+#include <utility> // std::to_underlying
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QPushButton>
+#include <QSpinBox>
+
+
+TemporalAggregationDialog::TemporalAggregationDialog(const QStringList& substates, StepIndex lastStep, QWidget* parent)
+    : QDialog(parent)
+    , substateComboBox(new QComboBox(this))
+    , operationComboBox(new QComboBox(this))
+    , firstStepSpinBox(new QSpinBox(this))
+    , lastStepSpinBox(new QSpinBox(this))
+    , thresholdSpinBox(new QDoubleSpinBox(this))
+{
+    setWindowTitle(tr("Aggregate Steps"));
+
+    substateComboBox->addItems(substates);
+
+    const QStringList operationLabels{ tr("Maximum"), tr("Minimum"), tr("Mean"), tr("Step of the maximum"), tr("First step reaching the threshold") };
+    for (const auto operation : temporalOperations())
+        operationComboBox->addItem(operationLabels.value(std::to_underlying(operation)), std::to_underlying(operation));
+
+    const int maximalStep = static_cast<int>(std::min<StepIndex>(lastStep, std::numeric_limits<int>::max()));
+    firstStepSpinBox->setRange(0, maximalStep);
+    lastStepSpinBox->setRange(0, maximalStep);
+    lastStepSpinBox->setValue(maximalStep);
+    // the range is never empty
+    connect(firstStepSpinBox, &QSpinBox::valueChanged, lastStepSpinBox, &QSpinBox::setMinimum);
+    connect(lastStepSpinBox, &QSpinBox::valueChanged, firstStepSpinBox, &QSpinBox::setMaximum);
+
+    thresholdSpinBox->setRange(std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max());
+    thresholdSpinBox->setDecimals(6);
+    connect(operationComboBox, &QComboBox::currentIndexChanged, this, &TemporalAggregationDialog::onOperationChanged);
+    onOperationChanged();
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons->button(QDialogButtonBox::Ok)->setEnabled(! substates.isEmpty());
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* layout = new QFormLayout(this);
+    layout->addRow(tr("Substate:"), substateComboBox);
+    layout->addRow(tr("Operation:"), operationComboBox);
+    layout->addRow(tr("First step:"), firstStepSpinBox);
+    layout->addRow(tr("Last step:"), lastStepSpinBox);
+    layout->addRow(tr("Threshold:"), thresholdSpinBox);
+    layout->addRow(buttons);
+    setLayout(layout);
+}
+
+TemporalAggregationRequest TemporalAggregationDialog::request() const
+{
+    return TemporalAggregationRequest{ .substate = substateComboBox->currentText().toStdString(),
+                                       .operation = static_cast<TemporalOperation>(operationComboBox->currentData().toInt()),
+                                       .firstStep = static_cast<StepIndex>(firstStepSpinBox->value()),
+                                       .lastStep = static_cast<StepIndex>(lastStepSpinBox->value()),
+                                       .threshold = thresholdSpinBox->value() };
+}
+
+void TemporalAggregationDialog::onOperationChanged()
+{
+    const auto operation = static_cast<TemporalOperation>(operationComboBox->currentData().toInt());
+    thresholdSpinBox->setEnabled(TemporalOperation::FirstExceedance == operation);
+}
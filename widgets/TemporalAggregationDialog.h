@@ -0,0 +1,43 @@
+/** @file TemporalAggregationDialog.h
+ * @brief Declaration of the TemporalAggregationDialog class for choosing a temporal aggregation of steps. */
+
+#pragma once
+
+#include <QDialog>
+#include <QStringList>
+
+#include "utilities/types.h"
+#include "visualiser/TemporalAggregation.h"
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+/** @class TemporalAggregationDialog
+ * @brief A dialog choosing the substate, the operation and the range of steps to aggregate (see TemporalAccumulator).
+ *
+ * The threshold can be edited only for the first exceedance, the range always covers at least one step. */
+class TemporalAggregationDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /** @brief Constructs the dialog, the whole run is selected initially.
+     *  @param substates Names of numeric substates of the model (`substates` of the configuration)
+     *  @param lastStep The last step of the run
+     *  @param parent The parent widget */
+    TemporalAggregationDialog(const QStringList& substates, StepIndex lastStep, QWidget* parent = nullptr);
+
+    /// @brief The aggregation chosen in the dialog
+    TemporalAggregationRequest request() const;
+
+private:
+    /// @brief Enables the threshold only for the operation which uses it
+    void onOperationChanged();
+
+    QComboBox* substateComboBox;     ///< Aggregated substate
+    QComboBox* operationComboBox;    ///< Operation, items keep TemporalOperation as data
+    QSpinBox* firstStepSpinBox;      ///< First step of the range
+    QSpinBox* lastStepSpinBox;       ///< Last step of the range (inclusive)
+    QDoubleSpinBox* thresholdSpinBox; ///< Threshold of TemporalOperation::FirstExceedance
+};